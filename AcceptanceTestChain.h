@@ -0,0 +1,141 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef AcceptanceTestChain_H
+#define AcceptanceTestChain_H
+
+// ITK
+#include "itkImageRegion.h"
+
+// STL
+#include <cstddef>
+#include <string>
+#include <tuple>
+#include <type_traits>
+
+// Boost
+#include <boost/signals2/signal.hpp>
+
+// Custom
+#include "Match.h"
+
+/** An instrumentation policy of AcceptanceTestChain that records nothing, so it costs nothing. */
+struct AcceptanceTestNoInstrumentation
+{
+  void TestFailed(const char* const, const float) {}
+};
+
+/** An instrumentation policy of AcceptanceTestChain that reports each failure through signals,
+  * like AcceptanceTestComposite does. */
+struct AcceptanceTestSignalInstrumentation
+{
+  void TestFailed(const char* const testName, const float score)
+  {
+    WhichFailedSignal(std::string(testName) + " failed.");
+    FailedScoreSignal(score);
+  }
+
+  boost::signals2::signal<void (std::string)> WhichFailedSignal;
+  boost::signals2::signal<void (float)> FailedScoreSignal;
+};
+
+namespace Internal
+{
+  /** Determine if the Cost of each test is at most the Cost of the test after it. */
+  template <typename... TTests>
+  struct IsOrderedByCost : std::true_type {};
+
+  template <typename TFirst, typename TSecond, typename... TRest>
+  struct IsOrderedByCost<TFirst, TSecond, TRest...> :
+    std::integral_constant<bool, (TFirst::Cost <= TSecond::Cost) && IsOrderedByCost<TSecond, TRest...>::value> {};
+}
+
+/** Run a fixed sequence of acceptance tests, stopping at the first one that fails. This is the compile
+  * time counterpart of AcceptanceTestComposite: the tests are members rather than pointers, so every
+  * call is resolved (and usually inlined) by the compiler, and a chain of one test costs the same as
+  * calling that test directly.
+  *
+  * A test is any class with
+  *   static const unsigned int Cost;
+  *   static const char* GetName();
+  *   bool IsBetterWithScore(const itk::ImageRegion<2>& queryRegion, const Match& currentMatch,
+  *                          const Match& potentialBetterMatch, float& score);
+  * The tests must be listed from the lowest to the highest Cost, so that the cheap tests reject most
+  * candidates before the expensive ones run. 'TInstrumentation' is told about every failure. */
+template <typename TInstrumentation, typename... TTests>
+class AcceptanceTestChain : public TInstrumentation
+{
+public:
+  static_assert(Internal::IsOrderedByCost<TTests...>::value,
+                "AcceptanceTestChain: the tests must be listed in order of increasing Cost.");
+
+  /** Determine if all of the tests accept 'potentialBetterMatch', accumulating their scores in 'score'. */
+  bool IsBetterWithScore(const itk::ImageRegion<2>& queryRegion, const Match& currentMatch,
+                         const Match& potentialBetterMatch, float& score)
+  {
+    return RunTests<0>(queryRegion, currentMatch, potentialBetterMatch, score);
+  }
+
+  /** Determine if all of the tests accept 'potentialBetterMatch'. */
+  bool IsBetter(const itk::ImageRegion<2>& queryRegion, const Match& currentMatch,
+                const Match& potentialBetterMatch)
+  {
+    float score = 0.0f; // unused
+    return RunTests<0>(queryRegion, currentMatch, potentialBetterMatch, score);
+  }
+
+  /** Get the test at position 'TIndex' of the chain, for example to configure it. */
+  template <size_t TIndex>
+  typename std::tuple_element<TIndex, std::tuple<TTests...> >::type& GetTest()
+  {
+    return std::get<TIndex>(this->Tests);
+  }
+
+  static std::string GetName()
+  {
+    return "AcceptanceTestChain";
+  }
+
+private:
+  std::tuple<TTests...> Tests;
+
+  template <size_t TIndex>
+  typename std::enable_if<TIndex == sizeof...(TTests), bool>::type
+  RunTests(const itk::ImageRegion<2>&, const Match&, const Match&, float&)
+  {
+    return true;
+  }
+
+  template <size_t TIndex>
+  typename std::enable_if<(TIndex < sizeof...(TTests)), bool>::type
+  RunTests(const itk::ImageRegion<2>& queryRegion, const Match& currentMatch,
+           const Match& potentialBetterMatch, float& score)
+  {
+    typedef typename std::tuple_element<TIndex, std::tuple<TTests...> >::type TestType;
+
+    if(!std::get<TIndex>(this->Tests).IsBetterWithScore(queryRegion, currentMatch, potentialBetterMatch, score))
+    {
+      this->TestFailed(TestType::GetName(), score);
+      return false;
+    }
+
+    return RunTests<TIndex + 1>(queryRegion, currentMatch, potentialBetterMatch, score);
+  }
+};
+
+#endif
@@ -19,34 +19,43 @@
 #ifndef AcceptanceTestSSD_H
 #define AcceptanceTestSSD_H
 
+// STL
+#include <cmath>
+
 // Custom
-#include "AcceptanceTest.h"
+#include "Match.h"
 
-class AcceptanceTestSSD : public AcceptanceTest
+/** Accept a match if its score is lower than the score of the current match. Only the stored scores
+  * are compared, so this is the cheapest test and belongs at the front of an AcceptanceTestChain. */
+class AcceptanceTestSSD
 {
 public:
-  virtual bool IsBetterWithScore(const itk::ImageRegion<2>& queryRegion, const Match& currentMatch,
-                        const Match& potentialBetterMatch, float& score)
-  {
-    if(potentialBetterMatch.GetSSDScore() < currentMatch.GetSSDScore())
-    {
-      return true;
-    }
-    else
-    {
-      return false;
-    }
+  static const unsigned int Cost = 0;
 
+  bool IsBetterWithScore(const itk::ImageRegion<2>&, const Match& currentMatch,
+                         const Match& potentialBetterMatch, float& score) const
+  {
     if(this->IncludeInScore)
     {
-      score += fabs(potentialBetterMatch.GetSSDScore() - currentMatch.GetSSDScore());
+      score += std::fabs(potentialBetterMatch.GetScore() - currentMatch.GetScore());
     }
+
+    return potentialBetterMatch.GetScore() < currentMatch.GetScore();
+  }
+
+  /** Set if this test contributes to the score of the chain it is in. */
+  void SetIncludeInScore(const bool includeInScore)
+  {
+    this->IncludeInScore = includeInScore;
   }
 
-  std::string GetName() const
+  static const char* GetName()
   {
     return "AcceptanceTestSSD";
   }
+
+private:
+  bool IncludeInScore = true;
 };
 
 #endif
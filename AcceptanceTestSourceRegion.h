@@ -0,0 +1,69 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef AcceptanceTestSourceRegion_H
+#define AcceptanceTestSourceRegion_H
+
+// ITK
+#include "itkImage.h"
+
+// STL
+#include <cassert>
+
+// Submodules
+#include <ITKHelpers/ITKHelpers.h>
+
+// Custom
+#include "Match.h"
+
+/** Accept a match only if its patch is inside the image and its center is 'true' in the valid patch
+  * centers image. This reads a single pixel, so it should run after the score comparisons. */
+class AcceptanceTestSourceRegion
+{
+public:
+  static const unsigned int Cost = 1;
+
+  bool IsBetterWithScore(const itk::ImageRegion<2>&, const Match&,
+                         const Match& potentialBetterMatch, float&) const
+  {
+    assert(this->ValidPatchCentersImage);
+
+    itk::ImageRegion<2> region = potentialBetterMatch.GetRegion();
+    if(!this->ValidPatchCentersImage->GetLargestPossibleRegion().IsInside(region))
+    {
+      return false;
+    }
+
+    return this->ValidPatchCentersImage->GetPixel(ITKHelpers::GetRegionCenter(region));
+  }
+
+  void SetValidPatchCentersImage(const itk::Image<bool, 2>* const validPatchCentersImage)
+  {
+    this->ValidPatchCentersImage = validPatchCentersImage;
+  }
+
+  static const char* GetName()
+  {
+    return "AcceptanceTestSourceRegion";
+  }
+
+private:
+  const itk::Image<bool, 2>* ValidPatchCentersImage = nullptr;
+};
+
+#endif
@@ -0,0 +1,110 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "Arena.h"
+
+// STL
+#include <algorithm>
+#include <cassert>
+
+void* Arena::Allocate(const size_t numberOfBytes, const size_t alignment)
+{
+  assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+  while(true)
+  {
+    if(this->CurrentChunk < this->Chunks.size())
+    {
+      Chunk& chunk = this->Chunks[this->CurrentChunk];
+
+      // Align the address rather than the offset, since the chunk itself is only aligned for max_align_t
+      const size_t address = reinterpret_cast<size_t>(chunk.Data.get()) + this->Used;
+      const size_t padding = (alignment - address % alignment) % alignment;
+
+      if(this->Used + padding + numberOfBytes <= chunk.Size)
+      {
+        void* memory = chunk.Data.get() + this->Used + padding;
+        this->Used += padding + numberOfBytes;
+        this->PeakUsage = std::max(this->PeakUsage, chunk.Begin + this->Used);
+        return memory;
+      }
+
+      // Move on to the next chunk (the rest of this one is wasted until the next Release() or Reset())
+      if(this->CurrentChunk + 1 < this->Chunks.size())
+      {
+        this->CurrentChunk++;
+        this->Used = 0;
+        continue;
+      }
+    }
+
+    AddChunk(numberOfBytes + alignment);
+    this->CurrentChunk = this->Chunks.size() - 1;
+    this->Used = 0;
+  }
+}
+
+void Arena::Release(const Marker& marker)
+{
+  assert(marker.ChunkId < this->CurrentChunk ||
+         (marker.ChunkId == this->CurrentChunk && marker.Used <= this->Used));
+
+  this->CurrentChunk = marker.ChunkId;
+  this->Used = marker.Used;
+}
+
+void Arena::Reset()
+{
+  if(this->Chunks.size() > 1)
+  {
+    size_t capacity = GetCapacity();
+    this->Chunks.clear();
+    AddChunk(std::max(capacity, this->PeakUsage));
+  }
+
+  this->CurrentChunk = 0;
+  this->Used = 0;
+}
+
+size_t Arena::GetCapacity() const
+{
+  if(this->Chunks.empty())
+  {
+    return 0;
+  }
+
+  return this->Chunks.back().Begin + this->Chunks.back().Size;
+}
+
+void Arena::AddChunk(const size_t minimumSize)
+{
+  // Grow geometrically so that the number of chunks stays logarithmic in the peak usage
+  size_t size = std::max(minimumSize, this->InitialCapacity);
+  if(!this->Chunks.empty())
+  {
+    size = std::max(size, 2 * this->Chunks.back().Size);
+  }
+
+  Chunk chunk;
+  chunk.Data.reset(new char[size]);
+  chunk.Size = size;
+  chunk.Begin = GetCapacity();
+
+  this->Chunks.push_back(std::move(chunk));
+  this->NumberOfChunkAllocations++;
+}
@@ -0,0 +1,183 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef Arena_H
+#define Arena_H
+
+// STL
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/** A bump allocator for the temporary buffers of one iteration. Allocation moves a pointer forward,
+  * individual allocations are never freed, and the whole arena is released at once by Reset() (or back to
+  * a Marker by Release()). The memory is kept between resets, so once the arena has grown to the largest
+  * amount an iteration needs, later iterations do not touch the heap at all.
+  * An arena is not thread safe; each thread that needs temporary buffers should use its own. */
+class Arena
+{
+public:
+  /** A position in the arena that can be returned to with Release(). */
+  class Marker
+  {
+    friend class Arena;
+    size_t ChunkId = 0;
+    size_t Used = 0;
+  };
+
+  /** Release everything allocated from 'arena' during the lifetime of this object. */
+  class Scope
+  {
+  public:
+    Scope(Arena* const arena) : ScopedArena(arena), ScopeMarker(arena->GetMarker()) {}
+
+    ~Scope()
+    {
+      this->ScopedArena->Release(this->ScopeMarker);
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+  private:
+    Arena* ScopedArena;
+    Marker ScopeMarker;
+  };
+
+  Arena(const size_t initialCapacity = 64 * 1024) : InitialCapacity(initialCapacity) {}
+
+  /** Copies start out empty; memory is never shared between arenas. */
+  Arena(const Arena& other) : InitialCapacity(other.InitialCapacity) {}
+
+  Arena& operator=(const Arena& other)
+  {
+    this->InitialCapacity = other.InitialCapacity;
+    Reset();
+    return *this;
+  }
+
+  /** Get 'numberOfBytes' of memory aligned to 'alignment' (which must be a power of two). */
+  void* Allocate(const size_t numberOfBytes, const size_t alignment = alignof(std::max_align_t));
+
+  /** Get the current position, to later release everything allocated after it. */
+  Marker GetMarker() const
+  {
+    Marker marker;
+    marker.ChunkId = this->CurrentChunk;
+    marker.Used = this->Used;
+    return marker;
+  }
+
+  /** Release everything allocated since 'marker' was taken. */
+  void Release(const Marker& marker);
+
+  /** Release everything. If the last round of allocations needed more than one chunk, the chunks are
+    * replaced by a single one large enough for all of them, so that the next round fits without growing. */
+  void Reset();
+
+  /** Get the number of bytes of memory held by the arena. */
+  size_t GetCapacity() const;
+
+  /** Get the largest number of bytes that were in use at once since the arena was created. */
+  size_t GetPeakUsage() const
+  {
+    return this->PeakUsage;
+  }
+
+  /** Get the number of times the arena had to get memory from the heap. */
+  size_t GetNumberOfChunkAllocations() const
+  {
+    return this->NumberOfChunkAllocations;
+  }
+
+private:
+  struct Chunk
+  {
+    std::unique_ptr<char[]> Data;
+
+    size_t Size = 0;
+
+    /** The total size of the chunks before this one, used to measure the usage. */
+    size_t Begin = 0;
+  };
+
+  /** Add a chunk that can hold at least 'minimumSize' bytes. */
+  void AddChunk(const size_t minimumSize);
+
+  /** The size of the first chunk. */
+  size_t InitialCapacity;
+
+  std::vector<Chunk> Chunks;
+
+  /** The chunk being allocated from. */
+  size_t CurrentChunk = 0;
+
+  /** The number of bytes of the current chunk in use. */
+  size_t Used = 0;
+
+  size_t PeakUsage = 0;
+
+  size_t NumberOfChunkAllocations = 0;
+};
+
+/** An STL allocator that draws from an Arena. Deallocation does nothing; the memory is reclaimed when
+  * the arena is reset or released, so containers using this allocator must not outlive that. */
+template <typename T>
+class ArenaAllocator
+{
+public:
+  typedef T value_type;
+
+  ArenaAllocator(Arena* const arena) : SourceArena(arena) {}
+
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) : SourceArena(other.GetArena()) {}
+
+  T* allocate(const size_t numberOfElements)
+  {
+    return static_cast<T*>(this->SourceArena->Allocate(numberOfElements * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T* const, const size_t) {}
+
+  Arena* GetArena() const
+  {
+    return this->SourceArena;
+  }
+
+private:
+  Arena* SourceArena;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b)
+{
+  return a.GetArena() == b.GetArena();
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b)
+{
+  return !(a == b);
+}
+
+/** A vector whose memory comes from an Arena. */
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T> >;
+
+#endif
@@ -0,0 +1,149 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#include "AsyncFileWriter.h"
+
+// STL
+#include <cstdio>
+
+// POSIX
+#include <unistd.h>
+
+AsyncFileWriter::~AsyncFileWriter()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    this->Stopping = true;
+  }
+  this->Condition.notify_all();
+
+  if(this->WriterThread.joinable())
+  {
+    this->WriterThread.join();
+  }
+}
+
+void AsyncFileWriter::Write(const std::string& fileName, std::vector<char>& data)
+{
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+
+    if(this->HasPendingFile)
+    {
+      this->NumberOfDroppedFiles++;
+    }
+
+    this->PendingFileName = fileName;
+    this->PendingData.swap(data);
+    this->HasPendingFile = true;
+
+    // The thread is only started by the first file, so an object that never writes costs nothing
+    if(!this->WriterThread.joinable())
+    {
+      this->WriterThread = std::thread(&AsyncFileWriter::Run, this);
+    }
+  }
+  this->Condition.notify_all();
+}
+
+void AsyncFileWriter::Flush()
+{
+  std::unique_lock<std::mutex> lock(this->Mutex);
+  this->Condition.wait(lock, [this]() { return !this->HasPendingFile && !this->Writing; });
+}
+
+size_t AsyncFileWriter::GetNumberOfWrittenFiles()
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  return this->NumberOfWrittenFiles;
+}
+
+size_t AsyncFileWriter::GetNumberOfDroppedFiles()
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  return this->NumberOfDroppedFiles;
+}
+
+size_t AsyncFileWriter::GetNumberOfFailedFiles()
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  return this->NumberOfFailedFiles;
+}
+
+void AsyncFileWriter::Run()
+{
+  std::string fileName;
+  std::vector<char> data;
+
+  std::unique_lock<std::mutex> lock(this->Mutex);
+  while(true)
+  {
+    this->Condition.wait(lock, [this]() { return this->HasPendingFile || this->Stopping; });
+
+    // The pending file is written before stopping, so that the last checkpoint is not lost
+    if(!this->HasPendingFile)
+    {
+      return;
+    }
+
+    fileName.swap(this->PendingFileName);
+    data.swap(this->PendingData);
+    this->HasPendingFile = false;
+    this->Writing = true;
+
+    lock.unlock();
+    bool written = WriteFile(fileName, data);
+    lock.lock();
+
+    this->Writing = false;
+    if(written)
+    {
+      this->NumberOfWrittenFiles++;
+    }
+    else
+    {
+      this->NumberOfFailedFiles++;
+    }
+    this->Condition.notify_all();
+  }
+}
+
+bool AsyncFileWriter::WriteFile(const std::string& fileName, const std::vector<char>& data)
+{
+  const std::string temporaryFileName = fileName + ".tmp";
+
+  FILE* file = fopen(temporaryFileName.c_str(), "wb");
+  if(!file)
+  {
+    return false;
+  }
+
+  // The data must be on the disk before the rename makes it the destination
+  bool written = fwrite(data.data(), 1, data.size(), file) == data.size() && fflush(file) == 0 &&
+                 fsync(fileno(file)) == 0;
+  written = fclose(file) == 0 && written;
+
+  if(!written || rename(temporaryFileName.c_str(), fileName.c_str()) != 0)
+  {
+    remove(temporaryFileName.c_str());
+    return false;
+  }
+
+  return true;
+}
@@ -0,0 +1,88 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#ifndef AsyncFileWriter_H
+#define AsyncFileWriter_H
+
+// STL
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/** Writes files on a background thread, so that the thread that produces the data does not wait for the disk.
+  * Only the latest file given to Write() matters: if the previous one is still waiting to be written when a new
+  * one arrives, it is dropped. A file is written next to its destination and then renamed over it, so the
+  * destination always holds a complete file, even if the process is killed during a write. */
+class AsyncFileWriter
+{
+public:
+  /** Wait for the pending file to be written and stop the background thread. */
+  ~AsyncFileWriter();
+
+  /** Write 'data' to 'fileName' in the background. The contents of 'data' are taken (it is left with the buffer of
+    * the file that was written before, so that its memory is reused). */
+  void Write(const std::string& fileName, std::vector<char>& data);
+
+  /** Wait until the pending file, if any, is written. */
+  void Flush();
+
+  /** Get the number of files that were written. */
+  size_t GetNumberOfWrittenFiles();
+
+  /** Get the number of files that were dropped because a newer one arrived before they were written. */
+  size_t GetNumberOfDroppedFiles();
+
+  /** Get the number of files that could not be written. */
+  size_t GetNumberOfFailedFiles();
+
+private:
+  std::thread WriterThread;
+
+  std::mutex Mutex;
+
+  /** Signals the writer thread that there is a file to write or that it must stop, and Flush() that the
+    * pending file was written. */
+  std::condition_variable Condition;
+
+  /** The file that is waiting to be written. */
+  std::string PendingFileName;
+  std::vector<char> PendingData;
+  bool HasPendingFile = false;
+
+  /** Whether the writer thread is writing a file at the moment. */
+  bool Writing = false;
+
+  bool Stopping = false;
+
+  size_t NumberOfWrittenFiles = 0;
+
+  size_t NumberOfDroppedFiles = 0;
+
+  size_t NumberOfFailedFiles = 0;
+
+  /** Write the pending files until Stopping is set. */
+  void Run();
+
+  /** Write 'data' to 'fileName' through a temporary file. Returns false if it could not be written. */
+  static bool WriteFile(const std::string& fileName, const std::vector<char>& data);
+};
+
+#endif
@@ -0,0 +1,208 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "AtomicNNField.h"
+
+// ITK
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageRegionIteratorWithIndex.h"
+
+// STL
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// Submodules
+#include <ITKHelpers/ITKHelpers.h>
+
+// Custom
+#include "NUMAHelpers.h"
+
+void AtomicNNField::Initialize(const itk::ImageRegion<2>& targetRegion, const itk::ImageRegion<2>& sourceRegion,
+                               const unsigned int patchRadius, const unsigned int numberOfThreads)
+{
+  if(sourceRegion.GetNumberOfPixels() >= NoMatch >> 32)
+  {
+    throw std::runtime_error("AtomicNNField::Initialize() The source image is too large to pack its offsets!");
+  }
+
+  this->TargetRegion = targetRegion;
+  this->SourceRegion = sourceRegion;
+  this->PatchRadius = patchRadius;
+
+  // Default constructed atomics are not written, so no page is placed until its band is cleared below
+  const size_t numberOfPixels = targetRegion.GetNumberOfPixels();
+  this->Words.reset(new std::atomic<uint64_t>[numberOfPixels]);
+
+  const size_t width = targetRegion.GetSize()[0];
+  const size_t height = targetRegion.GetSize()[1];
+
+  unsigned int threadCount = numberOfThreads;
+  if(threadCount == 0)
+  {
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+  }
+  threadCount = std::max<size_t>(1, std::min<size_t>(threadCount, height));
+
+  auto clearBand = [this, width, height, threadCount](const unsigned int bandId)
+  {
+    if(threadCount > 1)
+    {
+      NUMAHelpers::RunOnNode(NUMAHelpers::GetNodeOfWorker(bandId, threadCount));
+    }
+
+    const size_t begin = width * (height * bandId / threadCount);
+    const size_t end = width * (height * (bandId + 1) / threadCount);
+    for(size_t pixelOffset = begin; pixelOffset < end; ++pixelOffset)
+    {
+      this->Words[pixelOffset].store(NoMatch, std::memory_order_relaxed);
+    }
+  };
+
+  if(threadCount == 1)
+  {
+    clearBand(0);
+    return;
+  }
+
+  std::vector<std::thread> threads;
+  for(unsigned int bandId = 0; bandId < threadCount; ++bandId)
+  {
+    threads.push_back(std::thread(clearBand, bandId));
+  }
+  for(size_t threadId = 0; threadId < threads.size(); ++threadId)
+  {
+    threads[threadId].join();
+  }
+}
+
+void AtomicNNField::CopyFrom(const NNFieldType* const nnField, const itk::ImageRegion<2>& sourceRegion,
+                             const unsigned int patchRadius, const unsigned int numberOfThreads)
+{
+  Initialize(nnField->GetLargestPossibleRegion(), sourceRegion, patchRadius, numberOfThreads);
+
+  itk::ImageRegionConstIteratorWithIndex<NNFieldType> nnFieldIterator(nnField, this->TargetRegion);
+
+  while(!nnFieldIterator.IsAtEnd())
+  {
+    itk::ImageRegion<2> matchRegion = nnFieldIterator.Get().GetRegion();
+    if(matchRegion.GetNumberOfPixels() > 0)
+    {
+      UpdateIfBetter(nnFieldIterator.GetIndex(), ITKHelpers::GetRegionCenter(matchRegion), nnFieldIterator.Get().GetScore());
+    }
+
+    ++nnFieldIterator;
+  }
+}
+
+void AtomicNNField::CopyTo(NNFieldType* const nnField) const
+{
+  if(nnField->GetLargestPossibleRegion() != this->TargetRegion)
+  {
+    nnField->SetRegions(this->TargetRegion);
+    nnField->Allocate();
+  }
+
+  itk::ImageRegionIteratorWithIndex<NNFieldType> nnFieldIterator(nnField, this->TargetRegion);
+
+  while(!nnFieldIterator.IsAtEnd())
+  {
+    nnFieldIterator.Set(GetMatch(nnFieldIterator.GetIndex()));
+    ++nnFieldIterator;
+  }
+}
+
+bool AtomicNNField::UpdateIfBetter(const itk::Index<2>& targetPixel, const itk::Index<2>& sourceCenter, const float score)
+{
+  assert(this->TargetRegion.IsInside(targetPixel));
+  assert(this->SourceRegion.IsInside(sourceCenter));
+  assert(score >= 0.0f);
+
+  const uint64_t newWord = Pack(score, ComputeOffset(this->SourceRegion, sourceCenter));
+  std::atomic<uint64_t>& word = this->Words[ComputeOffset(this->TargetRegion, targetPixel)];
+
+  // On failure compare_exchange_weak reloads 'currentWord', so the loop ends as soon as another thread
+  // has stored something at least as good
+  uint64_t currentWord = word.load(std::memory_order_relaxed);
+  while(newWord < currentWord)
+  {
+    if(word.compare_exchange_weak(currentWord, newWord, std::memory_order_relaxed))
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool AtomicNNField::GetMatch(const itk::Index<2>& targetPixel, itk::Index<2>& sourceCenter, float& score) const
+{
+  assert(this->TargetRegion.IsInside(targetPixel));
+
+  const uint64_t word = this->Words[ComputeOffset(this->TargetRegion, targetPixel)].load(std::memory_order_relaxed);
+  if(word == NoMatch)
+  {
+    return false;
+  }
+
+  uint32_t sourceOffset;
+  Unpack(word, score, sourceOffset);
+  sourceCenter = ComputeIndex(this->SourceRegion, sourceOffset);
+  return true;
+}
+
+Match AtomicNNField::GetMatch(const itk::Index<2>& targetPixel) const
+{
+  Match match;
+
+  itk::Index<2> sourceCenter;
+  float score;
+  if(GetMatch(targetPixel, sourceCenter, score))
+  {
+    match.SetRegion(ITKHelpers::GetRegionInRadiusAroundPixel(sourceCenter, this->PatchRadius));
+    match.SetScore(score);
+  }
+
+  return match;
+}
+
+bool AtomicNNField::IsLockFree() const
+{
+  std::atomic<uint64_t> word(NoMatch);
+  return word.is_lock_free();
+}
+
+uint64_t AtomicNNField::Pack(const float score, const uint32_t sourceOffset)
+{
+  // -0 has the sign bit set, which would make it compare worse than every other score
+  const float nonNegativeScore = (score == 0.0f) ? 0.0f : score;
+
+  uint32_t scoreBits;
+  std::memcpy(&scoreBits, &nonNegativeScore, sizeof(scoreBits));
+  return (static_cast<uint64_t>(scoreBits) << 32) | sourceOffset;
+}
+
+void AtomicNNField::Unpack(const uint64_t word, float& score, uint32_t& sourceOffset)
+{
+  const uint32_t scoreBits = static_cast<uint32_t>(word >> 32);
+  std::memcpy(&score, &scoreBits, sizeof(score));
+  sourceOffset = static_cast<uint32_t>(word);
+}
@@ -0,0 +1,114 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef AtomicNNField_H
+#define AtomicNNField_H
+
+// ITK
+#include "itkImageRegion.h"
+
+// STL
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+// Custom
+#include "NNField.h"
+
+/** An NNField that many threads can improve at the same time without locks. Each target pixel's match is
+  * packed into one 64 bit word, the score in the high half and the raster offset of the source patch center
+  * in the low half, and UpdateIfBetter() replaces it with a compare-and-swap only while the new match is
+  * better. Since scores are not negative, the bits of a score compare like the score itself, so "better" is
+  * simply a smaller word: a lower score, or the same score with a lower source offset. Ties are therefore
+  * broken the same way no matter which thread gets there first, and once all of the threads are done every
+  * pixel holds the best match that any of them offered. */
+class AtomicNNField
+{
+public:
+  /** Allocate a field over 'targetRegion' whose matches are in 'sourceRegion' (the largest possible region
+    * of the source image), with no matches. The words are first written by 'numberOfThreads' threads (0 for
+    * one per hardware thread), each clearing one contiguous band of rows on the node given by
+    * NUMAHelpers::GetNodeOfWorker(), so that the pages of each band are placed where the worker of the same
+    * number in ConcurrentSearch will update them. */
+  void Initialize(const itk::ImageRegion<2>& targetRegion, const itk::ImageRegion<2>& sourceRegion,
+                  const unsigned int patchRadius, const unsigned int numberOfThreads = 1);
+
+  /** Allocate a field with the regions and matches of 'nnField'. Matches must have non-negative scores. */
+  void CopyFrom(const NNFieldType* const nnField, const itk::ImageRegion<2>& sourceRegion,
+                const unsigned int patchRadius, const unsigned int numberOfThreads = 1);
+
+  /** Write the matches into 'nnField', which is allocated over the target region if necessary. Pixels that
+    * have no match get an empty Match. This must not run at the same time as updates. */
+  void CopyTo(NNFieldType* const nnField) const;
+
+  /** Replace the match of 'targetPixel' by the patch centered at 'sourceCenter' if 'score' is better.
+    * Returns true if the match was replaced. This may be called from any number of threads at once. */
+  bool UpdateIfBetter(const itk::Index<2>& targetPixel, const itk::Index<2>& sourceCenter, const float score);
+
+  /** Get the current match of 'targetPixel'. Returns false if it has no match. */
+  bool GetMatch(const itk::Index<2>& targetPixel, itk::Index<2>& sourceCenter, float& score) const;
+
+  /** Get the current match of 'targetPixel' as a Match, which is empty if there is none. */
+  Match GetMatch(const itk::Index<2>& targetPixel) const;
+
+  const itk::ImageRegion<2>& GetTargetRegion() const
+  {
+    return this->TargetRegion;
+  }
+
+  const itk::ImageRegion<2>& GetSourceRegion() const
+  {
+    return this->SourceRegion;
+  }
+
+  /** Determine if the updates compile to atomic instructions rather than to a hidden lock. */
+  bool IsLockFree() const;
+
+private:
+  /** The word of a pixel that has no match. Its score half is a NaN that compares worse than any score. */
+  static const uint64_t NoMatch = ~static_cast<uint64_t>(0);
+
+  itk::ImageRegion<2> TargetRegion;
+
+  itk::ImageRegion<2> SourceRegion;
+
+  unsigned int PatchRadius = 0;
+
+  /** The packed match of each target pixel, in raster order. */
+  std::unique_ptr<std::atomic<uint64_t>[]> Words;
+
+  static uint64_t Pack(const float score, const uint32_t sourceOffset);
+
+  static void Unpack(const uint64_t word, float& score, uint32_t& sourceOffset);
+
+  /** Get the raster offset of 'index' in 'region'. */
+  static uint32_t ComputeOffset(const itk::ImageRegion<2>& region, const itk::Index<2>& index)
+  {
+    return (index[1] - region.GetIndex()[1]) * region.GetSize()[0] + (index[0] - region.GetIndex()[0]);
+  }
+
+  /** Get the index in 'region' of the raster 'offset'. */
+  static itk::Index<2> ComputeIndex(const itk::ImageRegion<2>& region, const uint32_t offset)
+  {
+    itk::Index<2> index = {{static_cast<itk::IndexValueType>(region.GetIndex()[0] + offset % region.GetSize()[0]),
+                            static_cast<itk::IndexValueType>(region.GetIndex()[1] + offset / region.GetSize()[0])}};
+    return index;
+  }
+};
+
+#endif
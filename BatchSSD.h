@@ -0,0 +1,165 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef BatchSSD_H
+#define BatchSSD_H
+
+// ITK
+#include "itkImage.h"
+#include "itkImageRegion.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkDefaultConvertPixelTraits.h"
+
+// STL
+#include <cassert>
+#include <vector>
+
+/** A sum of squared differences patch distance functor that can score many candidate
+  * patches against the same query patch in one call. The query patch is copied once into a
+  * small contiguous buffer and the candidates are then streamed directly from the image buffer,
+  * so the query pixels are not re-read through the image for every candidate.
+  * Query (target) patches are read from the TargetImage and candidate (source) patches from
+  * the SourceImage, which may be different images of different sizes. */
+template <typename TImage>
+class BatchSSD
+{
+public:
+  typedef TImage ImageType;
+  typedef typename TImage::PixelType PixelType;
+  typedef itk::DefaultConvertPixelTraits<PixelType> PixelTraitsType;
+
+  /** Set the image from which both the query and the candidate patches are read. */
+  void SetImage(TImage* const image)
+  {
+    this->SourceImage = image;
+    this->TargetImage = image;
+  }
+
+  /** Set the image from which the candidate (source) patches are read. */
+  void SetSourceImage(TImage* const sourceImage)
+  {
+    this->SourceImage = sourceImage;
+  }
+
+  /** Get the image from which the candidate (source) patches are read. */
+  TImage* GetSourceImage() const
+  {
+    return this->SourceImage;
+  }
+
+  /** Set the image from which the query (target) patches are read. */
+  void SetTargetImage(TImage* const targetImage)
+  {
+    this->TargetImage = targetImage;
+  }
+
+  /** Compute the distance between a source patch ('region1') and a target patch ('region2'). */
+  float Distance(const itk::ImageRegion<2>& region1, const itk::ImageRegion<2>& region2)
+  {
+    float score = 0.0f;
+    Distance(region2, &region1, 1, &score);
+    return score;
+  }
+
+  /** Compute the distance between 'queryRegion' and each of the 'numberOfCandidates' regions
+    * in 'candidateRegions', storing them in the corresponding entries of 'scores'. */
+  void Distance(const itk::ImageRegion<2>& queryRegion, const itk::ImageRegion<2>* const candidateRegions,
+                const size_t numberOfCandidates, float* const scores)
+  {
+    assert(this->SourceImage);
+    assert(this->TargetImage);
+
+    BufferQueryPatch(queryRegion);
+
+    const PixelType* const buffer = this->SourceImage->GetBufferPointer();
+    const itk::SizeValueType rowStride = this->SourceImage->GetBufferedRegion().GetSize()[0];
+    const unsigned int numberOfComponents = PixelTraitsType::GetNumberOfComponents();
+
+    const itk::SizeValueType patchWidth = queryRegion.GetSize()[0];
+    const itk::SizeValueType patchHeight = queryRegion.GetSize()[1];
+
+    for(size_t candidateId = 0; candidateId < numberOfCandidates; ++candidateId)
+    {
+      assert(candidateRegions[candidateId].GetSize() == queryRegion.GetSize());
+
+      const PixelType* candidateRow = buffer + this->SourceImage->ComputeOffset(candidateRegions[candidateId].GetIndex());
+      const float* queryComponent = this->QueryBuffer.data();
+
+      float sum = 0.0f;
+      for(itk::SizeValueType row = 0; row < patchHeight; ++row)
+      {
+        for(itk::SizeValueType column = 0; column < patchWidth; ++column)
+        {
+          for(unsigned int component = 0; component < numberOfComponents; ++component)
+          {
+            float difference = *queryComponent -
+                               static_cast<float>(PixelTraitsType::GetNthComponent(component, candidateRow[column]));
+            sum += difference * difference;
+            ++queryComponent;
+          }
+        }
+        candidateRow += rowStride;
+      }
+
+      scores[candidateId] = sum;
+    }
+  }
+
+  /** Convenience overload of the batched distance for a vector of candidates. */
+  void Distance(const itk::ImageRegion<2>& queryRegion, const std::vector<itk::ImageRegion<2> >& candidateRegions,
+                std::vector<float>& scores)
+  {
+    scores.resize(candidateRegions.size());
+    if(candidateRegions.empty())
+    {
+      return;
+    }
+    Distance(queryRegion, candidateRegions.data(), candidateRegions.size(), scores.data());
+  }
+
+private:
+  /** The image from which candidate (source) patches are read. */
+  TImage* SourceImage = nullptr;
+
+  /** The image from which query (target) patches are read. */
+  TImage* TargetImage = nullptr;
+
+  /** The components of the current query patch, in raster order. This is kept between calls
+    * so that its memory is reused. */
+  std::vector<float> QueryBuffer;
+
+  /** Copy the components of the query patch into 'QueryBuffer'. */
+  void BufferQueryPatch(const itk::ImageRegion<2>& queryRegion)
+  {
+    this->QueryBuffer.resize(queryRegion.GetNumberOfPixels() * PixelTraitsType::GetNumberOfComponents());
+
+    itk::ImageRegionConstIterator<TImage> queryIterator(this->TargetImage, queryRegion);
+    size_t componentId = 0;
+    while(!queryIterator.IsAtEnd())
+    {
+      for(unsigned int component = 0; component < PixelTraitsType::GetNumberOfComponents(); ++component)
+      {
+        this->QueryBuffer[componentId++] =
+            static_cast<float>(PixelTraitsType::GetNthComponent(component, queryIterator.Get()));
+      }
+      ++queryIterator;
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,114 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef BoundedQueue_H
+#define BoundedQueue_H
+
+// STL
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+/** A thread safe first-in-first-out queue with a maximum size. Push() blocks while the queue is full
+  * and Pop() blocks while it is empty, so a fast producer cannot run arbitrarily far ahead of its consumer. */
+template <typename T>
+class BoundedQueue
+{
+public:
+  BoundedQueue(const size_t capacity) : Capacity(capacity) {}
+
+  /** Add an item, waiting for space if the queue is full. Returns false (and drops the item)
+    * if the queue has been closed. */
+  bool Push(const T& item)
+  {
+    std::unique_lock<std::mutex> lock(this->Mutex);
+    this->NotFull.wait(lock, [this]{ return this->Closed || this->Items.size() < this->Capacity; });
+
+    if(this->Closed)
+    {
+      return false;
+    }
+
+    this->Items.push_back(item);
+    this->NotEmpty.notify_one();
+    return true;
+  }
+
+  /** Add an item only if there is space right now. Returns false if the queue is full or closed. */
+  bool TryPush(const T& item)
+  {
+    std::unique_lock<std::mutex> lock(this->Mutex);
+    if(this->Closed || this->Items.size() >= this->Capacity)
+    {
+      return false;
+    }
+
+    this->Items.push_back(item);
+    this->NotEmpty.notify_one();
+    return true;
+  }
+
+  /** Remove the oldest item, waiting for one if the queue is empty. Returns false once the queue
+    * has been closed and all of its items have been removed. */
+  bool Pop(T& item)
+  {
+    std::unique_lock<std::mutex> lock(this->Mutex);
+    this->NotEmpty.wait(lock, [this]{ return this->Closed || !this->Items.empty(); });
+
+    if(this->Items.empty())
+    {
+      return false;
+    }
+
+    item = this->Items.front();
+    this->Items.pop_front();
+    this->NotFull.notify_one();
+    return true;
+  }
+
+  /** Indicate that no more items will be pushed. Waiting calls return once the remaining items are consumed. */
+  void Close()
+  {
+    std::unique_lock<std::mutex> lock(this->Mutex);
+    this->Closed = true;
+    this->NotEmpty.notify_all();
+    this->NotFull.notify_all();
+  }
+
+  /** Get the number of items currently waiting in the queue. */
+  size_t GetSize()
+  {
+    std::unique_lock<std::mutex> lock(this->Mutex);
+    return this->Items.size();
+  }
+
+private:
+  /** The maximum number of items in the queue. */
+  size_t Capacity;
+
+  /** Set once no more items will be pushed. */
+  bool Closed = false;
+
+  std::deque<T> Items;
+
+  std::mutex Mutex;
+  std::condition_variable NotEmpty;
+  std::condition_variable NotFull;
+};
+
+#endif
@@ -0,0 +1,185 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef ConcurrentSearch_H
+#define ConcurrentSearch_H
+
+// ITK
+#include "itkImage.h"
+#include "itkOffset.h"
+
+// STL
+#include <random>
+#include <type_traits>
+#include <vector>
+
+// Custom
+#include "AtomicNNField.h"
+
+/** PatchMatch propagation and random search run by several threads at once on an AtomicNNField.
+  * Each thread takes a contiguous part of the target pixels, but nothing is owned: propagation both pulls
+  * matches from the neighbors at the propagation offsets and, when a pixel improves, pushes its match to the
+  * pixels that would pull from it, which may belong to another thread. Every write is a "keep if better"
+  * compare-and-swap, so no update is lost and no lock is taken.
+  * Each thread scores patches with its own copy of the patch distance functor, since functors such as
+  * BatchSSD keep scratch buffers.
+  * On a machine with several NUMA nodes (see NUMAHelpers), worker i always runs on node
+  * NUMAHelpers::GetNodeOfWorker(i, numberOfThreads), the node on which AtomicNNField::Initialize() places
+  * its band of the field when given the same number of threads. The source image can also be copied once per
+  * node, so that the random search reads it locally. */
+template <typename TPatchDistanceFunctor>
+class ConcurrentSearch
+{
+public:
+  ConcurrentSearch();
+
+  /** Run the iterations on 'nnField', which must already be initialized. Returns the number of accepted updates. */
+  size_t Search(AtomicNNField* const nnField);
+
+  void SetPatchRadius(const unsigned int patchRadius)
+  {
+    this->PatchRadius = patchRadius;
+  }
+
+  /** Set the functor used to compare patches. Each thread uses a copy of it. */
+  void SetPatchDistanceFunctor(TPatchDistanceFunctor* const patchDistanceFunctor)
+  {
+    this->PatchDistanceFunctor = patchDistanceFunctor;
+  }
+
+  /** Set the image indicating which source patches may be matched. */
+  void SetValidPatchCentersImage(const itk::Image<bool, 2>* const validPatchCentersImage)
+  {
+    this->ValidPatchCentersImage = validPatchCentersImage;
+  }
+
+  /** Set the pixels to improve. By default every pixel of the internal region of the field is improved. */
+  void SetTargetPixels(const std::vector<itk::Index<2> >& targetPixels)
+  {
+    this->TargetPixels = targetPixels;
+  }
+
+  /** Set the offsets from a pixel to the neighbors it propagates from in the forward iterations (the backward
+    * iterations use the opposite offsets). The default is the left and upper neighbors; longer (jump) offsets
+    * may be added. */
+  void SetPropagationOffsets(const std::vector<itk::Offset<2> >& propagationOffsets)
+  {
+    this->PropagationOffsets = propagationOffsets;
+  }
+
+  void SetIterations(const unsigned int iterations)
+  {
+    this->Iterations = iterations;
+  }
+
+  /** Set the number of threads, or 0 to use one per hardware thread. */
+  void SetNumberOfThreads(const unsigned int numberOfThreads)
+  {
+    this->NumberOfThreads = numberOfThreads;
+  }
+
+  /** Set the factor by which the random search window shrinks each step. */
+  void SetRegionReductionRatio(const float regionReductionRatio)
+  {
+    this->RegionReductionRatio = regionReductionRatio;
+  }
+
+  /** Set if each NUMA node gets its own copy of the source image. This has no effect on a single node, or if the
+    * patch distance functor does not provide ImageType, GetSourceImage() and SetSourceImage(). */
+  void SetReplicateSourceImage(const bool replicateSourceImage)
+  {
+    this->ReplicateSourceImage = replicateSourceImage;
+  }
+
+  /** Set if the random number generators are seeded differently every run. If not, the candidates each thread
+    * draws are repeatable, though the order in which threads reach shared pixels is not. */
+  void SetRandom(const bool random)
+  {
+    this->Random = random;
+  }
+
+private:
+  unsigned int PatchRadius = 0;
+
+  TPatchDistanceFunctor* PatchDistanceFunctor = nullptr;
+
+  const itk::Image<bool, 2>* ValidPatchCentersImage = nullptr;
+
+  std::vector<itk::Index<2> > TargetPixels;
+
+  std::vector<itk::Offset<2> > PropagationOffsets;
+
+  unsigned int Iterations = 5;
+
+  unsigned int NumberOfThreads = 0;
+
+  float RegionReductionRatio = 0.5f;
+
+  bool Random = true;
+
+  bool ReplicateSourceImage = false;
+
+  /** The state of one thread. */
+  struct Worker
+  {
+    Worker(const TPatchDistanceFunctor& patchDistanceFunctor) : PatchDistanceFunctor(patchDistanceFunctor) {}
+
+    TPatchDistanceFunctor PatchDistanceFunctor;
+    std::mt19937 Generator;
+    std::vector<itk::ImageRegion<2> > CandidateRegions;
+    std::vector<float> CandidateScores;
+    size_t NumberOfUpdates = 0;
+  };
+
+  /** Give the workers of each NUMA node a copy of the source image made on that node. */
+  void ReplicateSource(std::vector<Worker>& workers, const unsigned int numberOfNodes, std::true_type);
+
+  /** Do nothing, for patch distance functors whose source image cannot be replicated. */
+  void ReplicateSource(std::vector<Worker>& workers, const unsigned int numberOfNodes, std::false_type);
+
+  /** Visit the target pixels [begin, end) in the given direction. */
+  void ProcessPixels(AtomicNNField* const nnField, Worker& worker, const size_t begin, const size_t end,
+                     const bool forward) const;
+
+  /** Score the patch centered at 'sourceCenter' for 'targetPixel' and offer it. Returns true if it was accepted. */
+  bool Offer(AtomicNNField* const nnField, Worker& worker, const itk::Index<2>& targetPixel,
+             const itk::Index<2>& sourceCenter) const;
+
+  /** Get propagation offset 'offsetId' for the given scan direction. */
+  itk::Offset<2> GetPropagationOffset(const size_t offsetId, const bool forward) const
+  {
+    itk::Offset<2> offset = this->PropagationOffsets[offsetId];
+    if(!forward)
+    {
+      offset[0] = -offset[0];
+      offset[1] = -offset[1];
+    }
+    return offset;
+  }
+
+  /** Determine if 'sourceCenter' may be the center of a match. */
+  bool IsValidSourceCenter(const itk::ImageRegion<2>& sourceInternalRegion, const itk::Index<2>& sourceCenter) const
+  {
+    return sourceInternalRegion.IsInside(sourceCenter) &&
+           (!this->ValidPatchCentersImage || this->ValidPatchCentersImage->GetPixel(sourceCenter));
+  }
+};
+
+#include "ConcurrentSearch.hpp"
+
+#endif
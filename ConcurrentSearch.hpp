@@ -0,0 +1,307 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef ConcurrentSearch_HPP
+#define ConcurrentSearch_HPP
+
+#include "ConcurrentSearch.h"
+
+// STL
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+// Submodules
+#include <ITKHelpers/ITKHelpers.h>
+
+// Custom
+#include "NUMAHelpers.h"
+#include "PatchMatchHelpers.h"
+
+namespace Internal
+{
+/** Determine if a patch distance functor has a source image that ConcurrentSearch can replicate, that is if it
+  * provides ImageType, GetSourceImage() and SetSourceImage(). */
+template <typename TPatchDistanceFunctor>
+class HasReplicableSourceImage
+{
+  template <typename T>
+  static auto Test(int) -> decltype(std::declval<T&>().SetSourceImage(std::declval<typename T::ImageType::Pointer&>()),
+                                    std::declval<T&>().GetSourceImage(), std::true_type());
+
+  template <typename T>
+  static std::false_type Test(...);
+
+public:
+  static const bool value = decltype(Test<TPatchDistanceFunctor>(0))::value;
+};
+} // end Internal namespace
+
+template <typename TPatchDistanceFunctor>
+ConcurrentSearch<TPatchDistanceFunctor>::ConcurrentSearch()
+{
+  itk::Offset<2> leftOffset = {{-1, 0}};
+  itk::Offset<2> upOffset = {{0, -1}};
+  this->PropagationOffsets.push_back(leftOffset);
+  this->PropagationOffsets.push_back(upOffset);
+}
+
+template <typename TPatchDistanceFunctor>
+size_t ConcurrentSearch<TPatchDistanceFunctor>::Search(AtomicNNField* const nnField)
+{
+  assert(nnField);
+  assert(this->PatchRadius > 0);
+  assert(this->PatchDistanceFunctor);
+
+  if(nnField->GetTargetRegion().GetNumberOfPixels() == 0)
+  {
+    throw std::runtime_error("ConcurrentSearch::Search() The NNField has not been initialized!");
+  }
+
+  if(this->TargetPixels.empty())
+  {
+    this->TargetPixels = PatchMatchHelpers::GetAllPixelIndices(
+          ITKHelpers::GetInternalRegion(nnField->GetTargetRegion(), this->PatchRadius));
+  }
+
+  unsigned int threadCount = this->NumberOfThreads;
+  if(threadCount == 0)
+  {
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+  }
+  threadCount = std::max<size_t>(1, std::min<size_t>(threadCount, this->TargetPixels.size()));
+
+  std::random_device randomDevice;
+  std::vector<Worker> workers(threadCount, Worker(*this->PatchDistanceFunctor));
+  for(unsigned int workerId = 0; workerId < threadCount; ++workerId)
+  {
+    workers[workerId].Generator.seed(this->Random ? randomDevice() : workerId);
+  }
+
+  const unsigned int numberOfNodes = NUMAHelpers::GetNumberOfNodes();
+
+  if(this->ReplicateSourceImage && numberOfNodes > 1)
+  {
+    ReplicateSource(workers, numberOfNodes,
+                    std::integral_constant<bool, Internal::HasReplicableSourceImage<TPatchDistanceFunctor>::value>());
+  }
+
+  for(unsigned int iteration = 0; iteration < this->Iterations; ++iteration)
+  {
+    const bool forward = (iteration % 2 == 0);
+
+    std::vector<std::thread> threads;
+    for(unsigned int workerId = 0; workerId < threadCount; ++workerId)
+    {
+      size_t begin = this->TargetPixels.size() * workerId / threadCount;
+      size_t end = this->TargetPixels.size() * (workerId + 1) / threadCount;
+      threads.push_back(std::thread([this, nnField, &workers, workerId, threadCount, numberOfNodes, begin, end, forward]()
+      {
+        if(numberOfNodes > 1)
+        {
+          NUMAHelpers::RunOnNode(NUMAHelpers::GetNodeOfWorker(workerId, threadCount));
+        }
+        ProcessPixels(nnField, workers[workerId], begin, end, forward);
+      }));
+    }
+
+    for(size_t threadId = 0; threadId < threads.size(); ++threadId)
+    {
+      threads[threadId].join();
+    }
+  }
+
+  size_t numberOfUpdates = 0;
+  for(unsigned int workerId = 0; workerId < threadCount; ++workerId)
+  {
+    numberOfUpdates += workers[workerId].NumberOfUpdates;
+  }
+  return numberOfUpdates;
+}
+
+template <typename TPatchDistanceFunctor>
+void ConcurrentSearch<TPatchDistanceFunctor>::ReplicateSource(std::vector<Worker>& workers,
+                                                              const unsigned int numberOfNodes, std::true_type)
+{
+  typedef typename TPatchDistanceFunctor::ImageType ImageType;
+
+  // Each copy is written by a thread running on its node, so that is where its pages are placed
+  std::vector<typename ImageType::Pointer> sourceReplicas(numberOfNodes);
+  std::vector<std::thread> threads;
+  for(unsigned int node = 0; node < numberOfNodes; ++node)
+  {
+    threads.push_back(std::thread([this, node, &sourceReplicas]()
+    {
+      NUMAHelpers::RunOnNode(node);
+      sourceReplicas[node] = ImageType::New();
+      ITKHelpers::DeepCopy(this->PatchDistanceFunctor->GetSourceImage(), sourceReplicas[node].GetPointer());
+    }));
+  }
+  for(size_t threadId = 0; threadId < threads.size(); ++threadId)
+  {
+    threads[threadId].join();
+  }
+
+  const unsigned int threadCount = workers.size();
+  for(unsigned int workerId = 0; workerId < threadCount; ++workerId)
+  {
+    workers[workerId].PatchDistanceFunctor.SetSourceImage(
+          sourceReplicas[NUMAHelpers::GetNodeOfWorker(workerId, threadCount)]);
+  }
+}
+
+template <typename TPatchDistanceFunctor>
+void ConcurrentSearch<TPatchDistanceFunctor>::ReplicateSource(std::vector<Worker>&, const unsigned int,
+                                                              std::false_type)
+{
+  // The functor has no source image to replicate, so every worker reads the one it was copied with
+}
+
+template <typename TPatchDistanceFunctor>
+void ConcurrentSearch<TPatchDistanceFunctor>::ProcessPixels(AtomicNNField* const nnField, Worker& worker,
+                                                            const size_t begin, const size_t end,
+                                                            const bool forward) const
+{
+  itk::ImageRegion<2> targetInternalRegion = ITKHelpers::GetInternalRegion(nnField->GetTargetRegion(), this->PatchRadius);
+  itk::ImageRegion<2> sourceInternalRegion = ITKHelpers::GetInternalRegion(nnField->GetSourceRegion(), this->PatchRadius);
+
+  const unsigned int initialRadius = std::max(sourceInternalRegion.GetSize()[0], sourceInternalRegion.GetSize()[1]);
+
+  // The number of random guesses per search window. Windows that are mostly invalid are skipped rather than scanned.
+  const unsigned int numberOfGuesses = 8;
+
+  for(size_t visitId = begin; visitId < end; ++visitId)
+  {
+    const size_t targetPixelId = forward ? visitId : begin + end - 1 - visitId;
+    const itk::Index<2> targetPixel = this->TargetPixels[targetPixelId];
+
+    bool improved = false;
+
+    // Pull the matches of the neighbors that this scan direction has already visited
+    for(size_t offsetId = 0; offsetId < this->PropagationOffsets.size(); ++offsetId)
+    {
+      const itk::Offset<2> offset = GetPropagationOffset(offsetId, forward);
+      itk::Index<2> neighbor = targetPixel + offset;
+
+      itk::Index<2> neighborSourceCenter;
+      float neighborScore;
+      if(!targetInternalRegion.IsInside(neighbor) || !nnField->GetMatch(neighbor, neighborSourceCenter, neighborScore))
+      {
+        continue;
+      }
+
+      itk::Index<2> potentialSourceCenter = neighborSourceCenter - offset;
+      if(IsValidSourceCenter(sourceInternalRegion, potentialSourceCenter))
+      {
+        improved |= Offer(nnField, worker, targetPixel, potentialSourceCenter);
+      }
+    }
+
+    // Random search around the current best match
+    itk::Index<2> sourceCenter;
+    float score;
+    if(!nnField->GetMatch(targetPixel, sourceCenter, score))
+    {
+      continue;
+    }
+
+    worker.CandidateRegions.clear();
+    for(unsigned int radius = initialRadius; radius > this->PatchRadius;
+        radius = static_cast<unsigned int>(radius * this->RegionReductionRatio))
+    {
+      itk::ImageRegion<2> searchRegion = ITKHelpers::GetRegionInRadiusAroundPixel(sourceCenter, radius);
+      if(!searchRegion.Crop(sourceInternalRegion))
+      {
+        break;
+      }
+
+      std::uniform_int_distribution<itk::IndexValueType> xDistribution(searchRegion.GetIndex()[0],
+            searchRegion.GetIndex()[0] + static_cast<itk::IndexValueType>(searchRegion.GetSize()[0]) - 1);
+      std::uniform_int_distribution<itk::IndexValueType> yDistribution(searchRegion.GetIndex()[1],
+            searchRegion.GetIndex()[1] + static_cast<itk::IndexValueType>(searchRegion.GetSize()[1]) - 1);
+
+      for(unsigned int guessId = 0; guessId < numberOfGuesses; ++guessId)
+      {
+        itk::Index<2> randomPixel = {{xDistribution(worker.Generator), yDistribution(worker.Generator)}};
+        if(IsValidSourceCenter(sourceInternalRegion, randomPixel))
+        {
+          worker.CandidateRegions.push_back(ITKHelpers::GetRegionInRadiusAroundPixel(randomPixel, this->PatchRadius));
+          break;
+        }
+      }
+    }
+
+    if(!worker.CandidateRegions.empty())
+    {
+      itk::ImageRegion<2> queryRegion = ITKHelpers::GetRegionInRadiusAroundPixel(targetPixel, this->PatchRadius);
+      PatchMatchHelpers::BatchDistance(&worker.PatchDistanceFunctor, queryRegion,
+                                       worker.CandidateRegions, worker.CandidateScores);
+
+      size_t bestCandidateId = std::min_element(worker.CandidateScores.begin(), worker.CandidateScores.end()) -
+                               worker.CandidateScores.begin();
+
+      if(nnField->UpdateIfBetter(targetPixel, ITKHelpers::GetRegionCenter(worker.CandidateRegions[bestCandidateId]),
+                                 worker.CandidateScores[bestCandidateId]))
+      {
+        worker.NumberOfUpdates++;
+        improved = true;
+      }
+    }
+
+    if(!improved || !nnField->GetMatch(targetPixel, sourceCenter, score))
+    {
+      continue;
+    }
+
+    // Push the improved match to the pixels that propagate from this one, which may belong to another thread
+    for(size_t offsetId = 0; offsetId < this->PropagationOffsets.size(); ++offsetId)
+    {
+      const itk::Offset<2> offset = GetPropagationOffset(offsetId, forward);
+      itk::Index<2> follower = targetPixel - offset;
+      itk::Index<2> potentialSourceCenter = sourceCenter - offset;
+
+      if(targetInternalRegion.IsInside(follower) && IsValidSourceCenter(sourceInternalRegion, potentialSourceCenter))
+      {
+        Offer(nnField, worker, follower, potentialSourceCenter);
+      }
+    }
+  }
+}
+
+template <typename TPatchDistanceFunctor>
+bool ConcurrentSearch<TPatchDistanceFunctor>::Offer(AtomicNNField* const nnField, Worker& worker,
+                                                    const itk::Index<2>& targetPixel,
+                                                    const itk::Index<2>& sourceCenter) const
+{
+  itk::ImageRegion<2> sourceRegion = ITKHelpers::GetRegionInRadiusAroundPixel(sourceCenter, this->PatchRadius);
+  itk::ImageRegion<2> targetRegion = ITKHelpers::GetRegionInRadiusAroundPixel(targetPixel, this->PatchRadius);
+
+  float distance = worker.PatchDistanceFunctor.Distance(sourceRegion, targetRegion);
+  if(nnField->UpdateIfBetter(targetPixel, sourceCenter, distance))
+  {
+    worker.NumberOfUpdates++;
+    return true;
+  }
+
+  return false;
+}
+
+#endif
@@ -30,9 +30,9 @@
 // Submodules
 #include <Mask/Mask.h>
 #include <Mask/ITKHelpers/ITKHelpers.h>
-#include <PatchComparison/SSD.h>
 
 // Custom
+#include "PaddedSSD.h"
 #include "PatchMatch.h"
 #include "Propagator.h"
 #include "RandomSearch.h"
@@ -72,7 +72,7 @@ int main(int argc, char*argv[])
 
   ImageType* image = imageReader->GetOutput();
 
-  typedef SSD<ImageType> PatchDistanceFunctorType;
+  typedef PaddedSSD<ImageType> PatchDistanceFunctorType;
   PatchDistanceFunctorType* patchDistanceFunctor = new PatchDistanceFunctorType;
   patchDistanceFunctor->SetImage(image);
 
@@ -0,0 +1,122 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+/** This program computes the NN field of every image in a list against itself, matching several images at once.
+  * The images are read and the fields written by the threads that match them. */
+
+// STL
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// ITK
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkCovariantVector.h"
+
+// Submodules
+#include <Helpers/Helpers.h>
+
+// Custom
+#include "PatchMatchBatch.h"
+#include "PatchMatchHelpers.h"
+
+typedef itk::Image<itk::CovariantVector<unsigned char, 3>, 2> ImageType;
+
+std::vector<std::string> ReadLines(const std::string& fileName)
+{
+  std::vector<std::string> lines;
+  std::ifstream fin(fileName.c_str());
+  std::string line;
+  while(std::getline(fin, line))
+  {
+    if(!line.empty())
+    {
+      lines.push_back(line);
+    }
+  }
+  return lines;
+}
+
+int main(int argc, char*argv[])
+{
+  // Verify arguments
+  if(argc < 4)
+  {
+    std::cerr << "Required arguments: imageList patchRadius outputPrefix [numberOfThreads]" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Parse arguments
+  std::stringstream ss;
+  for(int i = 1; i < argc; ++i)
+  {
+    ss << argv[i] << " ";
+  }
+  std::string imageListFilename;
+  unsigned int patchRadius;
+  std::string outputPrefix;
+  unsigned int numberOfThreads = 0;
+
+  ss >> imageListFilename >> patchRadius >> outputPrefix >> numberOfThreads;
+
+  // Output arguments
+  std::cout << "imageListFilename: " << imageListFilename << std::endl;
+  std::cout << "patchRadius: " << patchRadius << std::endl;
+  std::cout << "outputPrefix: " << outputPrefix << std::endl;
+  std::cout << "numberOfThreads: " << numberOfThreads << std::endl;
+
+  std::vector<std::string> imageFilenames = ReadLines(imageListFilename);
+
+  PatchMatchBatch<ImageType> patchMatchBatch;
+  patchMatchBatch.SetPatchRadius(patchRadius);
+  patchMatchBatch.SetNumberOfThreads(numberOfThreads);
+
+  patchMatchBatch.Compute(imageFilenames.size(),
+                          [&imageFilenames](const size_t imageId)
+                          {
+                            typedef itk::ImageFileReader<ImageType> ImageReaderType;
+                            ImageReaderType::Pointer imageReader = ImageReaderType::New();
+                            imageReader->SetFileName(imageFilenames[imageId]);
+                            imageReader->Update();
+
+                            ImageType::Pointer image = imageReader->GetOutput();
+                            image->DisconnectPipeline();
+                            return image;
+                          },
+                          [&outputPrefix](const size_t imageId, ImageType* const, NNFieldType* const nnField)
+                          {
+                            PatchMatchHelpers::WriteNNField(nnField,
+                                                            Helpers::GetSequentialFileName(outputPrefix, imageId, "mha"));
+                          });
+
+  std::cout << "Matched " << patchMatchBatch.GetNumberOfProcessedImages() << " images on "
+            << patchMatchBatch.GetNumberOfThreads() << " threads at " << patchMatchBatch.GetImagesPerSecond()
+            << " images/sec." << std::endl;
+
+  if(patchMatchBatch.GetNumberOfFailedImages() > 0)
+  {
+    std::cerr << patchMatchBatch.GetNumberOfFailedImages() << " images failed." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
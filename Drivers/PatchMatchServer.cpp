@@ -0,0 +1,96 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+/** This program keeps a PatchMatchServer running on a Unix domain socket until it is interrupted, so that
+  * local clients can compute NN fields without starting a process for every image. */
+
+// STL
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// POSIX
+#include <pthread.h>
+#include <signal.h>
+
+// ITK
+#include "itkImage.h"
+#include "itkCovariantVector.h"
+
+// Custom
+#include "PatchMatchServer.h"
+
+typedef itk::Image<itk::CovariantVector<unsigned char, 3>, 2> ImageType;
+
+int main(int argc, char*argv[])
+{
+  // Verify arguments
+  if(argc < 2)
+  {
+    std::cerr << "Required arguments: socketPath [numberOfThreads] [queueCapacity] [connectionTimeout (ms)]" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Parse arguments
+  std::stringstream ss;
+  for(int i = 1; i < argc; ++i)
+  {
+    ss << argv[i] << " ";
+  }
+  std::string socketPath;
+  unsigned int numberOfThreads = 0;
+  unsigned int queueCapacity = 0;
+  unsigned int connectionTimeout = 30000;
+
+  ss >> socketPath >> numberOfThreads >> queueCapacity >> connectionTimeout;
+
+  // Output arguments
+  std::cout << "socketPath: " << socketPath << std::endl;
+  std::cout << "numberOfThreads: " << numberOfThreads << std::endl;
+  std::cout << "queueCapacity: " << queueCapacity << std::endl;
+  std::cout << "connectionTimeout: " << connectionTimeout << std::endl;
+
+  // The signals are blocked before the server starts its threads, which inherit the mask, so that only
+  // the sigwait() below receives them
+  sigset_t stopSignals;
+  sigemptyset(&stopSignals);
+  sigaddset(&stopSignals, SIGINT);
+  sigaddset(&stopSignals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &stopSignals, nullptr);
+
+  PatchMatchServer<ImageType> server;
+  server.SetNumberOfThreads(numberOfThreads);
+  server.SetQueueCapacity(queueCapacity);
+  server.SetConnectionTimeout(connectionTimeout);
+  server.Start(socketPath);
+
+  std::cout << "Listening on " << socketPath << std::endl;
+
+  int signalNumber = 0;
+  sigwait(&stopSignals, &signalNumber);
+
+  std::cout << "Stopping..." << std::endl;
+  server.Stop();
+
+  std::cout << "Completed " << server.GetNumberOfCompletedJobs() << " jobs, "
+            << server.GetNumberOfFailedJobs() << " failed, "
+            << server.GetNumberOfRejectedJobs() << " rejected while busy." << std::endl;
+
+  return EXIT_SUCCESS;
+}
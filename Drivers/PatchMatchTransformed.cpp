@@ -0,0 +1,125 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+/** This program computes the NN field of a target image against a source image, allowing the matches to be
+  * rotated and scaled versions of the source patches. It writes the field, and the number of target pixels
+  * that matched with each rotation and scale. */
+
+// STL
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// ITK
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkCovariantVector.h"
+
+// Custom
+#include "PatchMatchHelpers.h"
+#include "TransformedPatchMatch.h"
+
+int main(int argc, char*argv[])
+{
+  // Verify arguments
+  if(argc < 5)
+  {
+    std::cerr << "Required arguments: sourceImage targetImage patchRadius output "
+              << "[iterations numberOfAngles numberOfScales]" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Parse arguments
+  std::stringstream ss;
+  for(int i = 1; i < argc; ++i)
+  {
+    ss << argv[i] << " ";
+  }
+  std::string sourceImageFilename;
+  std::string targetImageFilename;
+  unsigned int patchRadius;
+  std::string outputFilename;
+  unsigned int iterations = 5;
+  unsigned int numberOfAngles = 8;
+  unsigned int numberOfScales = 3;
+
+  ss >> sourceImageFilename >> targetImageFilename >> patchRadius >> outputFilename
+     >> iterations >> numberOfAngles >> numberOfScales;
+
+  // Output arguments
+  std::cout << "sourceImageFilename: " << sourceImageFilename << std::endl;
+  std::cout << "targetImageFilename: " << targetImageFilename << std::endl;
+  std::cout << "patchRadius: " << patchRadius << std::endl;
+  std::cout << "outputFilename: " << outputFilename << std::endl;
+  std::cout << "iterations: " << iterations << std::endl;
+  std::cout << "numberOfAngles: " << numberOfAngles << std::endl;
+  std::cout << "numberOfScales: " << numberOfScales << std::endl;
+
+  typedef itk::Image<itk::CovariantVector<unsigned char, 3>, 2> ImageType;
+
+  typedef itk::ImageFileReader<ImageType> ImageReaderType;
+  ImageReaderType::Pointer sourceImageReader = ImageReaderType::New();
+  sourceImageReader->SetFileName(sourceImageFilename);
+  sourceImageReader->Update();
+
+  ImageReaderType::Pointer targetImageReader = ImageReaderType::New();
+  targetImageReader->SetFileName(targetImageFilename);
+  targetImageReader->Update();
+
+  TransformedPatchMatch<ImageType> transformedPatchMatch;
+  transformedPatchMatch.SetSourceImage(sourceImageReader->GetOutput());
+  transformedPatchMatch.SetTargetImage(targetImageReader->GetOutput());
+  transformedPatchMatch.SetPatchRadius(patchRadius);
+  transformedPatchMatch.SetIterations(iterations);
+
+  TransformedImageCache<ImageType>* cache = transformedPatchMatch.GetCache();
+  cache->SetNumberOfAngles(numberOfAngles);
+  cache->SetNumberOfScales(numberOfScales);
+
+  transformedPatchMatch.Compute();
+
+  NNFieldType::Pointer nnField = NNFieldType::New();
+  transformedPatchMatch.GetNNField(nnField);
+  PatchMatchHelpers::WriteNNField(nnField.GetPointer(), outputFilename);
+
+  std::vector<size_t> transformCounts(cache->GetNumberOfTransforms(), 0);
+  itk::ImageRegionConstIterator<TransformedNNFieldType>
+      nnFieldIterator(transformedPatchMatch.GetTransformedNNField(),
+                      transformedPatchMatch.GetTransformedNNField()->GetLargestPossibleRegion());
+  while(!nnFieldIterator.IsAtEnd())
+  {
+    if(nnFieldIterator.Get().Valid)
+    {
+      transformCounts[nnFieldIterator.Get().TransformId]++;
+    }
+    ++nnFieldIterator;
+  }
+
+  std::cout << "angle (degrees)\tscale\tpixels" << std::endl;
+  for(unsigned int transformId = 0; transformId < cache->GetNumberOfTransforms(); ++transformId)
+  {
+    std::cout << cache->GetAngle(transformId) * 180.0f / std::acos(-1.0f) << "\t" << cache->GetScale(transformId)
+              << "\t" << transformCounts[transformId] << std::endl;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,214 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+/** This program computes the NN field of every frame of a video against a source image.
+  * Each frame is warm-started from the previous frame's field. Reading the frames, matching
+  * and writing the fields run on separate threads connected by small queues, so the reader
+  * and writer never stall the matching and never run more than a couple of frames ahead of it. */
+
+// STL
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ITK
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkCovariantVector.h"
+
+// Submodules
+#include <Helpers/Helpers.h>
+
+// Custom
+#include "BatchSSD.h"
+#include "BoundedQueue.h"
+#include "PatchMatchHelpers.h"
+#include "PatchMatchSequence.h"
+#include "Propagator.h"
+#include "RandomSearch.h"
+
+typedef itk::Image<itk::CovariantVector<unsigned char, 3>, 2> ImageType;
+
+typedef BatchSSD<ImageType> PatchDistanceFunctorType;
+typedef Propagator<PatchDistanceFunctorType> PropagatorType;
+typedef RandomSearch<ImageType, PatchDistanceFunctorType> RandomSearchType;
+typedef PatchMatchSequence<ImageType, PropagatorType, RandomSearchType> PatchMatchSequenceType;
+
+/** A frame that has been read and is waiting to be matched. */
+struct DecodedFrame
+{
+  unsigned int FrameId;
+  ImageType::Pointer Frame;
+  PatchMatchSequenceType::FlowImageType::Pointer Flow;
+};
+
+/** A field that has been computed and is waiting to be written. */
+struct MatchedFrame
+{
+  unsigned int FrameId;
+  NNFieldType::Pointer NNField;
+};
+
+template <typename TImage>
+typename TImage::Pointer ReadImage(const std::string& fileName)
+{
+  typedef itk::ImageFileReader<TImage> ReaderType;
+  typename ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName(fileName);
+  reader->Update();
+
+  typename TImage::Pointer image = reader->GetOutput();
+  image->DisconnectPipeline();
+  return image;
+}
+
+std::vector<std::string> ReadLines(const std::string& fileName)
+{
+  std::vector<std::string> lines;
+  std::ifstream fin(fileName.c_str());
+  std::string line;
+  while(std::getline(fin, line))
+  {
+    if(!line.empty())
+    {
+      lines.push_back(line);
+    }
+  }
+  return lines;
+}
+
+int main(int argc, char*argv[])
+{
+  // Verify arguments
+  if(argc < 5)
+  {
+    std::cerr << "Required arguments: sourceImage frameList patchRadius outputPrefix [flowList]" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Parse arguments
+  std::stringstream ss;
+  for(int i = 1; i < argc; ++i)
+  {
+    ss << argv[i] << " ";
+  }
+  std::string sourceImageFilename;
+  std::string frameListFilename;
+  unsigned int patchRadius;
+  std::string outputPrefix;
+  std::string flowListFilename;
+
+  ss >> sourceImageFilename >> frameListFilename >> patchRadius >> outputPrefix >> flowListFilename;
+
+  // Output arguments
+  std::cout << "sourceImageFilename: " << sourceImageFilename << std::endl;
+  std::cout << "frameListFilename: " << frameListFilename << std::endl;
+  std::cout << "patchRadius: " << patchRadius << std::endl;
+  std::cout << "outputPrefix: " << outputPrefix << std::endl;
+  std::cout << "flowListFilename: " << flowListFilename << std::endl;
+
+  std::vector<std::string> frameFilenames = ReadLines(frameListFilename);
+
+  // The flow of frame i is its displacement to frame i-1, so the first entry is not used
+  std::vector<std::string> flowFilenames;
+  if(!flowListFilename.empty())
+  {
+    flowFilenames = ReadLines(flowListFilename);
+    if(flowFilenames.size() != frameFilenames.size())
+    {
+      std::cerr << "The flow list must have one entry per frame." << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  ImageType::Pointer sourceImage = ReadImage<ImageType>(sourceImageFilename);
+
+  PatchDistanceFunctorType* patchDistanceFunctor = new PatchDistanceFunctorType;
+  patchDistanceFunctor->SetSourceImage(sourceImage);
+
+  PropagatorType* propagator = new PropagatorType;
+  propagator->SetPatchRadius(patchRadius);
+  propagator->SetPatchDistanceFunctor(patchDistanceFunctor);
+
+  RandomSearchType* randomSearchFunctor = new RandomSearchType;
+  randomSearchFunctor->SetPatchRadius(patchRadius);
+  randomSearchFunctor->SetPatchDistanceFunctor(patchDistanceFunctor);
+
+  PatchMatchSequenceType patchMatchSequence;
+  patchMatchSequence.SetSourceImage(sourceImage);
+  patchMatchSequence.SetPatchRadius(patchRadius);
+  patchMatchSequence.SetPropagationFunctor(propagator);
+  patchMatchSequence.SetRandomSearchFunctor(randomSearchFunctor);
+
+  // Small queues bound how far reading and writing can get ahead of matching
+  BoundedQueue<DecodedFrame> decodedFrames(2);
+  BoundedQueue<MatchedFrame> matchedFrames(2);
+
+  std::thread readerThread([&]()
+  {
+    for(unsigned int frameId = 0; frameId < frameFilenames.size(); ++frameId)
+    {
+      DecodedFrame decodedFrame;
+      decodedFrame.FrameId = frameId;
+      decodedFrame.Frame = ReadImage<ImageType>(frameFilenames[frameId]);
+      if(frameId > 0 && !flowFilenames.empty())
+      {
+        decodedFrame.Flow = ReadImage<PatchMatchSequenceType::FlowImageType>(flowFilenames[frameId]);
+      }
+      decodedFrames.Push(decodedFrame);
+    }
+    decodedFrames.Close();
+  });
+
+  std::thread writerThread([&]()
+  {
+    MatchedFrame matchedFrame;
+    while(matchedFrames.Pop(matchedFrame))
+    {
+      PatchMatchHelpers::WriteNNField(matchedFrame.NNField.GetPointer(),
+                                      Helpers::GetSequentialFileName(outputPrefix, matchedFrame.FrameId, "mha"));
+    }
+  });
+
+  DecodedFrame decodedFrame;
+  while(decodedFrames.Pop(decodedFrame))
+  {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    MatchedFrame matchedFrame;
+    matchedFrame.FrameId = decodedFrame.FrameId;
+    matchedFrame.NNField = patchMatchSequence.ProcessFrame(decodedFrame.Frame, decodedFrame.Flow.GetPointer());
+
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    std::cout << "Frame " << decodedFrame.FrameId << ": "
+              << patchMatchSequence.GetNumberOfChangedPixels() << " pixels refined in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << " ms" << std::endl;
+
+    matchedFrames.Push(matchedFrame);
+  }
+  matchedFrames.Close();
+
+  readerThread.join();
+  writerThread.join();
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,211 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+/** This program measures the per-candidate cost of acceptance testing. The same random candidate
+  * matches are run through AcceptanceTestSSD directly, through AcceptanceTestChain with and without
+  * signal instrumentation, and through a vector of virtual tests with signals, which is how
+  * AcceptanceTestComposite runs them. */
+
+// STL
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// ITK
+#include "itkImage.h"
+
+// Boost
+#include <boost/signals2/signal.hpp>
+
+// Custom
+#include "AcceptanceTestChain.h"
+#include "AcceptanceTestSSD.h"
+#include "AcceptanceTestSourceRegion.h"
+
+/** The interface of the tests in AcceptanceTestComposite. */
+class VirtualAcceptanceTest
+{
+public:
+  virtual ~VirtualAcceptanceTest() {}
+
+  virtual bool IsBetterWithScore(const itk::ImageRegion<2>& queryRegion, const Match& currentMatch,
+                                 const Match& potentialBetterMatch, float& score) = 0;
+
+  virtual std::string GetName() const = 0;
+};
+
+/** Run a test through the virtual interface. */
+template <typename TTest>
+class VirtualAcceptanceTestAdapter : public VirtualAcceptanceTest
+{
+public:
+  VirtualAcceptanceTestAdapter(const TTest& test) : Test(test) {}
+
+  bool IsBetterWithScore(const itk::ImageRegion<2>& queryRegion, const Match& currentMatch,
+                         const Match& potentialBetterMatch, float& score)
+  {
+    return this->Test.IsBetterWithScore(queryRegion, currentMatch, potentialBetterMatch, score);
+  }
+
+  std::string GetName() const
+  {
+    return TTest::GetName();
+  }
+
+private:
+  TTest Test;
+};
+
+/** The loop of AcceptanceTestComposite::IsBetterWithScore(). */
+class VirtualAcceptanceTestComposite
+{
+public:
+  bool IsBetterWithScore(const itk::ImageRegion<2>& queryRegion, const Match& currentMatch,
+                         const Match& potentialBetterMatch, float& score)
+  {
+    for(size_t i = 0; i < this->AcceptanceTests.size(); ++i)
+    {
+      if(!this->AcceptanceTests[i]->IsBetterWithScore(queryRegion, currentMatch, potentialBetterMatch, score))
+      {
+        WhichFailedSignal(this->AcceptanceTests[i]->GetName() + " failed.");
+        FailedScoreSignal(score);
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  void AddAcceptanceTest(VirtualAcceptanceTest* const acceptanceTest)
+  {
+    this->AcceptanceTests.push_back(std::unique_ptr<VirtualAcceptanceTest>(acceptanceTest));
+  }
+
+  boost::signals2::signal<void (std::string)> WhichFailedSignal;
+  boost::signals2::signal<void (float)> FailedScoreSignal;
+
+private:
+  std::vector<std::unique_ptr<VirtualAcceptanceTest> > AcceptanceTests;
+};
+
+/** Run every candidate through 'test' and report the time per candidate. */
+template <typename TTest>
+void Time(const std::string& name, TTest& test, const std::vector<Match>& currentMatches,
+          const std::vector<Match>& candidates, const itk::ImageRegion<2>& queryRegion)
+{
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  size_t numberOfAccepted = 0;
+  float score = 0.0f;
+  for(size_t candidateId = 0; candidateId < candidates.size(); ++candidateId)
+  {
+    if(test.IsBetterWithScore(queryRegion, currentMatches[candidateId], candidates[candidateId], score))
+    {
+      numberOfAccepted++;
+    }
+  }
+
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+  double nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+
+  // Printing the results keeps the compiler from discarding the loop
+  std::cout << name << ": " << nanoseconds / candidates.size() << " ns per candidate ("
+            << numberOfAccepted << " accepted, score " << score << ")" << std::endl;
+}
+
+int main(int argc, char*argv[])
+{
+  unsigned int numberOfCandidates = 10000000;
+  if(argc > 1)
+  {
+    std::stringstream ss(argv[1]);
+    ss >> numberOfCandidates;
+  }
+
+  std::cout << "numberOfCandidates: " << numberOfCandidates << std::endl;
+
+  const unsigned int patchRadius = 3;
+  const unsigned int imageSize = 256;
+
+  // Every patch center is valid except for the left half of the image
+  itk::Index<2> imageCorner = {{0, 0}};
+  itk::Size<2> imageRegionSize = {{imageSize, imageSize}};
+  itk::ImageRegion<2> imageRegion(imageCorner, imageRegionSize);
+  itk::Image<bool, 2>::Pointer validPatchCentersImage = itk::Image<bool, 2>::New();
+  validPatchCentersImage->SetRegions(imageRegion);
+  validPatchCentersImage->Allocate();
+  for(unsigned int y = 0; y < imageSize; ++y)
+  {
+    for(unsigned int x = 0; x < imageSize; ++x)
+    {
+      itk::Index<2> index = {{x, y}};
+      validPatchCentersImage->SetPixel(index, x >= imageSize / 2);
+    }
+  }
+
+  std::mt19937 generator(0);
+  std::uniform_int_distribution<int> centerDistribution(patchRadius, imageSize - patchRadius - 1);
+  std::uniform_real_distribution<float> scoreDistribution(0.0f, 1.0f);
+
+  std::vector<Match> currentMatches(numberOfCandidates);
+  std::vector<Match> candidates(numberOfCandidates);
+  for(unsigned int candidateId = 0; candidateId < numberOfCandidates; ++candidateId)
+  {
+    itk::Index<2> center = {{centerDistribution(generator), centerDistribution(generator)}};
+    candidates[candidateId].SetRegion(ITKHelpers::GetRegionInRadiusAroundPixel(center, patchRadius));
+    candidates[candidateId].SetScore(scoreDistribution(generator));
+    currentMatches[candidateId].SetScore(scoreDistribution(generator));
+  }
+
+  itk::Index<2> queryCenter = {{imageSize / 2, imageSize / 2}};
+  itk::ImageRegion<2> queryRegion = ITKHelpers::GetRegionInRadiusAroundPixel(queryCenter, patchRadius);
+
+  AcceptanceTestSSD ssdTest;
+  Time("AcceptanceTestSSD", ssdTest, currentMatches, candidates, queryRegion);
+
+  AcceptanceTestChain<AcceptanceTestNoInstrumentation, AcceptanceTestSSD> chain;
+  Time("AcceptanceTestChain<AcceptanceTestSSD>", chain, currentMatches, candidates, queryRegion);
+
+  AcceptanceTestChain<AcceptanceTestSignalInstrumentation, AcceptanceTestSSD> signalChain;
+  Time("AcceptanceTestChain<AcceptanceTestSSD> with signals", signalChain, currentMatches, candidates, queryRegion);
+
+  VirtualAcceptanceTestComposite composite;
+  composite.AddAcceptanceTest(new VirtualAcceptanceTestAdapter<AcceptanceTestSSD>(ssdTest));
+  Time("Virtual composite of AcceptanceTestSSD", composite, currentMatches, candidates, queryRegion);
+
+  AcceptanceTestSourceRegion sourceRegionTest;
+  sourceRegionTest.SetValidPatchCentersImage(validPatchCentersImage);
+
+  AcceptanceTestChain<AcceptanceTestNoInstrumentation, AcceptanceTestSSD, AcceptanceTestSourceRegion> twoTestChain;
+  twoTestChain.GetTest<1>().SetValidPatchCentersImage(validPatchCentersImage);
+  Time("AcceptanceTestChain<AcceptanceTestSSD, AcceptanceTestSourceRegion>", twoTestChain,
+       currentMatches, candidates, queryRegion);
+
+  VirtualAcceptanceTestComposite twoTestComposite;
+  twoTestComposite.AddAcceptanceTest(new VirtualAcceptanceTestAdapter<AcceptanceTestSSD>(ssdTest));
+  twoTestComposite.AddAcceptanceTest(new VirtualAcceptanceTestAdapter<AcceptanceTestSourceRegion>(sourceRegionTest));
+  Time("Virtual composite of AcceptanceTestSSD, AcceptanceTestSourceRegion", twoTestComposite,
+       currentMatches, candidates, queryRegion);
+
+  return EXIT_SUCCESS;
+}
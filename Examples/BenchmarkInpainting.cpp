@@ -0,0 +1,162 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+/** This program compares hole-restricted inpainting with PatchMatch on the whole image. A rectangular hole
+  * is cut out of the middle of the image (for example data/dog.png), the hole is filled with PatchMatchInpainting,
+  * and then a whole-image NN field is computed with the same patch radius and number of iterations. */
+
+// STL
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <cmath>
+#include <string>
+
+// ITK
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkCovariantVector.h"
+
+// Submodules
+#include <Mask/Mask.h>
+#include <ITKHelpers/ITKHelpers.h>
+
+// Custom
+#include "BatchSSD.h"
+#include "PatchMatch.h"
+#include "Propagator.h"
+#include "RandomSearch.h"
+#include "Inpainting/PatchMatchInpainting.h"
+
+typedef itk::Image<itk::CovariantVector<unsigned char, 3>, 2> ImageType;
+
+int main(int argc, char*argv[])
+{
+  // Verify arguments
+  if(argc < 4)
+  {
+    std::cerr << "Required arguments: image patchRadius outputImage [holeFraction]" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Parse arguments
+  std::stringstream ss;
+  for(int i = 1; i < argc; ++i)
+  {
+    ss << argv[i] << " ";
+  }
+  std::string imageFilename;
+  unsigned int patchRadius;
+  std::string outputFilename;
+  float holeFraction = 0.1f;
+
+  ss >> imageFilename >> patchRadius >> outputFilename >> holeFraction;
+
+  // Output arguments
+  std::cout << "imageFilename: " << imageFilename << std::endl;
+  std::cout << "patchRadius: " << patchRadius << std::endl;
+  std::cout << "outputFilename: " << outputFilename << std::endl;
+  std::cout << "holeFraction: " << holeFraction << std::endl;
+
+  typedef itk::ImageFileReader<ImageType> ImageReaderType;
+  ImageReaderType::Pointer imageReader = ImageReaderType::New();
+  imageReader->SetFileName(imageFilename);
+  imageReader->Update();
+
+  ImageType* image = imageReader->GetOutput();
+  itk::ImageRegion<2> fullRegion = image->GetLargestPossibleRegion();
+
+  // A centered rectangular hole with 'holeFraction' of the image area
+  Mask::Pointer mask = Mask::New();
+  mask->SetRegions(fullRegion);
+  mask->Allocate();
+  ITKHelpers::SetImageToConstant(mask.GetPointer(), HoleMaskPixelTypeEnum::VALID);
+
+  itk::Size<2> holeSize;
+  itk::Index<2> holeCorner;
+  for(unsigned int dimension = 0; dimension < 2; ++dimension)
+  {
+    holeSize[dimension] = fullRegion.GetSize()[dimension] * std::sqrt(holeFraction);
+    holeCorner[dimension] = (fullRegion.GetSize()[dimension] - holeSize[dimension]) / 2;
+  }
+  itk::ImageRegion<2> holeRegion(holeCorner, holeSize);
+  std::vector<itk::Index<2> > holePixels = PatchMatchHelpers::GetAllPixelIndices(holeRegion);
+  for(size_t holePixelId = 0; holePixelId < holePixels.size(); ++holePixelId)
+  {
+    mask->SetHole(holePixels[holePixelId]);
+  }
+
+  std::cout << "Hole " << holeRegion << " has " << holePixels.size() << " of "
+            << fullRegion.GetNumberOfPixels() << " pixels." << std::endl;
+
+  const unsigned int iterations = 4;
+
+  // Hole-restricted inpainting
+  typedef PatchMatchInpainting<ImageType> InpaintingType;
+  InpaintingType inpainting;
+  inpainting.SetImage(image);
+  inpainting.SetMask(mask);
+  inpainting.SetPatchRadius(patchRadius);
+  inpainting.SetIterations(iterations);
+
+  std::chrono::steady_clock::time_point inpaintingStart = std::chrono::steady_clock::now();
+  inpainting.Inpaint();
+  std::chrono::steady_clock::time_point inpaintingEnd = std::chrono::steady_clock::now();
+
+  double inpaintingSeconds = std::chrono::duration<double>(inpaintingEnd - inpaintingStart).count();
+
+  ITKHelpers::WriteImage(inpainting.GetOutput(), outputFilename);
+
+  // Whole-image PatchMatch with the same patch radius and iterations
+  typedef BatchSSD<ImageType> PatchDistanceFunctorType;
+  PatchDistanceFunctorType patchDistanceFunctor;
+  patchDistanceFunctor.SetImage(image);
+
+  typedef Propagator<PatchDistanceFunctorType> PropagatorType;
+  PropagatorType propagator;
+  propagator.SetPatchRadius(patchRadius);
+  propagator.SetPatchDistanceFunctor(&patchDistanceFunctor);
+
+  typedef RandomSearch<ImageType, PatchDistanceFunctorType> RandomSearchType;
+  RandomSearchType randomSearch;
+  randomSearch.SetPatchRadius(patchRadius);
+  randomSearch.SetPatchDistanceFunctor(&patchDistanceFunctor);
+
+  typedef PatchMatch<ImageType, PropagatorType, RandomSearchType> PatchMatchType;
+  PatchMatchType patchMatch;
+  patchMatch.SetImage(image);
+  patchMatch.SetPatchRadius(patchRadius);
+  patchMatch.SetIterations(iterations);
+  patchMatch.SetPropagationFunctor(&propagator);
+  patchMatch.SetRandomSearchFunctor(&randomSearch);
+  patchMatch.SetWriteIntermediateFields(false);
+
+  std::chrono::steady_clock::time_point patchMatchStart = std::chrono::steady_clock::now();
+  patchMatch.Compute();
+  std::chrono::steady_clock::time_point patchMatchEnd = std::chrono::steady_clock::now();
+
+  double patchMatchSeconds = std::chrono::duration<double>(patchMatchEnd - patchMatchStart).count();
+
+  std::cout << "Inpainting: " << inpaintingSeconds << " s, "
+            << inpainting.GetNumberOfProcessedPixels() << " pixel updates" << std::endl;
+  std::cout << "Whole-image PatchMatch: " << patchMatchSeconds << " s" << std::endl;
+  std::cout << "Speedup: " << patchMatchSeconds / inpaintingSeconds << "x" << std::endl;
+
+  return EXIT_SUCCESS;
+}
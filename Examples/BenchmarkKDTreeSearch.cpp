@@ -0,0 +1,190 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+/** This program compares PatchMatch with its usual random search against PatchMatch with the kd-tree search.
+  * After every iteration it reports the elapsed time and the mean match score of each, and at the end the time
+  * the kd-tree search took to reach the final mean score of the random search. */
+
+// STL
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// ITK
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkCovariantVector.h"
+
+// Submodules
+#include <ITKHelpers/ITKHelpers.h>
+
+// Custom
+#include "BatchSSD.h"
+#include "KDTreeSearch.h"
+#include "PatchMatch.h"
+#include "Propagator.h"
+#include "RandomSearch.h"
+
+typedef itk::Image<itk::CovariantVector<unsigned char, 3>, 2> ImageType;
+
+typedef BatchSSD<ImageType> PatchDistanceFunctorType;
+typedef Propagator<PatchDistanceFunctorType> PropagatorType;
+
+/** The state of a run after one of its iterations. */
+struct Progress
+{
+  double Milliseconds;
+  double MeanScore;
+};
+
+double ComputeMeanScore(const NNFieldType* const nnField, const itk::ImageRegion<2>& internalRegion)
+{
+  double totalScore = 0.0;
+  itk::ImageRegionConstIterator<NNFieldType> nnFieldIterator(nnField, internalRegion);
+  while(!nnFieldIterator.IsAtEnd())
+  {
+    totalScore += nnFieldIterator.Get().GetScore();
+    ++nnFieldIterator;
+  }
+  return totalScore / internalRegion.GetNumberOfPixels();
+}
+
+template <typename TSearch>
+std::vector<Progress> Run(ImageType* const image, TSearch* const search, const unsigned int patchRadius,
+                          const unsigned int iterations)
+{
+  PatchDistanceFunctorType patchDistanceFunctor;
+  patchDistanceFunctor.SetImage(image);
+
+  PropagatorType propagator;
+  propagator.SetPatchRadius(patchRadius);
+  propagator.SetPatchDistanceFunctor(&patchDistanceFunctor);
+
+  search->SetPatchRadius(patchRadius);
+  search->SetPatchDistanceFunctor(&patchDistanceFunctor);
+
+  PatchMatch<ImageType, PropagatorType, TSearch> patchMatch;
+  patchMatch.SetImage(image);
+  patchMatch.SetPatchRadius(patchRadius);
+  patchMatch.SetIterations(iterations);
+  patchMatch.SetWriteIntermediateFields(false);
+  patchMatch.SetPropagationFunctor(&propagator);
+  patchMatch.SetRandomSearchFunctor(search);
+
+  itk::ImageRegion<2> internalRegion = ITKHelpers::GetInternalRegion(image->GetLargestPossibleRegion(), patchRadius);
+
+  std::vector<Progress> progress;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  unsigned int numberOfUpdates = 0;
+
+  // The field is updated after the propagation and after the search of every iteration
+  patchMatch.UpdatedSignal.connect([&](NNFieldType* nnField)
+  {
+    if(++numberOfUpdates % 2 == 1)
+    {
+      return;
+    }
+
+    // The scoring is not part of the timing
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    Progress iterationProgress;
+    iterationProgress.Milliseconds = std::chrono::duration<double, std::milli>(now - start).count();
+    iterationProgress.MeanScore = ComputeMeanScore(nnField, internalRegion);
+    progress.push_back(iterationProgress);
+    start += std::chrono::steady_clock::now() - now;
+  });
+
+  patchMatch.Compute();
+
+  return progress;
+}
+
+int main(int argc, char*argv[])
+{
+  // Verify arguments
+  if(argc < 3)
+  {
+    std::cerr << "Required arguments: image patchRadius [iterations numberOfComponents]" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Parse arguments
+  std::stringstream ss;
+  for(int i = 1; i < argc; ++i)
+  {
+    ss << argv[i] << " ";
+  }
+  std::string imageFilename;
+  unsigned int patchRadius;
+  unsigned int iterations = 5;
+  unsigned int numberOfComponents = 8;
+
+  ss >> imageFilename >> patchRadius >> iterations >> numberOfComponents;
+
+  // Output arguments
+  std::cout << "imageFilename: " << imageFilename << std::endl;
+  std::cout << "patchRadius: " << patchRadius << std::endl;
+  std::cout << "iterations: " << iterations << std::endl;
+  std::cout << "numberOfComponents: " << numberOfComponents << std::endl;
+
+  typedef itk::ImageFileReader<ImageType> ImageReaderType;
+  ImageReaderType::Pointer imageReader = ImageReaderType::New();
+  imageReader->SetFileName(imageFilename);
+  imageReader->Update();
+
+  ImageType* image = imageReader->GetOutput();
+
+  RandomSearch<ImageType, PatchDistanceFunctorType> randomSearch;
+  randomSearch.SetRandom(false);
+  std::vector<Progress> randomProgress = Run(image, &randomSearch, patchRadius, iterations);
+
+  KDTreeSearch<ImageType, PatchDistanceFunctorType> kdTreeSearch;
+  kdTreeSearch.SetNumberOfComponents(numberOfComponents);
+  srand(0);
+  std::vector<Progress> kdTreeProgress = Run(image, &kdTreeSearch, patchRadius, iterations);
+
+  std::cout << "PCA explained variance: " << kdTreeSearch.GetPatchPCA()->GetExplainedVariance() << std::endl;
+
+  std::cout << "iteration\trandom ms\trandom mean score\tkd-tree ms\tkd-tree mean score" << std::endl;
+  for(unsigned int iteration = 0; iteration < iterations; ++iteration)
+  {
+    std::cout << iteration << "\t" << randomProgress[iteration].Milliseconds << "\t"
+              << randomProgress[iteration].MeanScore << "\t" << kdTreeProgress[iteration].Milliseconds << "\t"
+              << kdTreeProgress[iteration].MeanScore << std::endl;
+  }
+
+  // The kd-tree time includes building the tree in the first iteration
+  const Progress& randomFinal = randomProgress.back();
+  for(unsigned int iteration = 0; iteration < iterations; ++iteration)
+  {
+    if(kdTreeProgress[iteration].MeanScore <= randomFinal.MeanScore)
+    {
+      std::cout << "The kd-tree search reached the final random search mean score after " << iteration + 1
+                << " iterations, " << randomFinal.Milliseconds / kdTreeProgress[iteration].Milliseconds
+                << " times faster." << std::endl;
+      return EXIT_SUCCESS;
+    }
+  }
+
+  std::cout << "The kd-tree search did not reach the final random search mean score." << std::endl;
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,179 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+/** This program compares a multithreaded search whose NN field is first written by the main thread with one
+  * whose field is first written by the workers that update it, and whose source image is copied to every NUMA
+  * node. For each, it reports the search time and the fraction of the pages placed during the run that went
+  * to a node other than the one the allocating thread ran on (from the kernel's numastat counters, when they
+  * are available). Node binding needs a build with PatchMatch_UseNUMA. */
+
+// STL
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// ITK
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkCovariantVector.h"
+
+// Submodules
+#include <ITKHelpers/ITKHelpers.h>
+
+// Custom
+#include "AtomicNNField.h"
+#include "BatchSSD.h"
+#include "ConcurrentSearch.h"
+#include "NUMAHelpers.h"
+#include "PatchMatchHelpers.h"
+
+typedef itk::Image<itk::CovariantVector<unsigned char, 3>, 2> ImageType;
+
+typedef BatchSSD<ImageType> PatchDistanceFunctorType;
+
+/** Read the counters of every node. Returns false if they are not available. */
+bool GetStatistics(std::vector<NUMAHelpers::NodeStatistics>& statistics)
+{
+  statistics.resize(NUMAHelpers::GetNumberOfNodes());
+  for(unsigned int node = 0; node < statistics.size(); ++node)
+  {
+    if(!NUMAHelpers::GetNodeStatistics(node, statistics[node]))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+void Run(const std::string& name, ImageType* const image, const NNFieldType* const initialField,
+         PatchDistanceFunctorType* const patchDistanceFunctor, const unsigned int patchRadius,
+         const unsigned int iterations, const unsigned int numberOfThreads, const bool numaAware)
+{
+  std::vector<NUMAHelpers::NodeStatistics> statisticsBefore;
+  bool haveStatistics = GetStatistics(statisticsBefore);
+
+  AtomicNNField nnField;
+  nnField.CopyFrom(initialField, image->GetLargestPossibleRegion(), patchRadius, numaAware ? numberOfThreads : 1);
+
+  ConcurrentSearch<PatchDistanceFunctorType> search;
+  search.SetPatchRadius(patchRadius);
+  search.SetPatchDistanceFunctor(patchDistanceFunctor);
+  search.SetIterations(iterations);
+  search.SetNumberOfThreads(numberOfThreads);
+  search.SetReplicateSourceImage(numaAware);
+  search.SetRandom(false);
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  size_t numberOfUpdates = search.Search(&nnField);
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+  std::cout << name << ": " << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count()
+            << " ms, " << numberOfUpdates << " updates";
+
+  std::vector<NUMAHelpers::NodeStatistics> statisticsAfter;
+  haveStatistics = haveStatistics && GetStatistics(statisticsAfter);
+  if(haveStatistics)
+  {
+    uint64_t localPages = 0;
+    uint64_t remotePages = 0;
+    for(unsigned int node = 0; node < statisticsAfter.size(); ++node)
+    {
+      localPages += statisticsAfter[node].LocalNode - statisticsBefore[node].LocalNode;
+      remotePages += statisticsAfter[node].OtherNode - statisticsBefore[node].OtherNode;
+    }
+
+    // The counters are system wide, so other processes add noise
+    std::cout << ", remote page placement ratio "
+              << (localPages + remotePages > 0 ? static_cast<double>(remotePages) / (localPages + remotePages) : 0.0)
+              << " (" << remotePages << " of " << localPages + remotePages << " pages)";
+  }
+  else
+  {
+    std::cout << ", NUMA statistics not available";
+  }
+  std::cout << std::endl;
+}
+
+int main(int argc, char*argv[])
+{
+  // Verify arguments
+  if(argc < 3)
+  {
+    std::cerr << "Required arguments: image patchRadius [iterations numberOfThreads]" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Parse arguments
+  std::stringstream ss;
+  for(int i = 1; i < argc; ++i)
+  {
+    ss << argv[i] << " ";
+  }
+  std::string imageFilename;
+  unsigned int patchRadius;
+  unsigned int iterations = 5;
+  unsigned int numberOfThreads = 0;
+
+  ss >> imageFilename >> patchRadius >> iterations >> numberOfThreads;
+
+  // Output arguments
+  std::cout << "imageFilename: " << imageFilename << std::endl;
+  std::cout << "patchRadius: " << patchRadius << std::endl;
+  std::cout << "iterations: " << iterations << std::endl;
+  std::cout << "numberOfThreads: " << numberOfThreads << std::endl;
+  std::cout << "NUMA nodes: " << NUMAHelpers::GetNumberOfNodes() << std::endl;
+
+  typedef itk::ImageFileReader<ImageType> ImageReaderType;
+  ImageReaderType::Pointer imageReader = ImageReaderType::New();
+  imageReader->SetFileName(imageFilename);
+  imageReader->Update();
+
+  ImageType* image = imageReader->GetOutput();
+
+  PatchDistanceFunctorType patchDistanceFunctor;
+  patchDistanceFunctor.SetImage(image);
+
+  // The same random initialization is used for both runs
+  itk::ImageRegion<2> internalRegion = ITKHelpers::GetInternalRegion(image->GetLargestPossibleRegion(), patchRadius);
+
+  NNFieldType::Pointer initialField = NNFieldType::New();
+  initialField->SetRegions(image->GetLargestPossibleRegion());
+  initialField->Allocate();
+  initialField->FillBuffer(Match());
+
+  itk::ImageRegionIteratorWithIndex<NNFieldType> initialFieldIterator(initialField, internalRegion);
+  while(!initialFieldIterator.IsAtEnd())
+  {
+    Match match;
+    match.SetRegion(PatchMatchHelpers::GetRandomRegionInRegion(internalRegion, patchRadius));
+    match.SetScore(patchDistanceFunctor.Distance(match.GetRegion(),
+                   ITKHelpers::GetRegionInRadiusAroundPixel(initialFieldIterator.GetIndex(), patchRadius)));
+    initialFieldIterator.Set(match);
+    ++initialFieldIterator;
+  }
+
+  Run("First touch by the main thread", image, initialField, &patchDistanceFunctor, patchRadius,
+      iterations, numberOfThreads, false);
+  Run("First touch by the workers, replicated source", image, initialField, &patchDistanceFunctor, patchRadius,
+      iterations, numberOfThreads, true);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,283 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+/** This program compares the throughput and the cache and TLB misses of scoring randomly placed candidate
+  * patches on a wide image, as random search does, with the source image in row-major order (BatchSSD on the
+  * ITK buffer and PaddedSSD on a float copy) and in Z-ordered tiles (TiledSSD). It fails if the layouts do not
+  * give the same scores. The misses are read from the Linux performance counters when they are available.
+  * Usage: BenchmarkTiledImage [width height]  (default 8192 1024) */
+
+// STL
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// ITK
+#include "itkImage.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkCovariantVector.h"
+
+// Custom
+#include "BatchSSD.h"
+#include "PaddedSSD.h"
+#include "TiledSSD.h"
+
+typedef itk::Image<itk::CovariantVector<unsigned char, 3>, 2> ImageType;
+
+/** A hardware event counter of the calling thread, which reads as -1 if the event cannot be counted. */
+class PerformanceCounter
+{
+public:
+  PerformanceCounter(const unsigned int type, const unsigned long long config)
+  {
+#ifdef __linux__
+    perf_event_attr attributes;
+    std::memset(&attributes, 0, sizeof(attributes));
+    attributes.size = sizeof(attributes);
+    attributes.type = type;
+    attributes.config = config;
+    attributes.disabled = 1;
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+    this->FileDescriptor = syscall(__NR_perf_event_open, &attributes, 0, -1, -1, 0);
+#else
+    (void)type;
+    (void)config;
+#endif
+  }
+
+  ~PerformanceCounter()
+  {
+#ifdef __linux__
+    if(this->FileDescriptor >= 0)
+    {
+      close(this->FileDescriptor);
+    }
+#endif
+  }
+
+  void Start()
+  {
+#ifdef __linux__
+    if(this->FileDescriptor >= 0)
+    {
+      ioctl(this->FileDescriptor, PERF_EVENT_IOC_RESET, 0);
+      ioctl(this->FileDescriptor, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+  }
+
+  long long Stop()
+  {
+    long long count = -1;
+#ifdef __linux__
+    if(this->FileDescriptor >= 0)
+    {
+      ioctl(this->FileDescriptor, PERF_EVENT_IOC_DISABLE, 0);
+      if(read(this->FileDescriptor, &count, sizeof(count)) != sizeof(count))
+      {
+        count = -1;
+      }
+    }
+#endif
+    return count;
+  }
+
+private:
+  int FileDescriptor = -1;
+};
+
+/** A query patch and the candidates it is scored against in one batch. */
+struct Query
+{
+  itk::ImageRegion<2> Region;
+
+  std::vector<itk::ImageRegion<2> > Candidates;
+};
+
+template <typename TDistanceFunctor>
+bool Benchmark(const std::string& name, TDistanceFunctor& distanceFunctor, const std::vector<Query>& queries,
+               std::vector<float>& checksums)
+{
+#ifdef __linux__
+  PerformanceCounter cacheMisses(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+  PerformanceCounter tlbMisses(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                                   (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+#else
+  PerformanceCounter cacheMisses(0, 0);
+  PerformanceCounter tlbMisses(0, 0);
+#endif
+
+  // Make the copies of the images outside of the measurement
+  std::vector<float> scores;
+  distanceFunctor.Distance(queries[0].Region, queries[0].Candidates, scores);
+
+  size_t numberOfCandidates = 0;
+  std::vector<float> queryChecksums(queries.size());
+
+  cacheMisses.Start();
+  tlbMisses.Start();
+  auto start = std::chrono::steady_clock::now();
+
+  for(size_t queryId = 0; queryId < queries.size(); ++queryId)
+  {
+    distanceFunctor.Distance(queries[queryId].Region, queries[queryId].Candidates, scores);
+
+    float checksum = 0.0f;
+    for(size_t candidateId = 0; candidateId < scores.size(); ++candidateId)
+    {
+      checksum += scores[candidateId];
+    }
+    queryChecksums[queryId] = checksum;
+    numberOfCandidates += scores.size();
+  }
+
+  auto end = std::chrono::steady_clock::now();
+  long long numberOfCacheMisses = cacheMisses.Stop();
+  long long numberOfTLBMisses = tlbMisses.Stop();
+
+  double seconds = std::chrono::duration<double>(end - start).count();
+
+  std::cout << std::left << std::setw(28) << name << std::right << std::fixed << std::setprecision(2)
+            << std::setw(10) << numberOfCandidates / seconds / 1e6 << " M patches/s";
+  if(numberOfCacheMisses >= 0)
+  {
+    std::cout << std::setw(10) << static_cast<double>(numberOfCacheMisses) / numberOfCandidates << " cache misses/patch";
+  }
+  else
+  {
+    std::cout << "      (cache misses unavailable)";
+  }
+  if(numberOfTLBMisses >= 0)
+  {
+    std::cout << std::setw(10) << static_cast<double>(numberOfTLBMisses) / numberOfCandidates << " dTLB misses/patch";
+  }
+  std::cout << std::endl;
+
+  if(checksums.empty())
+  {
+    checksums = queryChecksums;
+    return true;
+  }
+
+  // The layouts add the same values in the same order, so the scores are identical
+  if(queryChecksums != checksums)
+  {
+    std::cerr << name << " computed different scores than the first layout!" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char* argv[])
+{
+  itk::SizeValueType width = 8192;
+  itk::SizeValueType height = 1024;
+  if(argc >= 3)
+  {
+    width = std::atoi(argv[1]);
+    height = std::atoi(argv[2]);
+  }
+
+  const unsigned int patchRadius = 3;
+  const unsigned int numberOfQueries = 200000;
+  const unsigned int candidatesPerQuery = 12;
+
+  itk::Index<2> corner = {{0, 0}};
+  itk::Size<2> size = {{width, height}};
+  itk::ImageRegion<2> region(corner, size);
+
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions(region);
+  image->Allocate();
+
+  std::mt19937 generator(0);
+  std::uniform_int_distribution<int> valueDistribution(0, 255);
+
+  itk::ImageRegionIteratorWithIndex<ImageType> imageIterator(image, region);
+  while(!imageIterator.IsAtEnd())
+  {
+    ImageType::PixelType pixel;
+    for(unsigned int component = 0; component < 3; ++component)
+    {
+      pixel[component] = valueDistribution(generator);
+    }
+    imageIterator.Set(pixel);
+    ++imageIterator;
+  }
+
+  // The queries sweep the image in raster order, as the propagation does, and their candidates are spread over
+  // the whole image, as the first candidates of the random search are
+  std::uniform_int_distribution<itk::IndexValueType> xDistribution(0, width - 2 * patchRadius - 1);
+  std::uniform_int_distribution<itk::IndexValueType> yDistribution(0, height - 2 * patchRadius - 1);
+  itk::Size<2> patchSize = {{2 * patchRadius + 1, 2 * patchRadius + 1}};
+
+  std::vector<Query> queries(numberOfQueries);
+  for(unsigned int queryId = 0; queryId < numberOfQueries; ++queryId)
+  {
+    itk::Index<2> queryCorner = {{static_cast<itk::IndexValueType>(queryId % (width - 2 * patchRadius)),
+                                  static_cast<itk::IndexValueType>(queryId / (width - 2 * patchRadius) %
+                                                                   (height - 2 * patchRadius))}};
+    queries[queryId].Region = itk::ImageRegion<2>(queryCorner, patchSize);
+    for(unsigned int candidateId = 0; candidateId < candidatesPerQuery; ++candidateId)
+    {
+      itk::Index<2> candidateCorner = {{xDistribution(generator), yDistribution(generator)}};
+      queries[queryId].Candidates.push_back(itk::ImageRegion<2>(candidateCorner, patchSize));
+    }
+  }
+
+  std::cout << "Scoring " << numberOfQueries * candidatesPerQuery << " random " << patchSize[0] << "x" << patchSize[1]
+            << " patches on a " << width << "x" << height << " image." << std::endl;
+
+  std::vector<float> checksums;
+  bool passed = true;
+
+  BatchSSD<ImageType> batchSSD;
+  batchSSD.SetImage(image);
+  passed &= Benchmark("Row-major (ITK buffer)", batchSSD, queries, checksums);
+
+  PaddedSSD<ImageType> paddedSSD;
+  paddedSSD.SetImage(image);
+  passed &= Benchmark("Row-major (padded floats)", paddedSSD, queries, checksums);
+
+  for(unsigned int tileSizeLog2 = 3; tileSizeLog2 <= 5; ++tileSizeLog2)
+  {
+    TiledSSD<ImageType> tiledSSD;
+    tiledSSD.SetImage(image);
+    tiledSSD.SetTileSizeLog2(tileSizeLog2);
+    std::stringstream name;
+    name << "Z-order tiles (" << (1 << tileSizeLog2) << "x" << (1 << tileSizeLog2) << ")";
+    passed &= Benchmark(name.str(), tiledSSD, queries, checksums);
+  }
+
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,144 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#ifndef Initializer_H
+#define Initializer_H
+
+// ITK
+#include "itkImage.h"
+
+// STL
+#include <vector>
+
+// Submodules
+#include <ITKHelpers/ITKHelpers.h>
+
+// Custom
+#include "Arena.h"
+#include "Match.h"
+#include "MeanVarianceBound.h"
+#include "NNField.h"
+#include "PatchMatchHelpers.h"
+
+/** The interface of classes that create an initial NNField (or part of one) for PatchMatch to refine. */
+class Initializer
+{
+public:
+  virtual ~Initializer() {}
+
+  /** Set the matches of the pixels this initializer is responsible for in 'nnField'. */
+  virtual void Initialize(NNFieldType* const nnField) = 0;
+};
+
+/** An initializer that works on patches of a fixed radius. The source patches it may use are the ones centered
+  * on 'true' pixels of the SourceValidPatchCentersImage (or every patch inside the NNField if it is not set),
+  * and the target pixels it initializes are the TargetPixels (or every pixel of the internal region if they are not set). */
+class InitializerPatch : public Initializer
+{
+public:
+  InitializerPatch() {}
+
+  InitializerPatch(const unsigned int patchRadius) : PatchRadius(patchRadius) {}
+
+  /** Create the 'initialization' image. */
+  virtual void Initialize(NNFieldType* const nnField) = 0;
+
+  void SetPatchRadius(const unsigned int patchRadius)
+  {
+    this->PatchRadius = patchRadius;
+  }
+
+  /** Set the image (the size of the NNField) where 'true' pixels are the centers of patches that may be used as matches. */
+  void SetSourceValidPatchCentersImage(itk::Image<bool, 2>* const sourceValidPatchCentersImage)
+  {
+    this->SourceValidPatchCentersImage = sourceValidPatchCentersImage;
+  }
+
+  /** Set the pixels to initialize. */
+  void SetTargetPixels(const std::vector<itk::Index<2> >& targetPixels)
+  {
+    this->TargetPixels = targetPixels;
+  }
+
+  /** Set the arena from which the temporary pixel lists are drawn. If it is not set, an arena owned by this
+    * initializer is used. */
+  void SetArena(Arena* const arena)
+  {
+    this->TemporaryArena = arena;
+  }
+
+  /** Set the mean/variance bound used to skip the patch distance of candidates that cannot beat the best one
+    * found so far. Only initializers that compare several candidates use it. This is optional. */
+  void SetMeanVarianceBound(MeanVarianceBound* const meanVarianceBound)
+  {
+    this->DistanceBound = meanVarianceBound;
+  }
+
+protected:
+
+  unsigned int PatchRadius = 0;
+
+  itk::Image<bool, 2>* SourceValidPatchCentersImage = nullptr;
+
+  std::vector<itk::Index<2> > TargetPixels;
+
+  /** The bound set with SetMeanVarianceBound(), if any. */
+  MeanVarianceBound* DistanceBound = nullptr;
+
+  /** The arena set with SetArena(), if any. */
+  Arena* TemporaryArena = nullptr;
+
+  /** The arena used when none was set. */
+  Arena OwnArena;
+
+  /** Get the arena to draw temporary buffers from. */
+  Arena* GetArena()
+  {
+    return this->TemporaryArena ? this->TemporaryArena : &this->OwnArena;
+  }
+
+  /** Determine if the patch centered at 'center' may be used as a match in 'nnField'. */
+  bool IsValidSourceCenter(const NNFieldType* const nnField, const itk::Index<2>& center) const
+  {
+    itk::ImageRegion<2> internalRegion = ITKHelpers::GetInternalRegion(nnField->GetLargestPossibleRegion(), this->PatchRadius);
+    if(!internalRegion.IsInside(center))
+    {
+      return false;
+    }
+
+    return !this->SourceValidPatchCentersImage || this->SourceValidPatchCentersImage->GetPixel(center);
+  }
+
+  /** Append the TargetPixels, or every pixel of the internal region of 'nnField' if none were set, to 'targetPixels'. */
+  void GetTargetPixels(const NNFieldType* const nnField, ArenaVector<itk::Index<2> >& targetPixels) const
+  {
+    if(!this->TargetPixels.empty())
+    {
+      targetPixels.insert(targetPixels.end(), this->TargetPixels.begin(), this->TargetPixels.end());
+      return;
+    }
+
+    itk::ImageRegion<2> internalRegion = ITKHelpers::GetInternalRegion(nnField->GetLargestPossibleRegion(),
+                                                                       this->PatchRadius);
+    targetPixels.reserve(targetPixels.size() + internalRegion.GetNumberOfPixels());
+    PatchMatchHelpers::AppendAllPixelIndices(internalRegion, targetPixels);
+  }
+};
+
+#endif
@@ -0,0 +1,219 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef InitializerCSH_H
+#define InitializerCSH_H
+
+#include "Initializer.h"
+
+// ITK
+#include "itkDefaultConvertPixelTraits.h"
+
+// STL
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/** Initialize the target pixels with coherency sensitive hashing ("Coherency Sensitive Hashing", Korman and
+  * Avidan, ICCV 2011). Every patch gets a descriptor made of its lowest sequency Walsh-Hadamard coefficients, and
+  * the source descriptors are hashed into several locality sensitive hash tables, which are built in parallel.
+  * The candidates of a target patch are the source patches in its own buckets, plus the patches in the buckets
+  * of its 4 neighbors shifted by the offset to the neighbor (since neighboring patches tend to have neighboring
+  * matches). The candidates closest in descriptor space are scored with the patch distance functor, and the best
+  * one is kept if the pixel has no match yet or it is better than the current one.
+  * The SourceValidPatchCentersImage, if set, is the size of the source image. */
+template <typename TImage, typename TPatchDistanceFunctor>
+class InitializerCSH : public InitializerPatch
+{
+public:
+  typedef typename TImage::PixelType PixelType;
+  typedef itk::DefaultConvertPixelTraits<PixelType> PixelTraitsType;
+
+  /** Set the matches of the target pixels in 'nnField'. */
+  virtual void Initialize(NNFieldType* const nnField);
+
+  /** Set the image on which to operate when matching an image against itself. */
+  void SetImage(TImage* const image)
+  {
+    this->SourceImage = image;
+    this->TargetImage = image;
+  }
+
+  /** Set the image from which matches are drawn. */
+  void SetSourceImage(TImage* const sourceImage)
+  {
+    this->SourceImage = sourceImage;
+  }
+
+  /** Set the image for which the NNField is computed. */
+  void SetTargetImage(TImage* const targetImage)
+  {
+    this->TargetImage = targetImage;
+  }
+
+  void SetPatchDistanceFunctor(TPatchDistanceFunctor* const patchDistanceFunctor)
+  {
+    this->PatchDistanceFunctor = patchDistanceFunctor;
+  }
+
+  /** Set the number of hash tables. More tables give more candidates per patch. */
+  void SetNumberOfTables(const unsigned int numberOfTables)
+  {
+    this->NumberOfTables = numberOfTables;
+  }
+
+  /** Set the number of random projections that are quantized and combined into the hash of each table.
+    * More projections give smaller buckets. */
+  void SetNumberOfProjections(const unsigned int numberOfProjections)
+  {
+    this->NumberOfProjections = numberOfProjections;
+  }
+
+  /** Set the quantization step of the projections, relative to their standard deviation over the source patches. */
+  void SetBucketWidth(const float bucketWidth)
+  {
+    this->BucketWidth = bucketWidth;
+  }
+
+  /** Set the number of Walsh-Hadamard coefficients of each pixel component in a descriptor. */
+  void SetNumberOfKernels(const unsigned int numberOfKernels)
+  {
+    this->NumberOfKernels = numberOfKernels;
+  }
+
+  /** Set the largest number of candidates taken from one bucket. */
+  void SetMaximumCandidatesPerBucket(const unsigned int maximumCandidatesPerBucket)
+  {
+    this->MaximumCandidatesPerBucket = maximumCandidatesPerBucket;
+  }
+
+  /** Set the number of candidates (the closest in descriptor space) that are scored with the patch distance functor. */
+  void SetNumberOfCandidatesToScore(const unsigned int numberOfCandidatesToScore)
+  {
+    this->NumberOfCandidatesToScore = numberOfCandidatesToScore;
+  }
+
+  /** Set the number of threads that compute the descriptors and build the tables. If this is 0, one thread
+    * per core is used. */
+  void SetNumberOfThreads(const unsigned int numberOfThreads)
+  {
+    this->NumberOfThreads = numberOfThreads;
+  }
+
+  /** Set the seed of the random projections. */
+  void SetSeed(const unsigned int seed)
+  {
+    this->Seed = seed;
+  }
+
+private:
+  TImage* SourceImage = nullptr;
+
+  TImage* TargetImage = nullptr;
+
+  TPatchDistanceFunctor* PatchDistanceFunctor = nullptr;
+
+  unsigned int NumberOfTables = 4;
+
+  unsigned int NumberOfProjections = 4;
+
+  float BucketWidth = 0.5f;
+
+  unsigned int NumberOfKernels = 6;
+
+  unsigned int MaximumCandidatesPerBucket = 4;
+
+  unsigned int NumberOfCandidatesToScore = 8;
+
+  unsigned int NumberOfThreads = 0;
+
+  unsigned int Seed = 0;
+
+  /** The side length of the (power of two) window at the center of a patch that the kernels are applied to. */
+  unsigned int KernelSideLength = 0;
+
+  /** The Walsh-Hadamard kernels, KernelSideLength * KernelSideLength values each. */
+  std::vector<float> Kernels;
+
+  /** The length of a descriptor. */
+  unsigned int DescriptorLength = 0;
+
+  /** The descriptors of the pixels of the source and target images, DescriptorLength values each. Only the
+    * entries of patches that are used are computed. */
+  std::vector<float> SourceDescriptors;
+  std::vector<float> TargetDescriptors;
+
+  /** Whether the patch centered at each source pixel may be a match. */
+  std::vector<unsigned char> ValidSourceCenters;
+
+  /** The centers of the valid source patches. */
+  std::vector<itk::Index<2> > SourceCenters;
+
+  /** A locality sensitive hash table. */
+  struct HashTable
+  {
+    /** NumberOfProjections directions, DescriptorLength values each. */
+    std::vector<float> Directions;
+
+    /** The quantization offset and step of each projection. */
+    std::vector<float> Offsets;
+    std::vector<float> Widths;
+
+    /** The hash and offset (in the source image) of every valid source patch, sorted by hash. */
+    std::vector<std::pair<uint64_t, unsigned int> > Entries;
+
+    /** The hash of every pixel of the target image (0 for pixels that are not patch centers). */
+    std::vector<uint64_t> TargetHashes;
+  };
+
+  std::vector<HashTable> Tables;
+
+  /** The candidates (source image offsets) of the pixel currently being initialized. These are members so that
+    * their memory is reused. */
+  std::vector<unsigned int> CandidateOffsets;
+  std::vector<std::pair<float, unsigned int> > RankedCandidates;
+  std::vector<itk::ImageRegion<2> > CandidateRegions;
+  std::vector<float> CandidateScores;
+
+  /** Create the Walsh-Hadamard kernels for the current PatchRadius. */
+  void CreateKernels();
+
+  /** Compute the descriptors of the patches of 'image' centered at the pixels of 'centers' whose entry is not
+    * zero, using several threads. */
+  void ComputeDescriptors(const TImage* const image, const std::vector<unsigned char>& centers,
+                          std::vector<float>& descriptors);
+
+  /** Compute the descriptor of the patch of 'image' centered at 'center'. */
+  void ComputeDescriptor(const TImage* const image, const itk::Index<2>& center, float* const descriptor) const;
+
+  /** Create the projections of table 'tableId', hash the source patches into it and hash the target pixels. */
+  void BuildTable(const unsigned int tableId, const std::vector<unsigned char>& targetCenters);
+
+  /** Compute the hash of 'descriptor' in 'table'. */
+  uint64_t ComputeHash(const HashTable& table, const float* const descriptor) const;
+
+  /** Add (some of) the source patches of the bucket 'hash' of 'table', shifted by 'shift', to the CandidateOffsets. */
+  void AddBucket(const HashTable& table, const uint64_t hash, const itk::Offset<2>& shift, const unsigned int pick);
+
+  /** Get the number of threads to use. */
+  unsigned int GetNumberOfThreads() const;
+};
+
+#include "InitializerCSH.hpp"
+
+#endif
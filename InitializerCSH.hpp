@@ -0,0 +1,528 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef InitializerCSH_HPP
+#define InitializerCSH_HPP
+
+#include "InitializerCSH.h"
+
+// STL
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <functional>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+// Submodules
+#include <ITKHelpers/ITKHelpers.h>
+
+// Custom
+#include "PatchMatchHelpers.h"
+
+template <typename TImage, typename TPatchDistanceFunctor>
+void InitializerCSH<TImage, TPatchDistanceFunctor>::Initialize(NNFieldType* const nnField)
+{
+  assert(nnField);
+  assert(this->SourceImage);
+  assert(this->TargetImage);
+  assert(this->PatchDistanceFunctor);
+  assert(this->NumberOfTables > 0);
+  assert(this->NumberOfProjections > 0);
+  assert(nnField->GetLargestPossibleRegion() == this->TargetImage->GetLargestPossibleRegion());
+
+  itk::ImageRegion<2> sourceRegion = this->SourceImage->GetLargestPossibleRegion();
+  itk::ImageRegion<2> sourceInternalRegion = ITKHelpers::GetInternalRegion(sourceRegion, this->PatchRadius);
+  itk::ImageRegion<2> targetRegion = this->TargetImage->GetLargestPossibleRegion();
+  itk::ImageRegion<2> targetInternalRegion = ITKHelpers::GetInternalRegion(targetRegion, this->PatchRadius);
+
+  CreateKernels();
+
+  // Find the source patches that may be used
+  this->ValidSourceCenters.assign(sourceRegion.GetNumberOfPixels(), 0);
+  this->SourceCenters.clear();
+  for(itk::IndexValueType y = sourceInternalRegion.GetIndex()[1];
+      y < sourceInternalRegion.GetIndex()[1] + static_cast<itk::IndexValueType>(sourceInternalRegion.GetSize()[1]); ++y)
+  {
+    for(itk::IndexValueType x = sourceInternalRegion.GetIndex()[0];
+        x < sourceInternalRegion.GetIndex()[0] + static_cast<itk::IndexValueType>(sourceInternalRegion.GetSize()[0]); ++x)
+    {
+      itk::Index<2> center = {{x, y}};
+      if(!this->SourceValidPatchCentersImage || this->SourceValidPatchCentersImage->GetPixel(center))
+      {
+        this->ValidSourceCenters[this->SourceImage->ComputeOffset(center)] = 1;
+        this->SourceCenters.push_back(center);
+      }
+    }
+  }
+
+  if(this->SourceCenters.empty())
+  {
+    throw std::runtime_error("InitializerCSH: No valid source regions!");
+  }
+
+  Arena::Scope scope(GetArena());
+  ArenaVector<itk::Index<2> > targetPixels(GetArena());
+  GetTargetPixels(nnField, targetPixels);
+
+  // The target patches that are needed are the ones to initialize and their neighbors
+  const itk::Offset<2> neighborOffsets[4] = {{{-1, 0}}, {{1, 0}}, {{0, -1}}, {{0, 1}}};
+
+  std::vector<unsigned char> targetCenters(targetRegion.GetNumberOfPixels(), 0);
+  for(size_t targetPixelId = 0; targetPixelId < targetPixels.size(); ++targetPixelId)
+  {
+    if(!targetInternalRegion.IsInside(targetPixels[targetPixelId]))
+    {
+      continue;
+    }
+
+    targetCenters[this->TargetImage->ComputeOffset(targetPixels[targetPixelId])] = 1;
+    for(unsigned int neighborId = 0; neighborId < 4; ++neighborId)
+    {
+      itk::Index<2> neighbor = targetPixels[targetPixelId] + neighborOffsets[neighborId];
+      if(targetInternalRegion.IsInside(neighbor))
+      {
+        targetCenters[this->TargetImage->ComputeOffset(neighbor)] = 1;
+      }
+    }
+  }
+
+  ComputeDescriptors(this->SourceImage, this->ValidSourceCenters, this->SourceDescriptors);
+  ComputeDescriptors(this->TargetImage, targetCenters, this->TargetDescriptors);
+
+  // The tables are independent, so each thread builds every numberOfThreads'th one
+  this->Tables.resize(this->NumberOfTables);
+  const unsigned int numberOfThreads = std::min(GetNumberOfThreads(), this->NumberOfTables);
+
+  std::vector<std::thread> threads;
+  for(unsigned int threadId = 0; threadId < numberOfThreads; ++threadId)
+  {
+    threads.push_back(std::thread([this, threadId, numberOfThreads, &targetCenters]()
+    {
+      for(unsigned int tableId = threadId; tableId < this->NumberOfTables; tableId += numberOfThreads)
+      {
+        BuildTable(tableId, targetCenters);
+      }
+    }));
+  }
+  for(size_t threadId = 0; threadId < threads.size(); ++threadId)
+  {
+    threads[threadId].join();
+  }
+
+  // Assign each target pixel the best of its candidates
+  for(size_t targetPixelId = 0; targetPixelId < targetPixels.size(); ++targetPixelId)
+  {
+    const itk::Index<2>& targetPixel = targetPixels[targetPixelId];
+    if(!targetInternalRegion.IsInside(targetPixel))
+    {
+      continue;
+    }
+
+    const size_t targetOffset = this->TargetImage->ComputeOffset(targetPixel);
+
+    // Vary which entries of a large bucket are taken from pixel to pixel
+    const unsigned int pick = 7 * targetPixel[0] + 13 * targetPixel[1];
+
+    this->CandidateOffsets.clear();
+    for(unsigned int tableId = 0; tableId < this->NumberOfTables; ++tableId)
+    {
+      const HashTable& table = this->Tables[tableId];
+
+      itk::Offset<2> noShift = {{0, 0}};
+      AddBucket(table, table.TargetHashes[targetOffset], noShift, pick);
+
+      // A neighbor's candidates, moved by the offset from the neighbor to this pixel
+      for(unsigned int neighborId = 0; neighborId < 4; ++neighborId)
+      {
+        itk::Index<2> neighbor = targetPixel + neighborOffsets[neighborId];
+        if(targetInternalRegion.IsInside(neighbor))
+        {
+          itk::Offset<2> shift = targetPixel - neighbor;
+          AddBucket(table, table.TargetHashes[this->TargetImage->ComputeOffset(neighbor)], shift, pick);
+        }
+      }
+    }
+
+    std::sort(this->CandidateOffsets.begin(), this->CandidateOffsets.end());
+    this->CandidateOffsets.erase(std::unique(this->CandidateOffsets.begin(), this->CandidateOffsets.end()),
+                                 this->CandidateOffsets.end());
+
+    if(this->CandidateOffsets.empty())
+    {
+      continue;
+    }
+
+    // Only the candidates closest in descriptor space are scored with the (more expensive) patch distance
+    const float* targetDescriptor = &this->TargetDescriptors[targetOffset * this->DescriptorLength];
+    this->RankedCandidates.clear();
+    for(size_t candidateId = 0; candidateId < this->CandidateOffsets.size(); ++candidateId)
+    {
+      const float* sourceDescriptor = &this->SourceDescriptors[static_cast<size_t>(this->CandidateOffsets[candidateId]) *
+                                                               this->DescriptorLength];
+      float descriptorDistance = 0.0f;
+      for(unsigned int valueId = 0; valueId < this->DescriptorLength; ++valueId)
+      {
+        float difference = sourceDescriptor[valueId] - targetDescriptor[valueId];
+        descriptorDistance += difference * difference;
+      }
+      this->RankedCandidates.push_back(std::make_pair(descriptorDistance, this->CandidateOffsets[candidateId]));
+    }
+
+    const size_t numberOfCandidatesToScore = std::min<size_t>(this->NumberOfCandidatesToScore,
+                                                              this->RankedCandidates.size());
+    std::partial_sort(this->RankedCandidates.begin(), this->RankedCandidates.begin() + numberOfCandidatesToScore,
+                      this->RankedCandidates.end());
+
+    this->CandidateRegions.resize(numberOfCandidatesToScore);
+    for(size_t candidateId = 0; candidateId < numberOfCandidatesToScore; ++candidateId)
+    {
+      this->CandidateRegions[candidateId] =
+          ITKHelpers::GetRegionInRadiusAroundPixel(this->SourceImage->ComputeIndex(this->RankedCandidates[candidateId].second),
+                                                   this->PatchRadius);
+    }
+
+    itk::ImageRegion<2> targetPatchRegion = ITKHelpers::GetRegionInRadiusAroundPixel(targetPixel, this->PatchRadius);
+    const Match& currentMatch = nnField->GetPixel(targetPixel);
+
+    // With a bound, the closest candidate in descriptor space is scored on its own first, so that the
+    // others are only scored if they may beat it
+    itk::ImageRegion<2> firstRegion;
+    float firstScore = 0.0f;
+    bool scoredFirst = false;
+    if(this->DistanceBound && this->CandidateRegions.size() > 1)
+    {
+      firstRegion = this->CandidateRegions[0];
+      firstScore = this->PatchDistanceFunctor->Distance(firstRegion, targetPatchRegion);
+      scoredFirst = true;
+
+      float scoreToBeat = firstScore;
+      if(currentMatch.GetRegion().GetNumberOfPixels() > 0)
+      {
+        scoreToBeat = std::min(scoreToBeat, currentMatch.GetScore());
+      }
+
+      size_t numberOfKeptCandidates = 0;
+      for(size_t candidateId = 1; candidateId < this->CandidateRegions.size(); ++candidateId)
+      {
+        if(!this->DistanceBound->Rejects(this->SourceImage->ComputeIndex(this->RankedCandidates[candidateId].second),
+                                         targetPixel, scoreToBeat))
+        {
+          this->CandidateRegions[numberOfKeptCandidates++] = this->CandidateRegions[candidateId];
+        }
+      }
+      this->CandidateRegions.resize(numberOfKeptCandidates);
+    }
+
+    PatchMatchHelpers::BatchDistance(this->PatchDistanceFunctor, targetPatchRegion,
+                                     this->CandidateRegions, this->CandidateScores);
+
+    if(scoredFirst)
+    {
+      this->CandidateRegions.push_back(firstRegion);
+      this->CandidateScores.push_back(firstScore);
+    }
+
+    size_t bestCandidateId = std::min_element(this->CandidateScores.begin(), this->CandidateScores.end()) -
+                             this->CandidateScores.begin();
+
+    if(currentMatch.GetRegion().GetNumberOfPixels() == 0 ||
+       this->CandidateScores[bestCandidateId] < currentMatch.GetScore())
+    {
+      Match match;
+      match.SetRegion(this->CandidateRegions[bestCandidateId]);
+      match.SetScore(this->CandidateScores[bestCandidateId]);
+      nnField->SetPixel(targetPixel, match);
+    }
+  }
+}
+
+template <typename TImage, typename TPatchDistanceFunctor>
+void InitializerCSH<TImage, TPatchDistanceFunctor>::CreateKernels()
+{
+  // The kernels are applied to the largest power of two window that fits in the (odd sized) patch
+  const unsigned int patchSideLength = 2 * this->PatchRadius + 1;
+  this->KernelSideLength = 1;
+  while(2 * this->KernelSideLength <= patchSideLength)
+  {
+    this->KernelSideLength *= 2;
+  }
+  const unsigned int sideLength = this->KernelSideLength;
+
+  // Row 'k' of the (natural order) Hadamard matrix is (-1)^popcount(k & i). Ordering the rows by sequency
+  // (their number of sign changes) puts the smooth, most informative ones first.
+  auto hadamard = [](const unsigned int row, const unsigned int column)
+  {
+    return (__builtin_popcount(row & column) % 2) ? -1.0f : 1.0f;
+  };
+
+  std::vector<std::pair<unsigned int, unsigned int> > sequencyOrder;
+  for(unsigned int row = 0; row < sideLength; ++row)
+  {
+    unsigned int signChanges = 0;
+    for(unsigned int column = 1; column < sideLength; ++column)
+    {
+      if(hadamard(row, column) != hadamard(row, column - 1))
+      {
+        signChanges++;
+      }
+    }
+    sequencyOrder.push_back(std::make_pair(signChanges, row));
+  }
+  std::sort(sequencyOrder.begin(), sequencyOrder.end());
+
+  // The 2D kernels are products of two 1D ones, taken in order of their total sequency
+  std::vector<std::pair<unsigned int, std::pair<unsigned int, unsigned int> > > kernelOrder;
+  for(unsigned int v = 0; v < sideLength; ++v)
+  {
+    for(unsigned int u = 0; u < sideLength; ++u)
+    {
+      kernelOrder.push_back(std::make_pair(u + v, std::make_pair(v, u)));
+    }
+  }
+  std::sort(kernelOrder.begin(), kernelOrder.end());
+
+  const unsigned int numberOfKernels = std::min(this->NumberOfKernels, sideLength * sideLength);
+  this->Kernels.resize(numberOfKernels * sideLength * sideLength);
+  for(unsigned int kernelId = 0; kernelId < numberOfKernels; ++kernelId)
+  {
+    unsigned int rowFunction = sequencyOrder[kernelOrder[kernelId].second.first].second;
+    unsigned int columnFunction = sequencyOrder[kernelOrder[kernelId].second.second].second;
+    for(unsigned int y = 0; y < sideLength; ++y)
+    {
+      for(unsigned int x = 0; x < sideLength; ++x)
+      {
+        // Scaled so that the kernels are orthonormal
+        this->Kernels[(kernelId * sideLength + y) * sideLength + x] =
+            hadamard(rowFunction, y) * hadamard(columnFunction, x) / sideLength;
+      }
+    }
+  }
+
+  this->DescriptorLength = numberOfKernels * PixelTraitsType::GetNumberOfComponents();
+}
+
+template <typename TImage, typename TPatchDistanceFunctor>
+void InitializerCSH<TImage, TPatchDistanceFunctor>::
+ComputeDescriptors(const TImage* const image, const std::vector<unsigned char>& centers, std::vector<float>& descriptors)
+{
+  itk::ImageRegion<2> region = image->GetLargestPossibleRegion();
+  descriptors.resize(region.GetNumberOfPixels() * this->DescriptorLength);
+
+  const itk::IndexValueType height = region.GetSize()[1];
+  const unsigned int numberOfThreads = std::min<itk::IndexValueType>(GetNumberOfThreads(), std::max<itk::IndexValueType>(height, 1));
+
+  // Each thread computes the descriptors of a band of rows
+  auto computeBand = [this, image, &region, &centers, &descriptors, height, numberOfThreads](const unsigned int bandId)
+  {
+    for(itk::IndexValueType row = height * bandId / numberOfThreads; row < height * (bandId + 1) / numberOfThreads; ++row)
+    {
+      for(itk::SizeValueType column = 0; column < region.GetSize()[0]; ++column)
+      {
+        itk::Index<2> center = {{region.GetIndex()[0] + static_cast<itk::IndexValueType>(column),
+                                 region.GetIndex()[1] + row}};
+        size_t offset = image->ComputeOffset(center);
+        if(centers[offset])
+        {
+          ComputeDescriptor(image, center, &descriptors[offset * this->DescriptorLength]);
+        }
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for(unsigned int bandId = 0; bandId < numberOfThreads; ++bandId)
+  {
+    threads.push_back(std::thread(computeBand, bandId));
+  }
+  for(size_t threadId = 0; threadId < threads.size(); ++threadId)
+  {
+    threads[threadId].join();
+  }
+}
+
+template <typename TImage, typename TPatchDistanceFunctor>
+void InitializerCSH<TImage, TPatchDistanceFunctor>::
+ComputeDescriptor(const TImage* const image, const itk::Index<2>& center, float* const descriptor) const
+{
+  const unsigned int sideLength = this->KernelSideLength;
+  const unsigned int numberOfComponents = PixelTraitsType::GetNumberOfComponents();
+  const unsigned int numberOfKernels = this->DescriptorLength / numberOfComponents;
+
+  std::fill(descriptor, descriptor + this->DescriptorLength, 0.0f);
+
+  itk::Index<2> corner = {{center[0] - static_cast<itk::IndexValueType>(sideLength / 2),
+                           center[1] - static_cast<itk::IndexValueType>(sideLength / 2)}};
+  const PixelType* row = image->GetBufferPointer() + image->ComputeOffset(corner);
+  const itk::SizeValueType rowStride = image->GetBufferedRegion().GetSize()[0];
+
+  for(unsigned int y = 0; y < sideLength; ++y)
+  {
+    for(unsigned int x = 0; x < sideLength; ++x)
+    {
+      for(unsigned int component = 0; component < numberOfComponents; ++component)
+      {
+        const float value = static_cast<float>(PixelTraitsType::GetNthComponent(component, row[x]));
+        for(unsigned int kernelId = 0; kernelId < numberOfKernels; ++kernelId)
+        {
+          descriptor[kernelId * numberOfComponents + component] +=
+              this->Kernels[(kernelId * sideLength + y) * sideLength + x] * value;
+        }
+      }
+    }
+    row += rowStride;
+  }
+}
+
+template <typename TImage, typename TPatchDistanceFunctor>
+void InitializerCSH<TImage, TPatchDistanceFunctor>::
+BuildTable(const unsigned int tableId, const std::vector<unsigned char>& targetCenters)
+{
+  HashTable& table = this->Tables[tableId];
+
+  // Each table has its own generator, so the result does not depend on which thread builds it
+  std::mt19937 generator(this->Seed + tableId);
+  std::normal_distribution<float> directionDistribution(0.0f, 1.0f);
+
+  table.Directions.resize(this->NumberOfProjections * this->DescriptorLength);
+  for(size_t valueId = 0; valueId < table.Directions.size(); ++valueId)
+  {
+    table.Directions[valueId] = directionDistribution(generator);
+  }
+
+  // The quantization step of each projection follows the spread of the source patches along it
+  table.Offsets.resize(this->NumberOfProjections);
+  table.Widths.resize(this->NumberOfProjections);
+  for(unsigned int projectionId = 0; projectionId < this->NumberOfProjections; ++projectionId)
+  {
+    const float* direction = &table.Directions[projectionId * this->DescriptorLength];
+
+    double sum = 0.0;
+    double sumOfSquares = 0.0;
+    for(size_t centerId = 0; centerId < this->SourceCenters.size(); ++centerId)
+    {
+      const float* descriptor =
+          &this->SourceDescriptors[this->SourceImage->ComputeOffset(this->SourceCenters[centerId]) * this->DescriptorLength];
+      double projection = 0.0;
+      for(unsigned int valueId = 0; valueId < this->DescriptorLength; ++valueId)
+      {
+        projection += direction[valueId] * descriptor[valueId];
+      }
+      sum += projection;
+      sumOfSquares += projection * projection;
+    }
+
+    double mean = sum / this->SourceCenters.size();
+    double standardDeviation = std::sqrt(std::max(0.0, sumOfSquares / this->SourceCenters.size() - mean * mean));
+
+    table.Widths[projectionId] = std::max(this->BucketWidth * static_cast<float>(standardDeviation), 1e-3f);
+    std::uniform_real_distribution<float> offsetDistribution(0.0f, table.Widths[projectionId]);
+    table.Offsets[projectionId] = offsetDistribution(generator);
+  }
+
+  table.Entries.resize(this->SourceCenters.size());
+  for(size_t centerId = 0; centerId < this->SourceCenters.size(); ++centerId)
+  {
+    unsigned int sourceOffset = this->SourceImage->ComputeOffset(this->SourceCenters[centerId]);
+    table.Entries[centerId] = std::make_pair(ComputeHash(table, &this->SourceDescriptors[static_cast<size_t>(sourceOffset) *
+                                                                                         this->DescriptorLength]),
+                                             sourceOffset);
+  }
+  std::sort(table.Entries.begin(), table.Entries.end());
+
+  table.TargetHashes.assign(targetCenters.size(), 0);
+  for(size_t targetOffset = 0; targetOffset < targetCenters.size(); ++targetOffset)
+  {
+    if(targetCenters[targetOffset])
+    {
+      table.TargetHashes[targetOffset] = ComputeHash(table, &this->TargetDescriptors[targetOffset * this->DescriptorLength]);
+    }
+  }
+}
+
+template <typename TImage, typename TPatchDistanceFunctor>
+uint64_t InitializerCSH<TImage, TPatchDistanceFunctor>::
+ComputeHash(const HashTable& table, const float* const descriptor) const
+{
+  // FNV-1a over the quantized projections
+  uint64_t hash = 14695981039346656037ULL;
+  for(unsigned int projectionId = 0; projectionId < this->NumberOfProjections; ++projectionId)
+  {
+    const float* direction = &table.Directions[projectionId * this->DescriptorLength];
+    float projection = 0.0f;
+    for(unsigned int valueId = 0; valueId < this->DescriptorLength; ++valueId)
+    {
+      projection += direction[valueId] * descriptor[valueId];
+    }
+
+    int64_t cell = static_cast<int64_t>(std::floor((projection + table.Offsets[projectionId]) / table.Widths[projectionId]));
+    hash = (hash ^ static_cast<uint64_t>(cell)) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+template <typename TImage, typename TPatchDistanceFunctor>
+void InitializerCSH<TImage, TPatchDistanceFunctor>::
+AddBucket(const HashTable& table, const uint64_t hash, const itk::Offset<2>& shift, const unsigned int pick)
+{
+  typedef typename std::vector<std::pair<uint64_t, unsigned int> >::const_iterator EntryIteratorType;
+  std::pair<EntryIteratorType, EntryIteratorType> bucket =
+      std::equal_range(table.Entries.begin(), table.Entries.end(), std::make_pair(hash, 0u),
+                       [](const std::pair<uint64_t, unsigned int>& a, const std::pair<uint64_t, unsigned int>& b)
+                       { return a.first < b.first; });
+
+  const size_t bucketSize = bucket.second - bucket.first;
+  if(bucketSize == 0)
+  {
+    return;
+  }
+
+  itk::ImageRegion<2> sourceRegion = this->SourceImage->GetLargestPossibleRegion();
+
+  // Large buckets (flat areas) are sampled evenly rather than taken whole
+  const size_t numberOfEntries = std::min<size_t>(bucketSize, this->MaximumCandidatesPerBucket);
+  for(size_t entryId = 0; entryId < numberOfEntries; ++entryId)
+  {
+    const unsigned int sourceOffset = (bucket.first + (pick + entryId * bucketSize / numberOfEntries) % bucketSize)->second;
+    itk::Index<2> candidateCenter = this->SourceImage->ComputeIndex(sourceOffset) + shift;
+
+    if(!sourceRegion.IsInside(candidateCenter))
+    {
+      continue;
+    }
+
+    const unsigned int candidateOffset = this->SourceImage->ComputeOffset(candidateCenter);
+    if(this->ValidSourceCenters[candidateOffset])
+    {
+      this->CandidateOffsets.push_back(candidateOffset);
+    }
+  }
+}
+
+template <typename TImage, typename TPatchDistanceFunctor>
+unsigned int InitializerCSH<TImage, TPatchDistanceFunctor>::GetNumberOfThreads() const
+{
+  if(this->NumberOfThreads > 0)
+  {
+    return this->NumberOfThreads;
+  }
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+#endif
@@ -0,0 +1,147 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#ifndef InitializerBoundary_H
+#define InitializerBoundary_H
+
+#include "Initializer.h"
+
+// ITK
+#include "itkDanielssonDistanceMapImageFilter.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+
+// STL
+#include <stdexcept>
+
+/** Set target pixels to have the closest valid patch on the boundary of the valid source region
+  * as their nearest neighbor. When filling a hole, this is a much better starting point than a random patch. */
+template <typename TPatchDistanceFunctor>
+class InitializerBoundary : public InitializerPatch
+{
+public:
+
+  InitializerBoundary() {}
+
+  /** Set the target pixels in 'nnField' that do not already have a match to the closest boundary patch.
+    * Do not modify other pixels in 'nnField'. */
+  virtual void Initialize(NNFieldType* const nnField)
+  {
+    assert(this->PatchDistanceFunctor);
+    assert(this->SourceValidPatchCentersImage);
+
+    itk::ImageRegion<2> region = nnField->GetLargestPossibleRegion();
+    itk::ImageRegion<2> internalRegion = ITKHelpers::GetInternalRegion(region, this->PatchRadius);
+
+    // Mark the boundary patches, which are the valid patches next to an invalid one
+    typedef itk::Image<unsigned char, 2> BoundaryImageType;
+    BoundaryImageType::Pointer boundaryImage = BoundaryImageType::New();
+    boundaryImage->SetRegions(region);
+    boundaryImage->Allocate();
+    boundaryImage->FillBuffer(0);
+
+    bool hasBoundary = false;
+    itk::ImageRegionConstIteratorWithIndex<itk::Image<bool, 2> > validIterator(this->SourceValidPatchCentersImage,
+                                                                              internalRegion);
+    while(!validIterator.IsAtEnd())
+    {
+      if(validIterator.Get() && IsBoundary(validIterator.GetIndex(), internalRegion))
+      {
+        boundaryImage->SetPixel(validIterator.GetIndex(), 1);
+        hasBoundary = true;
+      }
+      ++validIterator;
+    }
+
+    if(!hasBoundary)
+    {
+      throw std::runtime_error("InitializerBoundary: No valid boundary regions!");
+    }
+
+    // The vector distance map stores, for every pixel, the offset to the closest boundary pixel. It is computed
+    // in time linear in the number of pixels, so each target can then find its closest boundary patch in O(1).
+    typedef itk::Image<float, 2> DistanceImageType;
+    typedef itk::DanielssonDistanceMapImageFilter<BoundaryImageType, DistanceImageType> DistanceMapFilterType;
+    typename DistanceMapFilterType::Pointer distanceMapFilter = DistanceMapFilterType::New();
+    distanceMapFilter->SetInput(boundaryImage);
+    distanceMapFilter->SetInputIsBinary(true);
+    distanceMapFilter->SetUseImageSpacing(false);
+    distanceMapFilter->Update();
+
+    typename DistanceMapFilterType::VectorImageType* closestBoundaryOffsets = distanceMapFilter->GetVectorDistanceMap();
+
+    Arena::Scope scope(GetArena());
+    ArenaVector<itk::Index<2> > targetPixels(GetArena());
+    GetTargetPixels(nnField, targetPixels);
+
+    for(size_t targetPixelId = 0; targetPixelId < targetPixels.size(); ++targetPixelId)
+    {
+      itk::Index<2> targetPixelIndex = targetPixels[targetPixelId];
+
+      // Only do this for pixels which have not already been initialized
+      if(nnField->GetPixel(targetPixelIndex).GetRegion().GetNumberOfPixels() > 0)
+      {
+        continue;
+      }
+
+      itk::ImageRegion<2> currentRegion =
+            ITKHelpers::GetRegionInRadiusAroundPixel(targetPixelIndex, this->PatchRadius);
+
+      if(!region.IsInside(currentRegion))
+      {
+        continue;
+      }
+
+      // Look up the nearest valid boundary patch
+      itk::Index<2> closestBoundaryPatchCenter = targetPixelIndex + closestBoundaryOffsets->GetPixel(targetPixelIndex);
+      itk::ImageRegion<2> closestBoundaryPatchRegion =
+            ITKHelpers::GetRegionInRadiusAroundPixel(closestBoundaryPatchCenter, this->PatchRadius);
+
+      Match match;
+      match.SetRegion(closestBoundaryPatchRegion);
+      match.SetScore(this->PatchDistanceFunctor->Distance(closestBoundaryPatchRegion, currentRegion));
+      nnField->SetPixel(targetPixelIndex, match);
+    }
+  }
+
+  void SetPatchDistanceFunctor(TPatchDistanceFunctor* const patchDistanceFunctor)
+  {
+    this->PatchDistanceFunctor = patchDistanceFunctor;
+  }
+
+protected:
+
+  TPatchDistanceFunctor* PatchDistanceFunctor = nullptr;
+
+  /** Determine if the valid center 'index' has an invalid 4-neighbor in 'internalRegion'. */
+  bool IsBoundary(const itk::Index<2>& index, const itk::ImageRegion<2>& internalRegion) const
+  {
+    const itk::Offset<2> offsets[4] = {{{-1, 0}}, {{1, 0}}, {{0, -1}}, {{0, 1}}};
+    for(unsigned int offsetId = 0; offsetId < 4; ++offsetId)
+    {
+      itk::Index<2> neighbor = index + offsets[offsetId];
+      if(internalRegion.IsInside(neighbor) && !this->SourceValidPatchCentersImage->GetPixel(neighbor))
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+#endif
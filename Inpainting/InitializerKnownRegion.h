@@ -0,0 +1,70 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#ifndef InitializerKnownRegion_H
+#define InitializerKnownRegion_H
+
+#include "Initializer.h"
+
+// Custom
+#include "Match.h"
+#include "PatchMatchHelpers.h"
+
+/** Set every target pixel whose surrounding patch is a valid source patch (entirely in the known region)
+  * to have its nearest neighbor as exactly itself. */
+class InitializerKnownRegion : public InitializerPatch
+{
+public:
+
+  InitializerKnownRegion() {}
+
+  InitializerKnownRegion(const unsigned int patchRadius) :
+    InitializerPatch(patchRadius) {}
+
+  /** Set every target pixel whose surrounding patch is a valid source patch to have its nearest neighbor
+    * as exactly itself, with a score of 0. Do not modify other pixels in 'nnField'.*/
+  virtual void Initialize(NNFieldType* const nnField)
+  {
+    assert(nnField);
+    assert(nnField->GetLargestPossibleRegion().GetSize()[0] > 0);
+
+    Arena::Scope scope(GetArena());
+    ArenaVector<itk::Index<2> > targetPixels(GetArena());
+    GetTargetPixels(nnField, targetPixels);
+
+    for(size_t targetPixelId = 0; targetPixelId < targetPixels.size(); ++targetPixelId)
+    {
+      itk::Index<2> targetPixel = targetPixels[targetPixelId];
+
+      if(!IsValidSourceCenter(nnField, targetPixel))
+      {
+        continue;
+      }
+
+      Match selfMatch;
+      selfMatch.SetRegion(ITKHelpers::GetRegionInRadiusAroundPixel(targetPixel, this->PatchRadius));
+      selfMatch.SetScore(0.0f);
+
+      nnField->SetPixel(targetPixel, selfMatch);
+    }
+  }
+
+};
+
+#endif
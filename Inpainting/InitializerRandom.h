@@ -0,0 +1,111 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#ifndef InitializerRandom_H
+#define InitializerRandom_H
+
+#include "Initializer.h"
+
+// STL
+#include <stdexcept>
+
+// Submodules
+#include <Helpers/Helpers.h>
+
+/** Set target pixels to have random nearest neighbors. */
+template <typename TPatchDistanceFunctor>
+class InitializerRandom : public InitializerPatch
+{
+public:
+
+  InitializerRandom() {}
+
+  /** Set the target pixels in 'nnField' to have a random valid nearest neighbor
+    * if they do not already have one. Do not modify other pixels in 'nnField'.*/
+  virtual void Initialize(NNFieldType* const nnField)
+  {
+    assert(this->PatchDistanceFunctor);
+    assert(nnField);
+
+    itk::ImageRegion<2> region = nnField->GetLargestPossibleRegion();
+
+    itk::ImageRegion<2> internalRegion =
+              ITKHelpers::GetInternalRegion(region, this->PatchRadius);
+
+    Arena::Scope scope(GetArena());
+
+    ArenaVector<itk::Index<2> > validSourceCenters(GetArena());
+    validSourceCenters.reserve(internalRegion.GetNumberOfPixels());
+    if(this->SourceValidPatchCentersImage)
+    {
+      PatchMatchHelpers::AppendPixelsWithValueInRegion(this->SourceValidPatchCentersImage, internalRegion, true,
+                                                       validSourceCenters);
+    }
+    else
+    {
+      PatchMatchHelpers::AppendAllPixelIndices(internalRegion, validSourceCenters);
+    }
+
+    if(validSourceCenters.size() == 0)
+    {
+      throw std::runtime_error("InitializerRandom: No valid source regions!");
+    }
+
+    ArenaVector<itk::Index<2> > targetPixels(GetArena());
+    GetTargetPixels(nnField, targetPixels);
+
+    for(size_t targetPixelId = 0; targetPixelId < targetPixels.size(); ++targetPixelId)
+    {
+      itk::Index<2> targetPixel = targetPixels[targetPixelId];
+
+      itk::ImageRegion<2> targetRegion =
+        ITKHelpers::GetRegionInRadiusAroundPixel(targetPixel, this->PatchRadius);
+      if(!region.IsInside(targetRegion))
+      {
+        continue;
+      }
+
+      if(nnField->GetPixel(targetPixel).GetRegion().GetNumberOfPixels() > 0)
+      {
+        continue;
+      }
+
+      unsigned int randomSourceCenterId = Helpers::RandomInt(0, validSourceCenters.size() - 1);
+      itk::ImageRegion<2> randomValidRegion =
+        ITKHelpers::GetRegionInRadiusAroundPixel(validSourceCenters[randomSourceCenterId], this->PatchRadius);
+
+      Match randomMatch;
+      randomMatch.SetRegion(randomValidRegion);
+      randomMatch.SetScore(this->PatchDistanceFunctor->Distance(randomValidRegion, targetRegion));
+
+      nnField->SetPixel(targetPixel, randomMatch);
+    }
+  }
+
+  void SetPatchDistanceFunctor(TPatchDistanceFunctor* const patchDistanceFunctor)
+  {
+    this->PatchDistanceFunctor = patchDistanceFunctor;
+  }
+
+protected:
+
+  TPatchDistanceFunctor* PatchDistanceFunctor = nullptr;
+};
+
+#endif
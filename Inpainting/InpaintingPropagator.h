@@ -0,0 +1,100 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#ifndef InpaintingPropagator_H
+#define InpaintingPropagator_H
+
+// STL
+#include <vector>
+
+// Custom
+#include "Match.h"
+#include "NeighborMask.h"
+#include "NNField.h"
+#include "PatchMatchHelpers.h"
+
+/** A propagator for filling holes. Unlike the raster scan Propagator, which only looks at the neighbors that
+  * were already visited in the current scan direction, this considers the matches of all 8 neighbors, since
+  * around a hole the useful neighbors (the ones that are already filled) can be on any side. */
+template <typename TPatchDistanceFunctor>
+class InpaintingPropagator
+{
+public:
+  /** Propagate good matches from the neighbors of each target pixel. Returns the number of pixels
+    * whose match was improved. */
+  unsigned int Propagate(NNFieldType* const nnField);
+
+  void SetPatchRadius(const unsigned int patchRadius)
+  {
+      this->PatchRadius = patchRadius;
+  }
+
+  void SetPatchDistanceFunctor(TPatchDistanceFunctor* const patchDistanceFunctor)
+  {
+      this->PatchDistanceFunctor = patchDistanceFunctor;
+  }
+
+  /** Set the pixels to propagate to, in the order in which to visit them. Every other call to Propagate()
+    * visits them in reverse order. */
+  void SetTargetPixels(const std::vector<itk::Index<2> >& targetPixels)
+  {
+      this->TargetPixels = targetPixels;
+  }
+
+  /** Set the image indicating which source patches may be propagated. */
+  void SetValidPatchCentersImage(itk::Image<bool, 2>* const validPatchCentersImage)
+  {
+      this->ValidPatchCentersImage = validPatchCentersImage;
+  }
+
+  /** Set the mask of the neighbors that have a match to propagate, or nullptr to test the neighbors of each
+    * pixel directly. The mask must cover the NNField, and only pixels inside the internal region may be eligible.
+    * Target pixels that get their first match are made eligible. */
+  void SetNeighborMask(NeighborMask* const neighborMask)
+  {
+      this->EligibleNeighborMask = neighborMask;
+  }
+
+private:
+  /** Whether the target pixels are visited in the given order (true) or in reverse (false). */
+  bool Forward = true;
+
+  /** The radius of the patches. */
+  unsigned int PatchRadius = 5;
+
+  /** The functor used to compare patches. */
+  TPatchDistanceFunctor* PatchDistanceFunctor = nullptr;
+
+  /** The pixels to propagate to. */
+  std::vector<itk::Index<2> > TargetPixels;
+
+  /** An image where if a pixel is 'true', it is the center of a valid source region. */
+  itk::Image<bool, 2>* ValidPatchCentersImage = nullptr;
+
+  /** The neighbors of each pixel that have a match to propagate. */
+  NeighborMask* EligibleNeighborMask = nullptr;
+
+  /** Get the mask of the neighbors of 'targetPixel' that are inside the internal region and have a match. */
+  static unsigned int ComputeEligibleNeighbors(const NNFieldType* const nnField, const itk::ImageRegion<2>& internalRegion,
+                                               const itk::Index<2>& targetPixel);
+};
+
+#include "InpaintingPropagator.hpp"
+
+#endif
@@ -0,0 +1,121 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#ifndef InpaintingPropagator_HPP
+#define InpaintingPropagator_HPP
+
+#include "InpaintingPropagator.h"
+
+// Submodules
+#include <ITKHelpers/ITKHelpers.h>
+
+template <typename TPatchDistanceFunctor>
+unsigned int InpaintingPropagator<TPatchDistanceFunctor>::
+Propagate(NNFieldType* const nnField)
+{
+  assert(this->PatchDistanceFunctor);
+
+  itk::ImageRegion<2> internalRegion = ITKHelpers::GetInternalRegion(nnField->GetLargestPossibleRegion(), this->PatchRadius);
+
+  unsigned int numberOfImprovedPixels = 0;
+
+  for(size_t visitId = 0; visitId < this->TargetPixels.size(); ++visitId)
+  {
+    size_t targetPixelId = this->Forward ? visitId : this->TargetPixels.size() - 1 - visitId;
+    itk::Index<2> targetPixel = this->TargetPixels[targetPixelId];
+
+    itk::ImageRegion<2> targetRegion = ITKHelpers::GetRegionInRadiusAroundPixel(targetPixel, this->PatchRadius);
+
+    Match currentMatch = nnField->GetPixel(targetPixel);
+    const bool hadMatch = currentMatch.GetRegion().GetNumberOfPixels() > 0;
+    bool improved = false;
+
+    const unsigned int eligibleNeighbors = this->EligibleNeighborMask ?
+          this->EligibleNeighborMask->GetEligibleNeighbors(targetPixel) :
+          ComputeEligibleNeighbors(nnField, internalRegion, targetPixel);
+
+    for(unsigned int bits = eligibleNeighbors; bits != 0; bits &= bits - 1)
+    {
+      const itk::Offset<2>& neighborOffset = NeighborMask::GetNeighborOffset(NeighborMask::GetLowestNeighborId(bits));
+
+      itk::ImageRegion<2> neighborMatchRegion = nnField->GetPixel(targetPixel + neighborOffset).GetRegion();
+
+      // The neighbor's match, shifted back by the offset to the neighbor
+      itk::Index<2> potentialMatchPixel = ITKHelpers::GetRegionCenter(neighborMatchRegion) - neighborOffset;
+
+      if(!internalRegion.IsInside(potentialMatchPixel) ||
+         (this->ValidPatchCentersImage && !this->ValidPatchCentersImage->GetPixel(potentialMatchPixel)))
+      {
+        continue;
+      }
+
+      itk::ImageRegion<2> potentialMatchRegion =
+            ITKHelpers::GetRegionInRadiusAroundPixel(potentialMatchPixel, this->PatchRadius);
+
+      if(potentialMatchRegion == currentMatch.GetRegion())
+      {
+        continue;
+      }
+
+      float distance = this->PatchDistanceFunctor->Distance(potentialMatchRegion, targetRegion);
+
+      if(currentMatch.GetRegion().GetNumberOfPixels() == 0 || distance < currentMatch.GetScore())
+      {
+        currentMatch.SetRegion(potentialMatchRegion);
+        currentMatch.SetScore(distance);
+        improved = true;
+      }
+    }
+
+    if(improved)
+    {
+      nnField->SetPixel(targetPixel, currentMatch);
+      numberOfImprovedPixels++;
+
+      // The pixel now has a match that its own neighbors can use
+      if(!hadMatch && this->EligibleNeighborMask && internalRegion.IsInside(targetPixel))
+      {
+        this->EligibleNeighborMask->SetEligible(targetPixel, true);
+      }
+    }
+  }
+
+  this->Forward = !this->Forward;
+
+  return numberOfImprovedPixels;
+}
+
+template <typename TPatchDistanceFunctor>
+unsigned int InpaintingPropagator<TPatchDistanceFunctor>::
+ComputeEligibleNeighbors(const NNFieldType* const nnField, const itk::ImageRegion<2>& internalRegion,
+                         const itk::Index<2>& targetPixel)
+{
+  unsigned int eligibleNeighbors = 0;
+  for(unsigned int neighborId = 0; neighborId < 8; ++neighborId)
+  {
+    itk::Index<2> neighbor = targetPixel + NeighborMask::GetNeighborOffset(neighborId);
+    if(internalRegion.IsInside(neighbor) && nnField->GetPixel(neighbor).GetRegion().GetNumberOfPixels() > 0)
+    {
+      eligibleNeighbors |= 1u << neighborId;
+    }
+  }
+  return eligibleNeighbors;
+}
+
+#endif
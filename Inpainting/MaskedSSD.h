@@ -0,0 +1,110 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#ifndef MaskedSSD_H
+#define MaskedSSD_H
+
+// ITK
+#include "itkImage.h"
+#include "itkImageRegion.h"
+#include "itkDefaultConvertPixelTraits.h"
+
+// STL
+#include <cassert>
+#include <limits>
+
+/** A sum of squared differences patch distance functor that only compares the target patch pixels that are
+  * marked as known. This lets partially filled target patches at the front of a hole be compared against
+  * source patches. The sum is scaled up to the full patch size so that scores with different numbers of
+  * known pixels are comparable. If no known pixels image is set, every pixel is compared. */
+template <typename TImage>
+class MaskedSSD
+{
+public:
+  typedef typename TImage::PixelType PixelType;
+  typedef itk::DefaultConvertPixelTraits<PixelType> PixelTraitsType;
+
+  /** Set the image from which both source and target patches are read. */
+  void SetImage(TImage* const image)
+  {
+    this->Image = image;
+  }
+
+  /** Set the image (the size of the Image) indicating which pixels of target patches to compare. */
+  void SetKnownPixelsImage(itk::Image<bool, 2>* const knownPixelsImage)
+  {
+    this->KnownPixelsImage = knownPixelsImage;
+  }
+
+  /** Compute the distance between a source patch ('sourceRegion') and a target patch ('targetRegion'). */
+  float Distance(const itk::ImageRegion<2>& sourceRegion, const itk::ImageRegion<2>& targetRegion)
+  {
+    assert(this->Image);
+    assert(sourceRegion.GetSize() == targetRegion.GetSize());
+
+    const PixelType* const buffer = this->Image->GetBufferPointer();
+    const itk::SizeValueType rowStride = this->Image->GetBufferedRegion().GetSize()[0];
+    const bool* const knownBuffer = this->KnownPixelsImage ? this->KnownPixelsImage->GetBufferPointer() : nullptr;
+
+    const itk::OffsetValueType sourceOffset = this->Image->ComputeOffset(sourceRegion.GetIndex());
+    const itk::OffsetValueType targetOffset = this->Image->ComputeOffset(targetRegion.GetIndex());
+
+    float sum = 0.0f;
+    unsigned int numberOfComparedPixels = 0;
+
+    for(itk::SizeValueType row = 0; row < targetRegion.GetSize()[1]; ++row)
+    {
+      const itk::OffsetValueType sourceRowOffset = sourceOffset + row * rowStride;
+      const itk::OffsetValueType targetRowOffset = targetOffset + row * rowStride;
+
+      for(itk::SizeValueType column = 0; column < targetRegion.GetSize()[0]; ++column)
+      {
+        if(knownBuffer && !knownBuffer[targetRowOffset + column])
+        {
+          continue;
+        }
+
+        for(unsigned int component = 0; component < PixelTraitsType::GetNumberOfComponents(); ++component)
+        {
+          float difference =
+              static_cast<float>(PixelTraitsType::GetNthComponent(component, buffer[sourceRowOffset + column])) -
+              static_cast<float>(PixelTraitsType::GetNthComponent(component, buffer[targetRowOffset + column]));
+          sum += difference * difference;
+        }
+        numberOfComparedPixels++;
+      }
+    }
+
+    if(numberOfComparedPixels == 0)
+    {
+      return std::numeric_limits<float>::max();
+    }
+
+    return sum * static_cast<float>(targetRegion.GetNumberOfPixels()) / static_cast<float>(numberOfComparedPixels);
+  }
+
+private:
+  /** The image from which patches are read. */
+  TImage* Image = nullptr;
+
+  /** If set, only the target patch pixels that are 'true' in this image are compared. */
+  itk::Image<bool, 2>* KnownPixelsImage = nullptr;
+};
+
+#endif
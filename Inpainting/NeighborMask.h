@@ -0,0 +1,148 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef NeighborMask_H
+#define NeighborMask_H
+
+// ITK
+#include "itkImageRegion.h"
+#include "itkOffset.h"
+
+// STL
+#include <cassert>
+#include <vector>
+
+/** For each pixel of a region, an 8 bit mask of which of its 8 neighbors are eligible to propagate to it.
+  * Eligibility is a property of the neighbor itself (for example "has a match" or "is verified"), so changing
+  * it with SetEligible() updates one bit of each of the 8 neighbors, and a pixel's eligible neighbors are read
+  * with a single load instead of testing each neighbor. Bit 'neighborId' refers to GetNeighborOffset(neighborId).
+  * The neighbors in a mask are visited with
+  *   for(unsigned int bits = mask; bits != 0; bits &= bits - 1)
+  *   {
+  *     unsigned int neighborId = NeighborMask::GetLowestNeighborId(bits);
+  *   }
+  */
+class NeighborMask
+{
+public:
+  /** Set the region of the pixels, and make every pixel ineligible. */
+  void SetRegion(const itk::ImageRegion<2>& region)
+  {
+    this->Region = region;
+    this->Width = region.GetSize()[0];
+    this->EligibleNeighbors.assign(region.GetNumberOfPixels(), 0);
+    this->Eligible.assign(region.GetNumberOfPixels(), false);
+  }
+
+  const itk::ImageRegion<2>& GetRegion() const
+  {
+    return this->Region;
+  }
+
+  /** Set whether 'pixel' may be propagated to its neighbors. */
+  void SetEligible(const itk::Index<2>& pixel, const bool eligible)
+  {
+    assert(this->Region.IsInside(pixel));
+
+    const size_t pixelOffset = ComputeOffset(pixel);
+    if(this->Eligible[pixelOffset] == eligible)
+    {
+      return;
+    }
+    this->Eligible[pixelOffset] = eligible;
+
+    // 'pixel' is neighbor 'neighborId' of the pixel at the opposite offset
+    for(unsigned int neighborId = 0; neighborId < 8; ++neighborId)
+    {
+      itk::Index<2> neighbor = pixel - GetNeighborOffset(neighborId);
+      if(!this->Region.IsInside(neighbor))
+      {
+        continue;
+      }
+
+      const unsigned char bit = static_cast<unsigned char>(1 << neighborId);
+      if(eligible)
+      {
+        this->EligibleNeighbors[ComputeOffset(neighbor)] |= bit;
+      }
+      else
+      {
+        this->EligibleNeighbors[ComputeOffset(neighbor)] &= static_cast<unsigned char>(~bit);
+      }
+    }
+  }
+
+  bool IsEligible(const itk::Index<2>& pixel) const
+  {
+    assert(this->Region.IsInside(pixel));
+    return this->Eligible[ComputeOffset(pixel)];
+  }
+
+  /** Get the mask of the eligible neighbors of 'pixel'. */
+  unsigned char GetEligibleNeighbors(const itk::Index<2>& pixel) const
+  {
+    assert(this->Region.IsInside(pixel));
+    return this->EligibleNeighbors[ComputeOffset(pixel)];
+  }
+
+  /** Get the offset from a pixel to its neighbor 'neighborId'. Neighbors 'neighborId' and '7 - neighborId'
+    * are opposite each other. */
+  static const itk::Offset<2>& GetNeighborOffset(const unsigned int neighborId)
+  {
+    static const itk::Offset<2> neighborOffsets[8] = {{{-1, -1}}, {{0, -1}}, {{1, -1}},
+                                                      {{-1, 0}},             {{1, 0}},
+                                                      {{-1, 1}},  {{0, 1}},  {{1, 1}}};
+    assert(neighborId < 8);
+    return neighborOffsets[neighborId];
+  }
+
+  /** Get the id of the lowest set bit of a non-zero mask. */
+  static unsigned int GetLowestNeighborId(const unsigned int bits)
+  {
+    assert(bits != 0);
+#if defined(__GNUC__)
+    return __builtin_ctz(bits);
+#else
+    unsigned int neighborId = 0;
+    while(!(bits & (1u << neighborId)))
+    {
+      neighborId++;
+    }
+    return neighborId;
+#endif
+  }
+
+private:
+  itk::ImageRegion<2> Region;
+
+  /** The width of the region, so that offsets do not need to look it up. */
+  size_t Width = 0;
+
+  /** The mask of the eligible neighbors of each pixel, in raster order. */
+  std::vector<unsigned char> EligibleNeighbors;
+
+  /** Whether each pixel is eligible, in raster order. */
+  std::vector<bool> Eligible;
+
+  size_t ComputeOffset(const itk::Index<2>& pixel) const
+  {
+    return (pixel[1] - this->Region.GetIndex()[1]) * this->Width + (pixel[0] - this->Region.GetIndex()[0]);
+  }
+};
+
+#endif
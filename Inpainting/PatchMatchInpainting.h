@@ -0,0 +1,228 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#ifndef PatchMatchInpainting_H
+#define PatchMatchInpainting_H
+
+// ITK
+#include "itkImage.h"
+
+// STL
+#include <vector>
+
+// Submodules
+#include <Mask/Mask.h>
+
+// Custom
+#include "NNField.h"
+#include "RandomSearch.h"
+#include "InpaintingPropagator.h"
+#include "MaskedSSD.h"
+#include "NeighborMask.h"
+#include "Verifier.h"
+
+/** This class fills the hole of an image with PatchMatch. Only the target patches that overlap the hole are
+  * matched (against the patches that are entirely outside of it), so the work depends on the size of the hole
+  * rather than on the size of the image.
+  *
+  * The hole is filled coarse to fine. At the coarsest scale it is filled from the outside in (an "onion peel"):
+  * each layer of the front is matched using only the pixels that are already known or filled, and its pixels
+  * are then filled from those matches. At every scale, a few expectation-maximization iterations then alternate
+  * between refining the matches and re-voting the hole pixels, and pixels whose match is verified stop being refined.
+  * Each finer scale starts from the upsampled hole content and NNField of the coarser one. */
+template <typename TImage>
+class PatchMatchInpainting
+{
+public:
+  typedef itk::Image<bool, 2> BoolImageType;
+
+  typedef MaskedSSD<TImage> PatchDistanceFunctorType;
+  typedef InpaintingPropagator<PatchDistanceFunctorType> PropagatorType;
+  typedef RandomSearch<TImage, PatchDistanceFunctorType> RandomSearchType;
+  typedef VerifierNeighborHistogram<TImage> VerifyFunctorType;
+
+  /** Fill the hole. */
+  void Inpaint();
+
+  /** Set the image to fill. It is not modified. */
+  void SetImage(TImage* const image)
+  {
+    this->Image = image;
+  }
+
+  /** Set the mask whose hole pixels are to be filled. */
+  void SetMask(Mask* const mask)
+  {
+    this->HoleMask = mask;
+  }
+
+  /** Set the patch radius. */
+  void SetPatchRadius(const unsigned int patchRadius)
+  {
+    this->PatchRadius = patchRadius;
+  }
+
+  /** Set the (maximum) number of scales. Fewer are used if the image becomes too small. */
+  void SetNumberOfScales(const unsigned int numberOfScales)
+  {
+    this->NumberOfScales = numberOfScales;
+  }
+
+  /** Set the number of expectation-maximization (match and vote) iterations at each scale. */
+  void SetIterations(const unsigned int iterations)
+  {
+    this->Iterations = iterations;
+  }
+
+  /** Set the number of propagation and random search passes in each expectation-maximization iteration. */
+  void SetSearchIterations(const unsigned int searchIterations)
+  {
+    this->SearchIterations = searchIterations;
+  }
+
+  /** Set whether pixels whose match is verified stop being refined. */
+  void SetUseVerifier(const bool useVerifier)
+  {
+    this->UseVerifier = useVerifier;
+  }
+
+  /** Set whether the pixels whose patch is entirely known are given themselves as their match in the final NNField. */
+  void SetComputeKnownRegionMatches(const bool computeKnownRegionMatches)
+  {
+    this->ComputeKnownRegionMatches = computeKnownRegionMatches;
+  }
+
+  /** Get the filled image. */
+  TImage* GetOutput()
+  {
+    return this->Output;
+  }
+
+  /** Get the NNField of the finest scale. Only the target pixels (and the known pixels, if
+    * ComputeKnownRegionMatches is set) have a match. */
+  NNFieldType* GetNNField()
+  {
+    return this->NNField;
+  }
+
+  /** Get the total number of target pixels visited by propagation and random search, over all scales. */
+  size_t GetNumberOfProcessedPixels() const
+  {
+    return this->NumberOfProcessedPixels;
+  }
+
+private:
+  /** The image and hole of one scale of the pyramid. */
+  struct Level
+  {
+    /** The image, whose hole pixels are filled in as the algorithm progresses. */
+    typename TImage::Pointer Image;
+
+    /** 'true' at the pixels to fill. */
+    BoolImageType::Pointer Hole;
+
+    /** 'true' at the centers of the patches that are entirely outside the hole (and inside the image). */
+    BoolImageType::Pointer ValidSourceCenters;
+
+    /** The pixels whose patch overlaps the hole, in raster order. */
+    std::vector<itk::Index<2> > TargetPixels;
+
+    /** The hole pixels, in raster order. */
+    std::vector<itk::Index<2> > HolePixels;
+
+    /** The number of 'true' pixels in ValidSourceCenters. */
+    size_t NumberOfValidSourceCenters = 0;
+  };
+
+  TImage* Image = nullptr;
+
+  Mask* HoleMask = nullptr;
+
+  unsigned int PatchRadius = 3;
+
+  unsigned int NumberOfScales = 3;
+
+  unsigned int Iterations = 4;
+
+  unsigned int SearchIterations = 2;
+
+  bool UseVerifier = true;
+
+  bool ComputeKnownRegionMatches = false;
+
+  typename TImage::Pointer Output;
+
+  NNFieldType::Pointer NNField;
+
+  size_t NumberOfProcessedPixels = 0;
+
+  PatchDistanceFunctorType PatchDistanceFunctor;
+
+  PropagatorType PropagationFunctor;
+
+  /** The neighbors of each pixel of the current level that have a match to propagate. */
+  NeighborMask EligibleNeighbors;
+
+  RandomSearchType RandomSearchFunctor;
+
+  /** Point the functors at the image and NNField of 'level'. */
+  void SetupFunctors(Level& level, NNFieldType* const nnField);
+
+  /** Create the pyramid, with the full resolution level first. */
+  std::vector<Level> BuildPyramid();
+
+  /** Determine the target pixels, hole pixels and valid source centers of 'level' from its Hole. */
+  void ComputeTargets(Level& level);
+
+  /** Fill the hole of the (coarsest) 'level' from the outside in, matching each layer of the front before filling it. */
+  void FillOnionPeel(Level& level, NNFieldType* const nnField);
+
+  /** Alternate between refining the matches of the target pixels and voting the hole pixels. */
+  void Refine(Level& level, NNFieldType* const nnField);
+
+  /** Run the propagation and random search passes on 'pixels'. */
+  void Search(NNFieldType* const nnField, const std::vector<itk::Index<2> >& pixels);
+
+  /** Recompute the scores of the matches of 'pixels', after the image has changed. */
+  void Rescore(NNFieldType* const nnField, const std::vector<itk::Index<2> >& pixels);
+
+  /** Set each pixel of 'pixels' to the average of the values that the overlapping matched target patches
+    * (for which 'canVote' is true) place there. Returns the pixels that no target voted for, which are left unchanged. */
+  template <typename TCanVote>
+  std::vector<itk::Index<2> > Vote(Level& level, const NNFieldType* const nnField, const std::vector<itk::Index<2> >& pixels, TCanVote canVote);
+
+  /** Initialize 'fineField' and the hole of 'fine' from the result at the next coarser level. */
+  void Upsample(const Level& coarse, const NNFieldType* const coarseField, Level& fine, NNFieldType* const fineField);
+
+  /** Give the target pixels of 'level' that do not have a match yet their closest boundary patch. */
+  void InitializeUnmatched(Level& level, NNFieldType* const nnField);
+
+  /** Create an NNField the size of 'level' with no matches. */
+  NNFieldType::Pointer CreateNNField(const Level& level);
+
+  /** Get an image half the size of 'image', averaging the known pixels of each 2x2 block. */
+  static typename TImage::Pointer Downsample(const TImage* const image, const BoolImageType* const hole);
+
+  /** Get a hole half the size of 'hole', where a pixel is a hole if any of its 2x2 block is. */
+  static BoolImageType::Pointer DownsampleHole(const BoolImageType* const hole);
+};
+
+#include "PatchMatchInpainting.hpp"
+
+#endif
@@ -0,0 +1,684 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#ifndef PatchMatchInpainting_HPP
+#define PatchMatchInpainting_HPP
+
+#include "PatchMatchInpainting.h"
+
+// ITK
+#include "itkDefaultConvertPixelTraits.h"
+#include "itkImageRegionIteratorWithIndex.h"
+
+// STL
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+// Submodules
+#include <ITKHelpers/ITKHelpers.h>
+
+// Custom
+#include "InitializerBoundary.h"
+#include "InitializerKnownRegion.h"
+#include "InitializerRandom.h"
+#include "PatchMatchHelpers.h"
+
+template <typename TImage>
+void PatchMatchInpainting<TImage>::Inpaint()
+{
+  assert(this->Image);
+  assert(this->HoleMask);
+  assert(this->PatchRadius > 0);
+
+  this->NumberOfProcessedPixels = 0;
+
+  std::vector<Level> levels = BuildPyramid();
+
+  NNFieldType::Pointer coarserField;
+
+  for(int levelId = static_cast<int>(levels.size()) - 1; levelId >= 0; --levelId)
+  {
+    Level& level = levels[levelId];
+
+    NNFieldType::Pointer nnField = CreateNNField(level);
+    SetupFunctors(level, nnField);
+
+    if(!level.TargetPixels.empty())
+    {
+      if(levelId == static_cast<int>(levels.size()) - 1)
+      {
+        FillOnionPeel(level, nnField);
+      }
+      else
+      {
+        Upsample(levels[levelId + 1], coarserField, level, nnField);
+        InitializeUnmatched(level, nnField);
+      }
+
+      Refine(level, nnField);
+    }
+
+    coarserField = nnField;
+  }
+
+  this->Output = levels[0].Image;
+  this->NNField = coarserField;
+
+  if(this->ComputeKnownRegionMatches)
+  {
+    InitializerKnownRegion initializerKnownRegion(this->PatchRadius);
+    initializerKnownRegion.SetSourceValidPatchCentersImage(levels[0].ValidSourceCenters);
+    initializerKnownRegion.Initialize(this->NNField);
+  }
+}
+
+template <typename TImage>
+void PatchMatchInpainting<TImage>::SetupFunctors(Level& level, NNFieldType* const nnField)
+{
+  this->PatchDistanceFunctor.SetImage(level.Image);
+  this->PatchDistanceFunctor.SetKnownPixelsImage(nullptr);
+
+  this->PropagationFunctor.SetPatchRadius(this->PatchRadius);
+  this->PropagationFunctor.SetPatchDistanceFunctor(&this->PatchDistanceFunctor);
+  this->PropagationFunctor.SetValidPatchCentersImage(level.ValidSourceCenters);
+  this->PropagationFunctor.SetNeighborMask(&this->EligibleNeighbors);
+
+  this->RandomSearchFunctor.SetPatchRadius(this->PatchRadius);
+  this->RandomSearchFunctor.SetImage(level.Image);
+  this->RandomSearchFunctor.SetPatchDistanceFunctor(&this->PatchDistanceFunctor);
+  this->RandomSearchFunctor.SetValidPatchCentersImage(level.ValidSourceCenters);
+}
+
+template <typename TImage>
+std::vector<typename PatchMatchInpainting<TImage>::Level> PatchMatchInpainting<TImage>::BuildPyramid()
+{
+  std::vector<Level> levels;
+
+  Level finest;
+  finest.Image = TImage::New();
+  ITKHelpers::DeepCopy(this->Image, finest.Image.GetPointer());
+
+  finest.Hole = BoolImageType::New();
+  finest.Hole->SetRegions(this->Image->GetLargestPossibleRegion());
+  finest.Hole->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<BoolImageType> holeIterator(finest.Hole, finest.Hole->GetLargestPossibleRegion());
+  while(!holeIterator.IsAtEnd())
+  {
+    holeIterator.Set(this->HoleMask->IsHole(holeIterator.GetIndex()));
+    ++holeIterator;
+  }
+
+  ComputeTargets(finest);
+  if(!finest.TargetPixels.empty() && finest.NumberOfValidSourceCenters == 0)
+  {
+    throw std::runtime_error("PatchMatchInpainting: No patches are entirely outside of the hole!");
+  }
+  levels.push_back(finest);
+
+  // Stop before the patches become large compared to the image, or before the hole swallows every source patch
+  const itk::SizeValueType minimumSize = 4 * (2 * this->PatchRadius + 1);
+  while(levels.size() < this->NumberOfScales)
+  {
+    const Level& finer = levels.back();
+    itk::Size<2> finerSize = finer.Image->GetLargestPossibleRegion().GetSize();
+    if(finerSize[0] / 2 < minimumSize || finerSize[1] / 2 < minimumSize)
+    {
+      break;
+    }
+
+    Level coarser;
+    coarser.Image = Downsample(finer.Image, finer.Hole);
+    coarser.Hole = DownsampleHole(finer.Hole);
+    ComputeTargets(coarser);
+
+    if(coarser.NumberOfValidSourceCenters == 0)
+    {
+      break;
+    }
+
+    levels.push_back(coarser);
+  }
+
+  return levels;
+}
+
+template <typename TImage>
+void PatchMatchInpainting<TImage>::ComputeTargets(Level& level)
+{
+  itk::ImageRegion<2> region = level.Hole->GetLargestPossibleRegion();
+  assert(region.GetIndex()[0] == 0 && region.GetIndex()[1] == 0);
+
+  const long width = region.GetSize()[0];
+  const long height = region.GetSize()[1];
+  const long tableWidth = width + 1;
+  const long patchRadius = this->PatchRadius;
+  const bool* const hole = level.Hole->GetBufferPointer();
+
+  level.HolePixels.clear();
+  level.TargetPixels.clear();
+  level.NumberOfValidSourceCenters = 0;
+
+  // A summed area table of the hole, with an extra leading row and column of zeros
+  std::vector<unsigned int> holeTable(tableWidth * (height + 1), 0);
+  for(long y = 0; y < height; ++y)
+  {
+    unsigned int rowSum = 0;
+    for(long x = 0; x < width; ++x)
+    {
+      if(hole[y * width + x])
+      {
+        rowSum++;
+        itk::Index<2> holePixel = {{x, y}};
+        level.HolePixels.push_back(holePixel);
+      }
+      holeTable[(y + 1) * tableWidth + x + 1] = holeTable[y * tableWidth + x + 1] + rowSum;
+    }
+  }
+
+  level.ValidSourceCenters = BoolImageType::New();
+  level.ValidSourceCenters->SetRegions(region);
+  level.ValidSourceCenters->Allocate();
+  level.ValidSourceCenters->FillBuffer(false);
+
+  // Patches that contain a hole pixel are targets, the others are valid sources
+  for(long y = patchRadius; y < height - patchRadius; ++y)
+  {
+    for(long x = patchRadius; x < width - patchRadius; ++x)
+    {
+      long x0 = x - patchRadius;
+      long y0 = y - patchRadius;
+      long x1 = x + patchRadius + 1;
+      long y1 = y + patchRadius + 1;
+      unsigned int numberOfHolePixels = holeTable[y1 * tableWidth + x1] - holeTable[y0 * tableWidth + x1] -
+                                        holeTable[y1 * tableWidth + x0] + holeTable[y0 * tableWidth + x0];
+
+      itk::Index<2> pixel = {{x, y}};
+      if(numberOfHolePixels > 0)
+      {
+        level.TargetPixels.push_back(pixel);
+      }
+      else
+      {
+        level.ValidSourceCenters->SetPixel(pixel, true);
+        level.NumberOfValidSourceCenters++;
+      }
+    }
+  }
+}
+
+template <typename TImage>
+NNFieldType::Pointer PatchMatchInpainting<TImage>::CreateNNField(const Level& level)
+{
+  NNFieldType::Pointer nnField = NNFieldType::New();
+  nnField->SetRegions(level.Image->GetLargestPossibleRegion());
+  nnField->Allocate();
+  nnField->FillBuffer(Match());
+  return nnField;
+}
+
+template <typename TImage>
+void PatchMatchInpainting<TImage>::InitializeUnmatched(Level& level, NNFieldType* const nnField)
+{
+  InitializerBoundary<PatchDistanceFunctorType> initializerBoundary;
+  initializerBoundary.SetPatchRadius(this->PatchRadius);
+  initializerBoundary.SetSourceValidPatchCentersImage(level.ValidSourceCenters);
+  initializerBoundary.SetTargetPixels(level.TargetPixels);
+  initializerBoundary.SetPatchDistanceFunctor(&this->PatchDistanceFunctor);
+  initializerBoundary.Initialize(nnField);
+
+  // The boundary initializer skips pixels whose patch is not inside the image, so make sure every target has a match
+  InitializerRandom<PatchDistanceFunctorType> initializerRandom;
+  initializerRandom.SetPatchRadius(this->PatchRadius);
+  initializerRandom.SetSourceValidPatchCentersImage(level.ValidSourceCenters);
+  initializerRandom.SetTargetPixels(level.TargetPixels);
+  initializerRandom.SetPatchDistanceFunctor(&this->PatchDistanceFunctor);
+  initializerRandom.Initialize(nnField);
+
+  // Only the targets have matches, so they are the only pixels that can be propagated
+  itk::ImageRegion<2> internalRegion =
+      ITKHelpers::GetInternalRegion(level.Image->GetLargestPossibleRegion(), this->PatchRadius);
+  this->EligibleNeighbors.SetRegion(level.Image->GetLargestPossibleRegion());
+  for(size_t targetPixelId = 0; targetPixelId < level.TargetPixels.size(); ++targetPixelId)
+  {
+    const itk::Index<2>& targetPixel = level.TargetPixels[targetPixelId];
+    if(internalRegion.IsInside(targetPixel) && nnField->GetPixel(targetPixel).GetRegion().GetNumberOfPixels() > 0)
+    {
+      this->EligibleNeighbors.SetEligible(targetPixel, true);
+    }
+  }
+}
+
+template <typename TImage>
+void PatchMatchInpainting<TImage>::FillOnionPeel(Level& level, NNFieldType* const nnField)
+{
+  itk::ImageRegion<2> region = level.Image->GetLargestPossibleRegion();
+
+  // The layer of each pixel is 0 if it is known, and otherwise its (chessboard) distance to the closest known pixel
+  typedef itk::Image<unsigned int, 2> LayerImageType;
+  LayerImageType::Pointer layerImage = LayerImageType::New();
+  layerImage->SetRegions(region);
+  layerImage->Allocate();
+  layerImage->FillBuffer(0);
+
+  const unsigned int unreached = std::numeric_limits<unsigned int>::max();
+  const itk::Offset<2> neighborOffsets[8] = {{{-1, -1}}, {{0, -1}}, {{1, -1}}, {{-1, 0}},
+                                             {{1, 0}}, {{-1, 1}}, {{0, 1}}, {{1, 1}}};
+
+  std::vector<itk::Index<2> > queue;
+  for(size_t holePixelId = 0; holePixelId < level.HolePixels.size(); ++holePixelId)
+  {
+    itk::Index<2> holePixel = level.HolePixels[holePixelId];
+    layerImage->SetPixel(holePixel, unreached);
+
+    for(unsigned int neighborId = 0; neighborId < 8; ++neighborId)
+    {
+      itk::Index<2> neighbor = holePixel + neighborOffsets[neighborId];
+      if(region.IsInside(neighbor) && !level.Hole->GetPixel(neighbor))
+      {
+        layerImage->SetPixel(holePixel, 1);
+        queue.push_back(holePixel);
+        break;
+      }
+    }
+  }
+
+  unsigned int numberOfLayers = 1;
+  for(size_t queueId = 0; queueId < queue.size(); ++queueId)
+  {
+    unsigned int nextLayer = layerImage->GetPixel(queue[queueId]) + 1;
+    for(unsigned int neighborId = 0; neighborId < 8; ++neighborId)
+    {
+      itk::Index<2> neighbor = queue[queueId] + neighborOffsets[neighborId];
+      if(region.IsInside(neighbor) && layerImage->GetPixel(neighbor) == unreached)
+      {
+        layerImage->SetPixel(neighbor, nextLayer);
+        queue.push_back(neighbor);
+        numberOfLayers = std::max(numberOfLayers, nextLayer + 1);
+      }
+    }
+  }
+
+  // Group the targets and the hole pixels by layer. Pixels that cannot be reached go in the last layer.
+  std::vector<std::vector<itk::Index<2> > > targetLayers(numberOfLayers);
+  for(size_t targetPixelId = 0; targetPixelId < level.TargetPixels.size(); ++targetPixelId)
+  {
+    unsigned int layer = std::min(layerImage->GetPixel(level.TargetPixels[targetPixelId]), numberOfLayers - 1);
+    targetLayers[layer].push_back(level.TargetPixels[targetPixelId]);
+  }
+
+  std::vector<std::vector<itk::Index<2> > > holeLayers(numberOfLayers);
+  for(size_t holePixelId = 0; holePixelId < level.HolePixels.size(); ++holePixelId)
+  {
+    unsigned int layer = std::min(layerImage->GetPixel(level.HolePixels[holePixelId]), numberOfLayers - 1);
+    holeLayers[layer].push_back(level.HolePixels[holePixelId]);
+  }
+
+  // Only the known and already filled pixels of the target patches are compared
+  BoolImageType::Pointer filled = BoolImageType::New();
+  filled->SetRegions(region);
+  filled->Allocate();
+  filled->FillBuffer(true);
+  for(size_t holePixelId = 0; holePixelId < level.HolePixels.size(); ++holePixelId)
+  {
+    filled->SetPixel(level.HolePixels[holePixelId], false);
+  }
+  this->PatchDistanceFunctor.SetKnownPixelsImage(filled);
+
+  InitializeUnmatched(level, nnField);
+
+  for(unsigned int layer = 0; layer < numberOfLayers; ++layer)
+  {
+    // The front has more filled pixels than when it was last scored
+    Rescore(nnField, targetLayers[layer]);
+    Search(nnField, targetLayers[layer]);
+
+    // Fill the layer from the targets of this and the previous layers
+    std::vector<itk::Index<2> > unvotedPixels =
+        Vote(level, nnField, holeLayers[layer],
+             [&layerImage, layer](const itk::Index<2>& target) { return layerImage->GetPixel(target) <= layer; });
+
+    for(size_t holePixelId = 0; holePixelId < holeLayers[layer].size(); ++holePixelId)
+    {
+      filled->SetPixel(holeLayers[layer][holePixelId], true);
+    }
+
+    // Pixels that no processed target covers yet (near the image edge) are filled with the next layer
+    if(layer + 1 < numberOfLayers)
+    {
+      holeLayers[layer + 1].insert(holeLayers[layer + 1].end(), unvotedPixels.begin(), unvotedPixels.end());
+      for(size_t holePixelId = 0; holePixelId < unvotedPixels.size(); ++holePixelId)
+      {
+        filled->SetPixel(unvotedPixels[holePixelId], false);
+      }
+    }
+  }
+
+  this->PatchDistanceFunctor.SetKnownPixelsImage(nullptr);
+}
+
+template <typename TImage>
+void PatchMatchInpainting<TImage>::Refine(Level& level, NNFieldType* const nnField)
+{
+  VerifyFunctorType verifyFunctor;
+  verifyFunctor.SetImage(level.Image);
+  verifyFunctor.SetMatchImage(nnField);
+  verifyFunctor.SetPatchRadius(this->PatchRadius);
+
+  Verifier<VerifyFunctorType> verifier;
+  verifier.SetVerifyFunctor(&verifyFunctor);
+  verifier.SetNeighborMask(&this->EligibleNeighbors);
+
+  IntegralHistogram<TImage> integralHistogram;
+
+  std::vector<itk::Index<2> > activePixels = level.TargetPixels;
+
+  for(unsigned int iteration = 0; iteration < this->Iterations && !activePixels.empty(); ++iteration)
+  {
+    // The hole content changed in the last vote
+    Rescore(nnField, activePixels);
+    Search(nnField, activePixels);
+
+    Vote(level, nnField, level.HolePixels, [](const itk::Index<2>&) { return true; });
+
+    if(this->UseVerifier)
+    {
+      // Each verification reads three patch histograms. Once that costs more than a pass per bin over
+      // the image, it is cheaper to build the integral histogram of the freshly voted image and read them from it.
+      const size_t patchSideLength = 2 * this->PatchRadius + 1;
+      const size_t directCost = 3 * activePixels.size() * patchSideLength * patchSideLength;
+      const size_t integralCost = level.Image->GetLargestPossibleRegion().GetNumberOfPixels() *
+                                  verifyFunctor.GetNumberOfBinsPerDimension();
+      if(directCost > integralCost)
+      {
+        integralHistogram.Compute(level.Image.GetPointer(), verifyFunctor.GetNumberOfBinsPerDimension(),
+                                  verifyFunctor.GetRangeMin(), verifyFunctor.GetRangeMax());
+        verifyFunctor.SetIntegralHistogram(&integralHistogram);
+      }
+      else
+      {
+        verifyFunctor.SetIntegralHistogram(nullptr);
+      }
+
+      activePixels = verifier.Verify(activePixels);
+    }
+  }
+}
+
+template <typename TImage>
+void PatchMatchInpainting<TImage>::Search(NNFieldType* const nnField, const std::vector<itk::Index<2> >& pixels)
+{
+  // RandomSearch processes every pixel if it is given none
+  if(pixels.empty())
+  {
+    return;
+  }
+
+  this->PropagationFunctor.SetTargetPixels(pixels);
+  this->RandomSearchFunctor.SetPixelsToProcess(pixels);
+
+  for(unsigned int searchIteration = 0; searchIteration < this->SearchIterations; ++searchIteration)
+  {
+    this->PropagationFunctor.Propagate(nnField);
+    this->RandomSearchFunctor.Search(nnField);
+    this->NumberOfProcessedPixels += pixels.size();
+  }
+}
+
+template <typename TImage>
+void PatchMatchInpainting<TImage>::Rescore(NNFieldType* const nnField, const std::vector<itk::Index<2> >& pixels)
+{
+  for(size_t pixelId = 0; pixelId < pixels.size(); ++pixelId)
+  {
+    Match match = nnField->GetPixel(pixels[pixelId]);
+    if(match.GetRegion().GetNumberOfPixels() == 0)
+    {
+      continue;
+    }
+
+    itk::ImageRegion<2> targetRegion = ITKHelpers::GetRegionInRadiusAroundPixel(pixels[pixelId], this->PatchRadius);
+    match.SetScore(this->PatchDistanceFunctor.Distance(match.GetRegion(), targetRegion));
+    nnField->SetPixel(pixels[pixelId], match);
+  }
+}
+
+template <typename TImage>
+template <typename TCanVote>
+std::vector<itk::Index<2> > PatchMatchInpainting<TImage>::Vote(Level& level, const NNFieldType* const nnField,
+                                                              const std::vector<itk::Index<2> >& pixels, TCanVote canVote)
+{
+  typedef typename TImage::PixelType PixelType;
+  typedef itk::DefaultConvertPixelTraits<PixelType> PixelTraitsType;
+  typedef typename PixelTraitsType::ComponentType ComponentType;
+  const unsigned int numberOfComponents = PixelTraitsType::GetNumberOfComponents();
+
+  itk::ImageRegion<2> internalRegion = ITKHelpers::GetInternalRegion(level.Image->GetLargestPossibleRegion(),
+                                                                     this->PatchRadius);
+  const itk::IndexValueType patchRadius = this->PatchRadius;
+
+  std::vector<itk::Index<2> > unvotedPixels;
+  std::vector<float> sums(numberOfComponents);
+
+  // Every source pixel that is read is outside of the hole, so the hole can be written in place
+  for(size_t pixelId = 0; pixelId < pixels.size(); ++pixelId)
+  {
+    itk::Index<2> pixel = pixels[pixelId];
+    std::fill(sums.begin(), sums.end(), 0.0f);
+    unsigned int numberOfVotes = 0;
+
+    for(itk::IndexValueType yOffset = -patchRadius; yOffset <= patchRadius; ++yOffset)
+    {
+      for(itk::IndexValueType xOffset = -patchRadius; xOffset <= patchRadius; ++xOffset)
+      {
+        // The target patch centered at 'target' contains 'pixel' at offset (xOffset, yOffset) from its center
+        itk::Index<2> target = {{pixel[0] - xOffset, pixel[1] - yOffset}};
+        if(!internalRegion.IsInside(target))
+        {
+          continue;
+        }
+
+        itk::ImageRegion<2> matchRegion = nnField->GetPixel(target).GetRegion();
+        if(matchRegion.GetNumberOfPixels() == 0 || !canVote(target))
+        {
+          continue;
+        }
+
+        itk::Index<2> matchCenter = ITKHelpers::GetRegionCenter(matchRegion);
+        itk::Index<2> sourcePixel = {{matchCenter[0] + xOffset, matchCenter[1] + yOffset}};
+        const PixelType& sourceValue = level.Image->GetPixel(sourcePixel);
+        for(unsigned int component = 0; component < numberOfComponents; ++component)
+        {
+          sums[component] += static_cast<float>(PixelTraitsType::GetNthComponent(component, sourceValue));
+        }
+        numberOfVotes++;
+      }
+    }
+
+    if(numberOfVotes == 0)
+    {
+      unvotedPixels.push_back(pixel);
+      continue;
+    }
+
+    PixelType value = level.Image->GetPixel(pixel);
+    for(unsigned int component = 0; component < numberOfComponents; ++component)
+    {
+      PixelTraitsType::SetNthComponent(component, value, PatchMatchHelpers::Internal::ConvertComponent<ComponentType>(
+                                         sums[component] / numberOfVotes,
+                                         std::integral_constant<bool, std::numeric_limits<ComponentType>::is_integer>()));
+    }
+    level.Image->SetPixel(pixel, value);
+  }
+
+  return unvotedPixels;
+}
+
+template <typename TImage>
+void PatchMatchInpainting<TImage>::Upsample(const Level& coarse, const NNFieldType* const coarseField,
+                                            Level& fine, NNFieldType* const fineField)
+{
+  itk::ImageRegion<2> coarseRegion = coarse.Image->GetLargestPossibleRegion();
+  itk::ImageRegion<2> fineInternalRegion = ITKHelpers::GetInternalRegion(fine.Image->GetLargestPossibleRegion(),
+                                                                         this->PatchRadius);
+
+  auto toCoarse = [&coarseRegion](const itk::Index<2>& finePixel)
+  {
+    itk::Index<2> coarsePixel;
+    for(unsigned int dimension = 0; dimension < 2; ++dimension)
+    {
+      coarsePixel[dimension] = std::min(finePixel[dimension] / 2,
+                                        static_cast<itk::IndexValueType>(coarseRegion.GetSize()[dimension]) - 1);
+    }
+    return coarsePixel;
+  };
+
+  // Start the hole from the coarse result
+  for(size_t holePixelId = 0; holePixelId < fine.HolePixels.size(); ++holePixelId)
+  {
+    fine.Image->SetPixel(fine.HolePixels[holePixelId], coarse.Image->GetPixel(toCoarse(fine.HolePixels[holePixelId])));
+  }
+
+  // Each fine target takes the match of its coarse parent, at the same position within the 2x2 block
+  for(size_t targetPixelId = 0; targetPixelId < fine.TargetPixels.size(); ++targetPixelId)
+  {
+    itk::Index<2> targetPixel = fine.TargetPixels[targetPixelId];
+    itk::Index<2> coarsePixel = toCoarse(targetPixel);
+
+    itk::ImageRegion<2> coarseMatchRegion = coarseField->GetPixel(coarsePixel).GetRegion();
+    if(coarseMatchRegion.GetNumberOfPixels() == 0)
+    {
+      continue;
+    }
+
+    itk::Index<2> coarseMatchCenter = ITKHelpers::GetRegionCenter(coarseMatchRegion);
+    itk::Index<2> matchCenter = {{2 * coarseMatchCenter[0] + targetPixel[0] - 2 * coarsePixel[0],
+                                  2 * coarseMatchCenter[1] + targetPixel[1] - 2 * coarsePixel[1]}};
+
+    if(!fineInternalRegion.IsInside(matchCenter) || !fine.ValidSourceCenters->GetPixel(matchCenter))
+    {
+      continue; // InitializeUnmatched() will take care of this pixel
+    }
+
+    itk::ImageRegion<2> matchRegion = ITKHelpers::GetRegionInRadiusAroundPixel(matchCenter, this->PatchRadius);
+    itk::ImageRegion<2> targetRegion = ITKHelpers::GetRegionInRadiusAroundPixel(targetPixel, this->PatchRadius);
+
+    Match match;
+    match.SetRegion(matchRegion);
+    match.SetScore(this->PatchDistanceFunctor.Distance(matchRegion, targetRegion));
+    fineField->SetPixel(targetPixel, match);
+  }
+}
+
+template <typename TImage>
+typename TImage::Pointer PatchMatchInpainting<TImage>::Downsample(const TImage* const image, const BoolImageType* const hole)
+{
+  typedef typename TImage::PixelType PixelType;
+  typedef itk::DefaultConvertPixelTraits<PixelType> PixelTraitsType;
+  typedef typename PixelTraitsType::ComponentType ComponentType;
+  const unsigned int numberOfComponents = PixelTraitsType::GetNumberOfComponents();
+
+  itk::Size<2> size = image->GetLargestPossibleRegion().GetSize();
+  itk::Index<2> corner = {{0, 0}};
+  itk::Size<2> halfSize = {{(size[0] + 1) / 2, (size[1] + 1) / 2}};
+
+  typename TImage::Pointer output = TImage::New();
+  output->SetRegions(itk::ImageRegion<2>(corner, halfSize));
+  output->Allocate();
+
+  std::vector<float> sums(numberOfComponents);
+
+  itk::ImageRegionIteratorWithIndex<TImage> outputIterator(output, output->GetLargestPossibleRegion());
+  while(!outputIterator.IsAtEnd())
+  {
+    itk::Index<2> outputPixel = outputIterator.GetIndex();
+
+    // Average the known pixels of the block, or all of them if none are known
+    for(unsigned int pass = 0; pass < 2; ++pass)
+    {
+      std::fill(sums.begin(), sums.end(), 0.0f);
+      unsigned int count = 0;
+
+      for(itk::IndexValueType y = 2 * outputPixel[1]; y < std::min(2 * outputPixel[1] + 2, static_cast<itk::IndexValueType>(size[1])); ++y)
+      {
+        for(itk::IndexValueType x = 2 * outputPixel[0]; x < std::min(2 * outputPixel[0] + 2, static_cast<itk::IndexValueType>(size[0])); ++x)
+        {
+          itk::Index<2> inputPixel = {{x, y}};
+          if(pass == 0 && hole->GetPixel(inputPixel))
+          {
+            continue;
+          }
+
+          for(unsigned int component = 0; component < numberOfComponents; ++component)
+          {
+            sums[component] += static_cast<float>(PixelTraitsType::GetNthComponent(component, image->GetPixel(inputPixel)));
+          }
+          count++;
+        }
+      }
+
+      if(count > 0)
+      {
+        PixelType value = outputIterator.Get();
+        for(unsigned int component = 0; component < numberOfComponents; ++component)
+        {
+          PixelTraitsType::SetNthComponent(component, value, PatchMatchHelpers::Internal::ConvertComponent<ComponentType>(
+                                             sums[component] / count,
+                                             std::integral_constant<bool, std::numeric_limits<ComponentType>::is_integer>()));
+        }
+        outputIterator.Set(value);
+        break;
+      }
+    }
+
+    ++outputIterator;
+  }
+
+  return output;
+}
+
+template <typename TImage>
+typename PatchMatchInpainting<TImage>::BoolImageType::Pointer
+PatchMatchInpainting<TImage>::DownsampleHole(const BoolImageType* const hole)
+{
+  itk::Size<2> size = hole->GetLargestPossibleRegion().GetSize();
+  itk::Index<2> corner = {{0, 0}};
+  itk::Size<2> halfSize = {{(size[0] + 1) / 2, (size[1] + 1) / 2}};
+
+  BoolImageType::Pointer output = BoolImageType::New();
+  output->SetRegions(itk::ImageRegion<2>(corner, halfSize));
+  output->Allocate();
+  output->FillBuffer(false);
+
+  itk::ImageRegionConstIteratorWithIndex<BoolImageType> holeIterator(hole, hole->GetLargestPossibleRegion());
+  while(!holeIterator.IsAtEnd())
+  {
+    if(holeIterator.Get())
+    {
+      itk::Index<2> outputPixel = {{holeIterator.GetIndex()[0] / 2, holeIterator.GetIndex()[1] / 2}};
+      output->SetPixel(outputPixel, true);
+    }
+    ++holeIterator;
+  }
+
+  return output;
+}
+
+#endif
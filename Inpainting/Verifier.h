@@ -0,0 +1,257 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#ifndef Verifier_H
+#define Verifier_H
+
+// STL
+#include <iostream>
+#include <vector>
+
+// ITK
+#include "itkImage.h"
+#include "itkNumericTraits.h"
+
+// Custom
+#include "IntegralHistogram.h"
+#include "Match.h"
+#include "NeighborMask.h"
+#include "NNField.h"
+
+// Submodules
+#include <Helpers/Helpers.h>
+#include <Histogram/Histogram.h>
+#include <ITKHelpers/ITKHelpers.h>
+#include <ITKHelpers/ITKTypeTraits.h>
+
+/** Test the matches of a set of pixels with a verify functor. Pixels whose match is verified are
+  * considered done, so the caller can stop refining them. */
+template <typename TVerifyFunctor>
+class Verifier
+{
+public:
+
+  void SetVerifyFunctor(TVerifyFunctor* const verifyFunctor)
+  {
+    this->VerifyFunctor = verifyFunctor;
+  }
+
+  /** Set the mask of the neighbors that may be propagated, or nullptr. Verify() makes the pixels it accepts
+    * eligible and the pixels it rejects ineligible, so that propagation only spreads verified (or not yet tested)
+    * matches. The pixels given to Verify() must be inside the region of the mask where pixels may be eligible. */
+  void SetNeighborMask(NeighborMask* const neighborMask)
+  {
+    this->EligibleNeighborMask = neighborMask;
+  }
+
+  /** Test the matches of 'pixels' and return the pixels that could not be verified. */
+  std::vector<itk::Index<2> > Verify(const std::vector<itk::Index<2> >& pixels)
+  {
+    assert(this->VerifyFunctor);
+
+    std::vector<itk::Index<2> > unverifiedPixels;
+
+    this->NumberOfVerifiedPixels = 0;
+    for(size_t pixelId = 0; pixelId < pixels.size(); ++pixelId)
+    {
+      const bool verified = this->VerifyFunctor->Verify(pixels[pixelId]);
+      if(verified)
+      {
+        this->NumberOfVerifiedPixels++;
+      }
+      else
+      {
+        unverifiedPixels.push_back(pixels[pixelId]);
+      }
+
+      if(this->EligibleNeighborMask)
+      {
+        this->EligibleNeighborMask->SetEligible(pixels[pixelId], verified);
+      }
+    }
+
+    return unverifiedPixels;
+  }
+
+  /** Get the number of pixels that were verified by the last call to Verify(). */
+  unsigned int GetNumberOfVerifiedPixels() const
+  {
+    return this->NumberOfVerifiedPixels;
+  }
+
+protected:
+
+  TVerifyFunctor* VerifyFunctor = nullptr;
+
+  NeighborMask* EligibleNeighborMask = nullptr;
+
+  unsigned int NumberOfVerifiedPixels = 0;
+};
+
+/** Verify a match if the histogram of its source patch is closer to the histogram of the query patch
+  * than (a multiple of) the histogram of a random neighboring patch is.
+  * If an IntegralHistogram of the current image content is set, the patch histograms are read from it
+  * rather than computed from the patch pixels. */
+template <typename TImage>
+class VerifierNeighborHistogram
+{
+public:
+  typedef typename TypeTraits<typename TImage::PixelType>::ComponentType ComponentType;
+
+  VerifierNeighborHistogram()
+  {
+    this->RangeMin = itk::NumericTraits<ComponentType>::min();
+    this->RangeMax = itk::NumericTraits<ComponentType>::max();
+  }
+
+  void SetPatchRadius(const unsigned int patchRadius)
+  {
+    this->PatchRadius = patchRadius;
+  }
+
+  void SetImage(TImage* const image)
+  {
+    this->Image = image;
+  }
+
+  void SetMatchImage(NNFieldType* const matchImage)
+  {
+    this->MatchImage = matchImage;
+  }
+
+  typedef Histogram<int>::HistogramType HistogramType;
+
+  /** Set the integral histogram to read patch histograms from, or nullptr to compute them from the image.
+    * It must have been computed from the current content of the image with the same bins and range. */
+  void SetIntegralHistogram(const IntegralHistogram<TImage>* const integralHistogram)
+  {
+    this->IntegralHistogramCache = integralHistogram;
+  }
+
+  bool Verify(const itk::Index<2>& queryCenter)
+  {
+    assert(this->PatchRadius > 0);
+    assert(this->Image);
+    assert(this->MatchImage);
+    assert(this->RangeMax > this->RangeMin);
+    assert(this->NeighborHistogramMultiplier > 1.0f);
+
+    itk::ImageRegion<2> queryRegion = ITKHelpers::GetRegionInRadiusAroundPixel(queryCenter, this->PatchRadius);
+    itk::ImageRegion<2> sourceRegion = this->MatchImage->GetPixel(queryCenter).GetRegion();
+
+    itk::Index<2> neighborCenter = queryCenter + RandomNeighborNonZeroOffset();
+    itk::ImageRegion<2> neighborRegion =
+      ITKHelpers::GetRegionInRadiusAroundPixel(neighborCenter, this->PatchRadius);
+
+    itk::ImageRegion<2> fullRegion = this->Image->GetLargestPossibleRegion();
+    if(sourceRegion.GetNumberOfPixels() == 0 || !fullRegion.IsInside(neighborRegion))
+    {
+      return false;
+    }
+
+    HistogramType queryHistogram = ComputeHistogram(queryRegion);
+    HistogramType sourceHistogram = ComputeHistogram(sourceRegion);
+    HistogramType neighborHistogram = ComputeHistogram(neighborRegion);
+
+    float neighborHistogramDifference =
+      Histogram<int>::HistogramDifference(neighborHistogram, queryHistogram);
+
+    float matchHistogramDifference =
+      Histogram<int>::HistogramDifference(queryHistogram, sourceHistogram);
+
+    return matchHistogramDifference < (this->NeighborHistogramMultiplier * neighborHistogramDifference);
+  }
+
+  void SetRangeMin(const ComponentType rangeMin)
+  {
+    this->RangeMin = rangeMin;
+  }
+
+  void SetRangeMax(const ComponentType rangeMax)
+  {
+    this->RangeMax = rangeMax;
+  }
+
+  ComponentType GetRangeMin() const
+  {
+    return this->RangeMin;
+  }
+
+  ComponentType GetRangeMax() const
+  {
+    return this->RangeMax;
+  }
+
+  void SetNumberOfBinsPerDimension(const unsigned int numberOfBinsPerDimension)
+  {
+    this->NumberOfBinsPerDimension = numberOfBinsPerDimension;
+  }
+
+  unsigned int GetNumberOfBinsPerDimension() const
+  {
+    return this->NumberOfBinsPerDimension;
+  }
+
+  void SetNeighborHistogramMultiplier(const float neighborHistogramMultiplier)
+  {
+    this->NeighborHistogramMultiplier = neighborHistogramMultiplier;
+  }
+
+protected:
+  TImage* Image = nullptr;
+
+  NNFieldType* MatchImage = nullptr;
+
+  unsigned int PatchRadius = 0;
+
+  float NeighborHistogramMultiplier = 2.0f;
+
+  ComponentType RangeMin;
+  ComponentType RangeMax;
+
+  /** The number of bins to use per image channel/dimension. */
+  unsigned int NumberOfBinsPerDimension = 20;
+
+  const IntegralHistogram<TImage>* IntegralHistogramCache = nullptr;
+
+  HistogramType ComputeHistogram(const itk::ImageRegion<2>& region) const
+  {
+    if(this->IntegralHistogramCache)
+    {
+      return this->IntegralHistogramCache->GetHistogram(region);
+    }
+
+    return Histogram<int>::ComputeImageHistogram1D(this->Image, region, this->NumberOfBinsPerDimension,
+                                                   this->RangeMin, this->RangeMax);
+  }
+
+  /** Get the offset to a random one of the 8 neighbors. */
+  static itk::Offset<2> RandomNeighborNonZeroOffset()
+  {
+    itk::Offset<2> offset = {{0, 0}};
+    while(offset[0] == 0 && offset[1] == 0)
+    {
+      offset[0] = Helpers::RandomInt(-1, 1);
+      offset[1] = Helpers::RandomInt(-1, 1);
+    }
+    return offset;
+  }
+};
+
+#endif
@@ -0,0 +1,95 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef IntegralHistogram_H
+#define IntegralHistogram_H
+
+// ITK
+#include "itkImage.h"
+#include "itkImageRegion.h"
+
+// STL
+#include <vector>
+
+// Submodules
+#include <Histogram/Histogram.h>
+
+/** A summed area table per histogram bin of an image. After Compute(), the histogram of any region can be
+  * read with four table lookups per bin, no matter how large the region is, instead of visiting every
+  * pixel of the region as Histogram::ComputeImageHistogram1D() does.
+  * The histogram has 'numberOfBinsPerDimension' bins for each component of the pixel, one block of bins
+  * per component, and every component is binned over the same [rangeMin, rangeMax] range.
+  * The table stores (width+1)*(height+1)*bins*components counts, so it is worth building when many patch
+  * histograms are read from the same image content. */
+template <typename TImage>
+class IntegralHistogram
+{
+public:
+  typedef Histogram<int>::HistogramType HistogramType;
+
+  /** Build the tables of 'image'. */
+  template <typename TValue>
+  void Compute(const TImage* const image, const unsigned int numberOfBinsPerDimension,
+               const TValue rangeMin, const TValue rangeMax);
+
+  /** Get the histogram of the pixels of 'region', which must be inside the image. */
+  HistogramType GetHistogram(const itk::ImageRegion<2>& region) const;
+
+  /** Get the histogram of the pixels of 'region' into 'histogram', reusing its storage. */
+  void GetHistogram(const itk::ImageRegion<2>& region, HistogramType& histogram) const;
+
+  /** Get the total number of bins of a histogram (the bins per dimension times the number of components). */
+  unsigned int GetNumberOfBins() const
+  {
+    return this->NumberOfBins;
+  }
+
+  /** Get the region of the image that the tables were computed from. */
+  const itk::ImageRegion<2>& GetRegion() const
+  {
+    return this->Region;
+  }
+
+  /** Determine if Compute() has been called. */
+  bool IsComputed() const
+  {
+    return !this->Table.empty();
+  }
+
+  /** Release the tables. */
+  void Clear()
+  {
+    std::vector<unsigned int>().swap(this->Table);
+  }
+
+private:
+  /** The region of the image that the tables were computed from. */
+  itk::ImageRegion<2> Region;
+
+  /** The number of bins of each histogram. */
+  unsigned int NumberOfBins = 0;
+
+  /** The counts of all of the bins of one table position are stored next to each other, so reading a
+    * histogram touches four contiguous runs of memory. Position (x,y) holds the counts of the pixels
+    * with image offsets less than (x,y); the extra leading row and column are zero. */
+  std::vector<unsigned int> Table;
+};
+
+#include "IntegralHistogram.hpp"
+
+#endif
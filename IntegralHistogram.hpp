@@ -0,0 +1,125 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef IntegralHistogram_HPP
+#define IntegralHistogram_HPP
+
+#include "IntegralHistogram.h"
+
+// ITK
+#include "itkDefaultConvertPixelTraits.h"
+#include "itkImageRegionConstIterator.h"
+
+// STL
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+template <typename TImage>
+template <typename TValue>
+void IntegralHistogram<TImage>::Compute(const TImage* const image, const unsigned int numberOfBinsPerDimension,
+                                        const TValue rangeMin, const TValue rangeMax)
+{
+  typedef itk::DefaultConvertPixelTraits<typename TImage::PixelType> PixelTraitsType;
+
+  if(numberOfBinsPerDimension == 0 || !(rangeMax > rangeMin))
+  {
+    throw std::runtime_error("IntegralHistogram::Compute() requires at least one bin and rangeMax > rangeMin!");
+  }
+
+  this->Region = image->GetLargestPossibleRegion();
+
+  const unsigned int numberOfComponents = PixelTraitsType::GetNumberOfComponents();
+  this->NumberOfBins = numberOfBinsPerDimension * numberOfComponents;
+
+  const size_t width = this->Region.GetSize()[0];
+  const size_t height = this->Region.GetSize()[1];
+  const size_t rowLength = (width + 1) * this->NumberOfBins;
+
+  this->Table.assign(rowLength * (height + 1), 0);
+
+  const float binScale = static_cast<float>(numberOfBinsPerDimension) /
+                         (static_cast<float>(rangeMax) - static_cast<float>(rangeMin));
+
+  std::vector<unsigned int> rowCounts(this->NumberOfBins);
+
+  itk::ImageRegionConstIterator<TImage> imageIterator(image, this->Region);
+
+  for(size_t y = 0; y < height; ++y)
+  {
+    std::fill(rowCounts.begin(), rowCounts.end(), 0);
+
+    const unsigned int* const above = &this->Table[y * rowLength];
+    unsigned int* const current = &this->Table[(y + 1) * rowLength];
+
+    for(size_t x = 0; x < width; ++x)
+    {
+      for(unsigned int component = 0; component < numberOfComponents; ++component)
+      {
+        float value = static_cast<float>(PixelTraitsType::GetNthComponent(component, imageIterator.Get()));
+        int bin = static_cast<int>((value - static_cast<float>(rangeMin)) * binScale);
+        bin = std::max(0, std::min(bin, static_cast<int>(numberOfBinsPerDimension) - 1));
+        rowCounts[component * numberOfBinsPerDimension + bin]++;
+      }
+
+      const size_t position = (x + 1) * this->NumberOfBins;
+      for(unsigned int bin = 0; bin < this->NumberOfBins; ++bin)
+      {
+        current[position + bin] = above[position + bin] + rowCounts[bin];
+      }
+
+      ++imageIterator;
+    }
+  }
+}
+
+template <typename TImage>
+typename IntegralHistogram<TImage>::HistogramType IntegralHistogram<TImage>::
+GetHistogram(const itk::ImageRegion<2>& region) const
+{
+  HistogramType histogram;
+  GetHistogram(region, histogram);
+  return histogram;
+}
+
+template <typename TImage>
+void IntegralHistogram<TImage>::GetHistogram(const itk::ImageRegion<2>& region, HistogramType& histogram) const
+{
+  assert(IsComputed());
+  assert(this->Region.IsInside(region));
+
+  const size_t rowLength = (this->Region.GetSize()[0] + 1) * this->NumberOfBins;
+
+  const size_t x0 = region.GetIndex()[0] - this->Region.GetIndex()[0];
+  const size_t y0 = region.GetIndex()[1] - this->Region.GetIndex()[1];
+  const size_t x1 = x0 + region.GetSize()[0];
+  const size_t y1 = y0 + region.GetSize()[1];
+
+  const unsigned int* const topLeft = &this->Table[y0 * rowLength + x0 * this->NumberOfBins];
+  const unsigned int* const topRight = &this->Table[y0 * rowLength + x1 * this->NumberOfBins];
+  const unsigned int* const bottomLeft = &this->Table[y1 * rowLength + x0 * this->NumberOfBins];
+  const unsigned int* const bottomRight = &this->Table[y1 * rowLength + x1 * this->NumberOfBins];
+
+  histogram.resize(this->NumberOfBins);
+  for(unsigned int bin = 0; bin < this->NumberOfBins; ++bin)
+  {
+    histogram[bin] = static_cast<int>(bottomRight[bin] - topRight[bin] - bottomLeft[bin] + topLeft[bin]);
+  }
+}
+
+#endif
@@ -0,0 +1,177 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "KDTree.h"
+
+// STL
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <limits>
+
+void KDTree::Build(const float* const points, const size_t numberOfPoints, const unsigned int dimension,
+                   const unsigned int leafSize)
+{
+  assert(dimension > 0);
+  assert(leafSize > 0);
+
+  Clear();
+
+  if(numberOfPoints == 0)
+  {
+    return;
+  }
+
+  this->Dimension = dimension;
+  this->Points.assign(points, points + numberOfPoints * dimension);
+
+  this->PointIds.resize(numberOfPoints);
+  for(size_t pointId = 0; pointId < numberOfPoints; ++pointId)
+  {
+    this->PointIds[pointId] = pointId;
+  }
+  this->LeafOfPoint.resize(numberOfPoints);
+
+  // A balanced tree has about 2 * numberOfPoints / leafSize nodes
+  this->Nodes.reserve(2 * (numberOfPoints / leafSize + 1));
+
+  Node root;
+  root.Begin = 0;
+  root.End = numberOfPoints;
+  this->Nodes.push_back(root);
+
+  BuildNode(0, leafSize);
+}
+
+void KDTree::Clear()
+{
+  this->Nodes.clear();
+  this->PointIds.clear();
+  this->LeafOfPoint.clear();
+  this->Points.clear();
+  this->Dimension = 0;
+}
+
+void KDTree::BuildNode(const unsigned int nodeId, const unsigned int leafSize)
+{
+  const unsigned int begin = this->Nodes[nodeId].Begin;
+  const unsigned int end = this->Nodes[nodeId].End;
+
+  // Split along the dimension in which the points are most spread out
+  unsigned int splitDimension = 0;
+  float largestSpread = 0.0f;
+  if(end - begin > leafSize)
+  {
+    for(unsigned int dimension = 0; dimension < this->Dimension; ++dimension)
+    {
+      float minimum = std::numeric_limits<float>::max();
+      float maximum = -std::numeric_limits<float>::max();
+      for(unsigned int position = begin; position < end; ++position)
+      {
+        float value = GetPoint(this->PointIds[position])[dimension];
+        minimum = std::min(minimum, value);
+        maximum = std::max(maximum, value);
+      }
+
+      if(maximum - minimum > largestSpread)
+      {
+        largestSpread = maximum - minimum;
+        splitDimension = dimension;
+      }
+    }
+  }
+
+  // Small nodes, and nodes whose points are all identical, are leaves
+  if(end - begin <= leafSize || largestSpread <= 0.0f)
+  {
+    for(unsigned int position = begin; position < end; ++position)
+    {
+      this->LeafOfPoint[this->PointIds[position]] = nodeId;
+    }
+    return;
+  }
+
+  const unsigned int middle = begin + (end - begin) / 2;
+  std::nth_element(this->PointIds.begin() + begin, this->PointIds.begin() + middle, this->PointIds.begin() + end,
+                   [this, splitDimension](const unsigned int a, const unsigned int b)
+                   { return GetPoint(a)[splitDimension] < GetPoint(b)[splitDimension]; });
+
+  this->Nodes[nodeId].SplitDimension = splitDimension;
+  this->Nodes[nodeId].SplitValue = GetPoint(this->PointIds[middle])[splitDimension];
+
+  // The points before 'middle' are not greater than the split value, and the rest are not smaller
+  for(unsigned int childId = 0; childId < 2; ++childId)
+  {
+    Node child;
+    child.Begin = (childId == 0) ? begin : middle;
+    child.End = (childId == 0) ? middle : end;
+
+    // 'Nodes' may reallocate, so the parent is looked up again rather than kept as a reference
+    this->Nodes[nodeId].Children[childId] = this->Nodes.size();
+    this->Nodes.push_back(child);
+    BuildNode(this->Nodes[nodeId].Children[childId], leafSize);
+  }
+}
+
+void KDTree::AppendApproximateNeighbors(const float* const query, const unsigned int numberOfLeaves,
+                                        std::vector<unsigned int>& pointIds) const
+{
+  if(!IsBuilt())
+  {
+    return;
+  }
+
+  // The queue is a min-heap on the distance bound
+  std::greater<std::pair<float, unsigned int> > isFurther;
+
+  this->SearchQueue.clear();
+  this->SearchQueue.push_back(std::make_pair(0.0f, 0u));
+
+  unsigned int numberOfVisitedLeaves = 0;
+  while(!this->SearchQueue.empty() && numberOfVisitedLeaves < numberOfLeaves)
+  {
+    std::pop_heap(this->SearchQueue.begin(), this->SearchQueue.end(), isFurther);
+    unsigned int nodeId = this->SearchQueue.back().second;
+    this->SearchQueue.pop_back();
+
+    // Descend to a leaf, queueing the far side of every split on the way
+    while(this->Nodes[nodeId].Children[0] != NoChild)
+    {
+      const Node& node = this->Nodes[nodeId];
+      float difference = query[node.SplitDimension] - node.SplitValue;
+      unsigned int nearChild = difference < 0.0f ? 0 : 1;
+
+      this->SearchQueue.push_back(std::make_pair(difference * difference, node.Children[1 - nearChild]));
+      std::push_heap(this->SearchQueue.begin(), this->SearchQueue.end(), isFurther);
+
+      nodeId = node.Children[nearChild];
+    }
+
+    const Node& leaf = this->Nodes[nodeId];
+    pointIds.insert(pointIds.end(), this->PointIds.begin() + leaf.Begin, this->PointIds.begin() + leaf.End);
+    numberOfVisitedLeaves++;
+  }
+}
+
+void KDTree::AppendLeafOfPoint(const unsigned int pointId, std::vector<unsigned int>& pointIds) const
+{
+  assert(pointId < this->LeafOfPoint.size());
+
+  const Node& leaf = this->Nodes[this->LeafOfPoint[pointId]];
+  pointIds.insert(pointIds.end(), this->PointIds.begin() + leaf.Begin, this->PointIds.begin() + leaf.End);
+}
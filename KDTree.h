@@ -0,0 +1,109 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef KDTree_H
+#define KDTree_H
+
+// STL
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/** A kd-tree over low dimensional descriptors, for approximate nearest neighbor queries.
+  * The leaves hold a few points each, and a query visits a bounded number of leaves in best bin first
+  * order rather than searching exhaustively, which is the usual trade of ANN searches: the candidates it
+  * returns are then scored with the real patch distance. */
+class KDTree
+{
+public:
+  /** Build the tree over 'numberOfPoints' points of 'dimension' floats each, stored one after the other in
+    * 'points'. The points are copied. A point's id is its position in 'points'. */
+  void Build(const float* const points, const size_t numberOfPoints, const unsigned int dimension,
+             const unsigned int leafSize = 8);
+
+  /** Release the tree. */
+  void Clear();
+
+  /** Determine if Build() has been called (and Clear() has not been called since). */
+  bool IsBuilt() const
+  {
+    return !this->Nodes.empty();
+  }
+
+  /** Append the ids of the points in the 'numberOfLeaves' leaves closest to 'query' (in best bin first order)
+    * to 'pointIds'. The 'query' must have the dimension the tree was built with. This is not thread safe. */
+  void AppendApproximateNeighbors(const float* const query, const unsigned int numberOfLeaves,
+                                  std::vector<unsigned int>& pointIds) const;
+
+  /** Append the ids of the points in the leaf that holds 'pointId' (including 'pointId' itself) to 'pointIds'. */
+  void AppendLeafOfPoint(const unsigned int pointId, std::vector<unsigned int>& pointIds) const;
+
+  /** Get the point with id 'pointId'. */
+  const float* GetPoint(const unsigned int pointId) const
+  {
+    return &this->Points[static_cast<size_t>(pointId) * this->Dimension];
+  }
+
+  size_t GetNumberOfPoints() const
+  {
+    return this->LeafOfPoint.size();
+  }
+
+  unsigned int GetDimension() const
+  {
+    return this->Dimension;
+  }
+
+private:
+  /** A node covers the points PointIds[Begin, End). Inner nodes split them at SplitValue along SplitDimension. */
+  struct Node
+  {
+    unsigned int Begin = 0;
+    unsigned int End = 0;
+
+    unsigned int SplitDimension = 0;
+    float SplitValue = 0.0f;
+
+    /** The children, or NoChild for a leaf. */
+    unsigned int Children[2] = {NoChild, NoChild};
+  };
+
+  static const unsigned int NoChild = static_cast<unsigned int>(-1);
+
+  /** Split the node at 'nodeId' until its leaves hold at most 'leafSize' points. */
+  void BuildNode(const unsigned int nodeId, const unsigned int leafSize);
+
+  std::vector<Node> Nodes;
+
+  /** The ids of the points, ordered so that the points of every node are contiguous. */
+  std::vector<unsigned int> PointIds;
+
+  /** The leaf (node id) that holds each point. */
+  std::vector<unsigned int> LeafOfPoint;
+
+  /** The points, 'Dimension' floats each. */
+  std::vector<float> Points;
+
+  unsigned int Dimension = 0;
+
+  /** The nodes still to be visited by a query, with a lower bound of their squared distance to it. This is
+    * a member so that queries do not allocate. */
+  mutable std::vector<std::pair<float, unsigned int> > SearchQueue;
+};
+
+#endif
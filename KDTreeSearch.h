@@ -0,0 +1,271 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef KDTreeSearch_H
+#define KDTreeSearch_H
+
+// ITK
+#include "itkImage.h"
+
+// STL
+#include <string>
+#include <vector>
+
+// Custom
+#include "Arena.h"
+#include "KDTree.h"
+#include "Match.h"
+#include "MeanVarianceBound.h"
+#include "NNField.h"
+#include "NNFieldReverseIndex.h"
+#include "PatchDescriptorPrefilter.h"
+#include "PatchPCA.h"
+
+/** A replacement for RandomSearch (it fits the TRandomSearch slot of PatchMatch) that looks for better matches
+  * with a kd-tree instead of random samples, following "Computing Nearest-Neighbor Fields via
+  * Propagation-Assisted KD-Trees" (He and Sun, CVPR 2012).
+  * Every valid source patch is projected onto the leading principal components of the source patches, and the
+  * descriptors are put in a kd-tree. The candidates of a target patch are the patches in the leaves that its
+  * own descriptor falls in, together with the leaves of its current match and of the matches of its two
+  * previous neighbors, shifted by the offset to that neighbor. The candidates are then scored with the patch
+  * distance functor. The tree is rebuilt by the next Search() after the source image, the valid patch centers
+  * image or the patch radius is set, or after Modified() is called. */
+template <typename TImage, typename TPatchDistanceFunctor>
+class KDTreeSearch
+{
+public:
+  /** Look for a better match for every pixel to process. */
+  void Search(NNFieldType* const nnField);
+
+  /** Set the patch radius. */
+  void SetPatchRadius(const unsigned int patchRadius)
+  {
+    this->PatchRadius = patchRadius;
+    Modified();
+  }
+
+  /** Set the image on which to operate when matching an image against itself. */
+  void SetImage(TImage* const image)
+  {
+    SetSourceImage(image);
+    SetTargetImage(image);
+  }
+
+  /** Set the image from which matches are drawn. */
+  void SetSourceImage(TImage* const sourceImage)
+  {
+    this->SourceImage = sourceImage;
+    Modified();
+  }
+
+  /** Set the image for which the NNField is computed. */
+  void SetTargetImage(TImage* const targetImage)
+  {
+    this->TargetImage = targetImage;
+  }
+
+  /** Set the functor used to compare patches. */
+  void SetPatchDistanceFunctor(TPatchDistanceFunctor* const patchDistanceFunctor)
+  {
+    this->PatchDistanceFunctor = patchDistanceFunctor;
+  }
+
+  /** Get the functor used to compare patches. */
+  TPatchDistanceFunctor* GetPatchDistanceFunctor() const
+  {
+    return this->PatchDistanceFunctor;
+  }
+
+  void SetPixelsToProcess(const std::vector<itk::Index<2> >& pixelsToProcess)
+  {
+    this->PixelsToProcess = pixelsToProcess;
+  }
+
+  /** Set the image (the size of the source image) where if a pixel is 'true', it is the center of a valid region. */
+  void SetValidPatchCentersImage(itk::Image<bool, 2>* const validPatchCentersImage)
+  {
+    this->ValidPatchCentersImage = validPatchCentersImage;
+    Modified();
+  }
+
+  /** Set the reverse index to keep up to date with the matches that are accepted. This is optional. */
+  void SetReverseIndex(NNFieldReverseIndex* const reverseIndex)
+  {
+    this->ReverseIndex = reverseIndex;
+  }
+
+  /** Set the arena from which the target descriptors are drawn. If it is not set, an arena owned by this
+    * functor is used. */
+  void SetArena(Arena* const arena)
+  {
+    this->TemporaryArena = arena;
+  }
+
+  /** Set the mean/variance bound used to skip the patch distance of candidates that cannot beat the current
+    * match. This is optional. */
+  void SetMeanVarianceBound(MeanVarianceBound* const meanVarianceBound)
+  {
+    this->DistanceBound = meanVarianceBound;
+  }
+
+  /** Set the descriptors used to reject candidates without computing their patch distance. This is optional. */
+  void SetDescriptorPrefilter(const PatchDescriptorPrefilter* const descriptorPrefilter)
+  {
+    this->DescriptorPrefilter = descriptorPrefilter;
+  }
+
+  /** Get the number of candidates that the DescriptorPrefilter rejected in the last Search(). */
+  unsigned int GetNumberOfRejectedCandidates() const
+  {
+    return this->NumberOfRejectedCandidates;
+  }
+
+  /** The search is deterministic, so there is no random state to save in a checkpoint (see RandomSearch). */
+  std::string GetRandomState() const
+  {
+    return std::string();
+  }
+
+  void SetRandomState(const std::string&)
+  {
+  }
+
+  /** Rebuild the tree at the next Search(), for example because the source image pixels changed. */
+  void Modified()
+  {
+    this->Tree.Clear();
+  }
+
+  /** Set the length of the patch descriptors. */
+  void SetNumberOfComponents(const unsigned int numberOfComponents)
+  {
+    this->NumberOfComponents = numberOfComponents;
+    Modified();
+  }
+
+  /** Set the largest number of source patches in a leaf of the tree. */
+  void SetLeafSize(const unsigned int leafSize)
+  {
+    this->LeafSize = leafSize;
+    Modified();
+  }
+
+  /** Set the number of leaves visited by the tree search of each target patch. */
+  void SetNumberOfLeavesToSearch(const unsigned int numberOfLeavesToSearch)
+  {
+    this->NumberOfLeavesToSearch = numberOfLeavesToSearch;
+  }
+
+  /** Set the number of source patches whose principal components are computed. */
+  void SetNumberOfTrainingPatches(const unsigned int numberOfTrainingPatches)
+  {
+    this->NumberOfTrainingPatches = numberOfTrainingPatches;
+    Modified();
+  }
+
+  /** Get the projection of the patches onto their descriptors. */
+  const PatchPCA<TImage>* GetPatchPCA() const
+  {
+    return &this->Descriptors;
+  }
+
+private:
+  /** The image from which matches are drawn. */
+  TImage* SourceImage = nullptr;
+
+  /** The image for which the NNField is computed. */
+  TImage* TargetImage = nullptr;
+
+  /** The patch radius we are using to define regions to compare. */
+  unsigned int PatchRadius = 0;
+
+  /** The functor used to compare patches. */
+  TPatchDistanceFunctor* PatchDistanceFunctor = nullptr;
+
+  /** The pixels for which we are trying to find a better match. */
+  std::vector<itk::Index<2> > PixelsToProcess;
+
+  /** An image (the size of the source image) where if a pixel is 'true', it is the center of a valid region.
+    * If this is not set, every patch entirely inside the source image is valid. */
+  itk::Image<bool, 2>* ValidPatchCentersImage = nullptr;
+
+  /** If set, this is updated whenever a match is accepted. */
+  NNFieldReverseIndex* ReverseIndex = nullptr;
+
+  /** If set, candidates whose mean/variance bound does not beat the current match are not scored. */
+  MeanVarianceBound* DistanceBound = nullptr;
+
+  /** If set, candidates whose descriptor bound does not beat the current match are not scored. */
+  const PatchDescriptorPrefilter* DescriptorPrefilter = nullptr;
+
+  unsigned int NumberOfRejectedCandidates = 0;
+
+  /** The length of the patch descriptors. */
+  unsigned int NumberOfComponents = 8;
+
+  /** The largest number of source patches in a leaf. */
+  unsigned int LeafSize = 8;
+
+  /** The number of leaves visited by the tree search of each target patch. */
+  unsigned int NumberOfLeavesToSearch = 1;
+
+  /** The number of source patches whose principal components are computed. */
+  unsigned int NumberOfTrainingPatches = 5000;
+
+  /** The projection of the patches onto their descriptors. */
+  PatchPCA<TImage> Descriptors;
+
+  /** The descriptors of the valid source patches. */
+  KDTree Tree;
+
+  /** The center of the source patch of each point of the Tree. */
+  std::vector<itk::Index<2> > SourceCenters;
+
+  /** The point of the Tree of each pixel of the source image, or NoPoint if the patch centered there is not valid. */
+  std::vector<unsigned int> PointOfSourcePixel;
+
+  static const unsigned int NoPoint = static_cast<unsigned int>(-1);
+
+  /** The candidates of the pixel currently being searched. These are members so that their memory is reused. */
+  std::vector<unsigned int> CandidatePoints;
+  std::vector<itk::ImageRegion<2> > CandidateRegions;
+  std::vector<float> CandidateScores;
+
+  /** The arena set with SetArena(), if any. */
+  Arena* TemporaryArena = nullptr;
+
+  /** The arena used when none was set. */
+  Arena OwnArena;
+
+  /** Get the arena to draw temporary buffers from. */
+  Arena* GetArena()
+  {
+    return this->TemporaryArena ? this->TemporaryArena : &this->OwnArena;
+  }
+
+  /** Compute the descriptors of the valid source patches and build the Tree over them. */
+  void BuildTree();
+
+  /** Add the points of the leaf holding the source patch centered at 'sourceCenter' to the CandidatePoints,
+    * if that patch is valid. */
+  void AddLeafOfSourceCenter(const itk::Index<2>& sourceCenter);
+};
+
+#include "KDTreeSearch.hpp"
+
+#endif
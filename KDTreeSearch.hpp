@@ -0,0 +1,227 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef KDTreeSearch_HPP
+#define KDTreeSearch_HPP
+
+#include "KDTreeSearch.h"
+
+// ITK
+#include "itkImageRegion.h"
+
+// STL
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+// Submodules
+#include <ITKHelpers/ITKHelpers.h>
+
+// Custom
+#include "PatchMatchHelpers.h"
+
+// NoPoint is bound to a reference by std::vector::assign(), so it needs a definition
+template <typename TImage, typename TPatchDistanceFunctor>
+const unsigned int KDTreeSearch<TImage, TPatchDistanceFunctor>::NoPoint;
+
+template <typename TImage, typename TPatchDistanceFunctor>
+void KDTreeSearch<TImage, TPatchDistanceFunctor>::Search(NNFieldType* const nnField)
+{
+  assert(nnField);
+  assert(this->SourceImage);
+  assert(this->TargetImage);
+  assert(this->PatchRadius > 0);
+  assert(this->PatchDistanceFunctor);
+  assert(nnField->GetLargestPossibleRegion().GetSize() ==
+         this->TargetImage->GetLargestPossibleRegion().GetSize());
+
+  if(!this->Tree.IsBuilt())
+  {
+    BuildTree();
+  }
+
+  itk::ImageRegion<2> targetInternalRegion = ITKHelpers::GetInternalRegion(nnField->GetLargestPossibleRegion(),
+                                                                            this->PatchRadius);
+
+  this->NumberOfRejectedCandidates = 0;
+
+  if(this->PixelsToProcess.size() == 0)
+  {
+    this->PixelsToProcess = PatchMatchHelpers::GetAllPixelIndices(targetInternalRegion);
+  }
+
+  const unsigned int numberOfComponents = this->Descriptors.GetNumberOfComponents();
+
+  Arena::Scope scope(GetArena());
+  ArenaVector<float> descriptor(GetArena());
+  descriptor.resize(numberOfComponents);
+
+  // The neighbors whose matches are shifted onto the current pixel, as in propagation
+  const itk::Offset<2> neighborOffsets[2] = {{{-1, 0}}, {{0, -1}}};
+
+  for(size_t pixelId = 0; pixelId < this->PixelsToProcess.size(); ++pixelId)
+  {
+    const itk::Index<2>& queryPixel = this->PixelsToProcess[pixelId];
+
+    this->CandidatePoints.clear();
+
+    this->Descriptors.Project(this->TargetImage, queryPixel, descriptor.data());
+    this->Tree.AppendApproximateNeighbors(descriptor.data(), this->NumberOfLeavesToSearch, this->CandidatePoints);
+
+    const Match& currentMatch = nnField->GetPixel(queryPixel);
+    if(currentMatch.GetRegion().GetNumberOfPixels() > 0)
+    {
+      AddLeafOfSourceCenter(ITKHelpers::GetRegionCenter(currentMatch.GetRegion()));
+    }
+
+    for(unsigned int neighborId = 0; neighborId < 2; ++neighborId)
+    {
+      itk::Index<2> neighbor = queryPixel + neighborOffsets[neighborId];
+      if(!targetInternalRegion.IsInside(neighbor))
+      {
+        continue;
+      }
+
+      const Match& neighborMatch = nnField->GetPixel(neighbor);
+      if(neighborMatch.GetRegion().GetNumberOfPixels() == 0)
+      {
+        continue;
+      }
+
+      AddLeafOfSourceCenter(ITKHelpers::GetRegionCenter(neighborMatch.GetRegion()) - neighborOffsets[neighborId]);
+    }
+
+    // The leaves of the neighbors often coincide, so duplicates are removed before the (expensive) scoring
+    std::sort(this->CandidatePoints.begin(), this->CandidatePoints.end());
+    this->CandidatePoints.erase(std::unique(this->CandidatePoints.begin(), this->CandidatePoints.end()),
+                                this->CandidatePoints.end());
+
+    // Only the candidates that the descriptors and the mean/variance bound do not rule out are scored
+    if(this->DescriptorPrefilter || this->DistanceBound)
+    {
+      size_t numberOfKeptCandidates = 0;
+      for(size_t candidateId = 0; candidateId < this->CandidatePoints.size(); ++candidateId)
+      {
+        const itk::Index<2>& candidateCenter = this->SourceCenters[this->CandidatePoints[candidateId]];
+
+        if(this->DescriptorPrefilter && this->DescriptorPrefilter->Rejects(candidateCenter, queryPixel, currentMatch))
+        {
+          this->NumberOfRejectedCandidates++;
+          continue;
+        }
+
+        if(this->DistanceBound && this->DistanceBound->Rejects(candidateCenter, queryPixel, currentMatch))
+        {
+          continue;
+        }
+
+        this->CandidatePoints[numberOfKeptCandidates++] = this->CandidatePoints[candidateId];
+      }
+      this->CandidatePoints.resize(numberOfKeptCandidates);
+    }
+
+    if(this->CandidatePoints.empty())
+    {
+      continue;
+    }
+
+    this->CandidateRegions.resize(this->CandidatePoints.size());
+    for(size_t candidateId = 0; candidateId < this->CandidatePoints.size(); ++candidateId)
+    {
+      this->CandidateRegions[candidateId] =
+          ITKHelpers::GetRegionInRadiusAroundPixel(this->SourceCenters[this->CandidatePoints[candidateId]],
+                                                   this->PatchRadius);
+    }
+
+    itk::ImageRegion<2> queryRegion = ITKHelpers::GetRegionInRadiusAroundPixel(queryPixel, this->PatchRadius);
+    PatchMatchHelpers::BatchDistance(this->PatchDistanceFunctor, queryRegion,
+                                     this->CandidateRegions, this->CandidateScores);
+
+    size_t bestCandidateId = std::min_element(this->CandidateScores.begin(), this->CandidateScores.end()) -
+                             this->CandidateScores.begin();
+
+    if(this->CandidateScores[bestCandidateId] < currentMatch.GetScore())
+    {
+      Match betterMatch;
+      betterMatch.SetRegion(this->CandidateRegions[bestCandidateId]);
+      betterMatch.SetScore(this->CandidateScores[bestCandidateId]);
+      nnField->SetPixel(queryPixel, betterMatch);
+
+      if(this->ReverseIndex)
+      {
+        this->ReverseIndex->Update(queryPixel, this->SourceCenters[this->CandidatePoints[bestCandidateId]]);
+      }
+    }
+  }
+}
+
+template <typename TImage, typename TPatchDistanceFunctor>
+void KDTreeSearch<TImage, TPatchDistanceFunctor>::BuildTree()
+{
+  itk::ImageRegion<2> sourceRegion = this->SourceImage->GetLargestPossibleRegion();
+  itk::ImageRegion<2> sourceInternalRegion = ITKHelpers::GetInternalRegion(sourceRegion, this->PatchRadius);
+
+  if(this->ValidPatchCentersImage)
+  {
+    this->SourceCenters = ITKHelpers::GetPixelsWithValueInRegion(this->ValidPatchCentersImage,
+                                                                 sourceInternalRegion, true);
+  }
+  else
+  {
+    this->SourceCenters = PatchMatchHelpers::GetAllPixelIndices(sourceInternalRegion);
+  }
+
+  if(this->SourceCenters.empty())
+  {
+    throw std::runtime_error("KDTreeSearch: No valid source regions!");
+  }
+
+  this->Descriptors.Compute(this->SourceImage, this->PatchRadius, this->SourceCenters,
+                            this->NumberOfComponents, this->NumberOfTrainingPatches);
+
+  const unsigned int numberOfComponents = this->Descriptors.GetNumberOfComponents();
+
+  std::vector<float> sourceDescriptors(this->SourceCenters.size() * numberOfComponents);
+  this->PointOfSourcePixel.assign(sourceRegion.GetNumberOfPixels(), NoPoint);
+
+  for(size_t pointId = 0; pointId < this->SourceCenters.size(); ++pointId)
+  {
+    this->Descriptors.Project(this->SourceImage, this->SourceCenters[pointId],
+                              &sourceDescriptors[pointId * numberOfComponents]);
+    this->PointOfSourcePixel[this->SourceImage->ComputeOffset(this->SourceCenters[pointId])] = pointId;
+  }
+
+  this->Tree.Build(sourceDescriptors.data(), this->SourceCenters.size(), numberOfComponents, this->LeafSize);
+}
+
+template <typename TImage, typename TPatchDistanceFunctor>
+void KDTreeSearch<TImage, TPatchDistanceFunctor>::AddLeafOfSourceCenter(const itk::Index<2>& sourceCenter)
+{
+  if(!this->SourceImage->GetLargestPossibleRegion().IsInside(sourceCenter))
+  {
+    return;
+  }
+
+  unsigned int pointId = this->PointOfSourcePixel[this->SourceImage->ComputeOffset(sourceCenter)];
+  if(pointId != NoPoint)
+  {
+    this->Tree.AppendLeafOfPoint(pointId, this->CandidatePoints);
+  }
+}
+
+#endif
@@ -0,0 +1,94 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#include "MeanVarianceBound.h"
+
+// STL
+#include <algorithm>
+#include <cmath>
+
+float MeanVarianceBound::LowerBound(const itk::Index<2>& sourceCenter, const itk::Index<2>& targetCenter) const
+{
+  assert(IsComputed());
+
+  const SummedAreaTables& targetTables = this->TargetIsSource ? this->SourceTables : this->TargetTables;
+
+  size_t sourceCorners[4];
+  size_t targetCorners[4];
+  GetCornerOffsets(this->SourceTables, sourceCenter, sourceCorners);
+  GetCornerOffsets(targetTables, targetCenter, targetCorners);
+
+  const double* sourceSums = this->SourceTables.Sums.data();
+  const double* targetSums = targetTables.Sums.data();
+
+  const unsigned int patchSideLength = 2 * this->PatchRadius + 1;
+  const double numberOfPixels = patchSideLength * patchSideLength;
+
+  double bound = 0.0;
+  for(unsigned int value = 0; value < 2 * this->NumberOfChannels; value += 2)
+  {
+    double sourceSum = sourceSums[sourceCorners[3] + value] - sourceSums[sourceCorners[1] + value] -
+                       sourceSums[sourceCorners[2] + value] + sourceSums[sourceCorners[0] + value];
+    double sourceSumOfSquares = sourceSums[sourceCorners[3] + value + 1] - sourceSums[sourceCorners[1] + value + 1] -
+                                sourceSums[sourceCorners[2] + value + 1] + sourceSums[sourceCorners[0] + value + 1];
+    double targetSum = targetSums[targetCorners[3] + value] - targetSums[targetCorners[1] + value] -
+                       targetSums[targetCorners[2] + value] + targetSums[targetCorners[0] + value];
+    double targetSumOfSquares = targetSums[targetCorners[3] + value + 1] - targetSums[targetCorners[1] + value + 1] -
+                                targetSums[targetCorners[2] + value + 1] + targetSums[targetCorners[0] + value + 1];
+
+    // The squared norms of the deviations from the means. Rounding can make a flat patch slightly negative.
+    double sourceDeviation = std::sqrt(std::max(0.0, sourceSumOfSquares - sourceSum * sourceSum / numberOfPixels));
+    double targetDeviation = std::sqrt(std::max(0.0, targetSumOfSquares - targetSum * targetSum / numberOfPixels));
+
+    double sumDifference = sourceSum - targetSum;
+    double deviationDifference = sourceDeviation - targetDeviation;
+    bound += sumDifference * sumDifference / numberOfPixels + deviationDifference * deviationDifference;
+  }
+
+  return static_cast<float>(bound);
+}
+
+void MeanVarianceBound::Clear()
+{
+  this->SourceTables = SummedAreaTables();
+  this->TargetTables = SummedAreaTables();
+  this->TargetIsSource = false;
+  this->NumberOfChannels = 0;
+  ResetCounts();
+}
+
+void MeanVarianceBound::GetCornerOffsets(const SummedAreaTables& tables, const itk::Index<2>& center,
+                                         size_t* const cornerOffsets) const
+{
+  assert(tables.Region.IsInside(center));
+
+  const size_t tableWidth = tables.Region.GetSize()[0] + 1;
+  const size_t entryLength = 2 * this->NumberOfChannels;
+
+  // Entry (x, y) of a table holds the sums over the pixels above and to the left of pixel (x, y)
+  const size_t x0 = center[0] - this->PatchRadius - tables.Region.GetIndex()[0];
+  const size_t y0 = center[1] - this->PatchRadius - tables.Region.GetIndex()[1];
+  const size_t x1 = x0 + 2 * this->PatchRadius + 1;
+  const size_t y1 = y0 + 2 * this->PatchRadius + 1;
+
+  cornerOffsets[0] = (y0 * tableWidth + x0) * entryLength;
+  cornerOffsets[1] = (y0 * tableWidth + x1) * entryLength;
+  cornerOffsets[2] = (y1 * tableWidth + x0) * entryLength;
+  cornerOffsets[3] = (y1 * tableWidth + x1) * entryLength;
+}
@@ -0,0 +1,144 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#ifndef MeanVarianceBound_H
+#define MeanVarianceBound_H
+
+// ITK
+#include "itkImage.h"
+#include "itkImageRegion.h"
+
+// STL
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+// Custom
+#include "Match.h"
+
+/** A lower bound of the sum of squared differences between two patches computed from their per-channel means
+  * and variances. Splitting each channel of a patch into its mean and the (orthogonal) deviation from it gives
+  *   SSD(a,b) >= sum over channels of n * (mean(a) - mean(b))^2 + (|a - mean(a)| - |b - mean(b)|)^2
+  * by the triangle inequality, where n is the number of pixels in a patch. The sums and sums of squares of the
+  * patches are read from summed area tables of every channel and its square, so a bound costs O(channels).
+  * Candidates whose bound is not below the score of the current match cannot replace it, so their full distance
+  * does not need to be computed. The bound only holds for a plain SSD patch distance (e.g. BatchSSD).
+  * Rejects() counts the candidates it tests and prunes, so it must not be called from several threads at once. */
+class MeanVarianceBound
+{
+public:
+  /** Build the summed area tables of both images. If 'targetImage' is the same as 'sourceImage', the tables
+    * are only built once. */
+  template <typename TImage>
+  void Compute(const TImage* const sourceImage, const TImage* const targetImage, const unsigned int patchRadius);
+
+  /** Get a lower bound of the distance between the source patch centered at 'sourceCenter' and the target
+    * patch centered at 'targetCenter'. Both patches must be entirely inside their images. */
+  float LowerBound(const itk::Index<2>& sourceCenter, const itk::Index<2>& targetCenter) const;
+
+  /** Return true (and count the candidate as pruned) if the source patch centered at 'sourceCenter' cannot be
+    * a better match for the target patch centered at 'targetCenter' than one with score 'scoreToBeat'. */
+  bool Rejects(const itk::Index<2>& sourceCenter, const itk::Index<2>& targetCenter, const float scoreToBeat)
+  {
+    this->NumberOfTests++;
+    if(LowerBound(sourceCenter, targetCenter) >= scoreToBeat)
+    {
+      this->NumberOfPrunedCandidates++;
+      return true;
+    }
+    return false;
+  }
+
+  /** Same as above, against 'currentMatch'. An empty current match rejects nothing. */
+  bool Rejects(const itk::Index<2>& sourceCenter, const itk::Index<2>& targetCenter, const Match& currentMatch)
+  {
+    return currentMatch.GetRegion().GetNumberOfPixels() > 0 &&
+           Rejects(sourceCenter, targetCenter, currentMatch.GetScore());
+  }
+
+  bool IsComputed() const
+  {
+    return this->NumberOfChannels > 0;
+  }
+
+  /** Release the tables. */
+  void Clear();
+
+  /** Get the number of candidates that were tested against the bound since the last ResetCounts(). */
+  size_t GetNumberOfTests() const
+  {
+    return this->NumberOfTests;
+  }
+
+  /** Get the number of candidates that the bound pruned since the last ResetCounts(). */
+  size_t GetNumberOfPrunedCandidates() const
+  {
+    return this->NumberOfPrunedCandidates;
+  }
+
+  /** Get the fraction of the tested candidates that were pruned. */
+  float GetPruningRate() const
+  {
+    return this->NumberOfTests > 0 ?
+           static_cast<float>(this->NumberOfPrunedCandidates) / static_cast<float>(this->NumberOfTests) : 0.0f;
+  }
+
+  void ResetCounts()
+  {
+    this->NumberOfTests = 0;
+    this->NumberOfPrunedCandidates = 0;
+  }
+
+private:
+  /** The summed area tables of an image. Each table has an extra leading row and column of zeros, and
+    * stores the sum and the sum of squares of every channel at each entry. */
+  struct SummedAreaTables
+  {
+    itk::ImageRegion<2> Region;
+
+    std::vector<double> Sums;
+  };
+
+  SummedAreaTables SourceTables;
+
+  SummedAreaTables TargetTables;
+
+  /** True if the target image is the source image, in which case the TargetTables are not used. */
+  bool TargetIsSource = false;
+
+  unsigned int PatchRadius = 0;
+
+  unsigned int NumberOfChannels = 0;
+
+  size_t NumberOfTests = 0;
+
+  size_t NumberOfPrunedCandidates = 0;
+
+  /** Build the summed area tables of 'image'. */
+  template <typename TImage>
+  void ComputeTables(const TImage* const image, SummedAreaTables& tables);
+
+  /** Get the offsets in the tables of the entries at the four corners of the patch centered at 'center',
+    * in the order top left, top right, bottom left, bottom right. */
+  void GetCornerOffsets(const SummedAreaTables& tables, const itk::Index<2>& center, size_t* const cornerOffsets) const;
+};
+
+#include "MeanVarianceBound.hpp"
+
+#endif
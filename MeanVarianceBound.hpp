@@ -0,0 +1,94 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#ifndef MeanVarianceBound_HPP
+#define MeanVarianceBound_HPP
+
+#include "MeanVarianceBound.h"
+
+// ITK
+#include "itkDefaultConvertPixelTraits.h"
+#include "itkImageRegionConstIterator.h"
+
+template <typename TImage>
+void MeanVarianceBound::Compute(const TImage* const sourceImage, const TImage* const targetImage,
+                                const unsigned int patchRadius)
+{
+  assert(sourceImage);
+  assert(targetImage);
+
+  typedef itk::DefaultConvertPixelTraits<typename TImage::PixelType> PixelTraitsType;
+
+  this->PatchRadius = patchRadius;
+  this->NumberOfChannels = PixelTraitsType::GetNumberOfComponents();
+
+  ComputeTables(sourceImage, this->SourceTables);
+
+  this->TargetIsSource = (targetImage == sourceImage);
+  if(this->TargetIsSource)
+  {
+    this->TargetTables = SummedAreaTables();
+  }
+  else
+  {
+    ComputeTables(targetImage, this->TargetTables);
+  }
+}
+
+template <typename TImage>
+void MeanVarianceBound::ComputeTables(const TImage* const image, SummedAreaTables& tables)
+{
+  typedef itk::DefaultConvertPixelTraits<typename TImage::PixelType> PixelTraitsType;
+
+  tables.Region = image->GetLargestPossibleRegion();
+  const size_t width = tables.Region.GetSize()[0];
+  const size_t height = tables.Region.GetSize()[1];
+  const size_t tableWidth = width + 1;
+  const size_t entryLength = 2 * this->NumberOfChannels;
+
+  // Doubles, since the sums of squares of a large image do not fit in the mantissa of a float
+  tables.Sums.assign(tableWidth * (height + 1) * entryLength, 0.0);
+
+  std::vector<double> rowSums(entryLength);
+
+  itk::ImageRegionConstIterator<TImage> imageIterator(image, tables.Region);
+
+  for(size_t y = 0; y < height; ++y)
+  {
+    std::fill(rowSums.begin(), rowSums.end(), 0.0);
+    for(size_t x = 0; x < width; ++x)
+    {
+      const double* above = &tables.Sums[(y * tableWidth + x + 1) * entryLength];
+      double* entry = &tables.Sums[((y + 1) * tableWidth + x + 1) * entryLength];
+
+      for(unsigned int channel = 0; channel < this->NumberOfChannels; ++channel)
+      {
+        double value = static_cast<double>(PixelTraitsType::GetNthComponent(channel, imageIterator.Get()));
+        rowSums[2 * channel] += value;
+        rowSums[2 * channel + 1] += value * value;
+        entry[2 * channel] = above[2 * channel] + rowSums[2 * channel];
+        entry[2 * channel + 1] = above[2 * channel + 1] + rowSums[2 * channel + 1];
+      }
+
+      ++imageIterator;
+    }
+  }
+}
+
+#endif
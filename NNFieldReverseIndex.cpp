@@ -0,0 +1,267 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "NNFieldReverseIndex.h"
+
+// ITK
+#include "itkImageRegionConstIteratorWithIndex.h"
+
+// STL
+#include <algorithm>
+#include <cassert>
+
+// Submodules
+#include <ITKHelpers/ITKHelpers.h>
+
+const unsigned int NNFieldReverseIndex::NoSource;
+const unsigned int NNFieldReverseIndex::NoTarget;
+
+void NNFieldReverseIndex::Build(const NNFieldType* const nnField, const itk::ImageRegion<2>& sourceRegion)
+{
+  this->SourceRegion = sourceRegion;
+  this->TargetRegion = nnField->GetLargestPossibleRegion();
+
+  this->CurrentSource.assign(this->TargetRegion.GetNumberOfPixels(), NoSource);
+  this->MovedNext.assign(this->TargetRegion.GetNumberOfPixels(), NoTarget);
+
+  itk::ImageRegionConstIteratorWithIndex<NNFieldType> nnFieldIterator(nnField, this->TargetRegion);
+
+  while(!nnFieldIterator.IsAtEnd())
+  {
+    itk::ImageRegion<2> matchRegion = nnFieldIterator.Get().GetRegion();
+
+    if(matchRegion.GetNumberOfPixels() > 0)
+    {
+      this->CurrentSource[ComputeOffset(this->TargetRegion, nnFieldIterator.GetIndex())] =
+          ComputeOffset(this->SourceRegion, ITKHelpers::GetRegionCenter(matchRegion));
+    }
+
+    ++nnFieldIterator;
+  }
+
+  RebuildBuckets();
+}
+
+void NNFieldReverseIndex::Clear()
+{
+  // swap() rather than clear() so that the memory is actually released
+  std::vector<unsigned int>().swap(this->CurrentSource);
+  std::vector<unsigned int>().swap(this->BucketStarts);
+  std::vector<unsigned int>().swap(this->BucketTargets);
+  std::vector<unsigned int>().swap(this->MovedHead);
+  std::vector<unsigned int>().swap(this->MovedNext);
+  this->NumberOfMovedTargets = 0;
+  this->NeedsRebuild = false;
+}
+
+void NNFieldReverseIndex::RebuildBuckets()
+{
+  const size_t numberOfSources = this->SourceRegion.GetNumberOfPixels();
+
+  // Count the targets of each source, shifted by one so that the prefix sum gives the bucket starts
+  this->BucketStarts.assign(numberOfSources + 1, 0);
+  for(size_t targetOffset = 0; targetOffset < this->CurrentSource.size(); ++targetOffset)
+  {
+    if(this->CurrentSource[targetOffset] != NoSource)
+    {
+      this->BucketStarts[this->CurrentSource[targetOffset] + 1]++;
+    }
+  }
+
+  for(size_t sourceOffset = 0; sourceOffset < numberOfSources; ++sourceOffset)
+  {
+    this->BucketStarts[sourceOffset + 1] += this->BucketStarts[sourceOffset];
+  }
+
+  // Targets are visited in increasing order, so each bucket ends up sorted
+  this->BucketTargets.resize(this->BucketStarts.back());
+  std::vector<unsigned int> nextPosition(this->BucketStarts.begin(), this->BucketStarts.end() - 1);
+  for(size_t targetOffset = 0; targetOffset < this->CurrentSource.size(); ++targetOffset)
+  {
+    if(this->CurrentSource[targetOffset] != NoSource)
+    {
+      this->BucketTargets[nextPosition[this->CurrentSource[targetOffset]]++] = targetOffset;
+    }
+  }
+
+  this->MovedHead.assign(numberOfSources, NoTarget);
+  this->NumberOfMovedTargets = 0;
+  this->NeedsRebuild = false;
+}
+
+bool NNFieldReverseIndex::IsInBucket(const unsigned int sourceOffset, const unsigned int targetOffset) const
+{
+  std::vector<unsigned int>::const_iterator bucketBegin = this->BucketTargets.begin() + this->BucketStarts[sourceOffset];
+  std::vector<unsigned int>::const_iterator bucketEnd = this->BucketTargets.begin() + this->BucketStarts[sourceOffset + 1];
+  return std::binary_search(bucketBegin, bucketEnd, targetOffset);
+}
+
+void NNFieldReverseIndex::Update(const itk::Index<2>& targetPixel, const itk::Index<2>& sourceCenter)
+{
+  if(!IsBuilt())
+  {
+    return;
+  }
+
+  const unsigned int targetOffset = ComputeOffset(this->TargetRegion, targetPixel);
+  const unsigned int newSource = ComputeOffset(this->SourceRegion, sourceCenter);
+  const unsigned int oldSource = this->CurrentSource[targetOffset];
+
+  if(newSource == oldSource)
+  {
+    return;
+  }
+
+  this->CurrentSource[targetOffset] = newSource;
+
+  // Stale bucket entries are skipped by the queries, but side list entries have to be removed
+  // so that a target never appears twice
+  if(oldSource != NoSource)
+  {
+    unsigned int* link = &this->MovedHead[oldSource];
+    while(*link != NoTarget && *link != targetOffset)
+    {
+      link = &this->MovedNext[*link];
+    }
+    if(*link == targetOffset)
+    {
+      *link = this->MovedNext[targetOffset];
+      this->NumberOfMovedTargets--;
+    }
+  }
+
+  // If the target is moving back to the bucket it was built in, that entry becomes valid again
+  if(!IsInBucket(newSource, targetOffset))
+  {
+    this->MovedNext[targetOffset] = this->MovedHead[newSource];
+    this->MovedHead[newSource] = targetOffset;
+    this->NumberOfMovedTargets++;
+
+    if(this->NumberOfMovedTargets > this->RebuildFraction * this->BucketTargets.size() + 1024)
+    {
+      this->NeedsRebuild = true;
+    }
+  }
+}
+
+void NNFieldReverseIndex::AppendTargets(const unsigned int sourceOffset, std::vector<itk::Index<2> >& targets) const
+{
+  for(unsigned int position = this->BucketStarts[sourceOffset]; position < this->BucketStarts[sourceOffset + 1]; ++position)
+  {
+    unsigned int targetOffset = this->BucketTargets[position];
+    if(this->CurrentSource[targetOffset] == sourceOffset)
+    {
+      targets.push_back(ComputeIndex(this->TargetRegion, targetOffset));
+    }
+  }
+
+  for(unsigned int targetOffset = this->MovedHead[sourceOffset]; targetOffset != NoTarget;
+      targetOffset = this->MovedNext[targetOffset])
+  {
+    targets.push_back(ComputeIndex(this->TargetRegion, targetOffset));
+  }
+}
+
+std::vector<itk::Index<2> > NNFieldReverseIndex::GetTargets(const itk::Index<2>& sourceCenter)
+{
+  assert(IsBuilt());
+
+  if(this->NeedsRebuild)
+  {
+    RebuildBuckets();
+  }
+
+  std::vector<itk::Index<2> > targets;
+  AppendTargets(ComputeOffset(this->SourceRegion, sourceCenter), targets);
+  return targets;
+}
+
+unsigned int NNFieldReverseIndex::GetNumberOfTargets(const itk::Index<2>& sourceCenter)
+{
+  assert(IsBuilt());
+
+  if(this->NeedsRebuild)
+  {
+    RebuildBuckets();
+  }
+
+  const unsigned int sourceOffset = ComputeOffset(this->SourceRegion, sourceCenter);
+
+  unsigned int numberOfTargets = 0;
+  for(unsigned int targetOffset = this->MovedHead[sourceOffset]; targetOffset != NoTarget;
+      targetOffset = this->MovedNext[targetOffset])
+  {
+    numberOfTargets++;
+  }
+  for(unsigned int position = this->BucketStarts[sourceOffset]; position < this->BucketStarts[sourceOffset + 1]; ++position)
+  {
+    if(this->CurrentSource[this->BucketTargets[position]] == sourceOffset)
+    {
+      numberOfTargets++;
+    }
+  }
+
+  return numberOfTargets;
+}
+
+std::vector<itk::Index<2> > NNFieldReverseIndex::GetTargetsInRegion(const itk::ImageRegion<2>& sourceCenterRegion)
+{
+  std::vector<itk::Index<2> > targets;
+  AppendTargetsInRegion(sourceCenterRegion, targets);
+  return targets;
+}
+
+void NNFieldReverseIndex::AppendTargetsInRegion(const itk::ImageRegion<2>& sourceCenterRegion,
+                                                std::vector<itk::Index<2> >& targets)
+{
+  assert(IsBuilt());
+
+  if(this->NeedsRebuild)
+  {
+    RebuildBuckets();
+  }
+
+  itk::ImageRegion<2> region = sourceCenterRegion;
+  if(!region.Crop(this->SourceRegion))
+  {
+    return;
+  }
+
+  for(itk::IndexValueType y = region.GetIndex()[1]; y < region.GetIndex()[1] + static_cast<itk::IndexValueType>(region.GetSize()[1]); ++y)
+  {
+    itk::Index<2> rowStart = {{region.GetIndex()[0], y}};
+    unsigned int sourceOffset = ComputeOffset(this->SourceRegion, rowStart);
+    for(itk::SizeValueType x = 0; x < region.GetSize()[0]; ++x)
+    {
+      AppendTargets(sourceOffset + x, targets);
+    }
+  }
+}
+
+size_t NNFieldReverseIndex::GetMemoryUsage() const
+{
+  size_t memoryUsage = sizeof(*this);
+  memoryUsage += this->CurrentSource.capacity() * sizeof(unsigned int);
+  memoryUsage += this->BucketStarts.capacity() * sizeof(unsigned int);
+  memoryUsage += this->BucketTargets.capacity() * sizeof(unsigned int);
+
+  memoryUsage += this->MovedHead.capacity() * sizeof(unsigned int);
+  memoryUsage += this->MovedNext.capacity() * sizeof(unsigned int);
+
+  return memoryUsage;
+}
@@ -0,0 +1,142 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef NNFieldReverseIndex_H
+#define NNFieldReverseIndex_H
+
+// ITK
+#include "itkImageRegion.h"
+
+// STL
+#include <vector>
+
+// Custom
+#include "NNField.h"
+
+/** For every source patch center, the list of target pixels whose current match is centered there.
+  * This is the reverse of the NNField, which stores the source patch for every target pixel.
+  *
+  * The lists are stored as compressed sparse row (CSR) buckets: one array of target offsets grouped by
+  * source pixel, and one array of where each source pixel's group starts. Matches that change after the
+  * buckets were built are recorded with Update(). A target that moved away from its bucket is simply skipped
+  * by queries (the current source of every target is stored), and a target that moved into a source other than
+  * the one it is bucketed under is kept in a side list of that source. The side lists are linked through arrays
+  * that are allocated by Build(), so Update() never allocates. Once the side lists hold more than a fraction of
+  * the field, the buckets are rebuilt from the current matches on the next query. */
+class NNFieldReverseIndex
+{
+public:
+  /** Index every pixel of 'nnField' that has a match. 'sourceRegion' is the largest possible region of the source image. */
+  void Build(const NNFieldType* const nnField, const itk::ImageRegion<2>& sourceRegion);
+
+  /** Record that the match of 'targetPixel' is now centered at 'sourceCenter'. */
+  void Update(const itk::Index<2>& targetPixel, const itk::Index<2>& sourceCenter);
+
+  /** Get the target pixels whose match is centered at 'sourceCenter'. */
+  std::vector<itk::Index<2> > GetTargets(const itk::Index<2>& sourceCenter);
+
+  /** Get the target pixels whose match is centered anywhere in 'sourceCenterRegion'. */
+  std::vector<itk::Index<2> > GetTargetsInRegion(const itk::ImageRegion<2>& sourceCenterRegion);
+
+  /** Append the target pixels whose match is centered anywhere in 'sourceCenterRegion' to 'targets', so that
+    * a caller querying many regions can reuse one vector. */
+  void AppendTargetsInRegion(const itk::ImageRegion<2>& sourceCenterRegion, std::vector<itk::Index<2> >& targets);
+
+  /** Get the number of target pixels whose match is centered at 'sourceCenter'. */
+  unsigned int GetNumberOfTargets(const itk::Index<2>& sourceCenter);
+
+  /** Get the number of bytes used by the index. */
+  size_t GetMemoryUsage() const;
+
+  /** Set the fraction of the indexed targets that may be in the side table before the buckets are rebuilt. */
+  void SetRebuildFraction(const float rebuildFraction)
+  {
+    this->RebuildFraction = rebuildFraction;
+  }
+
+  /** Determine if the index has been built. */
+  bool IsBuilt() const
+  {
+    return !this->CurrentSource.empty();
+  }
+
+  /** Forget the indexed field, for example because the NNField was recomputed. */
+  void Clear();
+
+private:
+  /** The value of CurrentSource for target pixels that have no match. */
+  static const unsigned int NoSource = static_cast<unsigned int>(-1);
+
+  /** The end of a side list. */
+  static const unsigned int NoTarget = static_cast<unsigned int>(-1);
+
+  /** The largest possible region of the source image. */
+  itk::ImageRegion<2> SourceRegion;
+
+  /** The largest possible region of the NNField (target image). */
+  itk::ImageRegion<2> TargetRegion;
+
+  /** For each target pixel (in raster order), the raster offset of the source pixel at the center of its match. */
+  std::vector<unsigned int> CurrentSource;
+
+  /** For each source pixel, the position in BucketTargets of its first target. This has one extra entry at the end. */
+  std::vector<unsigned int> BucketStarts;
+
+  /** The target offsets of every bucket, one bucket after the other, each in increasing order. */
+  std::vector<unsigned int> BucketTargets;
+
+  /** For each source pixel, the first of the targets that have moved to it from another bucket, or NoTarget. */
+  std::vector<unsigned int> MovedHead;
+
+  /** For each target pixel in a side list, the next target of that list, or NoTarget. */
+  std::vector<unsigned int> MovedNext;
+
+  /** The number of targets in the side lists. */
+  size_t NumberOfMovedTargets = 0;
+
+  /** The fraction of the indexed targets that may be in the side lists before the buckets are rebuilt. */
+  float RebuildFraction = 0.125f;
+
+  /** Set when the side lists have grown large enough that the next query should rebuild the buckets. */
+  bool NeedsRebuild = false;
+
+  /** Rebuild the buckets from CurrentSource with a counting sort, and empty the side lists. */
+  void RebuildBuckets();
+
+  /** Determine if 'targetOffset' is in the bucket of 'sourceOffset'. */
+  bool IsInBucket(const unsigned int sourceOffset, const unsigned int targetOffset) const;
+
+  /** Append the targets currently matched to 'sourceOffset' to 'targets'. */
+  void AppendTargets(const unsigned int sourceOffset, std::vector<itk::Index<2> >& targets) const;
+
+  /** Get the raster offset of 'index' in 'region'. */
+  static unsigned int ComputeOffset(const itk::ImageRegion<2>& region, const itk::Index<2>& index)
+  {
+    return (index[1] - region.GetIndex()[1]) * region.GetSize()[0] + (index[0] - region.GetIndex()[0]);
+  }
+
+  /** Get the index in 'region' of the raster 'offset'. */
+  static itk::Index<2> ComputeIndex(const itk::ImageRegion<2>& region, const unsigned int offset)
+  {
+    itk::Index<2> index = {{static_cast<itk::IndexValueType>(region.GetIndex()[0] + offset % region.GetSize()[0]),
+                            static_cast<itk::IndexValueType>(region.GetIndex()[1] + offset / region.GetSize()[0])}};
+    return index;
+  }
+};
+
+#endif
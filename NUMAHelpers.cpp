@@ -0,0 +1,98 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "NUMAHelpers.h"
+
+// STL
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#ifdef PatchMatch_USE_NUMA
+#include <numa.h>
+#endif
+
+namespace NUMAHelpers
+{
+
+unsigned int GetNumberOfNodes()
+{
+#ifdef PatchMatch_USE_NUMA
+  if(numa_available() >= 0)
+  {
+    return static_cast<unsigned int>(numa_num_configured_nodes());
+  }
+#endif
+  return 1;
+}
+
+unsigned int GetNodeOfWorker(const unsigned int workerId, const unsigned int numberOfWorkers)
+{
+  if(numberOfWorkers == 0)
+  {
+    return 0;
+  }
+  return static_cast<unsigned int>(static_cast<uint64_t>(workerId) * GetNumberOfNodes() / numberOfWorkers);
+}
+
+bool RunOnNode(const unsigned int node)
+{
+#ifdef PatchMatch_USE_NUMA
+  if(numa_available() >= 0 && GetNumberOfNodes() > 1)
+  {
+    return numa_run_on_node(static_cast<int>(node)) == 0;
+  }
+#else
+  (void)node;
+#endif
+  return false;
+}
+
+bool GetNodeStatistics(const unsigned int node, NodeStatistics& statistics)
+{
+  std::stringstream fileName;
+  fileName << "/sys/devices/system/node/node" << node << "/numastat";
+
+  std::ifstream fin(fileName.str().c_str());
+  if(!fin)
+  {
+    return false;
+  }
+
+  bool foundLocal = false;
+  bool foundOther = false;
+  std::string name;
+  uint64_t value;
+  while(fin >> name >> value)
+  {
+    if(name == "local_node")
+    {
+      statistics.LocalNode = value;
+      foundLocal = true;
+    }
+    else if(name == "other_node")
+    {
+      statistics.OtherNode = value;
+      foundOther = true;
+    }
+  }
+
+  return foundLocal && foundOther;
+}
+
+} // end namespace NUMAHelpers
@@ -0,0 +1,56 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef NUMAHelpers_H
+#define NUMAHelpers_H
+
+// STL
+#include <cstdint>
+
+/** Helpers for placing memory on the NUMA node of the thread that uses it. Linux places a page on the node
+  * of the thread that first writes it, so a buffer that is filled by the worker that will later use it ends
+  * up local to that worker, as long as the worker keeps running on the same node.
+  * Threads are only bound to nodes when PatchMatch is built with PatchMatch_USE_NUMA (libnuma); otherwise
+  * there is a single node and every function is a no-op. */
+namespace NUMAHelpers
+{
+  /** Get the number of NUMA nodes that threads are distributed over. */
+  unsigned int GetNumberOfNodes();
+
+  /** Get the node on which worker 'workerId' of 'numberOfWorkers' runs. Consecutive workers share a node,
+    * so contiguous bands of a buffer stay on the same node. */
+  unsigned int GetNodeOfWorker(const unsigned int workerId, const unsigned int numberOfWorkers);
+
+  /** Restrict the calling thread to the CPUs of 'node'. Returns false if the thread could not be bound. */
+  bool RunOnNode(const unsigned int node);
+
+  /** Page placement counters of one node, as reported by the kernel in numastat. */
+  struct NodeStatistics
+  {
+    /** Pages placed on this node for a thread running on this node. */
+    uint64_t LocalNode = 0;
+
+    /** Pages placed on this node for a thread running on another node. */
+    uint64_t OtherNode = 0;
+  };
+
+  /** Read the counters of 'node'. Returns false if they are not available. */
+  bool GetNodeStatistics(const unsigned int node, NodeStatistics& statistics);
+}
+
+#endif
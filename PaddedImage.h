@@ -0,0 +1,135 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#ifndef PaddedImage_H
+#define PaddedImage_H
+
+// ITK
+#include "itkImage.h"
+#include "itkImageRegion.h"
+#include "itkDefaultConvertPixelTraits.h"
+
+// STL
+#include <cassert>
+#include <cstddef>
+#include <memory>
+
+/** A float copy of an image with an apron of ApronRadius pixels around it, so that every patch of radius
+  * ApronRadius centered on an image pixel can be read with raw pointers and no bounds checks. The components
+  * of a pixel are interleaved, and every row starts on an Alignment byte boundary: the left apron is widened
+  * so that the first image pixel of every row is aligned, and the rows are padded to a multiple of Alignment
+  * bytes. The apron either replicates the nearest border pixel or is zero (see SetReplicateApron). */
+template <typename TImage>
+class PaddedImage
+{
+public:
+  typedef typename TImage::PixelType PixelType;
+  typedef itk::DefaultConvertPixelTraits<PixelType> PixelTraitsType;
+
+  /** The alignment of the rows, in bytes. This is a cache line, and enough for any SIMD register. */
+  static const size_t Alignment = 64;
+
+  /** Copy 'image' into the padded buffer. */
+  void Compute(const TImage* const image, const unsigned int apronRadius);
+
+  /** Copy 'region' of 'image' into the buffer again after the image was edited there, along with the apron
+    * pixels that replicate it. 'image' must be the image (or one of the same region) that was computed. */
+  void Update(const TImage* const image, const itk::ImageRegion<2>& region);
+
+  /** Set whether the apron replicates the nearest border pixel (the default) or is zero. */
+  void SetReplicateApron(const bool replicateApron)
+  {
+    this->ReplicateApron = replicateApron;
+  }
+
+  bool IsComputed() const
+  {
+    return this->Origin != nullptr;
+  }
+
+  /** Release the buffer. */
+  void Clear()
+  {
+    this->Data.reset();
+    this->Origin = nullptr;
+  }
+
+  /** Get the region of the image, without the apron. */
+  const itk::ImageRegion<2>& GetRegion() const
+  {
+    return this->Region;
+  }
+
+  unsigned int GetApronRadius() const
+  {
+    return this->ApronRadius;
+  }
+
+  unsigned int GetNumberOfComponents() const
+  {
+    return this->NumberOfComponents;
+  }
+
+  /** Get the distance between two vertically adjacent pixels, in floats. */
+  size_t GetRowStride() const
+  {
+    return this->RowStride;
+  }
+
+  /** Get the components of the pixel at 'index', which may be up to ApronRadius pixels outside the Region.
+    * The components of the following pixels of the row follow them. */
+  const float* GetPixel(const itk::Index<2>& index) const
+  {
+    assert(IsComputed());
+    assert(index[0] >= this->Region.GetIndex()[0] - static_cast<itk::IndexValueType>(this->ApronRadius));
+    assert(index[1] >= this->Region.GetIndex()[1] - static_cast<itk::IndexValueType>(this->ApronRadius));
+    assert(index[0] < this->Region.GetIndex()[0] + static_cast<itk::IndexValueType>(this->Region.GetSize()[0] +
+                                                                                      this->ApronRadius));
+    assert(index[1] < this->Region.GetIndex()[1] + static_cast<itk::IndexValueType>(this->Region.GetSize()[1] +
+                                                                                      this->ApronRadius));
+
+    return this->Origin + (index[1] - this->Region.GetIndex()[1]) * static_cast<std::ptrdiff_t>(this->RowStride) +
+           (index[0] - this->Region.GetIndex()[0]) * static_cast<std::ptrdiff_t>(this->NumberOfComponents);
+  }
+
+private:
+  itk::ImageRegion<2> Region;
+
+  unsigned int ApronRadius = 0;
+
+  unsigned int NumberOfComponents = 0;
+
+  size_t RowStride = 0;
+
+  bool ReplicateApron = true;
+
+  /** The allocation, which is larger than the buffer by the Alignment so that the buffer can be aligned. */
+  std::unique_ptr<float[]> Data;
+
+  /** The first component of the first pixel of the Region. */
+  float* Origin = nullptr;
+
+  /** Copy the pixels of 'paddedRegion', which may extend up to ApronRadius pixels outside of the Region, from
+    * 'image'. The apron pixels are copies of the nearest border pixel, and are skipped if the apron is zero. */
+  void CopyPixels(const TImage* const image, const itk::ImageRegion<2>& paddedRegion);
+};
+
+#include "PaddedImage.hpp"
+
+#endif
@@ -0,0 +1,146 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#ifndef PaddedImage_HPP
+#define PaddedImage_HPP
+
+#include "PaddedImage.h"
+
+// STL
+#include <algorithm>
+#include <cstdint>
+
+template <typename TImage>
+void PaddedImage<TImage>::Compute(const TImage* const image, const unsigned int apronRadius)
+{
+  assert(image);
+
+  this->Region = image->GetLargestPossibleRegion();
+  this->ApronRadius = apronRadius;
+  this->NumberOfComponents = PixelTraitsType::GetNumberOfComponents();
+
+  const size_t floatsPerAlignment = Alignment / sizeof(float);
+  auto roundUp = [floatsPerAlignment](const size_t numberOfFloats)
+  {
+    return (numberOfFloats + floatsPerAlignment - 1) / floatsPerAlignment * floatsPerAlignment;
+  };
+
+  const itk::IndexValueType width = this->Region.GetSize()[0];
+  const itk::IndexValueType height = this->Region.GetSize()[1];
+  const itk::IndexValueType apron = apronRadius;
+
+  // The left apron is widened to a multiple of the Alignment so that the first image pixel of a row is aligned
+  const size_t leftPadding = roundUp(apronRadius * this->NumberOfComponents);
+  this->RowStride = roundUp(leftPadding + (width + apron) * this->NumberOfComponents);
+  const size_t numberOfFloats = this->RowStride * (height + 2 * apron);
+
+  this->Data.reset(new float[numberOfFloats + floatsPerAlignment]);
+  float* alignedData = reinterpret_cast<float*>((reinterpret_cast<std::uintptr_t>(this->Data.get()) + Alignment - 1) /
+                                                Alignment * Alignment);
+  std::fill(alignedData, alignedData + numberOfFloats, 0.0f);
+
+  this->Origin = alignedData + apron * this->RowStride + leftPadding;
+
+  itk::ImageRegion<2> paddedRegion = this->Region;
+  paddedRegion.PadByRadius(apronRadius);
+  CopyPixels(image, paddedRegion);
+}
+
+template <typename TImage>
+void PaddedImage<TImage>::Update(const TImage* const image, const itk::ImageRegion<2>& region)
+{
+  assert(IsComputed());
+  assert(image->GetLargestPossibleRegion() == this->Region);
+
+  itk::ImageRegion<2> updatedRegion = region;
+  if(!updatedRegion.Crop(this->Region))
+  {
+    return;
+  }
+
+  // The apron next to an edited border pixel is a copy of it
+  if(this->ReplicateApron)
+  {
+    for(unsigned int dimension = 0; dimension < 2; ++dimension)
+    {
+      itk::Index<2> index = updatedRegion.GetIndex();
+      itk::Size<2> size = updatedRegion.GetSize();
+      if(updatedRegion.GetUpperIndex()[dimension] == this->Region.GetUpperIndex()[dimension])
+      {
+        size[dimension] += this->ApronRadius;
+      }
+      if(index[dimension] == this->Region.GetIndex()[dimension])
+      {
+        index[dimension] -= this->ApronRadius;
+        size[dimension] += this->ApronRadius;
+      }
+      updatedRegion.SetIndex(index);
+      updatedRegion.SetSize(size);
+    }
+  }
+
+  CopyPixels(image, updatedRegion);
+}
+
+template <typename TImage>
+void PaddedImage<TImage>::CopyPixels(const TImage* const image, const itk::ImageRegion<2>& paddedRegion)
+{
+  const itk::IndexValueType width = this->Region.GetSize()[0];
+  const itk::IndexValueType height = this->Region.GetSize()[1];
+
+  const PixelType* imageBuffer = image->GetBufferPointer() + image->ComputeOffset(this->Region.GetIndex());
+  const itk::SizeValueType imageRowStride = image->GetBufferedRegion().GetSize()[0];
+
+  // The bounds of 'paddedRegion' relative to the first pixel of the Region
+  const itk::IndexValueType xBegin = paddedRegion.GetIndex()[0] - this->Region.GetIndex()[0];
+  const itk::IndexValueType yBegin = paddedRegion.GetIndex()[1] - this->Region.GetIndex()[1];
+  const itk::IndexValueType xEnd = xBegin + static_cast<itk::IndexValueType>(paddedRegion.GetSize()[0]);
+  const itk::IndexValueType yEnd = yBegin + static_cast<itk::IndexValueType>(paddedRegion.GetSize()[1]);
+
+  for(itk::IndexValueType y = yBegin; y < yEnd; ++y)
+  {
+    const bool apronRow = y < 0 || y >= height;
+    if(apronRow && !this->ReplicateApron)
+    {
+      continue;
+    }
+
+    const itk::IndexValueType imageY = std::min(std::max<itk::IndexValueType>(y, 0), height - 1);
+    const PixelType* imageRow = imageBuffer + imageY * imageRowStride;
+    float* row = this->Origin + y * static_cast<std::ptrdiff_t>(this->RowStride);
+
+    for(itk::IndexValueType x = xBegin; x < xEnd; ++x)
+    {
+      const bool apronColumn = x < 0 || x >= width;
+      if(apronColumn && !this->ReplicateApron)
+      {
+        continue;
+      }
+
+      const PixelType& pixel = imageRow[std::min(std::max<itk::IndexValueType>(x, 0), width - 1)];
+      float* value = row + x * static_cast<std::ptrdiff_t>(this->NumberOfComponents);
+      for(unsigned int component = 0; component < this->NumberOfComponents; ++component)
+      {
+        value[component] = static_cast<float>(PixelTraitsType::GetNthComponent(component, pixel));
+      }
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,195 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#ifndef PaddedSSD_H
+#define PaddedSSD_H
+
+// ITK
+#include "itkImage.h"
+#include "itkImageRegion.h"
+
+// STL
+#include <cassert>
+#include <vector>
+
+// Custom
+#include "PaddedImage.h"
+
+/** A sum of squared differences patch distance functor with the interface of BatchSSD that reads both patches
+  * from PaddedImage copies of the images. The patches are scored with raw pointers over contiguous float rows,
+  * with no pixel traits, offset computations or bounds checks in the loop, and the query patch is read in place
+  * rather than copied first. The copies are made on the first distance (or by Compute()), with an apron of the
+  * patch radius, so a patch centered anywhere in an image can be scored. They are not updated when the images
+  * change: call UpdateSourceRegion() or UpdateTargetRegion() after editing a region of an image (which
+  * PatchMatch::MarkDirty() and MarkSourceDirty() do), or Clear() so that the whole image is copied again. */
+template <typename TImage>
+class PaddedSSD
+{
+public:
+  typedef TImage ImageType;
+
+  /** Set the image from which both the query and the candidate patches are read. */
+  void SetImage(TImage* const image)
+  {
+    this->SourceImage = image;
+    this->TargetImage = image;
+    Clear();
+  }
+
+  /** Set the image from which the candidate (source) patches are read. */
+  void SetSourceImage(TImage* const sourceImage)
+  {
+    this->SourceImage = sourceImage;
+    Clear();
+  }
+
+  /** Get the image from which the candidate (source) patches are read. */
+  TImage* GetSourceImage() const
+  {
+    return this->SourceImage;
+  }
+
+  /** Set the image from which the query (target) patches are read. */
+  void SetTargetImage(TImage* const targetImage)
+  {
+    this->TargetImage = targetImage;
+    Clear();
+  }
+
+  /** Make the padded copies of the images for patches of radius 'patchRadius'. This must be done before the
+    * functor is shared between threads, since otherwise the first distance does it. */
+  void Compute(const unsigned int patchRadius)
+  {
+    assert(this->SourceImage);
+    assert(this->TargetImage);
+
+    this->Source.Compute(this->SourceImage, patchRadius);
+    if(this->TargetImage != this->SourceImage)
+    {
+      this->Target.Compute(this->TargetImage, patchRadius);
+    }
+  }
+
+  /** Discard the padded copies, so that the images are copied again by the next distance. */
+  void Clear()
+  {
+    this->Source.Clear();
+    this->Target.Clear();
+  }
+
+  /** Copy 'region' of the source image again after it was edited. */
+  void UpdateSourceRegion(const itk::ImageRegion<2>& region)
+  {
+    // A copy that has not been made yet will be made from the edited image
+    if(this->Source.IsComputed())
+    {
+      this->Source.Update(this->SourceImage, region);
+    }
+  }
+
+  /** Copy 'region' of the target image again after it was edited. */
+  void UpdateTargetRegion(const itk::ImageRegion<2>& region)
+  {
+    if(this->TargetImage == this->SourceImage)
+    {
+      UpdateSourceRegion(region);
+    }
+    else if(this->Target.IsComputed())
+    {
+      this->Target.Update(this->TargetImage, region);
+    }
+  }
+
+  /** Compute the distance between a source patch ('region1') and a target patch ('region2'). */
+  float Distance(const itk::ImageRegion<2>& region1, const itk::ImageRegion<2>& region2)
+  {
+    float score = 0.0f;
+    Distance(region2, &region1, 1, &score);
+    return score;
+  }
+
+  /** Compute the distance between 'queryRegion' and each of the 'numberOfCandidates' regions
+    * in 'candidateRegions', storing them in the corresponding entries of 'scores'. */
+  void Distance(const itk::ImageRegion<2>& queryRegion, const itk::ImageRegion<2>* const candidateRegions,
+                const size_t numberOfCandidates, float* const scores)
+  {
+    if(!this->Source.IsComputed())
+    {
+      Compute(queryRegion.GetSize()[0] / 2);
+    }
+
+    const PaddedImage<TImage>& target = (this->TargetImage == this->SourceImage) ? this->Source : this->Target;
+    assert(queryRegion.GetSize()[0] <= 2 * this->Source.GetApronRadius() + 1);
+
+    const size_t rowLength = queryRegion.GetSize()[0] * this->Source.GetNumberOfComponents();
+    const itk::SizeValueType patchHeight = queryRegion.GetSize()[1];
+    const size_t sourceRowStride = this->Source.GetRowStride();
+    const size_t targetRowStride = target.GetRowStride();
+
+    const float* const queryCorner = target.GetPixel(queryRegion.GetIndex());
+
+    for(size_t candidateId = 0; candidateId < numberOfCandidates; ++candidateId)
+    {
+      assert(candidateRegions[candidateId].GetSize() == queryRegion.GetSize());
+
+      const float* candidateRow = this->Source.GetPixel(candidateRegions[candidateId].GetIndex());
+      const float* queryRow = queryCorner;
+
+      float sum = 0.0f;
+      for(itk::SizeValueType row = 0; row < patchHeight; ++row)
+      {
+        for(size_t valueId = 0; valueId < rowLength; ++valueId)
+        {
+          float difference = queryRow[valueId] - candidateRow[valueId];
+          sum += difference * difference;
+        }
+        candidateRow += sourceRowStride;
+        queryRow += targetRowStride;
+      }
+
+      scores[candidateId] = sum;
+    }
+  }
+
+  /** Convenience overload of the batched distance for a vector of candidates. */
+  void Distance(const itk::ImageRegion<2>& queryRegion, const std::vector<itk::ImageRegion<2> >& candidateRegions,
+                std::vector<float>& scores)
+  {
+    scores.resize(candidateRegions.size());
+    if(candidateRegions.empty())
+    {
+      return;
+    }
+    Distance(queryRegion, candidateRegions.data(), candidateRegions.size(), scores.data());
+  }
+
+private:
+  /** The image from which candidate (source) patches are read. */
+  TImage* SourceImage = nullptr;
+
+  /** The image from which query (target) patches are read. */
+  TImage* TargetImage = nullptr;
+
+  PaddedImage<TImage> Source;
+
+  /** The copy of the TargetImage, unused when it is the SourceImage. */
+  PaddedImage<TImage> Target;
+};
+
+#endif
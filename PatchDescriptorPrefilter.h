@@ -0,0 +1,164 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#ifndef PatchDescriptorPrefilter_H
+#define PatchDescriptorPrefilter_H
+
+// ITK
+#include "itkImage.h"
+#include "itkImageRegion.h"
+
+// STL
+#include <cassert>
+#include <vector>
+
+// Custom
+#include "Match.h"
+#include "PatchPCA.h"
+
+/** Per-pixel patch descriptors of the source and target images, used to reject candidate matches without
+  * computing their full patch distance. The descriptors are the projections of the patches onto their leading
+  * principal components. The components are orthonormal, so the squared distance between two descriptors is a
+  * lower bound of the sum of squared differences between the patches: a candidate whose bound is not below the
+  * score of the current match cannot replace it, and its full distance does not need to be computed.
+  * The bound only holds for a plain SSD patch distance (e.g. BatchSSD). With any other distance, or with a
+  * BoundScale above 1, it is an estimate and some better candidates may be rejected.
+  * The queries do not modify the object, so they may be made from several threads. */
+class PatchDescriptorPrefilter
+{
+public:
+  /** Train a PCA on the patches of the source image and compute the descriptors of every patch of both images.
+    * If 'targetImage' is the same as 'sourceImage', the descriptors are only computed once. */
+  template <typename TImage>
+  void Compute(const TImage* const sourceImage, const TImage* const targetImage, const unsigned int patchRadius,
+               const unsigned int numberOfComponents = 8);
+
+  /** Compute the descriptors of every patch of both images with an already trained PCA. */
+  template <typename TImage>
+  void Compute(const PatchPCA<TImage>& patchPCA, const TImage* const sourceImage, const TImage* const targetImage);
+
+  /** Get a lower bound of the distance between the source patch centered at 'sourceCenter' and the target
+    * patch centered at 'targetCenter'. Both patches must be entirely inside their images. */
+  float LowerBound(const itk::Index<2>& sourceCenter, const itk::Index<2>& targetCenter) const
+  {
+    assert(IsComputed());
+
+    const float* sourceDescriptor = GetDescriptor(this->SourceDescriptors, sourceCenter);
+    const float* targetDescriptor = GetDescriptor(GetTargetDescriptors(), targetCenter);
+
+    float squaredDistance = 0.0f;
+    for(unsigned int componentId = 0; componentId < this->NumberOfComponents; ++componentId)
+    {
+      float difference = sourceDescriptor[componentId] - targetDescriptor[componentId];
+      squaredDistance += difference * difference;
+    }
+
+    return this->BoundScale * squaredDistance;
+  }
+
+  /** Return true if the source patch centered at 'sourceCenter' cannot be a better match for the target patch
+    * centered at 'targetCenter' than 'currentMatch'. An empty current match rejects nothing. */
+  bool Rejects(const itk::Index<2>& sourceCenter, const itk::Index<2>& targetCenter, const Match& currentMatch) const
+  {
+    return currentMatch.GetRegion().GetNumberOfPixels() > 0 &&
+           LowerBound(sourceCenter, targetCenter) >= currentMatch.GetScore();
+  }
+
+  /** Set the factor the bound is multiplied by. Values below 1 leave a margin for rounding errors, values
+    * above 1 reject more candidates at the risk of rejecting better ones. */
+  void SetBoundScale(const float boundScale)
+  {
+    this->BoundScale = boundScale;
+  }
+
+  /** Set the number of threads that compute the descriptors. If this is 0, one thread per core is used. */
+  void SetNumberOfThreads(const unsigned int numberOfThreads)
+  {
+    this->NumberOfThreads = numberOfThreads;
+  }
+
+  /** Get the length of each descriptor. */
+  unsigned int GetNumberOfComponents() const
+  {
+    return this->NumberOfComponents;
+  }
+
+  bool IsComputed() const
+  {
+    return this->NumberOfComponents > 0;
+  }
+
+  /** Release the descriptors. */
+  void Clear()
+  {
+    this->SourceDescriptors = DescriptorImage();
+    this->TargetDescriptors = DescriptorImage();
+    this->TargetIsSource = false;
+    this->NumberOfComponents = 0;
+  }
+
+private:
+  /** The descriptors of the patches centered at every pixel of an image, NumberOfComponents values each.
+    * The descriptors of pixels whose patch is not entirely inside the image are zero. */
+  struct DescriptorImage
+  {
+    itk::ImageRegion<2> Region;
+
+    std::vector<float> Values;
+  };
+
+  DescriptorImage SourceDescriptors;
+
+  DescriptorImage TargetDescriptors;
+
+  /** True if the target image is the source image, in which case the TargetDescriptors are not used. */
+  bool TargetIsSource = false;
+
+  unsigned int NumberOfComponents = 0;
+
+  float BoundScale = 1.0f;
+
+  unsigned int NumberOfThreads = 0;
+
+  const DescriptorImage& GetTargetDescriptors() const
+  {
+    return this->TargetIsSource ? this->SourceDescriptors : this->TargetDescriptors;
+  }
+
+  const float* GetDescriptor(const DescriptorImage& descriptorImage, const itk::Index<2>& center) const
+  {
+    assert(descriptorImage.Region.IsInside(center));
+
+    const size_t offset = (center[1] - descriptorImage.Region.GetIndex()[1]) * descriptorImage.Region.GetSize()[0] +
+                          (center[0] - descriptorImage.Region.GetIndex()[0]);
+    return &descriptorImage.Values[offset * this->NumberOfComponents];
+  }
+
+  /** Compute the descriptors of every patch entirely inside 'image', with several threads. */
+  template <typename TImage>
+  void ComputeDescriptorImage(const PatchPCA<TImage>& patchPCA, const TImage* const image,
+                              DescriptorImage& descriptorImage) const;
+
+  /** Get the number of threads to use. */
+  unsigned int GetNumberOfThreads() const;
+};
+
+#include "PatchDescriptorPrefilter.hpp"
+
+#endif
@@ -0,0 +1,133 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#ifndef PatchDescriptorPrefilter_HPP
+#define PatchDescriptorPrefilter_HPP
+
+#include "PatchDescriptorPrefilter.h"
+
+// STL
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+// Submodules
+#include <ITKHelpers/ITKHelpers.h>
+
+// Custom
+#include "PatchMatchHelpers.h"
+
+template <typename TImage>
+void PatchDescriptorPrefilter::Compute(const TImage* const sourceImage, const TImage* const targetImage,
+                                       const unsigned int patchRadius, const unsigned int numberOfComponents)
+{
+  assert(sourceImage);
+
+  itk::ImageRegion<2> sourceInternalRegion =
+      ITKHelpers::GetInternalRegion(sourceImage->GetLargestPossibleRegion(), patchRadius);
+
+  if(sourceInternalRegion.GetNumberOfPixels() == 0)
+  {
+    throw std::runtime_error("PatchDescriptorPrefilter: The source image is smaller than a patch!");
+  }
+
+  PatchPCA<TImage> patchPCA;
+  patchPCA.Compute(sourceImage, patchRadius, PatchMatchHelpers::GetAllPixelIndices(sourceInternalRegion),
+                   numberOfComponents);
+
+  Compute(patchPCA, sourceImage, targetImage);
+}
+
+template <typename TImage>
+void PatchDescriptorPrefilter::Compute(const PatchPCA<TImage>& patchPCA, const TImage* const sourceImage,
+                                       const TImage* const targetImage)
+{
+  assert(sourceImage);
+  assert(targetImage);
+  assert(patchPCA.GetNumberOfComponents() > 0);
+
+  this->NumberOfComponents = patchPCA.GetNumberOfComponents();
+
+  ComputeDescriptorImage(patchPCA, sourceImage, this->SourceDescriptors);
+
+  this->TargetIsSource = (targetImage == sourceImage);
+  if(this->TargetIsSource)
+  {
+    this->TargetDescriptors = DescriptorImage();
+  }
+  else
+  {
+    ComputeDescriptorImage(patchPCA, targetImage, this->TargetDescriptors);
+  }
+}
+
+template <typename TImage>
+void PatchDescriptorPrefilter::ComputeDescriptorImage(const PatchPCA<TImage>& patchPCA, const TImage* const image,
+                                                      DescriptorImage& descriptorImage) const
+{
+  descriptorImage.Region = image->GetLargestPossibleRegion();
+  descriptorImage.Values.assign(descriptorImage.Region.GetNumberOfPixels() * this->NumberOfComponents, 0.0f);
+
+  itk::ImageRegion<2> internalRegion = ITKHelpers::GetInternalRegion(descriptorImage.Region, patchPCA.GetPatchRadius());
+
+  const itk::IndexValueType height = internalRegion.GetSize()[1];
+  if(height == 0)
+  {
+    return;
+  }
+
+  const unsigned int numberOfThreads = std::min<itk::IndexValueType>(GetNumberOfThreads(), height);
+
+  // Each thread computes the descriptors of a band of rows
+  auto computeBand = [this, &patchPCA, image, &internalRegion, &descriptorImage, height, numberOfThreads](const unsigned int bandId)
+  {
+    for(itk::IndexValueType row = height * bandId / numberOfThreads; row < height * (bandId + 1) / numberOfThreads; ++row)
+    {
+      for(itk::SizeValueType column = 0; column < internalRegion.GetSize()[0]; ++column)
+      {
+        itk::Index<2> center = {{internalRegion.GetIndex()[0] + static_cast<itk::IndexValueType>(column),
+                                 internalRegion.GetIndex()[1] + row}};
+        size_t offset = (center[1] - descriptorImage.Region.GetIndex()[1]) * descriptorImage.Region.GetSize()[0] +
+                        (center[0] - descriptorImage.Region.GetIndex()[0]);
+        patchPCA.Project(image, center, &descriptorImage.Values[offset * this->NumberOfComponents]);
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for(unsigned int bandId = 0; bandId < numberOfThreads; ++bandId)
+  {
+    threads.push_back(std::thread(computeBand, bandId));
+  }
+  for(size_t threadId = 0; threadId < threads.size(); ++threadId)
+  {
+    threads[threadId].join();
+  }
+}
+
+inline unsigned int PatchDescriptorPrefilter::GetNumberOfThreads() const
+{
+  if(this->NumberOfThreads > 0)
+  {
+    return this->NumberOfThreads;
+  }
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+#endif
@@ -31,12 +31,27 @@
 #include <Mask/Mask.h>
 #include <PatchComparison/PatchDistance.h>
 
+// STL
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+
 // Custom
+#include "Arena.h"
+#include "AsyncFileWriter.h"
+#include "Initializer.h"
 #include "Match.h"
+#include "MeanVarianceBound.h"
 #include "NNField.h"
+#include "NNFieldReverseIndex.h"
+#include "PatchDescriptorPrefilter.h"
 
 /** This class computes a nearest neighbor field using the PatchMatch algorithm.
-  * Note that this class does not actually need the image, as the acceptance test
+  * The field is computed for the pixels of the target image, and the matches are patches
+  * of the source image. These are the same image when matching an image against itself (SetImage()),
+  * but can be different images of different sizes (SetSourceImage() and SetTargetImage()).
+  * Note that this class does not actually need the pixel data, as the acceptance test
   * and the patch distance functor already have the images that they need.*/
 template <typename TImage, typename TPropagation, typename TRandomSearch>
 class PatchMatch
@@ -46,6 +61,32 @@ public:
   /** Perform multiple iterations of propagation and random search.*/
   void Compute();
 
+  /** Continue the run saved in a checkpoint file (see SetCheckpointFileName()) with the iterations that it had not
+    * completed. The images, masks, patch radius and functors must be set up as they were for the run, and
+    * SetIterations() is the total number of iterations of the run. The result is the same as if the run had not
+    * been stopped. */
+  void Resume(const std::string& checkpointFileName);
+
+  /** Set the file to which Compute() saves a checkpoint every CheckpointInterval iterations, so that a run that is
+    * stopped can be continued with Resume(). The checkpoints are written by a background thread while the next
+    * iterations run. If this is empty (the default), no checkpoints are saved. */
+  void SetCheckpointFileName(const std::string& checkpointFileName)
+  {
+    this->CheckpointFileName = checkpointFileName;
+  }
+
+  /** Set the number of iterations between checkpoints. */
+  void SetCheckpointInterval(const unsigned int checkpointInterval)
+  {
+    this->CheckpointInterval = checkpointInterval;
+  }
+
+  /** Get the number of checkpoints that could not be written. */
+  size_t GetNumberOfFailedCheckpoints()
+  {
+    return this->CheckpointWriter.GetNumberOfFailedFiles();
+  }
+
   /** Set the number of iterations to perform. */
   void SetIterations(const unsigned int iterations)
   {
@@ -82,20 +123,112 @@ public:
       return this->RandomSearchFunctor;
   }
 
-  /** Set the image. */
+  /** Set the image to match against itself. */
   void SetImage(TImage* const image)
   {
-      this->Image = image;
+      this->SourceImage = image;
+      this->TargetImage = image;
+  }
+
+  /** Set the image from which matches are drawn. */
+  void SetSourceImage(TImage* const sourceImage)
+  {
+      this->SourceImage = sourceImage;
   }
 
-  /** Set the image. */
+  /** Set the image for which to compute the NNField. */
+  void SetTargetImage(TImage* const targetImage)
+  {
+      this->TargetImage = targetImage;
+  }
+
+  /** Get the NNField. */
   NNFieldType* GetNNField()
   {
       return this->NNField;
   }
 
-  /** Get a random region in the image. */
-  itk::ImageRegion<2> GetRandomRegion();
+  /** Set the NNField to start from. If it is the size of the target image, Compute() refines it
+    * in place instead of starting from a random initialization. */
+  void SetInitialNNField(NNFieldType* const nnField)
+  {
+      this->NNField = nnField;
+      this->NNFieldNeedsInitialization = false;
+  }
+
+  /** Make the next Compute() initialize the NNField even though it is already the size of the target image, and
+    * recompute the TargetPixels. This lets one object, and the memory of its NNField, be reused for a new image. */
+  void ResetNNField()
+  {
+      this->NNFieldNeedsInitialization = true;
+      this->TargetPixels.clear();
+  }
+
+  /** Set whether the progress of Compute() is written to the standard output. */
+  void SetVerbose(const bool verbose)
+  {
+      this->Verbose = verbose;
+  }
+
+  /** Set whether the NNField is written to disk after every propagation and random search. */
+  void SetWriteIntermediateFields(const bool writeIntermediateFields)
+  {
+      this->WriteIntermediateFields = writeIntermediateFields;
+  }
+
+  /** Mark a region of the image that has been edited since the NNField was computed. The target patches that
+    * overlap it are invalidated, and when matching an image against itself, so are the matches whose source patch
+    * overlaps it. Call RecomputeDirty() once all of the edits have been marked. A patch distance functor that
+    * keeps its own copies of the images (such as PaddedSSD) has the region copied again, so the image must be
+    * edited before the region is marked. */
+  void MarkDirty(const itk::ImageRegion<2>& dirtyRegion);
+
+  /** Mark the 'true' pixels of 'dirtyMask' (an image the size of the edited image) as edited. Only the largest
+    * possible region of the mask is scanned, so it can be just the bounding box of the edit. */
+  void MarkDirty(const itk::Image<bool, 2>* const dirtyMask);
+
+  /** Mark a region of the source image that has been edited, when the source and target images are different. */
+  void MarkSourceDirty(const itk::ImageRegion<2>& dirtyRegion);
+
+  /** Update the NNField after the marked edits. The invalidated matches are re-scored, and propagation and
+    * random search are run on them and on a neighbourhood around them that grows by DirtyGrowthRadius every
+    * iteration, so the work done depends on the size of the edit rather than on the size of the image. A source
+    * edit relies on the ReverseIndex, which is only free if it is maintained (see SetMaintainReverseIndex()). */
+  void RecomputeDirty();
+
+  /** Set the number of pixels by which the recomputed neighbourhood grows in each iteration of RecomputeDirty(). */
+  void SetDirtyGrowthRadius(const unsigned int dirtyGrowthRadius)
+  {
+    this->DirtyGrowthRadius = dirtyGrowthRadius;
+  }
+
+  /** Get the number of target pixels that were processed by the last RecomputeDirty(). */
+  size_t GetNumberOfRecomputedPixels() const
+  {
+    return this->NumberOfRecomputedPixels;
+  }
+
+  /** Set whether a reverse index (source patch to target pixels) is built by Compute() and kept up to date
+    * as matches are accepted. This is on by default, so that RecomputeDirty() can find the matches into an edited
+    * source region without a pass over the whole field. Turn it off if RecomputeDirty() is never used after a
+    * source edit; the first RecomputeDirty() that needs the index after each Compute() then builds it. */
+  void SetMaintainReverseIndex(const bool maintainReverseIndex)
+  {
+    this->MaintainReverseIndex = maintainReverseIndex;
+  }
+
+  /** Get the reverse index. It is only valid if IsBuilt() is true. */
+  NNFieldReverseIndex* GetReverseIndex()
+  {
+    return &this->ReverseIndex;
+  }
+
+  /** Set if the random initialization is truly randomized. If not, the random number generator is seeded with 0. */
+  void SetRandom(const bool random)
+  {
+    this->Random = random;
+    this->GeneratorIsSeeded = false;
+  }
 
   boost::signals2::signal<void (NNFieldType*)> UpdatedSignal;
 
@@ -104,10 +237,70 @@ public:
     this->TargetPixels = targetPixels;
   }
 
+  /** Set the image (the size of the source image) indicating which source patches may be used as matches.
+    * This is the same as SetSourceValidPatchCentersImage(). */
   void SetValidPatchCentersImage(itk::Image<bool, 2>* const validPatchCentersImage)
   {
-    this->ValidPatchCentersImage = validPatchCentersImage;
-    CorrectValidPatchCentersImage();
+    SetSourceValidPatchCentersImage(validPatchCentersImage);
+  }
+
+  /** Set the image (the size of the source image) indicating which source patches may be used as matches. */
+  void SetSourceValidPatchCentersImage(itk::Image<bool, 2>* const sourceValidPatchCentersImage)
+  {
+    this->SourceValidPatchCentersImage = sourceValidPatchCentersImage;
+  }
+
+  /** Set the image (the size of the target image) indicating at which pixels to compute the NNField.
+    * This is only used if no TargetPixels have been set. */
+  void SetTargetValidPatchCentersImage(itk::Image<bool, 2>* const targetValidPatchCentersImage)
+  {
+    this->TargetValidPatchCentersImage = targetValidPatchCentersImage;
+  }
+
+  /** Set the initializer that creates the NNField when Compute() is called without an initial one. PatchMatch
+    * sets its patch radius, source valid patch centers image and target pixels; anything else it needs (images,
+    * patch distance functor) must already be set. Target pixels it leaves without a match get random ones. If no
+    * initializer is set, every target pixel gets a uniformly random match. */
+  void SetInitializer(InitializerPatch* const initializer)
+  {
+    this->NNFieldInitializer = initializer;
+  }
+
+  /** Set whether Compute() builds summed area tables of the images and gives the functors and the initializer a
+    * mean/variance lower bound of the patch distance, so that candidates that cannot beat the current match are
+    * not scored. The bound is only valid for a plain SSD patch distance. RecomputeDirty() does not use it, since
+    * the tables of the whole images would have to be rebuilt after every edit. */
+  void SetUseMeanVarianceBound(const bool useMeanVarianceBound)
+  {
+    this->UseMeanVarianceBound = useMeanVarianceBound;
+  }
+
+  /** Get the mean/variance bound, whose counts cover the last Compute(). */
+  const MeanVarianceBound* GetMeanVarianceBound() const
+  {
+    return &this->DistanceBound;
+  }
+
+  /** Set whether Compute() computes PCA descriptors of the patches of the images and gives the propagation and
+    * random search functors a PatchDescriptorPrefilter, so that candidates whose descriptor distance does not beat
+    * the current match are not scored. Like the mean/variance bound, this is only valid for a plain SSD patch
+    * distance. The descriptors are released when Compute() returns. */
+  void SetUseDescriptorPrefilter(const bool useDescriptorPrefilter)
+  {
+    this->UseDescriptorPrefilter = useDescriptorPrefilter;
+  }
+
+  /** Set the length of the descriptors of the prefilter. Longer descriptors reject more candidates but cost
+    * more to compute and to compare. */
+  void SetNumberOfDescriptorComponents(const unsigned int numberOfDescriptorComponents)
+  {
+    this->NumberOfDescriptorComponents = numberOfDescriptorComponents;
+  }
+
+  /** Get the arena that the temporary buffers of an iteration are drawn from. */
+  const Arena* GetTemporaryArena() const
+  {
+    return &this->TemporaryArena;
   }
 
 protected:
@@ -115,12 +308,41 @@ protected:
   /** The number of iterations to perform. */
   unsigned int Iterations = 5;
 
+  /** Whether the NNField is written to disk after every propagation and random search. */
+  bool WriteIntermediateFields = true;
+
+  /** Whether the progress of Compute() is written to the standard output. */
+  bool Verbose = true;
+
+  /** Whether the next Compute() must initialize the NNField even if it is the size of the target image. */
+  bool NNFieldNeedsInitialization = false;
+
   /** The nearest neighbor field. */
   NNFieldType::Pointer NNField = NNFieldType::New();
 
-  /** Randomly initialize the NNField. */
+  /** Determine if the random initialization should be randomized. This should only be false for testing purposes. */
+  bool Random = true;
+
+  /** The random number generator of the random initialization. Unlike rand(), it is not shared with the other
+    * PatchMatch objects, so several of them can be computed concurrently. */
+  std::mt19937 Generator;
+
+  /** Whether the Generator has been seeded since Random was set. */
+  bool GeneratorIsSeeded = false;
+
+  /** Seed the random number generator if it has not been seeded yet. */
+  void InitializeRandomGenerator();
+
+  /** Get a random pixel in the specified region. */
+  itk::Index<2> GetRandomPixelInRegion(const itk::ImageRegion<2>& region);
+
+  /** Initialize the NNField with the NNFieldInitializer (if it is set), then give every target pixel that still
+    * has no match a random one. */
   void RandomlyInitializeNNField();
 
+  /** The initializer used by RandomlyInitializeNNField(). This is optional. */
+  InitializerPatch* NNFieldInitializer = nullptr;
+
   /** The radius of patches to compare. (Patch side length = 2*radius + 1)*/
   unsigned int PatchRadius = 5;
 
@@ -130,20 +352,123 @@ protected:
   /** Set the random search functor. */
   TRandomSearch* RandomSearchFunctor = nullptr;
 
+  /** The image from which matches are drawn. */
+  TImage* SourceImage = nullptr;
+
   /** The image for which to compute the NNField. */
-  TImage* Image = nullptr;
+  TImage* TargetImage = nullptr;
 
   /** The pixel indices at which to compute the NNField. */
   std::vector<itk::Index<2> > TargetPixels;
 
-  /** An image where if a pixel is 'true', it is the center of a valid region. */
+  /** An image (the size of the source image) where if a pixel is 'true', it is the center of a valid source region. */
   typedef itk::Image<bool, 2> BoolImageType;
-  BoolImageType* ValidPatchCentersImage = nullptr;
+  BoolImageType* SourceValidPatchCentersImage = nullptr;
+
+  /** An image (the size of the target image) where if a pixel is 'true', the NNField should be computed there. */
+  BoolImageType* TargetValidPatchCentersImage = nullptr;
 
-  /** Since the ValidPatchCentersImage can be constructed externally, this function ensures
-    * that the pixels marked as valid are the centers of patches of radius PatchRadius that are fully inside the image. */
+  /** Since the SourceValidPatchCentersImage can be constructed externally, this function ensures
+    * that the pixels marked as valid are the centers of patches of radius PatchRadius that are fully inside the source image. */
   void CorrectValidPatchCentersImage();
 
+  /** Determine the TargetPixels from the TargetValidPatchCentersImage (or the whole target internal region)
+    * if they have not been set explicitly. */
+  void ComputeTargetPixels();
+
+  /** The target image regions (in patch center coordinates) whose matches are invalid. */
+  std::vector<itk::ImageRegion<2> > DirtyTargetRegions;
+
+  /** The source image regions (in patch center coordinates) whose matches are invalid. */
+  std::vector<itk::ImageRegion<2> > DirtySourceRegions;
+
+  /** The number of pixels by which the recomputed neighbourhood grows in each iteration of RecomputeDirty(). */
+  unsigned int DirtyGrowthRadius = 2;
+
+  /** The number of target pixels that were processed by the last RecomputeDirty(). */
+  size_t NumberOfRecomputedPixels = 0;
+
+  /** The target pixels that use each source patch. This is built by Compute() if MaintainReverseIndex is set,
+    * and otherwise by every first RecomputeDirty() after Compute() that needs it. */
+  NNFieldReverseIndex ReverseIndex;
+
+  /** Whether Compute() builds the ReverseIndex and keeps it up to date. */
+  bool MaintainReverseIndex = true;
+
+  /** Point the propagation and random search functors at the ReverseIndex if it is built, so that they update it. */
+  void AttachReverseIndex();
+
+  /** Copy the edited 'region' of the target image (or of the source image if 'source' is set) again into the patch
+    * distance functor of the random search, which the propagation is expected to share, if that functor keeps its
+    * own copies of the images. */
+  void UpdatePatchDistanceFunctor(const itk::ImageRegion<2>& region, const bool source);
+
+  /** Copy 'region' again into a patch distance functor that provides UpdateSourceRegion() and UpdateTargetRegion(). */
+  template <typename TPatchDistanceFunctor>
+  void UpdatePatchDistanceFunctor(TPatchDistanceFunctor* const patchDistanceFunctor,
+                                  const itk::ImageRegion<2>& region, const bool source, std::true_type);
+
+  /** Do nothing, for patch distance functors that read the images directly. */
+  template <typename TPatchDistanceFunctor>
+  void UpdatePatchDistanceFunctor(TPatchDistanceFunctor* const patchDistanceFunctor,
+                                  const itk::ImageRegion<2>& region, const bool source, std::false_type);
+
+  /** An image (the size of the target image) marking the pixels that are being recomputed.
+    * It is kept between calls to RecomputeDirty() so that it is not reallocated for every edit. */
+  typedef itk::Image<unsigned char, 2> MarkerImageType;
+  MarkerImageType::Pointer ActivePixelsImage = MarkerImageType::New();
+
+  /** The temporary buffers of the current iteration. It is reset at the start of every iteration of Compute(),
+    * so after the first iteration has grown it, the iterations do not allocate. */
+  Arena TemporaryArena;
+
+  /** Whether a mean/variance bound is used to prune candidates. */
+  bool UseMeanVarianceBound = false;
+
+  /** The bound given to the functors and the initializer if UseMeanVarianceBound is set. */
+  MeanVarianceBound DistanceBound;
+
+  /** If UseMeanVarianceBound is set, build the DistanceBound for the current images and give it to the functors
+    * and the initializer. Otherwise, or if 'attach' is false, take it away from them. */
+  void AttachMeanVarianceBound(const bool attach);
+
+  /** Whether a descriptor prefilter is used to reject candidates. */
+  bool UseDescriptorPrefilter = false;
+
+  unsigned int NumberOfDescriptorComponents = 8;
+
+  /** The prefilter given to the functors if UseDescriptorPrefilter is set. */
+  PatchDescriptorPrefilter DescriptorPrefilter;
+
+  /** If UseDescriptorPrefilter is set, compute the DescriptorPrefilter for the current images and give it to the
+    * functors. Otherwise, or if 'attach' is false, take it away from them and release the descriptors. */
+  void AttachDescriptorPrefilter(const bool attach);
+
+  /** Write the number of candidates that the DistanceBound has pruned so far, and the number that the
+    * DescriptorPrefilter rejected in the last propagation and random search. */
+  void ReportPruning() const;
+
+  /** Run the iterations from 'firstIteration' on. This is Compute() for a new run and Resume() for a checkpoint. */
+  void ComputeFrom(const unsigned int firstIteration);
+
+  /** The file to which Compute() saves checkpoints, if any. */
+  std::string CheckpointFileName;
+
+  /** The number of iterations between checkpoints. */
+  unsigned int CheckpointInterval = 1;
+
+  /** Writes the checkpoints in the background. */
+  AsyncFileWriter CheckpointWriter;
+
+  /** The last checkpoint that was serialized, kept so that its memory is reused by the next one. */
+  std::vector<char> CheckpointBuffer;
+
+  /** Hand the state of the run after 'numberOfCompletedIterations' iterations to the CheckpointWriter. */
+  void WriteCheckpoint(const unsigned int numberOfCompletedIterations);
+
+  /** Add the runs of 'true' pixels of 'dirtyMask' to 'dirtyRegions', padded to the patches that overlap them. */
+  void AddDirtyMaskRuns(const BoolImageType* const dirtyMask, std::vector<itk::ImageRegion<2> >& dirtyRegions);
+
 }; // end PatchMatch class
 
 #include "PatchMatch.hpp"
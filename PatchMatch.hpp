@@ -37,105 +37,737 @@
 // STL
 #include <algorithm>
 #include <ctime>
+#include <random>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
 
 // Custom
+#include "PatchMatchCheckpoint.h"
 #include "PatchMatchHelpers.h"
 #include "RandomSearch.h"
 
+namespace Internal
+{
+/** Determine if a patch distance functor keeps copies of the images that can be refreshed in an edited region,
+  * that is if it provides UpdateSourceRegion() and UpdateTargetRegion(). */
+template <typename TPatchDistanceFunctor>
+class HasUpdatableImageRegions
+{
+  template <typename T>
+  static auto Test(int) -> decltype(std::declval<T&>().UpdateSourceRegion(std::declval<const itk::ImageRegion<2>&>()),
+                                    std::declval<T&>().UpdateTargetRegion(std::declval<const itk::ImageRegion<2>&>()),
+                                    std::true_type());
+
+  template <typename T>
+  static std::false_type Test(...);
+
+public:
+  static const bool value = decltype(Test<TPatchDistanceFunctor>(0))::value;
+};
+} // end Internal namespace
+
 template<typename TImage, typename TPropagation, typename TRandomSearch>
 void PatchMatch<TImage, TPropagation, TRandomSearch>::Compute()
+{
+  ComputeFrom(0);
+}
+
+template<typename TImage, typename TPropagation, typename TRandomSearch>
+void PatchMatch<TImage, TPropagation, TRandomSearch>::Resume(const std::string& checkpointFileName)
+{
+  assert(this->PropagationFunctor);
+  assert(this->RandomSearchFunctor);
+  assert(this->TargetImage);
+
+  PatchMatchCheckpoint checkpoint;
+  checkpoint.Read(checkpointFileName);
+
+  unsigned int patchRadius = PatchMatchHelpers::DeserializeNNField(checkpoint.NNFieldData.data(),
+                                                                   checkpoint.NNFieldData.size(), this->NNField);
+  if(patchRadius != this->PatchRadius ||
+     this->NNField->GetLargestPossibleRegion() != this->TargetImage->GetLargestPossibleRegion())
+  {
+    throw std::runtime_error("PatchMatch: The checkpoint is not for this target image and patch radius!");
+  }
+  this->NNFieldNeedsInitialization = false;
+
+  this->PropagationFunctor->SetForward(checkpoint.Forward);
+  this->RandomSearchFunctor->SetRandomState(checkpoint.RandomState);
+
+  if(this->Verbose)
+  {
+    std::cout << "PatchMatch: Resuming after iteration " << checkpoint.Iteration << std::endl;
+  }
+
+  ComputeFrom(checkpoint.Iteration);
+}
+
+template<typename TImage, typename TPropagation, typename TRandomSearch>
+void PatchMatch<TImage, TPropagation, TRandomSearch>::WriteCheckpoint(const unsigned int numberOfCompletedIterations)
+{
+  PatchMatchCheckpoint checkpoint;
+  checkpoint.Iteration = numberOfCompletedIterations;
+  checkpoint.Forward = this->PropagationFunctor->GetForward();
+  checkpoint.RandomState = this->RandomSearchFunctor->GetRandomState();
+
+  // Serializing is a single pass over the field, which is small next to an iteration. The disk is left to the
+  // CheckpointWriter's thread.
+  PatchMatchHelpers::SerializeNNField(this->NNField, this->PatchRadius, checkpoint.NNFieldData);
+  checkpoint.Serialize(this->CheckpointBuffer);
+
+  this->CheckpointWriter.Write(this->CheckpointFileName, this->CheckpointBuffer);
+}
+
+template<typename TImage, typename TPropagation, typename TRandomSearch>
+void PatchMatch<TImage, TPropagation, TRandomSearch>::ComputeFrom(const unsigned int firstIteration)
 {
   assert(this->PropagationFunctor);
   assert(this->RandomSearchFunctor);
+  assert(this->SourceImage);
+  assert(this->TargetImage);
+
+  if(this->SourceValidPatchCentersImage)
+  {
+    CorrectValidPatchCentersImage();
+  }
+
+  ComputeTargetPixels();
+
+  AttachMeanVarianceBound(true);
+  AttachDescriptorPrefilter(true);
 
   // If the NNField is not already initialized, initialize it
-  if(this->NNField->GetLargestPossibleRegion() != this->Image->GetLargestPossibleRegion())
+  if(this->NNFieldNeedsInitialization ||
+     this->NNField->GetLargestPossibleRegion() != this->TargetImage->GetLargestPossibleRegion())
   {
     RandomlyInitializeNNField();
+    this->NNFieldNeedsInitialization = false;
   }
 
-  this->RandomSearchFunctor->SetValidPatchCentersImage(this->ValidPatchCentersImage);
+  // Most of the field is about to change, so an index that is not maintained would have to be rebuilt anyway
+  if(this->MaintainReverseIndex)
+  {
+    this->ReverseIndex.Build(this->NNField, this->SourceImage->GetLargestPossibleRegion());
+  }
+  else
+  {
+    this->ReverseIndex.Clear();
+  }
+  AttachReverseIndex();
+
+  this->PropagationFunctor->SetSourceRegion(this->SourceImage->GetLargestPossibleRegion());
+  this->PropagationFunctor->SetValidPatchCentersImage(this->SourceValidPatchCentersImage);
+  this->PropagationFunctor->SetTargetPixels(this->TargetPixels);
+
+  this->RandomSearchFunctor->SetSourceImage(this->SourceImage);
+  this->RandomSearchFunctor->SetTargetImage(this->TargetImage);
+  this->RandomSearchFunctor->SetValidPatchCentersImage(this->SourceValidPatchCentersImage);
   this->RandomSearchFunctor->SetPixelsToProcess(this->TargetPixels);
+  this->RandomSearchFunctor->SetArena(&this->TemporaryArena);
 
   // For the number of iterations specified, perform the appropriate propagation and then a random search
-  for(unsigned int iteration = 0; iteration < this->Iterations; ++iteration)
+  for(unsigned int iteration = firstIteration; iteration < this->Iterations; ++iteration)
   {
-    std::cout << "PatchMatch iteration " << iteration << std::endl;
+    if(this->Verbose)
+    {
+      std::cout << "PatchMatch iteration " << iteration << std::endl;
+    }
+
+    // Nothing allocated from the arena outlives an iteration
+    this->TemporaryArena.Reset();
 
     // We can propagate before random search because we are hoping the the random initialization gave us something good enough to propagate
-    std::cout << "PatchMatch: Propagating..." << std::endl;
+    if(this->Verbose)
+    {
+      std::cout << "PatchMatch: Propagating..." << std::endl;
+    }
     this->PropagationFunctor->Propagate(this->NNField);
 
     UpdatedSignal(this->NNField);
 
-    PatchMatchHelpers::WriteNNField(this->NNField.GetPointer(),
-                                    Helpers::GetSequentialFileName("AfterPropagation", iteration, "mha"));
+    if(this->WriteIntermediateFields)
+    {
+      PatchMatchHelpers::WriteNNField(this->NNField.GetPointer(),
+                                      Helpers::GetSequentialFileName("AfterPropagation", iteration, "mha"));
+    }
 
-    std::cout << "PatchMatch: Random searching..." << std::endl;
+    if(this->Verbose)
+    {
+      std::cout << "PatchMatch: Random searching..." << std::endl;
+    }
     this->RandomSearchFunctor->Search(this->NNField);
 
     UpdatedSignal(this->NNField);
 
-    PatchMatchHelpers::WriteNNField(this->NNField.GetPointer(),
-                                    Helpers::GetSequentialFileName("AfterRandomSearch", iteration, "mha"));
+    ReportPruning();
+
+    if(this->WriteIntermediateFields)
+    {
+      PatchMatchHelpers::WriteNNField(this->NNField.GetPointer(),
+                                      Helpers::GetSequentialFileName("AfterRandomSearch", iteration, "mha"));
 
-    { // Debug only
-    std::string sequentialFileName = Helpers::GetSequentialFileName("PatchMatch", iteration, "mha", 2);
-    PatchMatchHelpers::WriteNNField(this->NNField.GetPointer(), sequentialFileName);
+      // Debug only
+      std::string sequentialFileName = Helpers::GetSequentialFileName("PatchMatch", iteration, "mha", 2);
+      PatchMatchHelpers::WriteNNField(this->NNField.GetPointer(), sequentialFileName);
+    }
+
+    if(!this->CheckpointFileName.empty() && this->CheckpointInterval > 0 &&
+       ((iteration + 1) % this->CheckpointInterval == 0 || iteration + 1 == this->Iterations))
+    {
+      WriteCheckpoint(iteration + 1);
     }
   } // end iteration loop
 
-  std::cout << "PatchMatch finished." << std::endl;
+  // The last checkpoint is complete on the disk when Compute() returns
+  this->CheckpointWriter.Flush();
+
+  // The functors may outlive this object, so they go back to their own arena and lose the bound
+  this->RandomSearchFunctor->SetArena(nullptr);
+  AttachMeanVarianceBound(false);
+  AttachDescriptorPrefilter(false);
+
+  if(this->Verbose)
+  {
+    std::cout << "PatchMatch finished." << std::endl;
+  }
 }
 
 template<typename TImage, typename TPropagation, typename TRandomSearch>
 void PatchMatch<TImage, TPropagation, TRandomSearch>::RandomlyInitializeNNField()
 {
-    itk::ImageRegion<2> internalRegion = ITKHelpers::GetInternalRegion(this->Image->GetLargestPossibleRegion(),
-                                              this->PatchRadius);
+    itk::ImageRegion<2> sourceInternalRegion = ITKHelpers::GetInternalRegion(this->SourceImage->GetLargestPossibleRegion(),
+                                                                              this->PatchRadius);
 
-    this->NNField->SetRegions(this->Image->GetLargestPossibleRegion());
+    this->NNField->SetRegions(this->TargetImage->GetLargestPossibleRegion());
     this->NNField->Allocate();
 
-    itk::ImageRegionIteratorWithIndex<NNFieldType> nnFieldIterator(this->NNField, internalRegion);
+    InitializeRandomGenerator();
+
+    if(this->NNFieldInitializer)
+    {
+      // An empty region marks the pixels that the initializer did not match
+      this->NNField->FillBuffer(Match());
+
+      this->NNFieldInitializer->SetPatchRadius(this->PatchRadius);
+      this->NNFieldInitializer->SetSourceValidPatchCentersImage(this->SourceValidPatchCentersImage);
+      this->NNFieldInitializer->SetTargetPixels(this->TargetPixels);
+      this->NNFieldInitializer->SetArena(&this->TemporaryArena);
+      this->NNFieldInitializer->Initialize(this->NNField);
+      this->NNFieldInitializer->SetArena(nullptr);
+    }
 
-    while(!nnFieldIterator.IsAtEnd())
+    // If only some source patches are allowed, draw the random matches from those
+    Arena::Scope scope(&this->TemporaryArena);
+    ArenaVector<itk::Index<2> > validSourceCenters(&this->TemporaryArena);
+    if(this->SourceValidPatchCentersImage)
     {
-      itk::ImageRegion<2> targetRegion = ITKHelpers::GetRegionInRadiusAroundPixel(nnFieldIterator.GetIndex(), this->PatchRadius);
+      validSourceCenters.reserve(sourceInternalRegion.GetNumberOfPixels());
+      PatchMatchHelpers::AppendPixelsWithValueInRegion(this->SourceValidPatchCentersImage, sourceInternalRegion, true,
+                                                       validSourceCenters);
+      if(validSourceCenters.size() == 0)
+      {
+        throw std::runtime_error("PatchMatch: No valid source regions!");
+      }
+    }
+
+    for(size_t targetPixelId = 0; targetPixelId < this->TargetPixels.size(); ++targetPixelId)
+    {
+      itk::Index<2> targetPixel = this->TargetPixels[targetPixelId];
+      if(this->NNFieldInitializer && this->NNField->GetPixel(targetPixel).GetRegion().GetNumberOfPixels() > 0)
+      {
+        continue;
+      }
+
+      itk::ImageRegion<2> targetRegion = ITKHelpers::GetRegionInRadiusAroundPixel(targetPixel, this->PatchRadius);
+
+      itk::ImageRegion<2> randomRegion;
+      if(validSourceCenters.empty())
+      {
+        randomRegion = ITKHelpers::GetRegionInRadiusAroundPixel(GetRandomPixelInRegion(sourceInternalRegion),
+                                                                this->PatchRadius);
+      }
+      else
+      {
+        std::uniform_int_distribution<size_t> distribution(0, validSourceCenters.size() - 1);
+        itk::Index<2> randomCenter = validSourceCenters[distribution(this->Generator)];
+        randomRegion = ITKHelpers::GetRegionInRadiusAroundPixel(randomCenter, this->PatchRadius);
+      }
 
-      itk::ImageRegion<2> randomRegion = PatchMatchHelpers::GetRandomRegionInRegion(internalRegion, this->PatchRadius);
       Match randomMatch;
       randomMatch.SetRegion(randomRegion);
       randomMatch.SetScore(this->RandomSearchFunctor->GetPatchDistanceFunctor()->Distance(randomRegion, targetRegion));
 
-      nnFieldIterator.Set(randomMatch);
-      ++nnFieldIterator;
+      this->NNField->SetPixel(targetPixel, randomMatch);
+    }
+}
+
+template<typename TImage, typename TPropagation, typename TRandomSearch>
+void PatchMatch<TImage, TPropagation, TRandomSearch>::InitializeRandomGenerator()
+{
+    if(this->GeneratorIsSeeded)
+    {
+      return;
+    }
+
+    if(this->Random)
+    {
+      std::random_device randomDevice;
+      this->Generator.seed(randomDevice());
     }
+    else
+    {
+      this->Generator.seed(0);
+    }
+    this->GeneratorIsSeeded = true;
+}
+
+template<typename TImage, typename TPropagation, typename TRandomSearch>
+itk::Index<2> PatchMatch<TImage, TPropagation, TRandomSearch>::GetRandomPixelInRegion(const itk::ImageRegion<2>& region)
+{
+    itk::Index<2> pixel;
+    for(unsigned int dimension = 0; dimension < 2; ++dimension)
+    {
+      std::uniform_int_distribution<itk::IndexValueType> distribution(region.GetIndex()[dimension],
+                                                                      region.GetIndex()[dimension] +
+                                                                      region.GetSize()[dimension] - 1);
+      pixel[dimension] = distribution(this->Generator);
+    }
+
+    return pixel;
 }
 
 template<typename TImage, typename TPropagation, typename TRandomSearch>
 void PatchMatch<TImage, TPropagation, TRandomSearch>::CorrectValidPatchCentersImage()
 {
-    itk::ImageRegion<2> internalRegion = ITKHelpers::GetInternalRegion(this->Image->GetLargestPossibleRegion(),
-                                              this->PatchRadius);
+    itk::ImageRegion<2> sourceInternalRegion = ITKHelpers::GetInternalRegion(this->SourceImage->GetLargestPossibleRegion(),
+                                                                              this->PatchRadius);
 
-    itk::ImageRegionIteratorWithIndex<BoolImageType> boolImageIterator(this->ValidPatchCentersImage, internalRegion);
+    itk::ImageRegionIteratorWithIndex<BoolImageType> boolImageIterator(this->SourceValidPatchCentersImage,
+                                                                       this->SourceValidPatchCentersImage->GetLargestPossibleRegion());
 
     while(!boolImageIterator.IsAtEnd())
     {
-      if(boolImageIterator.Get()) // if the pixel is marked as valid
+      // If the pixel is marked as valid but the patch centered on it is not entirely inside the source image
+      if(boolImageIterator.Get() && !sourceInternalRegion.IsInside(boolImageIterator.GetIndex()))
+      {
+        boolImageIterator.Set(false);
+      }
+
+      ++boolImageIterator;
+    }
+}
+
+template<typename TImage, typename TPropagation, typename TRandomSearch>
+void PatchMatch<TImage, TPropagation, TRandomSearch>::ComputeTargetPixels()
+{
+    if(this->TargetPixels.size() > 0)
+    {
+      return;
+    }
+
+    itk::ImageRegion<2> targetInternalRegion = ITKHelpers::GetInternalRegion(this->TargetImage->GetLargestPossibleRegion(),
+                                                                              this->PatchRadius);
+
+    if(this->TargetValidPatchCentersImage)
+    {
+      this->TargetPixels = ITKHelpers::GetPixelsWithValueInRegion(this->TargetValidPatchCentersImage,
+                                                                  targetInternalRegion, true);
+    }
+    else
+    {
+      this->TargetPixels = PatchMatchHelpers::GetAllPixelIndices(targetInternalRegion);
+    }
+}
+
+template<typename TImage, typename TPropagation, typename TRandomSearch>
+void PatchMatch<TImage, TPropagation, TRandomSearch>::MarkDirty(const itk::ImageRegion<2>& dirtyRegion)
+{
+    // The patches centered within PatchRadius of the edit contain edited pixels
+    itk::ImageRegion<2> paddedRegion = dirtyRegion;
+    paddedRegion.PadByRadius(this->PatchRadius);
+
+    this->DirtyTargetRegions.push_back(paddedRegion);
+
+    if(this->SourceImage == this->TargetImage)
+    {
+      this->DirtySourceRegions.push_back(paddedRegion);
+    }
+
+    UpdatePatchDistanceFunctor(dirtyRegion, false);
+}
+
+template<typename TImage, typename TPropagation, typename TRandomSearch>
+void PatchMatch<TImage, TPropagation, TRandomSearch>::MarkDirty(const itk::Image<bool, 2>* const dirtyMask)
+{
+    AddDirtyMaskRuns(dirtyMask, this->DirtyTargetRegions);
+
+    if(this->SourceImage == this->TargetImage)
+    {
+      AddDirtyMaskRuns(dirtyMask, this->DirtySourceRegions);
+    }
+
+    UpdatePatchDistanceFunctor(dirtyMask->GetLargestPossibleRegion(), false);
+}
+
+template<typename TImage, typename TPropagation, typename TRandomSearch>
+void PatchMatch<TImage, TPropagation, TRandomSearch>::MarkSourceDirty(const itk::ImageRegion<2>& dirtyRegion)
+{
+    itk::ImageRegion<2> paddedRegion = dirtyRegion;
+    paddedRegion.PadByRadius(this->PatchRadius);
+
+    this->DirtySourceRegions.push_back(paddedRegion);
+
+    UpdatePatchDistanceFunctor(dirtyRegion, true);
+}
+
+template<typename TImage, typename TPropagation, typename TRandomSearch>
+void PatchMatch<TImage, TPropagation, TRandomSearch>::UpdatePatchDistanceFunctor(const itk::ImageRegion<2>& region,
+                                                                                 const bool source)
+{
+    if(!this->RandomSearchFunctor)
+    {
+      return;
+    }
+
+    typedef typename std::remove_pointer<decltype(this->RandomSearchFunctor->GetPatchDistanceFunctor())>::type
+        PatchDistanceFunctorType;
+    UpdatePatchDistanceFunctor(this->RandomSearchFunctor->GetPatchDistanceFunctor(), region, source,
+                               std::integral_constant<bool,
+                                   Internal::HasUpdatableImageRegions<PatchDistanceFunctorType>::value>());
+}
+
+template<typename TImage, typename TPropagation, typename TRandomSearch>
+template<typename TPatchDistanceFunctor>
+void PatchMatch<TImage, TPropagation, TRandomSearch>::
+UpdatePatchDistanceFunctor(TPatchDistanceFunctor* const patchDistanceFunctor, const itk::ImageRegion<2>& region,
+                           const bool source, std::true_type)
+{
+    if(source)
+    {
+      patchDistanceFunctor->UpdateSourceRegion(region);
+    }
+    else
+    {
+      patchDistanceFunctor->UpdateTargetRegion(region);
+    }
+}
+
+template<typename TImage, typename TPropagation, typename TRandomSearch>
+template<typename TPatchDistanceFunctor>
+void PatchMatch<TImage, TPropagation, TRandomSearch>::
+UpdatePatchDistanceFunctor(TPatchDistanceFunctor* const, const itk::ImageRegion<2>&, const bool, std::false_type)
+{
+    // The functor reads the images directly, so it already sees the edit
+}
+
+template<typename TImage, typename TPropagation, typename TRandomSearch>
+void PatchMatch<TImage, TPropagation, TRandomSearch>::
+AddDirtyMaskRuns(const BoolImageType* const dirtyMask, std::vector<itk::ImageRegion<2> >& dirtyRegions)
+{
+    itk::ImageRegion<2> maskRegion = dirtyMask->GetLargestPossibleRegion();
+    const itk::IndexValueType xEnd = maskRegion.GetIndex()[0] + static_cast<itk::IndexValueType>(maskRegion.GetSize()[0]);
+    const itk::IndexValueType yEnd = maskRegion.GetIndex()[1] + static_cast<itk::IndexValueType>(maskRegion.GetSize()[1]);
+
+    // Each horizontal run of dirty pixels becomes one region, and a run that spans the same columns as a run of
+    // the row above extends that region instead, so a brush stroke gives a few rectangles rather than one
+    // (padded, and so heavily overlapping) region per row
+    const size_t firstNewRegion = dirtyRegions.size();
+    std::vector<size_t> previousRowRegions;
+    std::vector<size_t> currentRowRegions;
+    for(itk::IndexValueType y = maskRegion.GetIndex()[1]; y < yEnd; ++y)
+    {
+      size_t previousRowRegionId = 0;
+      itk::IndexValueType x = maskRegion.GetIndex()[0];
+      while(x < xEnd)
       {
-        itk::ImageRegion<2> queryRegion =
-              ITKHelpers::GetRegionInRadiusAroundPixel(boolImageIterator.GetIndex(), this->PatchRadius);
+        itk::Index<2> pixel = {{x, y}};
+        if(!dirtyMask->GetPixel(pixel))
+        {
+          ++x;
+          continue;
+        }
 
-        if(!internalRegion.IsInside(queryRegion))
+        itk::IndexValueType runStart = x;
+        do
         {
-          boolImageIterator.Set(false);
+          ++x;
+          pixel[0] = x;
+        } while(x < xEnd && dirtyMask->GetPixel(pixel));
+
+        const itk::SizeValueType runLength = static_cast<itk::SizeValueType>(x - runStart);
+
+        // The runs of a row are found from left to right, so the runs of the row above are only scanned once
+        while(previousRowRegionId < previousRowRegions.size() &&
+              dirtyRegions[previousRowRegions[previousRowRegionId]].GetIndex()[0] < runStart)
+        {
+          ++previousRowRegionId;
         }
+
+        if(previousRowRegionId < previousRowRegions.size() &&
+           dirtyRegions[previousRowRegions[previousRowRegionId]].GetIndex()[0] == runStart &&
+           dirtyRegions[previousRowRegions[previousRowRegionId]].GetSize()[0] == runLength)
+        {
+          itk::ImageRegion<2>& region = dirtyRegions[previousRowRegions[previousRowRegionId]];
+          itk::Size<2> size = region.GetSize();
+          size[1]++;
+          region.SetSize(size);
+          currentRowRegions.push_back(previousRowRegions[previousRowRegionId]);
+          continue;
+        }
+
+        itk::Index<2> runIndex = {{runStart, y}};
+        itk::Size<2> runSize = {{runLength, 1}};
+        currentRowRegions.push_back(dirtyRegions.size());
+        dirtyRegions.push_back(itk::ImageRegion<2>(runIndex, runSize));
       }
 
-      ++boolImageIterator;
+      previousRowRegions.swap(currentRowRegions);
+      currentRowRegions.clear();
     }
+
+    // The patches centered within PatchRadius of a dirty pixel contain it
+    for(size_t regionId = firstNewRegion; regionId < dirtyRegions.size(); ++regionId)
+    {
+      dirtyRegions[regionId].PadByRadius(this->PatchRadius);
+    }
+}
+
+template<typename TImage, typename TPropagation, typename TRandomSearch>
+void PatchMatch<TImage, TPropagation, TRandomSearch>::RecomputeDirty()
+{
+  assert(this->PropagationFunctor);
+  assert(this->RandomSearchFunctor);
+  assert(this->SourceImage);
+  assert(this->TargetImage);
+
+  this->NumberOfRecomputedPixels = 0;
+
+  if(this->DirtyTargetRegions.empty() && this->DirtySourceRegions.empty())
+  {
+    return;
+  }
+
+  if(this->NNField->GetLargestPossibleRegion() != this->TargetImage->GetLargestPossibleRegion())
+  {
+    throw std::runtime_error("PatchMatch::RecomputeDirty: Compute() must be called before RecomputeDirty()!");
+  }
+
+  itk::ImageRegion<2> targetInternalRegion = ITKHelpers::GetInternalRegion(this->TargetImage->GetLargestPossibleRegion(),
+                                                                            this->PatchRadius);
+
+  if(this->ActivePixelsImage->GetLargestPossibleRegion() != this->TargetImage->GetLargestPossibleRegion())
+  {
+    this->ActivePixelsImage->SetRegions(this->TargetImage->GetLargestPossibleRegion());
+    this->ActivePixelsImage->Allocate();
+    this->ActivePixelsImage->FillBuffer(0);
+  }
+
+  // The pixels to recompute
+  std::vector<itk::Index<2> > activePixels;
+
+  // Only pixels that already have a match (that is, that were computed by Compute()) are recomputed
+  auto activatePixel = [&](const itk::Index<2>& pixel)
+  {
+    if(!targetInternalRegion.IsInside(pixel) || this->ActivePixelsImage->GetPixel(pixel))
+    {
+      return;
+    }
+
+    itk::ImageRegion<2> matchRegion = this->NNField->GetPixel(pixel).GetRegion();
+    if(matchRegion.GetNumberOfPixels() == 0)
+    {
+      return;
+    }
+
+    this->ActivePixelsImage->SetPixel(pixel, 1);
+    activePixels.push_back(pixel);
+  };
+
+  // Invalidate the target patches that overlap the edit
+  for(size_t regionId = 0; regionId < this->DirtyTargetRegions.size(); ++regionId)
+  {
+    itk::ImageRegion<2> dirtyRegion = this->DirtyTargetRegions[regionId];
+    if(!dirtyRegion.Crop(targetInternalRegion))
+    {
+      continue;
+    }
+
+    const itk::IndexValueType xEnd = dirtyRegion.GetIndex()[0] + static_cast<itk::IndexValueType>(dirtyRegion.GetSize()[0]);
+    const itk::IndexValueType yEnd = dirtyRegion.GetIndex()[1] + static_cast<itk::IndexValueType>(dirtyRegion.GetSize()[1]);
+    for(itk::IndexValueType y = dirtyRegion.GetIndex()[1]; y < yEnd; ++y)
+    {
+      for(itk::IndexValueType x = dirtyRegion.GetIndex()[0]; x < xEnd; ++x)
+      {
+        itk::Index<2> pixel = {{x, y}};
+        activatePixel(pixel);
+      }
+    }
+  }
+
+  // Invalidate the matches whose source patch overlaps the edit
+  if(!this->DirtySourceRegions.empty())
+  {
+    // Only when MaintainReverseIndex was turned off, at the cost of a pass over the whole field
+    if(!this->ReverseIndex.IsBuilt())
+    {
+      this->ReverseIndex.Build(this->NNField, this->SourceImage->GetLargestPossibleRegion());
+    }
+
+    std::vector<itk::Index<2> > affectedPixels;
+    for(size_t regionId = 0; regionId < this->DirtySourceRegions.size(); ++regionId)
+    {
+      affectedPixels.clear();
+      this->ReverseIndex.AppendTargetsInRegion(this->DirtySourceRegions[regionId], affectedPixels);
+      std::for_each(affectedPixels.begin(), affectedPixels.end(), activatePixel);
+    }
+  }
+
+  this->DirtyTargetRegions.clear();
+  this->DirtySourceRegions.clear();
+
+  // The scores of the invalidated matches refer to the image before the edit
+  for(size_t pixelId = 0; pixelId < activePixels.size(); ++pixelId)
+  {
+    itk::ImageRegion<2> targetRegion = ITKHelpers::GetRegionInRadiusAroundPixel(activePixels[pixelId], this->PatchRadius);
+
+    Match match = this->NNField->GetPixel(activePixels[pixelId]);
+    match.SetScore(this->RandomSearchFunctor->GetPatchDistanceFunctor()->Distance(match.GetRegion(), targetRegion));
+    this->NNField->SetPixel(activePixels[pixelId], match);
+  }
+
+  this->PropagationFunctor->SetSourceRegion(this->SourceImage->GetLargestPossibleRegion());
+  this->PropagationFunctor->SetValidPatchCentersImage(this->SourceValidPatchCentersImage);
+
+  this->RandomSearchFunctor->SetSourceImage(this->SourceImage);
+  this->RandomSearchFunctor->SetTargetImage(this->TargetImage);
+  this->RandomSearchFunctor->SetValidPatchCentersImage(this->SourceValidPatchCentersImage);
+
+  // Once the index exists, the functors keep it in sync with the matches that they change
+  AttachReverseIndex();
+
+  // The mean/variance bound is not used here. Its summed area tables cover the whole images, so rebuilding them
+  // after an edit would make the cost proportional to the image rather than to the edit.
+  const itk::IndexValueType growthRadius = this->DirtyGrowthRadius;
+  size_t frontierBegin = 0;
+
+  for(unsigned int iteration = 0; iteration < this->Iterations; ++iteration)
+  {
+    // Grow the neighbourhood so that improvements can flow out of (and into) the edited area
+    if(iteration > 0)
+    {
+      size_t frontierEnd = activePixels.size();
+      for(size_t pixelId = frontierBegin; pixelId < frontierEnd; ++pixelId)
+      {
+        itk::Index<2> frontierPixel = activePixels[pixelId];
+        for(itk::IndexValueType yOffset = -growthRadius; yOffset <= growthRadius; ++yOffset)
+        {
+          for(itk::IndexValueType xOffset = -growthRadius; xOffset <= growthRadius; ++xOffset)
+          {
+            itk::Index<2> neighbor = {{frontierPixel[0] + xOffset, frontierPixel[1] + yOffset}};
+            activatePixel(neighbor);
+          }
+        }
+      }
+      frontierBegin = frontierEnd;
+    }
+
+    // Propagation relies on the pixels being visited in raster order
+    std::vector<itk::Index<2> > sortedPixels = activePixels;
+    std::sort(sortedPixels.begin(), sortedPixels.end(),
+              [](const itk::Index<2>& a, const itk::Index<2>& b)
+              { return a[1] < b[1] || (a[1] == b[1] && a[0] < b[0]); });
+
+    this->PropagationFunctor->SetTargetPixels(sortedPixels);
+    this->PropagationFunctor->Propagate(this->NNField);
+
+    this->RandomSearchFunctor->SetPixelsToProcess(sortedPixels);
+    this->RandomSearchFunctor->Search(this->NNField);
+
+    UpdatedSignal(this->NNField);
+  }
+
+  // Reset only the markers that were set, so that the next edit does not have to clear the whole image
+  for(size_t pixelId = 0; pixelId < activePixels.size(); ++pixelId)
+  {
+    this->ActivePixelsImage->SetPixel(activePixels[pixelId], 0);
+  }
+
+  // Leave the functors set up for a full Compute()
+  this->PropagationFunctor->SetTargetPixels(this->TargetPixels);
+  this->RandomSearchFunctor->SetPixelsToProcess(this->TargetPixels);
+
+  this->NumberOfRecomputedPixels = activePixels.size();
+}
+
+template<typename TImage, typename TPropagation, typename TRandomSearch>
+void PatchMatch<TImage, TPropagation, TRandomSearch>::AttachMeanVarianceBound(const bool attach)
+{
+  MeanVarianceBound* distanceBound = nullptr;
+  if(attach && this->UseMeanVarianceBound)
+  {
+    this->DistanceBound.Compute(this->SourceImage, this->TargetImage, this->PatchRadius);
+    this->DistanceBound.ResetCounts();
+    distanceBound = &this->DistanceBound;
+  }
+
+  this->PropagationFunctor->SetMeanVarianceBound(distanceBound);
+  this->RandomSearchFunctor->SetMeanVarianceBound(distanceBound);
+  if(this->NNFieldInitializer)
+  {
+    this->NNFieldInitializer->SetMeanVarianceBound(distanceBound);
+  }
+}
+
+template<typename TImage, typename TPropagation, typename TRandomSearch>
+void PatchMatch<TImage, TPropagation, TRandomSearch>::AttachDescriptorPrefilter(const bool attach)
+{
+  PatchDescriptorPrefilter* descriptorPrefilter = nullptr;
+  if(attach && this->UseDescriptorPrefilter)
+  {
+    this->DescriptorPrefilter.Compute(this->SourceImage, this->TargetImage, this->PatchRadius,
+                                      this->NumberOfDescriptorComponents);
+    descriptorPrefilter = &this->DescriptorPrefilter;
+  }
+  else
+  {
+    this->DescriptorPrefilter.Clear();
+  }
+
+  this->PropagationFunctor->SetDescriptorPrefilter(descriptorPrefilter);
+  this->RandomSearchFunctor->SetDescriptorPrefilter(descriptorPrefilter);
+}
+
+template<typename TImage, typename TPropagation, typename TRandomSearch>
+void PatchMatch<TImage, TPropagation, TRandomSearch>::ReportPruning() const
+{
+  if(!this->Verbose)
+  {
+    return;
+  }
+
+  if(this->UseMeanVarianceBound)
+  {
+    std::cout << "PatchMatch: The mean/variance bound pruned " << this->DistanceBound.GetNumberOfPrunedCandidates()
+              << " of " << this->DistanceBound.GetNumberOfTests() << " candidates ("
+              << 100.0f * this->DistanceBound.GetPruningRate() << "%)." << std::endl;
+  }
+
+  if(this->DescriptorPrefilter.IsComputed())
+  {
+    std::cout << "PatchMatch: The descriptor prefilter rejected "
+              << this->PropagationFunctor->GetNumberOfRejectedCandidates() << " propagated and "
+              << this->RandomSearchFunctor->GetNumberOfRejectedCandidates() << " random candidates." << std::endl;
+  }
+}
+
+template<typename TImage, typename TPropagation, typename TRandomSearch>
+void PatchMatch<TImage, TPropagation, TRandomSearch>::AttachReverseIndex()
+{
+  NNFieldReverseIndex* reverseIndex = this->ReverseIndex.IsBuilt() ? &this->ReverseIndex : nullptr;
+
+  this->PropagationFunctor->SetReverseIndex(reverseIndex);
+  this->RandomSearchFunctor->SetReverseIndex(reverseIndex);
 }
 
 #endif
@@ -0,0 +1,136 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#ifndef PatchMatchBatch_H
+#define PatchMatchBatch_H
+
+// ITK
+#include "itkImage.h"
+
+// STL
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Custom
+#include "BatchSSD.h"
+#include "NNField.h"
+#include "PatchMatch.h"
+#include "Propagator.h"
+#include "RandomSearch.h"
+
+/** This class computes the NNFields of many independent images, each matched against itself. Images as small as
+  * thumbnails are not worth splitting between threads, so instead the images are spread over a pool of threads,
+  * each of which matches one image at a time. Every thread keeps its own distance functor, propagator, random
+  * search and PatchMatch object for all of the images that it processes, so the NNField and the other buffers
+  * are only reallocated when the image size changes, and the logging and intermediate fields of PatchMatch are
+  * turned off. */
+template <typename TImage, typename TPatchDistanceFunctor = BatchSSD<TImage> >
+class PatchMatchBatch
+{
+public:
+  typedef Propagator<TPatchDistanceFunctor> PropagatorType;
+  typedef RandomSearch<TImage, TPatchDistanceFunctor> RandomSearchType;
+  typedef PatchMatch<TImage, PropagatorType, RandomSearchType> PatchMatchType;
+
+  /** Get image 'imageId', or a null pointer to skip it. */
+  typedef std::function<typename TImage::Pointer (const size_t imageId)> ImageSourceType;
+
+  /** Receive the NNField of image 'imageId'. The NNField is reused by the thread once this returns. */
+  typedef std::function<void (const size_t imageId, TImage* const image, NNFieldType* const nnField)> ResultHandlerType;
+
+  /** Compute the NNFields of 'numberOfImages' images. The images are taken from 'getImage' and the fields are
+    * given to 'handleResult' by the thread that computed them, so both are called concurrently from several
+    * threads. An exception thrown while processing an image is reported and counts it as failed. */
+  void Compute(const size_t numberOfImages, const ImageSourceType& getImage, const ResultHandlerType& handleResult);
+
+  /** Compute the NNFields of 'images' into 'nnFields'. */
+  void Compute(const std::vector<typename TImage::Pointer>& images, std::vector<NNFieldType::Pointer>& nnFields);
+
+  void SetPatchRadius(const unsigned int patchRadius)
+  {
+    this->PatchRadius = patchRadius;
+  }
+
+  void SetIterations(const unsigned int iterations)
+  {
+    this->Iterations = iterations;
+  }
+
+  /** Set the number of threads. 0 (the default) uses one per hardware thread. */
+  void SetNumberOfThreads(const unsigned int numberOfThreads)
+  {
+    this->NumberOfThreads = numberOfThreads;
+  }
+
+  unsigned int GetNumberOfThreads() const;
+
+  /** Get the number of images whose NNField was computed by the last Compute(). */
+  size_t GetNumberOfProcessedImages() const
+  {
+    return this->NumberOfProcessedImages;
+  }
+
+  /** Get the number of images of the last Compute() that were skipped or failed. */
+  size_t GetNumberOfFailedImages() const
+  {
+    return this->NumberOfFailedImages;
+  }
+
+  /** Get the number of images processed per second by the last Compute(). */
+  double GetImagesPerSecond() const
+  {
+    return this->ImagesPerSecond;
+  }
+
+private:
+  /** The objects that one thread uses for every image it matches. */
+  struct Worker
+  {
+    TPatchDistanceFunctor PatchDistanceFunctor;
+
+    PropagatorType PropagationFunctor;
+
+    RandomSearchType RandomSearchFunctor;
+
+    PatchMatchType Matcher;
+  };
+
+  unsigned int PatchRadius = 5;
+
+  unsigned int Iterations = 5;
+
+  unsigned int NumberOfThreads = 0;
+
+  /** The workers, which are kept between calls to Compute(). */
+  std::vector<std::unique_ptr<Worker> > Workers;
+
+  size_t NumberOfProcessedImages = 0;
+
+  size_t NumberOfFailedImages = 0;
+
+  double ImagesPerSecond = 0.0;
+
+  /** Create the workers that are missing, and give all of them the current settings. */
+  void SetupWorkers(const unsigned int numberOfWorkers);
+};
+
+#include "PatchMatchBatch.hpp"
+
+#endif
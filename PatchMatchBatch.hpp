@@ -0,0 +1,153 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#ifndef PatchMatchBatch_HPP
+#define PatchMatchBatch_HPP
+
+#include "PatchMatchBatch.h"
+
+// STL
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+// Submodules
+#include <ITKHelpers/ITKHelpers.h>
+
+template <typename TImage, typename TPatchDistanceFunctor>
+void PatchMatchBatch<TImage, TPatchDistanceFunctor>::Compute(const size_t numberOfImages, const ImageSourceType& getImage,
+                                                             const ResultHandlerType& handleResult)
+{
+  const unsigned int numberOfWorkers =
+      static_cast<unsigned int>(std::max<size_t>(1, std::min<size_t>(GetNumberOfThreads(), numberOfImages)));
+  SetupWorkers(numberOfWorkers);
+
+  // The images are handed out one at a time, so a thread that gets small or easy images just takes more of them
+  std::atomic<size_t> nextImageId(0);
+  std::atomic<size_t> numberOfProcessedImages(0);
+  std::mutex errorMutex;
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  std::vector<std::thread> threads;
+  for(unsigned int workerId = 0; workerId < numberOfWorkers; ++workerId)
+  {
+    threads.push_back(std::thread([&, workerId]()
+    {
+      Worker& worker = *this->Workers[workerId];
+
+      for(size_t imageId = nextImageId++; imageId < numberOfImages; imageId = nextImageId++)
+      {
+        try
+        {
+          typename TImage::Pointer image = getImage(imageId);
+          if(!image)
+          {
+            continue;
+          }
+
+          worker.PatchDistanceFunctor.SetImage(image);
+          worker.Matcher.SetImage(image);
+          worker.Matcher.ResetNNField();
+          worker.Matcher.Compute();
+
+          handleResult(imageId, image, worker.Matcher.GetNNField());
+          numberOfProcessedImages++;
+        }
+        catch(const std::exception& exception)
+        {
+          std::lock_guard<std::mutex> lock(errorMutex);
+          std::cerr << "PatchMatchBatch: Image " << imageId << " failed: " << exception.what() << std::endl;
+        }
+      }
+    }));
+  }
+
+  for(size_t threadId = 0; threadId < threads.size(); ++threadId)
+  {
+    threads[threadId].join();
+  }
+
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  this->NumberOfProcessedImages = numberOfProcessedImages;
+  this->NumberOfFailedImages = numberOfImages - this->NumberOfProcessedImages;
+  this->ImagesPerSecond = seconds > 0.0 ? this->NumberOfProcessedImages / seconds : 0.0;
+}
+
+template <typename TImage, typename TPatchDistanceFunctor>
+void PatchMatchBatch<TImage, TPatchDistanceFunctor>::Compute(const std::vector<typename TImage::Pointer>& images,
+                                                             std::vector<NNFieldType::Pointer>& nnFields)
+{
+  nnFields.assign(images.size(), NNFieldType::Pointer());
+
+  // Each field is written by exactly one thread, into its own entry
+  Compute(images.size(),
+          [&images](const size_t imageId) { return images[imageId]; },
+          [&nnFields](const size_t imageId, TImage* const, NNFieldType* const nnField)
+          {
+            nnFields[imageId] = NNFieldType::New();
+            ITKHelpers::DeepCopy(nnField, nnFields[imageId].GetPointer());
+          });
+}
+
+template <typename TImage, typename TPatchDistanceFunctor>
+unsigned int PatchMatchBatch<TImage, TPatchDistanceFunctor>::GetNumberOfThreads() const
+{
+  if(this->NumberOfThreads > 0)
+  {
+    return this->NumberOfThreads;
+  }
+
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+template <typename TImage, typename TPatchDistanceFunctor>
+void PatchMatchBatch<TImage, TPatchDistanceFunctor>::SetupWorkers(const unsigned int numberOfWorkers)
+{
+  while(this->Workers.size() < numberOfWorkers)
+  {
+    std::unique_ptr<Worker> worker(new Worker);
+
+    worker->PropagationFunctor.SetPatchDistanceFunctor(&worker->PatchDistanceFunctor);
+    worker->RandomSearchFunctor.SetPatchDistanceFunctor(&worker->PatchDistanceFunctor);
+
+    worker->Matcher.SetPropagationFunctor(&worker->PropagationFunctor);
+    worker->Matcher.SetRandomSearchFunctor(&worker->RandomSearchFunctor);
+    worker->Matcher.SetWriteIntermediateFields(false);
+    worker->Matcher.SetVerbose(false);
+
+    this->Workers.push_back(std::move(worker));
+  }
+
+  for(size_t workerId = 0; workerId < this->Workers.size(); ++workerId)
+  {
+    Worker& worker = *this->Workers[workerId];
+    worker.PropagationFunctor.SetPatchRadius(this->PatchRadius);
+    worker.RandomSearchFunctor.SetPatchRadius(this->PatchRadius);
+    worker.Matcher.SetPatchRadius(this->PatchRadius);
+    worker.Matcher.SetIterations(this->Iterations);
+  }
+}
+
+#endif
@@ -0,0 +1,96 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#include "PatchMatchCheckpoint.h"
+
+// STL
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace
+{
+const char CheckpointMagic[4] = {'P', 'M', 'C', '1'};
+}
+
+void PatchMatchCheckpoint::Serialize(std::vector<char>& buffer) const
+{
+  const uint32_t iteration = this->Iteration;
+  const uint8_t forward = this->Forward;
+  const uint32_t randomStateLength = static_cast<uint32_t>(this->RandomState.size());
+
+  buffer.clear();
+  buffer.reserve(sizeof(CheckpointMagic) + sizeof(iteration) + sizeof(forward) + sizeof(randomStateLength) +
+                 this->RandomState.size() + this->NNFieldData.size());
+
+  buffer.insert(buffer.end(), CheckpointMagic, CheckpointMagic + sizeof(CheckpointMagic));
+  buffer.insert(buffer.end(), reinterpret_cast<const char*>(&iteration),
+                reinterpret_cast<const char*>(&iteration) + sizeof(iteration));
+  buffer.insert(buffer.end(), reinterpret_cast<const char*>(&forward),
+                reinterpret_cast<const char*>(&forward) + sizeof(forward));
+  buffer.insert(buffer.end(), reinterpret_cast<const char*>(&randomStateLength),
+                reinterpret_cast<const char*>(&randomStateLength) + sizeof(randomStateLength));
+  buffer.insert(buffer.end(), this->RandomState.begin(), this->RandomState.end());
+  buffer.insert(buffer.end(), this->NNFieldData.begin(), this->NNFieldData.end());
+}
+
+void PatchMatchCheckpoint::Deserialize(const char* const data, const size_t size)
+{
+  uint32_t iteration = 0;
+  uint8_t forward = 0;
+  uint32_t randomStateLength = 0;
+  const size_t headerSize = sizeof(CheckpointMagic) + sizeof(iteration) + sizeof(forward) + sizeof(randomStateLength);
+  if(size < headerSize || std::memcmp(data, CheckpointMagic, sizeof(CheckpointMagic)) != 0)
+  {
+    throw std::runtime_error("PatchMatchCheckpoint: The data is not a PatchMatch checkpoint!");
+  }
+
+  const char* position = data + sizeof(CheckpointMagic);
+  std::memcpy(&iteration, position, sizeof(iteration));
+  position += sizeof(iteration);
+  std::memcpy(&forward, position, sizeof(forward));
+  position += sizeof(forward);
+  std::memcpy(&randomStateLength, position, sizeof(randomStateLength));
+  position += sizeof(randomStateLength);
+
+  if(size - headerSize < randomStateLength)
+  {
+    throw std::runtime_error("PatchMatchCheckpoint: The checkpoint is truncated!");
+  }
+
+  this->Iteration = iteration;
+  this->Forward = forward != 0;
+  this->RandomState.assign(position, randomStateLength);
+  position += randomStateLength;
+  this->NNFieldData.assign(position, data + size);
+}
+
+void PatchMatchCheckpoint::Read(const std::string& fileName)
+{
+  std::ifstream fin(fileName.c_str(), std::ios::binary);
+  if(!fin)
+  {
+    throw std::runtime_error("PatchMatchCheckpoint: Could not open " + fileName + "!");
+  }
+
+  std::vector<char> data((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+  Deserialize(data.data(), data.size());
+}
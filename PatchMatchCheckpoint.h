@@ -0,0 +1,58 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#ifndef PatchMatchCheckpoint_H
+#define PatchMatchCheckpoint_H
+
+// STL
+#include <string>
+#include <vector>
+
+/** The state of a PatchMatch run between two iterations: everything that Compute() needs, besides the images and
+  * the settings of the run, to continue exactly as if it had not been stopped.
+  *
+  * The binary format is the magic "PMC1", the uint32 number of completed iterations, a uint8 propagation direction,
+  * the uint32 length of the random state followed by its bytes, and then the NNField in the binary NNField format
+  * (see PatchMatchHelpers::SerializeNNField()) up to the end of the file. As in the NNField format, the numbers are
+  * in the byte order of the host. */
+struct PatchMatchCheckpoint
+{
+  /** The number of iterations that were completed, which is the first iteration of a resumed run. */
+  unsigned int Iteration = 0;
+
+  /** The direction of the next propagation (see Propagator::SetForward()). */
+  bool Forward = true;
+
+  /** The state of the random search's random number generator. */
+  std::string RandomState;
+
+  /** The NNField in the binary NNField format. */
+  std::vector<char> NNFieldData;
+
+  /** Write the checkpoint to 'buffer' in the binary format. */
+  void Serialize(std::vector<char>& buffer) const;
+
+  /** Read the checkpoint from the 'size' bytes at 'data'. */
+  void Deserialize(const char* const data, const size_t size);
+
+  /** Read the checkpoint from a file. */
+  void Read(const std::string& fileName);
+};
+
+#endif
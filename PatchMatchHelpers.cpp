@@ -18,15 +18,21 @@
 
 #include "PatchMatchHelpers.h"
 
+// ITK
+#include "itkImageRegionIterator.h"
+
+// STL
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
 
 namespace PatchMatchHelpers
 {
 
 itk::ImageRegion<2> GetRandomRegionInRegion(const itk::ImageRegion<2>& region, const unsigned int patchRadius)
 {
-    itk::Index<2> randomPixel;
-    randomPixel[0] = Helpers::RandomInt(region.GetIndex()[0], region.GetIndex()[0] + region.GetSize()[0]);
-    randomPixel[1] = Helpers::RandomInt(region.GetIndex()[1], region.GetIndex()[1] + region.GetSize()[1]);
+    itk::Index<2> randomPixel = GetRandomPixelInRegion(region);
 
     itk::ImageRegion<2> randomRegion = ITKHelpers::GetRegionInRadiusAroundPixel(randomPixel, patchRadius);
 
@@ -88,4 +94,104 @@ std::vector<itk::Index<2> > GetAllPixelIndices(const itk::ImageRegion<2>& region
   return pixelIndices;
 }
 
+namespace
+{
+const char NNFieldMagic[4] = {'N', 'N', 'F', '1'};
+
+template <typename T>
+void AppendValue(const T& value, std::vector<char>& buffer)
+{
+  const char* bytes = reinterpret_cast<const char*>(&value);
+  buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+T ReadValue(const char*& data)
+{
+  T value;
+  std::memcpy(&value, data, sizeof(T));
+  data += sizeof(T);
+  return value;
+}
+} // end anonymous namespace
+
+void SerializeNNField(const NNFieldType* const nnField, const unsigned int patchRadius, std::vector<char>& buffer)
+{
+  itk::ImageRegion<2> region = nnField->GetLargestPossibleRegion();
+
+  buffer.clear();
+  buffer.reserve(sizeof(NNFieldMagic) + 5 * sizeof(uint32_t) +
+                 region.GetNumberOfPixels() * (2 * sizeof(int32_t) + sizeof(float)));
+
+  buffer.insert(buffer.end(), NNFieldMagic, NNFieldMagic + sizeof(NNFieldMagic));
+  AppendValue(static_cast<int32_t>(region.GetIndex()[0]), buffer);
+  AppendValue(static_cast<int32_t>(region.GetIndex()[1]), buffer);
+  AppendValue(static_cast<uint32_t>(region.GetSize()[0]), buffer);
+  AppendValue(static_cast<uint32_t>(region.GetSize()[1]), buffer);
+  AppendValue(static_cast<uint32_t>(patchRadius), buffer);
+
+  itk::ImageRegionConstIterator<NNFieldType> nnFieldIterator(nnField, region);
+  while(!nnFieldIterator.IsAtEnd())
+  {
+    const Match& match = nnFieldIterator.Get();
+
+    int32_t center[2] = {-1, -1};
+    if(match.GetRegion().GetNumberOfPixels() > 0)
+    {
+      itk::Index<2> matchCenter = ITKHelpers::GetRegionCenter(match.GetRegion());
+      center[0] = static_cast<int32_t>(matchCenter[0]);
+      center[1] = static_cast<int32_t>(matchCenter[1]);
+    }
+
+    AppendValue(center[0], buffer);
+    AppendValue(center[1], buffer);
+    AppendValue(match.GetScore(), buffer);
+
+    ++nnFieldIterator;
+  }
+}
+
+unsigned int DeserializeNNField(const char* const data, const size_t size, NNFieldType* const nnField)
+{
+  const size_t headerSize = sizeof(NNFieldMagic) + 5 * sizeof(uint32_t);
+  if(size < headerSize || std::memcmp(data, NNFieldMagic, sizeof(NNFieldMagic)) != 0)
+  {
+    throw std::runtime_error("DeserializeNNField: The data is not a binary NNField!");
+  }
+
+  const char* position = data + sizeof(NNFieldMagic);
+  itk::Index<2> index = {{ReadValue<int32_t>(position), ReadValue<int32_t>(position)}};
+  itk::Size<2> regionSize = {{ReadValue<uint32_t>(position), ReadValue<uint32_t>(position)}};
+  const unsigned int patchRadius = ReadValue<uint32_t>(position);
+
+  itk::ImageRegion<2> region(index, regionSize);
+  if(size != headerSize + region.GetNumberOfPixels() * (2 * sizeof(int32_t) + sizeof(float)))
+  {
+    throw std::runtime_error("DeserializeNNField: The size of the data does not match the size of the field!");
+  }
+
+  nnField->SetRegions(region);
+  nnField->Allocate();
+
+  itk::ImageRegionIterator<NNFieldType> nnFieldIterator(nnField, region);
+  while(!nnFieldIterator.IsAtEnd())
+  {
+    int32_t x = ReadValue<int32_t>(position);
+    int32_t y = ReadValue<int32_t>(position);
+
+    Match match;
+    match.SetScore(ReadValue<float>(position));
+    if(x >= 0 && y >= 0)
+    {
+      itk::Index<2> center = {{x, y}};
+      match.SetRegion(ITKHelpers::GetRegionInRadiusAroundPixel(center, patchRadius));
+    }
+
+    nnFieldIterator.Set(match);
+    ++nnFieldIterator;
+  }
+
+  return patchRadius;
+}
+
 } // namespace PatchMatchHelpers
@@ -48,12 +48,51 @@ void GetPatchCentersImage(const NNFieldType* const matchImage, CoordinateImageTy
 template <typename NNFieldType>
 void WriteNNField(const NNFieldType* const nnField, const std::string& fileName);
 
+/** Compute the distance between 'queryRegion' and each of the 'candidateRegions', storing them in 'scores'.
+  * If the functor provides a batched Distance(queryRegion, candidateRegions, scores) it is used,
+  * otherwise Distance(candidateRegion, queryRegion) is called once per candidate. */
+template <typename TPatchDistanceFunctor>
+void BatchDistance(TPatchDistanceFunctor* const patchDistanceFunctor, const itk::ImageRegion<2>& queryRegion,
+                   const std::vector<itk::ImageRegion<2> >& candidateRegions, std::vector<float>& scores);
+
+/** Reconstruct an image from the NNField by voting: every target pixel's source patch is pasted at the target patch,
+  * and each output pixel is the weighted average of all of the patches that overlap it. If 'scoreWeightScale' is
+  * greater than zero, each patch is weighted by exp(-(score - best score) / scoreWeightScale), otherwise all patches
+  * count equally. Target pixels without a match do not vote, and 'output' pixels that receive no votes are left
+  * unchanged, so 'output' must already be allocated at the size of the NNField. If 'numberOfThreads' is 0, one
+  * thread per core is used. */
+template <typename TImage>
+void ReconstructImage(const NNFieldType* const nnField, const TImage* const sourceImage, TImage* const output,
+                      const float scoreWeightScale = 0.0f, const unsigned int numberOfThreads = 0);
+
+/** Append the indices of all of the pixels in 'region' to 'pixelIndices', in raster scan order. Unlike
+  * GetAllPixelIndices(), this works with any allocator (for example an ArenaAllocator). */
+template <typename TAllocator>
+void AppendAllPixelIndices(const itk::ImageRegion<2>& region, std::vector<itk::Index<2>, TAllocator>& pixelIndices);
+
+/** Append the indices of the pixels in 'region' of 'image' that are equal to 'value' to 'pixelIndices',
+  * in raster scan order. */
+template <typename TImage, typename TAllocator>
+void AppendPixelsWithValueInRegion(const TImage* const image, const itk::ImageRegion<2>& region,
+                                   const typename TImage::PixelType& value,
+                                   std::vector<itk::Index<2>, TAllocator>& pixelIndices);
+
 /////////// Non-template functions (defined in PatchMatchHelpers.cpp) /////////////
 
 /** Read a nearest neighbor field from a file. */
 void ReadNNField(const std::string& fileName, const unsigned int patchRadius,
                  NNFieldType* const nnField);
 
+/** Write 'nnField' into 'buffer' in the binary NNField format: the characters "NNF1", the index (int32) and
+  * size (uint32) of the field's region and the patch radius (uint32), then for every pixel in raster order the
+  * center of its match (int32 x and y, -1 -1 if it has none) and its score (float). The numbers are in the
+  * byte order of the host. */
+void SerializeNNField(const NNFieldType* const nnField, const unsigned int patchRadius, std::vector<char>& buffer);
+
+/** Read a field in the binary NNField format from the 'size' bytes at 'data' into 'nnField', and return its
+  * patch radius. */
+unsigned int DeserializeNNField(const char* const data, const size_t size, NNFieldType* const nnField);
+
 /** Get a random region inside of a specified 'region'. */
 itk::ImageRegion<2> GetRandomRegionInRegion(const itk::ImageRegion<2>& region, const unsigned int patchRadius);
 
@@ -19,8 +19,18 @@
 #ifndef PatchMatchHelpers_HPP
 #define PatchMatchHelpers_HPP
 
+// ITK
+#include "itkDefaultConvertPixelTraits.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+
 // STL
+#include <algorithm>
+#include <cassert>
+#include <cmath>
 #include <limits>
+#include <thread>
+#include <type_traits>
+#include <utility>
 
 namespace PatchMatchHelpers
 {
@@ -61,6 +71,330 @@ void WriteNNField(const NNFieldType* const nnField, const std::string& fileName)
   ITKHelpers::WriteImage(coordinateImage.GetPointer(), fileName);
 }
 
+namespace Internal
+{
+/** Determine if a patch distance functor provides the batched Distance() overload. */
+template <typename TPatchDistanceFunctor>
+class HasBatchDistance
+{
+  template <typename T>
+  static auto Test(int) -> decltype(std::declval<T&>().Distance(std::declval<const itk::ImageRegion<2>&>(),
+                                                                std::declval<const std::vector<itk::ImageRegion<2> >&>(),
+                                                                std::declval<std::vector<float>&>()),
+                                    std::true_type());
+
+  template <typename T>
+  static std::false_type Test(...);
+
+public:
+  static const bool value = decltype(Test<TPatchDistanceFunctor>(0))::value;
+};
+
+template <typename TPatchDistanceFunctor>
+void BatchDistance(TPatchDistanceFunctor* const patchDistanceFunctor, const itk::ImageRegion<2>& queryRegion,
+                   const std::vector<itk::ImageRegion<2> >& candidateRegions, std::vector<float>& scores,
+                   std::true_type)
+{
+  patchDistanceFunctor->Distance(queryRegion, candidateRegions, scores);
+}
+
+template <typename TPatchDistanceFunctor>
+void BatchDistance(TPatchDistanceFunctor* const patchDistanceFunctor, const itk::ImageRegion<2>& queryRegion,
+                   const std::vector<itk::ImageRegion<2> >& candidateRegions, std::vector<float>& scores,
+                   std::false_type)
+{
+  scores.resize(candidateRegions.size());
+  for(size_t candidateId = 0; candidateId < candidateRegions.size(); ++candidateId)
+  {
+    scores[candidateId] = patchDistanceFunctor->Distance(candidateRegions[candidateId], queryRegion);
+  }
+}
+/** Add 'weight' times each of the 'count' values of 'source' to 'accumulator'. This is kept as a plain loop over
+  * contiguous floats so that the compiler vectorizes it. */
+inline void AccumulateWeighted(float* const accumulator, const float* const source, const size_t count, const float weight)
+{
+  for(size_t i = 0; i < count; ++i)
+  {
+    accumulator[i] += weight * source[i];
+  }
+}
+
+/** Add 'weight' to each of the 'count' values of 'accumulator'. */
+inline void AccumulateConstant(float* const accumulator, const size_t count, const float weight)
+{
+  for(size_t i = 0; i < count; ++i)
+  {
+    accumulator[i] += weight;
+  }
+}
+
+/** Convert an averaged value back to a pixel component, rounding and clamping for integer components. */
+template <typename TComponent>
+TComponent ConvertComponent(const float value, std::true_type)
+{
+  float clamped = std::min(std::max(value, static_cast<float>(std::numeric_limits<TComponent>::lowest())),
+                           static_cast<float>(std::numeric_limits<TComponent>::max()));
+  return static_cast<TComponent>(std::lround(clamped));
+}
+
+template <typename TComponent>
+TComponent ConvertComponent(const float value, std::false_type)
+{
+  return static_cast<TComponent>(value);
+}
+
+/** The accumulation buffers of one thread. The thread votes for the target rows [Begin, End), whose patches
+  * cover the output rows [BufferBegin, BufferEnd), that is, the band plus an apron of a patch radius on each side. */
+struct VotingBand
+{
+  long Begin;
+  long End;
+  long BufferBegin;
+  long BufferEnd;
+
+  /** The weighted sum of the votes for each component of each pixel in the buffer rows. */
+  std::vector<float> Values;
+
+  /** The sum of the weights of the votes for each pixel in the buffer rows. */
+  std::vector<float> Weights;
+};
+} // end Internal namespace
+
+template <typename TPatchDistanceFunctor>
+void BatchDistance(TPatchDistanceFunctor* const patchDistanceFunctor, const itk::ImageRegion<2>& queryRegion,
+                   const std::vector<itk::ImageRegion<2> >& candidateRegions, std::vector<float>& scores)
+{
+  Internal::BatchDistance(patchDistanceFunctor, queryRegion, candidateRegions, scores,
+                          std::integral_constant<bool, Internal::HasBatchDistance<TPatchDistanceFunctor>::value>());
+}
+
+template <typename TImage>
+void ReconstructImage(const NNFieldType* const nnField, const TImage* const sourceImage, TImage* const output,
+                      const float scoreWeightScale, const unsigned int numberOfThreads)
+{
+  typedef typename TImage::PixelType PixelType;
+  typedef itk::DefaultConvertPixelTraits<PixelType> PixelTraitsType;
+  typedef typename PixelTraitsType::ComponentType ComponentType;
+
+  const unsigned int numberOfComponents = PixelTraitsType::GetNumberOfComponents();
+
+  itk::ImageRegion<2> targetRegion = nnField->GetLargestPossibleRegion();
+  itk::ImageRegion<2> sourceRegion = sourceImage->GetLargestPossibleRegion();
+  assert(output->GetLargestPossibleRegion() == targetRegion);
+
+  const long targetWidth = targetRegion.GetSize()[0];
+  const long targetHeight = targetRegion.GetSize()[1];
+  const long sourceWidth = sourceRegion.GetSize()[0];
+
+  if(targetWidth == 0 || targetHeight == 0)
+  {
+    return;
+  }
+
+  // Copy the source components into a float buffer once, so that the voting reads contiguous floats
+  // instead of converting every sample
+  std::vector<float> sourceBuffer(sourceRegion.GetNumberOfPixels() * numberOfComponents);
+  {
+    itk::ImageRegionConstIterator<TImage> sourceIterator(sourceImage, sourceRegion);
+    size_t componentId = 0;
+    while(!sourceIterator.IsAtEnd())
+    {
+      for(unsigned int component = 0; component < numberOfComponents; ++component)
+      {
+        sourceBuffer[componentId++] = static_cast<float>(PixelTraitsType::GetNthComponent(component, sourceIterator.Get()));
+      }
+      ++sourceIterator;
+    }
+  }
+
+  // Find the largest patch radius (for the apron) and the best score (so that the weights are relative
+  // to it and cannot all underflow)
+  const Match* const nnFieldBuffer = nnField->GetBufferPointer();
+  long patchRadius = 0;
+  float bestScore = std::numeric_limits<float>::max();
+  for(size_t pixelId = 0; pixelId < targetRegion.GetNumberOfPixels(); ++pixelId)
+  {
+    const itk::ImageRegion<2>& matchRegion = nnFieldBuffer[pixelId].GetRegion();
+    if(matchRegion.GetNumberOfPixels() > 0)
+    {
+      patchRadius = std::max(patchRadius, static_cast<long>(std::max(matchRegion.GetSize()[0], matchRegion.GetSize()[1]) / 2));
+      bestScore = std::min(bestScore, nnFieldBuffer[pixelId].GetScore());
+    }
+  }
+
+  unsigned int threadCount = numberOfThreads;
+  if(threadCount == 0)
+  {
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+  }
+  threadCount = std::min(static_cast<long>(threadCount), targetHeight);
+
+  std::vector<Internal::VotingBand> bands(threadCount);
+  for(unsigned int bandId = 0; bandId < threadCount; ++bandId)
+  {
+    Internal::VotingBand& band = bands[bandId];
+    band.Begin = targetHeight * bandId / threadCount;
+    band.End = targetHeight * (bandId + 1) / threadCount;
+    band.BufferBegin = std::max(0l, band.Begin - patchRadius);
+    band.BufferEnd = std::min(targetHeight, band.End + patchRadius);
+  }
+
+  auto vote = [&](Internal::VotingBand& band)
+  {
+    const long bufferRows = band.BufferEnd - band.BufferBegin;
+    band.Values.assign(bufferRows * targetWidth * numberOfComponents, 0.0f);
+    band.Weights.assign(bufferRows * targetWidth, 0.0f);
+
+    for(long y = band.Begin; y < band.End; ++y)
+    {
+      for(long x = 0; x < targetWidth; ++x)
+      {
+        const Match& match = nnFieldBuffer[y * targetWidth + x];
+        const itk::ImageRegion<2>& matchRegion = match.GetRegion();
+        if(matchRegion.GetNumberOfPixels() == 0)
+        {
+          continue;
+        }
+
+        float weight = 1.0f;
+        if(scoreWeightScale > 0.0f)
+        {
+          weight = std::exp(-(match.GetScore() - bestScore) / scoreWeightScale);
+          if(weight <= 0.0f)
+          {
+            continue;
+          }
+        }
+
+        // The target patch has the size of the source patch and is centered on (x,y). Clip it to the target image.
+        const long halfWidth = matchRegion.GetSize()[0] / 2;
+        const long halfHeight = matchRegion.GetSize()[1] / 2;
+        const long sourceX = matchRegion.GetIndex()[0] - sourceRegion.GetIndex()[0];
+        const long sourceY = matchRegion.GetIndex()[1] - sourceRegion.GetIndex()[1];
+
+        const long columnBegin = std::max(0l, halfWidth - x);
+        const long columnEnd = std::min(static_cast<long>(matchRegion.GetSize()[0]), targetWidth - x + halfWidth);
+        const long rowBegin = std::max(0l, halfHeight - y);
+        const long rowEnd = std::min(static_cast<long>(matchRegion.GetSize()[1]), targetHeight - y + halfHeight);
+        if(columnBegin >= columnEnd)
+        {
+          continue;
+        }
+        const size_t rowLength = columnEnd - columnBegin;
+
+        for(long row = rowBegin; row < rowEnd; ++row)
+        {
+          const long outputY = y - halfHeight + row - band.BufferBegin;
+          const long outputX = x - halfWidth + columnBegin;
+
+          Internal::AccumulateWeighted(&band.Values[(outputY * targetWidth + outputX) * numberOfComponents],
+                                       &sourceBuffer[((sourceY + row) * sourceWidth + sourceX + columnBegin) * numberOfComponents],
+                                       rowLength * numberOfComponents, weight);
+          Internal::AccumulateConstant(&band.Weights[outputY * targetWidth + outputX], rowLength, weight);
+        }
+      }
+    }
+  };
+
+  // Each output row gets votes from its own band and from the aprons of its neighbors
+  auto merge = [&](const Internal::VotingBand& outputBand)
+  {
+    std::vector<float> values(targetWidth * numberOfComponents);
+    std::vector<float> weights(targetWidth);
+
+    PixelType* const outputBuffer = output->GetBufferPointer();
+
+    for(long y = outputBand.Begin; y < outputBand.End; ++y)
+    {
+      std::fill(values.begin(), values.end(), 0.0f);
+      std::fill(weights.begin(), weights.end(), 0.0f);
+
+      for(size_t bandId = 0; bandId < bands.size(); ++bandId)
+      {
+        const Internal::VotingBand& band = bands[bandId];
+        if(y < band.BufferBegin || y >= band.BufferEnd)
+        {
+          continue;
+        }
+
+        const long bufferRow = y - band.BufferBegin;
+        Internal::AccumulateWeighted(values.data(), &band.Values[bufferRow * targetWidth * numberOfComponents],
+                                     values.size(), 1.0f);
+        Internal::AccumulateWeighted(weights.data(), &band.Weights[bufferRow * targetWidth], weights.size(), 1.0f);
+      }
+
+      for(long x = 0; x < targetWidth; ++x)
+      {
+        if(weights[x] <= 0.0f)
+        {
+          continue;
+        }
+
+        PixelType& pixel = outputBuffer[y * targetWidth + x];
+        for(unsigned int component = 0; component < numberOfComponents; ++component)
+        {
+          PixelTraitsType::SetNthComponent(component, pixel, Internal::ConvertComponent<ComponentType>(
+                                             values[x * numberOfComponents + component] / weights[x],
+                                             std::integral_constant<bool, std::numeric_limits<ComponentType>::is_integer>()));
+        }
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for(unsigned int bandId = 0; bandId < threadCount; ++bandId)
+  {
+    threads.push_back(std::thread(vote, std::ref(bands[bandId])));
+  }
+  for(size_t threadId = 0; threadId < threads.size(); ++threadId)
+  {
+    threads[threadId].join();
+  }
+
+  threads.clear();
+  for(unsigned int bandId = 0; bandId < threadCount; ++bandId)
+  {
+    threads.push_back(std::thread(merge, std::cref(bands[bandId])));
+  }
+  for(size_t threadId = 0; threadId < threads.size(); ++threadId)
+  {
+    threads[threadId].join();
+  }
+}
+
+template <typename TAllocator>
+void AppendAllPixelIndices(const itk::ImageRegion<2>& region, std::vector<itk::Index<2>, TAllocator>& pixelIndices)
+{
+  const itk::IndexValueType xEnd = region.GetIndex()[0] + static_cast<itk::IndexValueType>(region.GetSize()[0]);
+  const itk::IndexValueType yEnd = region.GetIndex()[1] + static_cast<itk::IndexValueType>(region.GetSize()[1]);
+
+  for(itk::IndexValueType y = region.GetIndex()[1]; y < yEnd; ++y)
+  {
+    for(itk::IndexValueType x = region.GetIndex()[0]; x < xEnd; ++x)
+    {
+      itk::Index<2> pixel = {{x, y}};
+      pixelIndices.push_back(pixel);
+    }
+  }
+}
+
+template <typename TImage, typename TAllocator>
+void AppendPixelsWithValueInRegion(const TImage* const image, const itk::ImageRegion<2>& region,
+                                   const typename TImage::PixelType& value,
+                                   std::vector<itk::Index<2>, TAllocator>& pixelIndices)
+{
+  itk::ImageRegionConstIteratorWithIndex<TImage> imageIterator(image, region);
+
+  while(!imageIterator.IsAtEnd())
+  {
+    if(imageIterator.Get() == value)
+    {
+      pixelIndices.push_back(imageIterator.GetIndex());
+    }
+    ++imageIterator;
+  }
+}
+
 } // end PatchMatchHelpers namespace
 
 #endif
@@ -0,0 +1,148 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef PatchMatchSequence_H
+#define PatchMatchSequence_H
+
+// ITK
+#include "itkImage.h"
+#include "itkCovariantVector.h"
+
+// STL
+#include <vector>
+
+// Custom
+#include "NNField.h"
+#include "PatchMatch.h"
+
+/** This class computes the NNField of each frame of a video against a fixed source (reference) image.
+  * The first frame is computed from a random initialization. Every later frame starts from the previous
+  * frame's NNField (optionally motion compensated by a flow field), only the pixels whose target patch
+  * changed are re-scored, and only those pixels are refined, with fewer iterations.
+  * The patch distance functor of the random search functor must provide SetTargetImage(), since the
+  * target image changes from frame to frame. */
+template <typename TImage, typename TPropagation, typename TRandomSearch>
+class PatchMatchSequence
+{
+public:
+  /** For each pixel of the current frame, the displacement to the same point in the previous frame. */
+  typedef itk::Image<itk::CovariantVector<float, 2>, 2> FlowImageType;
+
+  typedef PatchMatch<TImage, TPropagation, TRandomSearch> PatchMatchType;
+
+  /** Compute the NNField of the next frame of the sequence. The 'backwardFlow' is optional.
+    * The returned field is a new image for every frame, so it may be kept while later frames are processed. */
+  NNFieldType::Pointer ProcessFrame(TImage* const frame, const FlowImageType* const backwardFlow = nullptr);
+
+  /** Start the next frame from a random initialization. */
+  void Reset()
+  {
+    this->PreviousFrame = nullptr;
+    this->PreviousNNField = nullptr;
+  }
+
+  /** Set the image from which matches are drawn for every frame. */
+  void SetSourceImage(TImage* const sourceImage)
+  {
+    this->SourceImage = sourceImage;
+  }
+
+  /** Set the patch radius. */
+  void SetPatchRadius(const unsigned int patchRadius)
+  {
+    this->PatchRadius = patchRadius;
+  }
+
+  /** Set the number of iterations to perform on a frame that starts from a random initialization. */
+  void SetIterations(const unsigned int iterations)
+  {
+    this->Iterations = iterations;
+  }
+
+  /** Set the number of iterations to perform on a frame that starts from the previous frame's NNField. */
+  void SetWarmStartIterations(const unsigned int warmStartIterations)
+  {
+    this->WarmStartIterations = warmStartIterations;
+  }
+
+  /** Set the largest sum of squared component differences at which a pixel is still considered unchanged
+    * from the previous frame. */
+  void SetChangeThreshold(const float changeThreshold)
+  {
+    this->ChangeThreshold = changeThreshold;
+  }
+
+  /** Set the propagation functor. */
+  void SetPropagationFunctor(TPropagation* const propagationFunctor)
+  {
+    this->PropagationFunctor = propagationFunctor;
+  }
+
+  /** Set the random search functor. */
+  void SetRandomSearchFunctor(TRandomSearch* const randomSearchFunctor)
+  {
+    this->RandomSearchFunctor = randomSearchFunctor;
+  }
+
+  /** Get the number of pixels that were re-scored and refined in the last frame. */
+  size_t GetNumberOfChangedPixels() const
+  {
+    return this->NumberOfChangedPixels;
+  }
+
+private:
+  /** The image from which matches are drawn. */
+  TImage* SourceImage = nullptr;
+
+  /** The radius of the patches to compare. */
+  unsigned int PatchRadius = 5;
+
+  /** The number of iterations to perform on a frame that starts from a random initialization. */
+  unsigned int Iterations = 5;
+
+  /** The number of iterations to perform on a frame that starts from the previous frame's NNField. */
+  unsigned int WarmStartIterations = 2;
+
+  /** The largest per-pixel squared difference that is not considered a change. */
+  float ChangeThreshold = 0.0f;
+
+  TPropagation* PropagationFunctor = nullptr;
+
+  TRandomSearch* RandomSearchFunctor = nullptr;
+
+  /** The last frame that was processed. */
+  typename TImage::Pointer PreviousFrame;
+
+  /** The NNField of the last frame that was processed. */
+  NNFieldType::Pointer PreviousNNField;
+
+  /** The number of pixels that were re-scored and refined in the last frame. */
+  size_t NumberOfChangedPixels = 0;
+
+  /** Create the initial NNField of 'frame' from the previous frame's NNField and return the target pixels
+    * whose patches changed. */
+  std::vector<itk::Index<2> > WarmStart(TImage* const frame, const FlowImageType* const backwardFlow,
+                                        NNFieldType* const nnField);
+
+  /** Compute a summed area table of the pixels that differ between 'frame' and the PreviousFrame. */
+  void ComputeChangedPixelTable(TImage* const frame, std::vector<unsigned int>& changedPixelTable);
+};
+
+#include "PatchMatchSequence.hpp"
+
+#endif
@@ -0,0 +1,218 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef PatchMatchSequence_HPP
+#define PatchMatchSequence_HPP
+
+#include "PatchMatchSequence.h"
+
+// ITK
+#include "itkDefaultConvertPixelTraits.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIteratorWithIndex.h"
+
+// STL
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+// Submodules
+#include <ITKHelpers/ITKHelpers.h>
+
+// Custom
+#include "PatchMatchHelpers.h"
+
+template <typename TImage, typename TPropagation, typename TRandomSearch>
+NNFieldType::Pointer PatchMatchSequence<TImage, TPropagation, TRandomSearch>::
+ProcessFrame(TImage* const frame, const FlowImageType* const backwardFlow)
+{
+  assert(frame);
+  assert(this->SourceImage);
+  assert(this->PropagationFunctor);
+  assert(this->RandomSearchFunctor);
+
+  this->RandomSearchFunctor->GetPatchDistanceFunctor()->SetSourceImage(this->SourceImage);
+  this->RandomSearchFunctor->GetPatchDistanceFunctor()->SetTargetImage(frame);
+
+  PatchMatchType patchMatch;
+  patchMatch.SetSourceImage(this->SourceImage);
+  patchMatch.SetTargetImage(frame);
+  patchMatch.SetPatchRadius(this->PatchRadius);
+  patchMatch.SetPropagationFunctor(this->PropagationFunctor);
+  patchMatch.SetRandomSearchFunctor(this->RandomSearchFunctor);
+  patchMatch.SetWriteIntermediateFields(false);
+
+  NNFieldType::Pointer nnField = NNFieldType::New();
+  patchMatch.SetInitialNNField(nnField);
+
+  bool warmStart = this->PreviousFrame && this->PreviousNNField &&
+                   this->PreviousFrame->GetLargestPossibleRegion() == frame->GetLargestPossibleRegion();
+
+  if(warmStart)
+  {
+    nnField->SetRegions(frame->GetLargestPossibleRegion());
+    nnField->Allocate();
+
+    std::vector<itk::Index<2> > changedPixels = WarmStart(frame, backwardFlow, nnField);
+    this->NumberOfChangedPixels = changedPixels.size();
+
+    // If nothing changed, the previous field is already the answer
+    if(changedPixels.size() > 0)
+    {
+      patchMatch.SetTargetPixels(changedPixels);
+      patchMatch.SetIterations(this->WarmStartIterations);
+      patchMatch.Compute();
+    }
+  }
+  else
+  {
+    // The NNField is empty, so Compute() randomly initializes it
+    patchMatch.SetIterations(this->Iterations);
+    patchMatch.Compute();
+
+    this->NumberOfChangedPixels =
+        ITKHelpers::GetInternalRegion(frame->GetLargestPossibleRegion(), this->PatchRadius).GetNumberOfPixels();
+  }
+
+  this->PreviousFrame = frame;
+  this->PreviousNNField = nnField;
+
+  return nnField;
+}
+
+template <typename TImage, typename TPropagation, typename TRandomSearch>
+std::vector<itk::Index<2> > PatchMatchSequence<TImage, TPropagation, TRandomSearch>::
+WarmStart(TImage* const frame, const FlowImageType* const backwardFlow, NNFieldType* const nnField)
+{
+  std::vector<unsigned int> changedPixelTable;
+  ComputeChangedPixelTable(frame, changedPixelTable);
+
+  itk::ImageRegion<2> fullRegion = frame->GetLargestPossibleRegion();
+  itk::ImageRegion<2> internalRegion = ITKHelpers::GetInternalRegion(fullRegion, this->PatchRadius);
+  itk::ImageRegion<2> sourceInternalRegion =
+      ITKHelpers::GetInternalRegion(this->SourceImage->GetLargestPossibleRegion(), this->PatchRadius);
+
+  const long tableWidth = fullRegion.GetSize()[0] + 1;
+  const long patchSideLength = 2 * this->PatchRadius + 1;
+
+  std::vector<itk::Index<2> > changedPixels;
+
+  itk::ImageRegionIteratorWithIndex<NNFieldType> nnFieldIterator(nnField, internalRegion);
+
+  while(!nnFieldIterator.IsAtEnd())
+  {
+    itk::Index<2> targetPixel = nnFieldIterator.GetIndex();
+
+    // Find where this pixel was in the previous frame
+    itk::Index<2> previousPixel = targetPixel;
+    if(backwardFlow)
+    {
+      FlowImageType::PixelType flow = backwardFlow->GetPixel(targetPixel);
+      for(unsigned int dimension = 0; dimension < 2; ++dimension)
+      {
+        previousPixel[dimension] = targetPixel[dimension] + std::lround(flow[dimension]);
+        previousPixel[dimension] = std::max(previousPixel[dimension], internalRegion.GetIndex()[dimension]);
+        previousPixel[dimension] = std::min(previousPixel[dimension], internalRegion.GetIndex()[dimension] +
+                                            static_cast<long>(internalRegion.GetSize()[dimension]) - 1);
+      }
+    }
+
+    Match match = this->PreviousNNField->GetPixel(previousPixel);
+
+    // If the pixel moved, its match has to be re-scored against the new patch content
+    bool changed = (previousPixel != targetPixel) || (match.GetRegion().GetNumberOfPixels() == 0);
+
+    if(!changed)
+    {
+      // Count the changed pixels in the target patch using the summed area table
+      long x0 = targetPixel[0] - this->PatchRadius - fullRegion.GetIndex()[0];
+      long y0 = targetPixel[1] - this->PatchRadius - fullRegion.GetIndex()[1];
+      long x1 = x0 + patchSideLength;
+      long y1 = y0 + patchSideLength;
+
+      unsigned int numberOfChangedPatchPixels = changedPixelTable[y1 * tableWidth + x1] -
+                                                changedPixelTable[y0 * tableWidth + x1] -
+                                                changedPixelTable[y1 * tableWidth + x0] +
+                                                changedPixelTable[y0 * tableWidth + x0];
+      changed = numberOfChangedPatchPixels > 0;
+    }
+
+    if(changed)
+    {
+      if(match.GetRegion().GetNumberOfPixels() == 0)
+      {
+        match.SetRegion(PatchMatchHelpers::GetRandomRegionInRegion(sourceInternalRegion, this->PatchRadius));
+      }
+
+      itk::ImageRegion<2> targetRegion = ITKHelpers::GetRegionInRadiusAroundPixel(targetPixel, this->PatchRadius);
+      match.SetScore(this->RandomSearchFunctor->GetPatchDistanceFunctor()->Distance(match.GetRegion(), targetRegion));
+
+      changedPixels.push_back(targetPixel);
+    }
+
+    nnFieldIterator.Set(match);
+    ++nnFieldIterator;
+  }
+
+  return changedPixels;
+}
+
+template <typename TImage, typename TPropagation, typename TRandomSearch>
+void PatchMatchSequence<TImage, TPropagation, TRandomSearch>::
+ComputeChangedPixelTable(TImage* const frame, std::vector<unsigned int>& changedPixelTable)
+{
+  typedef itk::DefaultConvertPixelTraits<typename TImage::PixelType> PixelTraitsType;
+
+  itk::ImageRegion<2> region = frame->GetLargestPossibleRegion();
+  const size_t width = region.GetSize()[0];
+  const size_t height = region.GetSize()[1];
+  const size_t tableWidth = width + 1;
+
+  // The table has an extra leading row and column of zeros so that patch sums need no special cases
+  changedPixelTable.assign(tableWidth * (height + 1), 0);
+
+  itk::ImageRegionConstIterator<TImage> frameIterator(frame, region);
+  itk::ImageRegionConstIterator<TImage> previousFrameIterator(this->PreviousFrame, region);
+
+  for(size_t y = 0; y < height; ++y)
+  {
+    unsigned int rowSum = 0;
+    for(size_t x = 0; x < width; ++x)
+    {
+      float squaredDifference = 0.0f;
+      for(unsigned int component = 0; component < PixelTraitsType::GetNumberOfComponents(); ++component)
+      {
+        float difference = static_cast<float>(PixelTraitsType::GetNthComponent(component, frameIterator.Get())) -
+                           static_cast<float>(PixelTraitsType::GetNthComponent(component, previousFrameIterator.Get()));
+        squaredDifference += difference * difference;
+      }
+
+      if(squaredDifference > this->ChangeThreshold)
+      {
+        rowSum++;
+      }
+
+      changedPixelTable[(y + 1) * tableWidth + x + 1] = changedPixelTable[y * tableWidth + x + 1] + rowSum;
+
+      ++frameIterator;
+      ++previousFrameIterator;
+    }
+  }
+}
+
+#endif
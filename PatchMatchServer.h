@@ -0,0 +1,210 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#ifndef PatchMatchServer_H
+#define PatchMatchServer_H
+
+// ITK
+#include "itkImage.h"
+
+// STL
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Custom
+#include "BatchSSD.h"
+#include "BoundedQueue.h"
+#include "NNField.h"
+#include "PatchMatch.h"
+#include "PatchMatchServerProtocol.h"
+#include "Propagator.h"
+#include "RandomSearch.h"
+
+/** A long running process that computes NNFields for local clients, so that they do not pay for process start up,
+  * ITK factory registration and image decoding on every job. The server listens on a Unix domain socket for
+  * PatchMatchServerProtocol requests, whose images are files or POSIX shared memory buffers, and answers each
+  * one with the field in the binary NNField format. A thread accepts the connections and puts them in an admission
+  * queue, from which a fixed pool of worker threads takes them. A connection that arrives while the queue is full
+  * is answered StatusBusy at once, so the number of jobs in the server is bounded. Each worker keeps its distance
+  * functor, propagator, random search and PatchMatch object between jobs, and decoded image files are kept in a
+  * cache (checked against the modification time of the file), so repeated source images are not decoded again.
+  * TImage must be an itk::Image of fixed size pixels, which is also the layout expected in shared memory. */
+template <typename TImage, typename TPatchDistanceFunctor = BatchSSD<TImage> >
+class PatchMatchServer
+{
+public:
+  typedef Propagator<TPatchDistanceFunctor> PropagatorType;
+  typedef RandomSearch<TImage, TPatchDistanceFunctor> RandomSearchType;
+  typedef PatchMatch<TImage, PropagatorType, RandomSearchType> PatchMatchType;
+
+  ~PatchMatchServer()
+  {
+    Stop();
+  }
+
+  /** Start listening on 'socketPath' and return. The jobs are processed on the server's own threads. */
+  void Start(const std::string& socketPath);
+
+  /** Stop accepting connections, finish the jobs that were already admitted and remove the socket file. */
+  void Stop();
+
+  /** Set the number of worker threads. 0 (the default) uses one per hardware thread. */
+  void SetNumberOfThreads(const unsigned int numberOfThreads)
+  {
+    this->NumberOfThreads = numberOfThreads;
+  }
+
+  /** Set the number of connections that can wait for a worker. 0 (the default) uses twice the number of threads. */
+  void SetQueueCapacity(const unsigned int queueCapacity)
+  {
+    this->QueueCapacity = queueCapacity;
+  }
+
+  /** Set how long, in milliseconds, the server waits for a client that stops sending its request or reading the
+    * response before it drops the connection and counts the job as failed. 0 waits forever. */
+  void SetConnectionTimeout(const unsigned int connectionTimeout)
+  {
+    this->ConnectionTimeout = connectionTimeout;
+  }
+
+  /** Set the number of decoded image files to keep. */
+  void SetImageCacheSize(const unsigned int imageCacheSize)
+  {
+    this->ImageCacheSize = imageCacheSize;
+  }
+
+  bool IsRunning() const
+  {
+    return this->ListenSocket >= 0;
+  }
+
+  /** Get the number of jobs answered with a field since the server was created. */
+  size_t GetNumberOfCompletedJobs() const
+  {
+    return this->NumberOfCompletedJobs;
+  }
+
+  /** Get the number of jobs answered StatusError, and of connections that broke or timed out before the
+    * response was delivered. */
+  size_t GetNumberOfFailedJobs() const
+  {
+    return this->NumberOfFailedJobs;
+  }
+
+  /** Get the number of connections answered StatusBusy because the admission queue was full. */
+  size_t GetNumberOfRejectedJobs() const
+  {
+    return this->NumberOfRejectedJobs;
+  }
+
+  /** Get the number of image files that were served from the cache instead of being decoded. */
+  size_t GetNumberOfCacheHits() const
+  {
+    return this->NumberOfCacheHits;
+  }
+
+private:
+  /** The objects that one worker thread uses for every job it processes. */
+  struct Worker
+  {
+    TPatchDistanceFunctor PatchDistanceFunctor;
+
+    PropagatorType PropagationFunctor;
+
+    RandomSearchType RandomSearchFunctor;
+
+    PatchMatchType Matcher;
+  };
+
+  /** A decoded image file. */
+  struct CachedImage
+  {
+    typename TImage::Pointer Image;
+
+    /** The modification time of the file when it was decoded, in nanoseconds. */
+    int64_t ModificationTime = 0;
+
+    /** The value of the CacheClock when the image was last used. */
+    uint64_t LastUse = 0;
+  };
+
+  unsigned int NumberOfThreads = 0;
+
+  unsigned int QueueCapacity = 0;
+
+  unsigned int ImageCacheSize = 16;
+
+  unsigned int ConnectionTimeout = 30000;
+
+  std::string SocketPath;
+
+  int ListenSocket = -1;
+
+  std::thread AcceptThread;
+
+  std::vector<std::thread> WorkerThreads;
+
+  std::vector<std::unique_ptr<Worker> > Workers;
+
+  /** The accepted connections waiting for a worker. */
+  std::unique_ptr<BoundedQueue<int> > Connections;
+
+  std::mutex CacheMutex;
+
+  std::map<std::string, CachedImage> ImageCache;
+
+  /** A counter that orders the uses of the cached images, to find the least recently used one. */
+  uint64_t CacheClock = 0;
+
+  std::atomic<size_t> NumberOfCompletedJobs{0};
+
+  std::atomic<size_t> NumberOfFailedJobs{0};
+
+  std::atomic<size_t> NumberOfRejectedJobs{0};
+
+  std::atomic<size_t> NumberOfCacheHits{0};
+
+  /** Accept connections until the listening socket is shut down. */
+  void Accept();
+
+  /** Process the connections of the queue until it is closed and empty. */
+  void Serve(Worker& worker);
+
+  /** Read the request of 'connection', compute its field and answer it. */
+  void ProcessConnection(Worker& worker, const int connection);
+
+  /** Compute the field of 'request' in the binary NNField format. */
+  void Match(Worker& worker, const PatchMatchServerProtocol::MatchRequest& request, std::vector<char>& field);
+
+  /** Get an image file, from the cache if it has not changed since it was decoded. */
+  typename TImage::Pointer GetImageFile(const std::string& fileName);
+
+  /** Copy the pixels of a shared memory object into a new image. */
+  typename TImage::Pointer GetSharedMemoryImage(const std::string& name, const uint32_t width, const uint32_t height);
+};
+
+#include "PatchMatchServer.hpp"
+
+#endif
@@ -0,0 +1,342 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#ifndef PatchMatchServer_HPP
+#define PatchMatchServer_HPP
+
+#include "PatchMatchServer.h"
+
+// ITK
+#include "itkImageFileReader.h"
+
+// STL
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+// POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Custom
+#include "PatchMatchHelpers.h"
+
+template <typename TImage, typename TPatchDistanceFunctor>
+void PatchMatchServer<TImage, TPatchDistanceFunctor>::Start(const std::string& socketPath)
+{
+  if(IsRunning())
+  {
+    throw std::runtime_error("PatchMatchServer: The server is already running!");
+  }
+
+  const unsigned int numberOfThreads = this->NumberOfThreads > 0 ? this->NumberOfThreads :
+                                       std::max(1u, std::thread::hardware_concurrency());
+  const unsigned int queueCapacity = this->QueueCapacity > 0 ? this->QueueCapacity : 2 * numberOfThreads;
+
+  this->ListenSocket = PatchMatchServerProtocol::Listen(socketPath, queueCapacity);
+  this->SocketPath = socketPath;
+
+  this->Connections.reset(new BoundedQueue<int>(queueCapacity));
+
+  while(this->Workers.size() < numberOfThreads)
+  {
+    std::unique_ptr<Worker> worker(new Worker);
+
+    worker->PropagationFunctor.SetPatchDistanceFunctor(&worker->PatchDistanceFunctor);
+    worker->RandomSearchFunctor.SetPatchDistanceFunctor(&worker->PatchDistanceFunctor);
+
+    worker->Matcher.SetPropagationFunctor(&worker->PropagationFunctor);
+    worker->Matcher.SetRandomSearchFunctor(&worker->RandomSearchFunctor);
+    worker->Matcher.SetWriteIntermediateFields(false);
+    worker->Matcher.SetVerbose(false);
+
+    this->Workers.push_back(std::move(worker));
+  }
+
+  for(unsigned int workerId = 0; workerId < numberOfThreads; ++workerId)
+  {
+    Worker* worker = this->Workers[workerId].get();
+    this->WorkerThreads.push_back(std::thread([this, worker]() { Serve(*worker); }));
+  }
+
+  this->AcceptThread = std::thread([this]() { Accept(); });
+}
+
+template <typename TImage, typename TPatchDistanceFunctor>
+void PatchMatchServer<TImage, TPatchDistanceFunctor>::Stop()
+{
+  if(!IsRunning())
+  {
+    return;
+  }
+
+  // Shutting the listening socket down wakes up the blocked accept()
+  shutdown(this->ListenSocket, SHUT_RDWR);
+  this->AcceptThread.join();
+  close(this->ListenSocket);
+  this->ListenSocket = -1;
+
+  // The workers finish the admitted connections before they see that the queue is closed
+  this->Connections->Close();
+  for(size_t threadId = 0; threadId < this->WorkerThreads.size(); ++threadId)
+  {
+    this->WorkerThreads[threadId].join();
+  }
+  this->WorkerThreads.clear();
+
+  unlink(this->SocketPath.c_str());
+}
+
+template <typename TImage, typename TPatchDistanceFunctor>
+void PatchMatchServer<TImage, TPatchDistanceFunctor>::Accept()
+{
+  while(true)
+  {
+    int connection = accept(this->ListenSocket, nullptr, nullptr);
+    if(connection < 0)
+    {
+      if(errno == EINTR || errno == ECONNABORTED)
+      {
+        continue;
+      }
+      return;
+    }
+
+    // A stalled client must not hold a worker, or this thread when it is turned away, forever
+    PatchMatchServerProtocol::SetTimeout(connection, this->ConnectionTimeout);
+
+    if(!this->Connections->TryPush(connection))
+    {
+      PatchMatchServerProtocol::MatchResponse response;
+      response.Status = PatchMatchServerProtocol::StatusBusy;
+      PatchMatchServerProtocol::WriteResponse(connection, response);
+      close(connection);
+      this->NumberOfRejectedJobs++;
+    }
+  }
+}
+
+template <typename TImage, typename TPatchDistanceFunctor>
+void PatchMatchServer<TImage, TPatchDistanceFunctor>::Serve(Worker& worker)
+{
+  int connection = -1;
+  while(this->Connections->Pop(connection))
+  {
+    ProcessConnection(worker, connection);
+    close(connection);
+  }
+}
+
+template <typename TImage, typename TPatchDistanceFunctor>
+void PatchMatchServer<TImage, TPatchDistanceFunctor>::ProcessConnection(Worker& worker, const int connection)
+{
+  // A request that is incomplete when the connection breaks or times out is not answered
+  PatchMatchServerProtocol::MatchRequest request;
+  if(!PatchMatchServerProtocol::ReadRequest(connection, request))
+  {
+    this->NumberOfFailedJobs++;
+    return;
+  }
+
+  PatchMatchServerProtocol::MatchResponse response;
+  try
+  {
+    Match(worker, request, response.Payload);
+    response.Status = PatchMatchServerProtocol::StatusSuccess;
+  }
+  catch(const std::exception& exception)
+  {
+    std::string message = exception.what();
+    response.Status = PatchMatchServerProtocol::StatusError;
+    response.Payload.assign(message.begin(), message.end());
+  }
+
+  // A field that the client did not receive is a failed job too
+  if(PatchMatchServerProtocol::WriteResponse(connection, response) &&
+     response.Status == PatchMatchServerProtocol::StatusSuccess)
+  {
+    this->NumberOfCompletedJobs++;
+  }
+  else
+  {
+    this->NumberOfFailedJobs++;
+  }
+}
+
+template <typename TImage, typename TPatchDistanceFunctor>
+void PatchMatchServer<TImage, TPatchDistanceFunctor>::Match(Worker& worker,
+                                                            const PatchMatchServerProtocol::MatchRequest& request,
+                                                            std::vector<char>& field)
+{
+  if(request.PatchRadius == 0 || request.Iterations == 0)
+  {
+    throw std::runtime_error("PatchMatchServer: The patch radius and the number of iterations must be positive!");
+  }
+
+  typename TImage::Pointer sourceImage;
+  typename TImage::Pointer targetImage;
+  if(request.ImageSource == PatchMatchServerProtocol::ImageFiles)
+  {
+    sourceImage = GetImageFile(request.SourceName);
+    targetImage = request.TargetName.empty() ? sourceImage : GetImageFile(request.TargetName);
+  }
+  else if(request.ImageSource == PatchMatchServerProtocol::SharedMemoryImages)
+  {
+    sourceImage = GetSharedMemoryImage(request.SourceName, request.SourceWidth, request.SourceHeight);
+    targetImage = request.TargetName.empty() ? sourceImage :
+                  GetSharedMemoryImage(request.TargetName, request.TargetWidth, request.TargetHeight);
+  }
+  else
+  {
+    throw std::runtime_error("PatchMatchServer: Unknown image source!");
+  }
+
+  const unsigned int patchRadius = request.PatchRadius;
+  itk::ImageRegion<2> sourceInternalRegion = ITKHelpers::GetInternalRegion(sourceImage->GetLargestPossibleRegion(),
+                                                                            patchRadius);
+  itk::ImageRegion<2> targetInternalRegion = ITKHelpers::GetInternalRegion(targetImage->GetLargestPossibleRegion(),
+                                                                            patchRadius);
+  if(sourceInternalRegion.GetNumberOfPixels() == 0 || targetInternalRegion.GetNumberOfPixels() == 0)
+  {
+    throw std::runtime_error("PatchMatchServer: The images must be larger than a patch!");
+  }
+
+  worker.PatchDistanceFunctor.SetSourceImage(sourceImage);
+  worker.PatchDistanceFunctor.SetTargetImage(targetImage);
+  worker.PropagationFunctor.SetPatchRadius(patchRadius);
+  worker.RandomSearchFunctor.SetPatchRadius(patchRadius);
+
+  worker.Matcher.SetSourceImage(sourceImage);
+  worker.Matcher.SetTargetImage(targetImage);
+  worker.Matcher.SetPatchRadius(patchRadius);
+  worker.Matcher.SetIterations(request.Iterations);
+  worker.Matcher.ResetNNField();
+  worker.Matcher.Compute();
+
+  PatchMatchHelpers::SerializeNNField(worker.Matcher.GetNNField(), patchRadius, field);
+}
+
+template <typename TImage, typename TPatchDistanceFunctor>
+typename TImage::Pointer PatchMatchServer<TImage, TPatchDistanceFunctor>::GetImageFile(const std::string& fileName)
+{
+  struct stat fileStatus;
+  if(stat(fileName.c_str(), &fileStatus) != 0)
+  {
+    throw std::runtime_error("PatchMatchServer: Could not find " + fileName + "!");
+  }
+  const int64_t modificationTime = static_cast<int64_t>(fileStatus.st_mtim.tv_sec) * 1000000000 +
+                                   fileStatus.st_mtim.tv_nsec;
+
+  {
+    std::lock_guard<std::mutex> lock(this->CacheMutex);
+    typename std::map<std::string, CachedImage>::iterator cachedImage = this->ImageCache.find(fileName);
+    if(cachedImage != this->ImageCache.end() && cachedImage->second.ModificationTime == modificationTime)
+    {
+      cachedImage->second.LastUse = ++this->CacheClock;
+      this->NumberOfCacheHits++;
+      return cachedImage->second.Image;
+    }
+  }
+
+  // The file is decoded outside of the lock so that the other workers are not held up
+  typedef itk::ImageFileReader<TImage> ReaderType;
+  typename ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName(fileName);
+  reader->Update();
+
+  typename TImage::Pointer image = reader->GetOutput();
+  if(!image)
+  {
+    throw std::runtime_error("PatchMatchServer: Could not read " + fileName + "!");
+  }
+  image->DisconnectPipeline();
+
+  if(this->ImageCacheSize > 0)
+  {
+    std::lock_guard<std::mutex> lock(this->CacheMutex);
+
+    if(this->ImageCache.size() >= this->ImageCacheSize && this->ImageCache.find(fileName) == this->ImageCache.end())
+    {
+      typename std::map<std::string, CachedImage>::iterator leastRecentlyUsed =
+          std::min_element(this->ImageCache.begin(), this->ImageCache.end(),
+                           [](const typename std::map<std::string, CachedImage>::value_type& a,
+                              const typename std::map<std::string, CachedImage>::value_type& b)
+                           { return a.second.LastUse < b.second.LastUse; });
+      this->ImageCache.erase(leastRecentlyUsed);
+    }
+
+    CachedImage& cachedImage = this->ImageCache[fileName];
+    cachedImage.Image = image;
+    cachedImage.ModificationTime = modificationTime;
+    cachedImage.LastUse = ++this->CacheClock;
+  }
+
+  return image;
+}
+
+template <typename TImage, typename TPatchDistanceFunctor>
+typename TImage::Pointer PatchMatchServer<TImage, TPatchDistanceFunctor>::
+GetSharedMemoryImage(const std::string& name, const uint32_t width, const uint32_t height)
+{
+  typedef typename TImage::PixelType PixelType;
+  const size_t numberOfBytes = static_cast<size_t>(width) * height * sizeof(PixelType);
+  if(numberOfBytes == 0)
+  {
+    throw std::runtime_error("PatchMatchServer: The shared memory image " + name + " is empty!");
+  }
+
+  int descriptor = shm_open(name.c_str(), O_RDONLY, 0);
+  if(descriptor < 0)
+  {
+    throw std::runtime_error("PatchMatchServer: Could not open the shared memory " + name + "!");
+  }
+
+  struct stat memoryStatus;
+  if(fstat(descriptor, &memoryStatus) != 0 || static_cast<size_t>(memoryStatus.st_size) < numberOfBytes)
+  {
+    close(descriptor);
+    throw std::runtime_error("PatchMatchServer: The shared memory " + name + " is smaller than the image!");
+  }
+
+  void* memory = mmap(nullptr, numberOfBytes, PROT_READ, MAP_SHARED, descriptor, 0);
+  close(descriptor);
+  if(memory == MAP_FAILED)
+  {
+    throw std::runtime_error("PatchMatchServer: Could not map the shared memory " + name + "!");
+  }
+
+  // The client may reuse its buffer as soon as it has the answer, so the pixels are copied
+  itk::Index<2> corner = {{0, 0}};
+  itk::Size<2> size = {{width, height}};
+  typename TImage::Pointer image = TImage::New();
+  image->SetRegions(itk::ImageRegion<2>(corner, size));
+  image->Allocate();
+  std::memcpy(image->GetBufferPointer(), memory, numberOfBytes);
+
+  munmap(memory, numberOfBytes);
+
+  return image;
+}
+
+#endif
@@ -0,0 +1,260 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#include "PatchMatchServerProtocol.h"
+
+// STL
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+// POSIX
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace PatchMatchServerProtocol
+{
+
+namespace
+{
+const uint32_t RequestMagic = 0x514d5050; // "PPMQ"
+const uint32_t ResponseMagic = 0x534d5050; // "PPMS"
+
+/** The longest string accepted, which is more than any path. */
+const uint32_t MaximumStringLength = 64 * 1024;
+
+/** The largest payload accepted, which is far more than the field of any image that fits in memory. */
+const uint32_t MaximumPayloadLength = 0xFFFFFFFF;
+
+bool WriteAll(const int socket, const void* const data, const size_t size)
+{
+  const char* position = static_cast<const char*>(data);
+  size_t remaining = size;
+  while(remaining > 0)
+  {
+    // A peer that has gone away must not kill the process with SIGPIPE
+    ssize_t written = send(socket, position, remaining, MSG_NOSIGNAL);
+    if(written < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if(written <= 0)
+    {
+      return false;
+    }
+    position += written;
+    remaining -= written;
+  }
+  return true;
+}
+
+bool ReadAll(const int socket, void* const data, const size_t size)
+{
+  char* position = static_cast<char*>(data);
+  size_t remaining = size;
+  while(remaining > 0)
+  {
+    ssize_t numberOfBytesRead = recv(socket, position, remaining, 0);
+    if(numberOfBytesRead < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if(numberOfBytesRead <= 0)
+    {
+      return false;
+    }
+    position += numberOfBytesRead;
+    remaining -= numberOfBytesRead;
+  }
+  return true;
+}
+
+bool WriteUInt32(const int socket, const uint32_t value)
+{
+  return WriteAll(socket, &value, sizeof(value));
+}
+
+bool ReadUInt32(const int socket, uint32_t& value)
+{
+  return ReadAll(socket, &value, sizeof(value));
+}
+
+bool WriteBytes(const int socket, const char* const data, const size_t size)
+{
+  return size <= MaximumPayloadLength && WriteUInt32(socket, static_cast<uint32_t>(size)) && WriteAll(socket, data, size);
+}
+
+template <typename TContainer>
+bool ReadBytes(const int socket, const uint32_t maximumLength, TContainer& bytes)
+{
+  uint32_t length = 0;
+  if(!ReadUInt32(socket, length) || length > maximumLength)
+  {
+    return false;
+  }
+  bytes.resize(length);
+  return length == 0 || ReadAll(socket, &bytes[0], length);
+}
+} // end anonymous namespace
+
+bool WriteRequest(const int socket, const MatchRequest& request)
+{
+  return WriteUInt32(socket, RequestMagic) &&
+         WriteUInt32(socket, request.ImageSource) &&
+         WriteBytes(socket, request.SourceName.data(), request.SourceName.size()) &&
+         WriteBytes(socket, request.TargetName.data(), request.TargetName.size()) &&
+         WriteUInt32(socket, request.SourceWidth) &&
+         WriteUInt32(socket, request.SourceHeight) &&
+         WriteUInt32(socket, request.TargetWidth) &&
+         WriteUInt32(socket, request.TargetHeight) &&
+         WriteUInt32(socket, request.PatchRadius) &&
+         WriteUInt32(socket, request.Iterations);
+}
+
+bool ReadRequest(const int socket, MatchRequest& request)
+{
+  uint32_t magic = 0;
+  return ReadUInt32(socket, magic) && magic == RequestMagic &&
+         ReadUInt32(socket, request.ImageSource) &&
+         ReadBytes(socket, MaximumStringLength, request.SourceName) &&
+         ReadBytes(socket, MaximumStringLength, request.TargetName) &&
+         ReadUInt32(socket, request.SourceWidth) &&
+         ReadUInt32(socket, request.SourceHeight) &&
+         ReadUInt32(socket, request.TargetWidth) &&
+         ReadUInt32(socket, request.TargetHeight) &&
+         ReadUInt32(socket, request.PatchRadius) &&
+         ReadUInt32(socket, request.Iterations);
+}
+
+bool WriteResponse(const int socket, const MatchResponse& response)
+{
+  return WriteUInt32(socket, ResponseMagic) &&
+         WriteUInt32(socket, response.Status) &&
+         WriteBytes(socket, response.Payload.data(), response.Payload.size());
+}
+
+bool ReadResponse(const int socket, MatchResponse& response)
+{
+  uint32_t magic = 0;
+  return ReadUInt32(socket, magic) && magic == ResponseMagic &&
+         ReadUInt32(socket, response.Status) &&
+         ReadBytes(socket, MaximumPayloadLength, response.Payload);
+}
+
+bool SetTimeout(const int socket, const unsigned int milliseconds)
+{
+  timeval timeout;
+  timeout.tv_sec = milliseconds / 1000;
+  timeout.tv_usec = (milliseconds % 1000) * 1000;
+  return setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) == 0 &&
+         setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)) == 0;
+}
+
+bool SendRequest(const std::string& socketPath, const MatchRequest& request, MatchResponse& response)
+{
+  sockaddr_un address;
+  if(socketPath.size() >= sizeof(address.sun_path))
+  {
+    return false;
+  }
+
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+  int connection = socket(AF_UNIX, SOCK_STREAM, 0);
+  if(connection < 0)
+  {
+    return false;
+  }
+
+  if(connect(connection, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+  {
+    close(connection);
+    return false;
+  }
+
+  // A busy server answers without reading the request, so the response is read even if the request
+  // could not be written completely
+  WriteRequest(connection, request);
+  bool received = ReadResponse(connection, response);
+
+  close(connection);
+  return received;
+}
+
+int Listen(const std::string& socketPath, const int backlog)
+{
+  sockaddr_un address;
+  if(socketPath.size() >= sizeof(address.sun_path))
+  {
+    throw std::runtime_error("PatchMatchServerProtocol: The socket path is too long!");
+  }
+
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+  int listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+  if(listenSocket < 0)
+  {
+    throw std::runtime_error("PatchMatchServerProtocol: Could not create a socket!");
+  }
+
+  // A socket file can only be bound if it does not exist. If nothing accepts connections on it, it is stale.
+  if(bind(listenSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+  {
+    if(errno != EADDRINUSE)
+    {
+      close(listenSocket);
+      throw std::runtime_error("PatchMatchServerProtocol: Could not bind " + socketPath + "!");
+    }
+
+    int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    bool inUse = probe >= 0 && connect(probe, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+    if(probe >= 0)
+    {
+      close(probe);
+    }
+    if(inUse)
+    {
+      close(listenSocket);
+      throw std::runtime_error("PatchMatchServerProtocol: Another server is listening on " + socketPath + "!");
+    }
+
+    unlink(socketPath.c_str());
+    if(bind(listenSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+    {
+      close(listenSocket);
+      throw std::runtime_error("PatchMatchServerProtocol: Could not bind " + socketPath + "!");
+    }
+  }
+
+  if(listen(listenSocket, backlog) != 0)
+  {
+    close(listenSocket);
+    throw std::runtime_error("PatchMatchServerProtocol: Could not listen on " + socketPath + "!");
+  }
+
+  return listenSocket;
+}
+
+} // end PatchMatchServerProtocol namespace
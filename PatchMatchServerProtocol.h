@@ -0,0 +1,97 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#ifndef PatchMatchServerProtocol_H
+#define PatchMatchServerProtocol_H
+
+// STL
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/** The messages exchanged with a PatchMatchServer over a Unix domain socket. A client connects, writes one
+  * request, reads one response and the connection is closed. Every message starts with a magic number, and all of
+  * the numbers are in the byte order of the host, since the server is only reachable from the same machine.
+  * Strings and byte arrays are written as their uint32 length followed by their bytes. */
+namespace PatchMatchServerProtocol
+{
+/** The ways the images of a request can be given. */
+const uint32_t ImageFiles = 0;
+const uint32_t SharedMemoryImages = 1;
+
+/** The status of a response. */
+const uint32_t StatusSuccess = 0;
+const uint32_t StatusError = 1;
+const uint32_t StatusBusy = 2;
+
+/** A matching job. */
+struct MatchRequest
+{
+  /** ImageFiles or SharedMemoryImages. */
+  uint32_t ImageSource = ImageFiles;
+
+  /** The path of the source image file, or the name of the POSIX shared memory object that holds its pixels
+    * (SourceWidth * SourceHeight pixels of the server's pixel type, in raster order). */
+  std::string SourceName;
+
+  /** The same for the target image. If it is empty, the source image is matched against itself. */
+  std::string TargetName;
+
+  /** The sizes of shared memory images, in pixels. */
+  uint32_t SourceWidth = 0;
+  uint32_t SourceHeight = 0;
+  uint32_t TargetWidth = 0;
+  uint32_t TargetHeight = 0;
+
+  uint32_t PatchRadius = 5;
+
+  uint32_t Iterations = 5;
+};
+
+/** The answer to a MatchRequest. */
+struct MatchResponse
+{
+  uint32_t Status = StatusError;
+
+  /** The NNField in the binary NNField format (see PatchMatchHelpers::SerializeNNField()) if the Status is
+    * StatusSuccess, and otherwise a message. */
+  std::vector<char> Payload;
+};
+
+/** Write or read a message on a connected socket. These return false if the connection broke or the data
+  * is not a valid message. */
+bool WriteRequest(const int socket, const MatchRequest& request);
+bool ReadRequest(const int socket, MatchRequest& request);
+bool WriteResponse(const int socket, const MatchResponse& response);
+bool ReadResponse(const int socket, MatchResponse& response);
+
+/** Make the reads and writes on 'socket' fail when they make no progress for 'milliseconds', so that a peer that
+  * stops sending or reading cannot block the other end forever. 0 removes the timeout. */
+bool SetTimeout(const int socket, const unsigned int milliseconds);
+
+/** Connect to the server listening on 'socketPath', send 'request' and wait for its response. This returns false
+  * if the server could not be reached or did not answer. */
+bool SendRequest(const std::string& socketPath, const MatchRequest& request, MatchResponse& response);
+
+/** Create a socket listening on 'socketPath', replacing a socket file left behind by a server that is gone. */
+int Listen(const std::string& socketPath, const int backlog);
+
+} // end PatchMatchServerProtocol namespace
+
+#endif
@@ -0,0 +1,90 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef PatchPCA_H
+#define PatchPCA_H
+
+// ITK
+#include "itkImage.h"
+#include "itkImageRegion.h"
+#include "itkDefaultConvertPixelTraits.h"
+
+// STL
+#include <vector>
+
+/** Projects patches onto the leading principal components of a set of training patches, giving each patch
+  * a short descriptor whose Euclidean distances approximate the SSD between the patches.
+  * The patches are read straight from the image buffer, so they must be entirely inside the buffered region. */
+template <typename TImage>
+class PatchPCA
+{
+public:
+  typedef typename TImage::PixelType PixelType;
+  typedef itk::DefaultConvertPixelTraits<PixelType> PixelTraitsType;
+
+  /** Compute the principal components of the patches of radius 'patchRadius' of 'image' centered at
+    * 'centers'. At most 'maximumNumberOfSamples' of them, evenly spaced in the list, are used. */
+  void Compute(const TImage* const image, const unsigned int patchRadius, const std::vector<itk::Index<2> >& centers,
+               const unsigned int numberOfComponents, const unsigned int maximumNumberOfSamples = 5000);
+
+  /** Compute the descriptor of the patch of 'image' centered at 'center', writing GetNumberOfComponents()
+    * floats to 'descriptor'. The image may be different from the one the components were computed on,
+    * as long as it has the same kind of pixels. */
+  void Project(const TImage* const image, const itk::Index<2>& center, float* const descriptor) const;
+
+  /** Get the number of components (the length of each descriptor). */
+  unsigned int GetNumberOfComponents() const
+  {
+    return this->NumberOfComponents;
+  }
+
+  unsigned int GetPatchRadius() const
+  {
+    return this->PatchRadius;
+  }
+
+  /** Get the fraction of the total variance of the training patches captured by the descriptors. */
+  float GetExplainedVariance() const
+  {
+    return this->ExplainedVariance;
+  }
+
+private:
+  unsigned int PatchRadius = 0;
+
+  unsigned int NumberOfComponents = 0;
+
+  /** The number of values in a patch (pixels times components per pixel). */
+  unsigned int PatchLength = 0;
+
+  /** The mean training patch. */
+  std::vector<float> Mean;
+
+  /** The principal components, stored so that value 'i' of a patch contributes to descriptor entry 'j'
+    * through Basis[i * NumberOfComponents + j]. */
+  std::vector<float> Basis;
+
+  float ExplainedVariance = 0.0f;
+
+  /** Copy the values of the patch centered at 'center' into 'values'. */
+  void GetPatchValues(const TImage* const image, const itk::Index<2>& center, float* const values) const;
+};
+
+#include "PatchPCA.hpp"
+
+#endif
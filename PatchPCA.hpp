@@ -0,0 +1,151 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef PatchPCA_HPP
+#define PatchPCA_HPP
+
+#include "PatchPCA.h"
+
+// STL
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+// Eigen
+#include <Eigen/Dense>
+
+template <typename TImage>
+void PatchPCA<TImage>::Compute(const TImage* const image, const unsigned int patchRadius,
+                               const std::vector<itk::Index<2> >& centers, const unsigned int numberOfComponents,
+                               const unsigned int maximumNumberOfSamples)
+{
+  assert(image);
+  assert(maximumNumberOfSamples > 0);
+
+  if(centers.empty())
+  {
+    throw std::runtime_error("PatchPCA: No training patches!");
+  }
+
+  const unsigned int patchSideLength = 2 * patchRadius + 1;
+  this->PatchRadius = patchRadius;
+  this->PatchLength = patchSideLength * patchSideLength * PixelTraitsType::GetNumberOfComponents();
+  this->NumberOfComponents = std::min(numberOfComponents, this->PatchLength);
+
+  const size_t numberOfSamples = std::min<size_t>(centers.size(), maximumNumberOfSamples);
+
+  Eigen::MatrixXf samples(numberOfSamples, this->PatchLength);
+  for(size_t sampleId = 0; sampleId < numberOfSamples; ++sampleId)
+  {
+    const itk::Index<2>& center = centers[sampleId * centers.size() / numberOfSamples];
+
+    // Eigen matrices are column major, so the row is filled through a temporary
+    Eigen::VectorXf values(this->PatchLength);
+    GetPatchValues(image, center, values.data());
+    samples.row(sampleId) = values.transpose();
+  }
+
+  Eigen::RowVectorXf mean = samples.colwise().mean();
+  samples.rowwise() -= mean;
+  Eigen::MatrixXf covariance = (samples.transpose() * samples) / static_cast<float>(numberOfSamples);
+
+  // The eigenvalues are in increasing order, so the principal components are the last columns
+  Eigen::SelfAdjointEigenSolver<Eigen::MatrixXf> eigenSolver(covariance);
+  if(eigenSolver.info() != Eigen::Success)
+  {
+    throw std::runtime_error("PatchPCA: The eigen decomposition of the patch covariance failed!");
+  }
+
+  this->Mean.assign(mean.data(), mean.data() + this->PatchLength);
+
+  this->Basis.resize(this->PatchLength * this->NumberOfComponents);
+  for(unsigned int componentId = 0; componentId < this->NumberOfComponents; ++componentId)
+  {
+    const unsigned int column = this->PatchLength - 1 - componentId;
+    for(unsigned int valueId = 0; valueId < this->PatchLength; ++valueId)
+    {
+      this->Basis[valueId * this->NumberOfComponents + componentId] = eigenSolver.eigenvectors()(valueId, column);
+    }
+  }
+
+  const float totalVariance = eigenSolver.eigenvalues().sum();
+  const float explainedVariance = eigenSolver.eigenvalues().tail(this->NumberOfComponents).sum();
+  this->ExplainedVariance = totalVariance > 0.0f ? explainedVariance / totalVariance : 1.0f;
+}
+
+template <typename TImage>
+void PatchPCA<TImage>::Project(const TImage* const image, const itk::Index<2>& center, float* const descriptor) const
+{
+  assert(this->PatchLength > 0);
+
+  std::fill(descriptor, descriptor + this->NumberOfComponents, 0.0f);
+
+  const PixelType* row = image->GetBufferPointer() +
+                         image->ComputeOffset(center) -
+                         static_cast<itk::OffsetValueType>(this->PatchRadius) *
+                         (static_cast<itk::OffsetValueType>(image->GetBufferedRegion().GetSize()[0]) + 1);
+  const itk::SizeValueType rowStride = image->GetBufferedRegion().GetSize()[0];
+  const unsigned int patchSideLength = 2 * this->PatchRadius + 1;
+
+  const float* mean = this->Mean.data();
+  const float* basisRow = this->Basis.data();
+
+  for(unsigned int y = 0; y < patchSideLength; ++y)
+  {
+    for(unsigned int x = 0; x < patchSideLength; ++x)
+    {
+      for(unsigned int component = 0; component < PixelTraitsType::GetNumberOfComponents(); ++component)
+      {
+        const float value = static_cast<float>(PixelTraitsType::GetNthComponent(component, row[x])) - *mean;
+        for(unsigned int componentId = 0; componentId < this->NumberOfComponents; ++componentId)
+        {
+          descriptor[componentId] += value * basisRow[componentId];
+        }
+        ++mean;
+        basisRow += this->NumberOfComponents;
+      }
+    }
+    row += rowStride;
+  }
+}
+
+template <typename TImage>
+void PatchPCA<TImage>::GetPatchValues(const TImage* const image, const itk::Index<2>& center, float* const values) const
+{
+  const PixelType* row = image->GetBufferPointer() +
+                         image->ComputeOffset(center) -
+                         static_cast<itk::OffsetValueType>(this->PatchRadius) *
+                         (static_cast<itk::OffsetValueType>(image->GetBufferedRegion().GetSize()[0]) + 1);
+  const itk::SizeValueType rowStride = image->GetBufferedRegion().GetSize()[0];
+  const unsigned int patchSideLength = 2 * this->PatchRadius + 1;
+
+  size_t valueId = 0;
+  for(unsigned int y = 0; y < patchSideLength; ++y)
+  {
+    for(unsigned int x = 0; x < patchSideLength; ++x)
+    {
+      for(unsigned int component = 0; component < PixelTraitsType::GetNumberOfComponents(); ++component)
+      {
+        values[valueId++] = static_cast<float>(PixelTraitsType::GetNthComponent(component, row[x]));
+      }
+    }
+    row += rowStride;
+  }
+}
+
+#endif
@@ -19,10 +19,16 @@
 #ifndef Propagator_H
 #define Propagator_H
 
+// STL
+#include <array>
+
 // Custom
 #include "Match.h"
 #include "PatchMatchHelpers.h"
 #include "NNField.h"
+#include "MeanVarianceBound.h"
+#include "NNFieldReverseIndex.h"
+#include "PatchDescriptorPrefilter.h"
 
 /** A class that traverses a target region and propagates good matches. */
 template <typename TPatchDistanceFunctor>
@@ -38,6 +44,12 @@ public:
       this->Forward = forward;
   }
 
+  /** Get the direction of the next propagation. It is reversed by every call to Propagate(). */
+  bool GetForward() const
+  {
+      return this->Forward;
+  }
+
   void SetPatchRadius(const unsigned int patchRadius)
   {
       this->PatchRadius = patchRadius;
@@ -48,17 +60,76 @@ public:
       this->PatchDistanceFunctor = patchDistanceFunctor;
   }
 
-  void SetTargetPixels(const std::vector<itk::Index<2> > targetPixels)
+  void SetTargetPixels(const std::vector<itk::Index<2> >& targetPixels)
   {
       this->TargetPixels = targetPixels;
   }
 
+  /** Set the largest possible region of the source image. If this is not set, the source
+    * image is assumed to be the same size as the NNField (self-matching). */
+  void SetSourceRegion(const itk::ImageRegion<2>& sourceRegion)
+  {
+      this->SourceRegion = sourceRegion;
+  }
+
+  /** Set the image (the size of the source image) indicating which source patches may be propagated. */
+  void SetValidPatchCentersImage(itk::Image<bool, 2>* const validPatchCentersImage)
+  {
+      this->ValidPatchCentersImage = validPatchCentersImage;
+  }
+
+  /** Set the reverse index to keep up to date with the matches that are accepted. This is optional. */
+  void SetReverseIndex(NNFieldReverseIndex* const reverseIndex)
+  {
+      this->ReverseIndex = reverseIndex;
+  }
+
+  /** Set the descriptors used to reject candidates without computing their patch distance. This is optional. */
+  void SetDescriptorPrefilter(const PatchDescriptorPrefilter* const descriptorPrefilter)
+  {
+      this->DescriptorPrefilter = descriptorPrefilter;
+  }
+
+  /** Set the mean/variance bound used to skip the patch distance of candidates that cannot beat the current
+    * match. This is optional. */
+  void SetMeanVarianceBound(MeanVarianceBound* const meanVarianceBound)
+  {
+      this->DistanceBound = meanVarianceBound;
+  }
+
+  /** Get the number of candidates that the DescriptorPrefilter rejected in the last Propagate(). */
+  unsigned int GetNumberOfRejectedCandidates() const
+  {
+      return this->NumberOfRejectedCandidates;
+  }
+
 private:
   /** A flag indicating whether we are in the forward (true) or backward (false) pass case. */
   bool Forward = true;
 
-  /** Return either the top and left pixel offsets or bottom and right pixel offsets depending on the Forward flag. */
-  std::vector<itk::Offset<2> > GetPropagationOffsets();
+  /** The offsets of the neighbors to propagate from. This is a fixed size array so that getting it does not allocate. */
+  typedef std::array<itk::Offset<2>, 2> PropagationOffsetsType;
+
+  /** Return either the top and left pixel offsets (forward pass) or bottom and right pixel offsets (backward pass).
+    * The offsets are compile time constants, so this folds away in the per-pixel loop. */
+  template <bool TForward>
+  static PropagationOffsetsType GetPropagationOffsets()
+  {
+    constexpr itk::OffsetValueType step = TForward ? -1 : 1;
+    PropagationOffsetsType propagationOffsets = {{ {{step, 0}}, {{0, step}} }};
+    return propagationOffsets;
+  }
+
+  /** Propagate to every target pixel in one direction. */
+  template <bool TForward>
+  unsigned int PropagatePass(NNFieldType* const nnField);
+
+  /** Propagate to 'targetPixel' from its two neighbors in the direction of the pass. Returns true if any neighbor
+    * had a match to propagate. The neighbors of interior pixels are known to be inside the target internal region,
+    * so that test is only compiled in when 'TCheckNeighbors' is true. */
+  template <bool TForward, bool TCheckNeighbors>
+  bool PropagatePixel(NNFieldType* const nnField, const itk::Index<2>& targetPixel,
+                      const itk::ImageRegion<2>& targetInternalRegion, const itk::ImageRegion<2>& sourceInternalRegion);
 
   /** The radius of the patches. */
   unsigned int PatchRadius = 5;
@@ -68,6 +139,23 @@ private:
 
   /** The pixels at which to compute the NNField. */
   std::vector<itk::Index<2> > TargetPixels;
+
+  /** The largest possible region of the source image. */
+  itk::ImageRegion<2> SourceRegion;
+
+  /** An image where if a pixel is 'true', it is the center of a valid source region. */
+  itk::Image<bool, 2>* ValidPatchCentersImage = nullptr;
+
+  /** If set, this is updated whenever a match is accepted. */
+  NNFieldReverseIndex* ReverseIndex = nullptr;
+
+  /** If set, candidates whose descriptor bound does not beat the current match are not scored. */
+  const PatchDescriptorPrefilter* DescriptorPrefilter = nullptr;
+
+  unsigned int NumberOfRejectedCandidates = 0;
+
+  /** If set, candidates whose mean/variance bound does not beat the current match are not scored. */
+  MeanVarianceBound* DistanceBound = nullptr;
 };
 
 #include "Propagator.hpp"
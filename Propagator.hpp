@@ -21,8 +21,6 @@
 
 #include "Propagator.h"
 
-#include <algorithm>
-
 #include "itkImageRegionIteratorWithIndex.h"
 
 template <typename TPatchDistanceFunctor>
@@ -32,134 +30,187 @@ Propagate(NNFieldType* const nnField)
   assert(this->PatchDistanceFunctor);
 
   // Pixels near the border do not have fully defined patches (the patches that they are the center of are not fully inside the image)
-  itk::ImageRegion<2> internalRegion = ITKHelpers::GetInternalRegion(nnField->GetLargestPossibleRegion(), this->PatchRadius);
+  itk::ImageRegion<2> targetInternalRegion = ITKHelpers::GetInternalRegion(nnField->GetLargestPossibleRegion(), this->PatchRadius);
 
   if(this->TargetPixels.size() == 0)
   {
-    this->TargetPixels = PatchMatchHelpers::GetAllPixelIndices(internalRegion);
+    this->TargetPixels = PatchMatchHelpers::GetAllPixelIndices(targetInternalRegion);
   }
 
-  std::vector<itk::Index<2> > targetPixels = this->TargetPixels;
+  this->NumberOfRejectedCandidates = 0;
+
+  // The direction is decided once per pass, so neither pass has to test it per pixel
+  unsigned int numberOfPropagatedPixels = this->Forward ? PropagatePass<true>(nnField) : PropagatePass<false>(nnField);
+
+  // Reverse the propagation for the next iteration
+  this->Forward = !this->Forward;
+
+  //std::cout << "Propagation() propagated " << propagatedPixels << " pixels." << std::endl;
+  return numberOfPropagatedPixels;
+}
 
-  if(!this->Forward)
+template <typename TPatchDistanceFunctor>
+template <bool TForward>
+unsigned int Propagator<TPatchDistanceFunctor>::
+PropagatePass(NNFieldType* const nnField)
+{
+  itk::ImageRegion<2> targetInternalRegion = ITKHelpers::GetInternalRegion(nnField->GetLargestPossibleRegion(), this->PatchRadius);
+
+  // If no source region was specified, we are matching the image against itself
+  itk::ImageRegion<2> sourceRegion = this->SourceRegion;
+  if(sourceRegion.GetNumberOfPixels() == 0)
+  {
+    sourceRegion = nnField->GetLargestPossibleRegion();
+  }
+  itk::ImageRegion<2> sourceInternalRegion = ITKHelpers::GetInternalRegion(sourceRegion, this->PatchRadius);
+
+  // Both neighbors of an interior pixel are inside the target internal region. This is the internal region
+  // without the row and column on the side the neighbors are on (the first ones for a forward pass and the
+  // last ones for a backward pass).
+  itk::IndexValueType interiorBegin[2];
+  itk::IndexValueType interiorEnd[2];
+  for(unsigned int dimension = 0; dimension < 2; ++dimension)
   {
-    std::reverse(targetPixels.begin(), targetPixels.end());
+    interiorBegin[dimension] = targetInternalRegion.GetIndex()[dimension];
+    interiorEnd[dimension] = interiorBegin[dimension] +
+                             static_cast<itk::IndexValueType>(targetInternalRegion.GetSize()[dimension]);
+    if(TForward)
+    {
+      interiorBegin[dimension]++;
+    }
+    else
+    {
+      interiorEnd[dimension]--;
+    }
   }
 
-//  std::cout << "Propagation(): There are " << targetPixels.size()
+//  std::cout << "Propagation(): There are " << this->TargetPixels.size()
 //            << " pixels that would like to be processed." << std::endl;
 
   unsigned int numberOfPropagatedPixels = 0;
 
-  for(size_t targetPixelId = 0; targetPixelId < targetPixels.size(); ++targetPixelId)
+  const size_t numberOfTargetPixels = this->TargetPixels.size();
+
+  // The backward pass visits the pixels in reverse order, so the list is indexed from the end rather than copied
+  for(size_t visitId = 0; visitId < numberOfTargetPixels; ++visitId)
   {
-    itk::Index<2> targetPixel = targetPixels[targetPixelId];
+    const itk::Index<2>& targetPixel = this->TargetPixels[TForward ? visitId : numberOfTargetPixels - 1 - visitId];
     //ProcessPixelSignal(targetPixel);
 
-    itk::ImageRegion<2> targetRegion =
-          ITKHelpers::GetRegionInRadiusAroundPixel(targetPixel, this->PatchRadius);
+    bool interior = targetPixel[0] >= interiorBegin[0] && targetPixel[0] < interiorEnd[0] &&
+                    targetPixel[1] >= interiorBegin[1] && targetPixel[1] < interiorEnd[1];
 
-    std::vector<itk::Offset<2> > propagationOffsets = GetPropagationOffsets();
+    bool propagated = interior ?
+          PropagatePixel<TForward, false>(nnField, targetPixel, targetInternalRegion, sourceInternalRegion) :
+          PropagatePixel<TForward, true>(nnField, targetPixel, targetInternalRegion, sourceInternalRegion);
 
-    bool propagated = false;
-    for(size_t propagationOffsetId = 0;
-        propagationOffsetId < propagationOffsets.size();
-        ++propagationOffsetId)
+    if(propagated)
     {
-      itk::Offset<2> propagationOffset = propagationOffsets[propagationOffsetId];
-
-      // The potential match is the opposite (hence the " - offset" in the following line)
-      // of the offset of the neighbor. Consider the following case:
-      // - We are at (4,4) and potentially propagating from (3,4)
-      // - The best match to (3,4) is (10,10)
-      // - potentialMatch should be (11,10), because since the current pixel is 1 to the right
-      // of the neighbor, we need to consider the patch one to the right of the neighbors best match
+      numberOfPropagatedPixels++;
+    }
+  } // end loop over target pixels
 
-      itk::Index<2> nnFieldLocation = targetPixel + propagationOffset;
+  //std::cout << "AcceptanceTest failed " << acceptanceTestFailed << std::endl;
+  return numberOfPropagatedPixels;
+}
 
-      if(!internalRegion.IsInside(nnFieldLocation))
-      {
-          continue; // We don't want to propagate information from outside of the
-                    // viable NN field region
-      }
+template <typename TPatchDistanceFunctor>
+template <bool TForward, bool TCheckNeighbors>
+bool Propagator<TPatchDistanceFunctor>::
+PropagatePixel(NNFieldType* const nnField, const itk::Index<2>& targetPixel,
+               const itk::ImageRegion<2>& targetInternalRegion, const itk::ImageRegion<2>& sourceInternalRegion)
+{
+  itk::ImageRegion<2> targetRegion =
+        ITKHelpers::GetRegionInRadiusAroundPixel(targetPixel, this->PatchRadius);
 
-      NNFieldType::PixelType nnFieldPixel = nnField->GetPixel(nnFieldLocation);
-      itk::Index<2> bestMatchPixel =
-        ITKHelpers::GetRegionCenter(nnFieldPixel.GetRegion());
+  const PropagationOffsetsType propagationOffsets = GetPropagationOffsets<TForward>();
 
-      itk::Index<2> potentialMatchPixel = bestMatchPixel - propagationOffset;
+  bool propagated = false;
+  for(size_t propagationOffsetId = 0;
+      propagationOffsetId < propagationOffsets.size();
+      ++propagationOffsetId)
+  {
+    const itk::Offset<2>& propagationOffset = propagationOffsets[propagationOffsetId];
 
-      if(!internalRegion.IsInside(potentialMatchPixel))
-      {
-          continue; // We don't want to propagate information from outside of the
-                    // viable NN field region
-      }
+    // The potential match is the opposite (hence the " - offset" in the following line)
+    // of the offset of the neighbor. Consider the following case:
+    // - We are at (4,4) and potentially propagating from (3,4)
+    // - The best match to (3,4) is (10,10)
+    // - potentialMatch should be (11,10), because since the current pixel is 1 to the right
+    // of the neighbor, we need to consider the patch one to the right of the neighbors best match
 
-      itk::ImageRegion<2> potentialMatchRegion =
-            ITKHelpers::GetRegionInRadiusAroundPixel(potentialMatchPixel, this->PatchRadius);
+    itk::Index<2> nnFieldLocation = targetPixel + propagationOffset;
 
+    if(TCheckNeighbors && !targetInternalRegion.IsInside(nnFieldLocation))
+    {
+        continue; // We don't want to propagate information from outside of the
+                  // viable NN field region
+    }
 
-      float distance = this->PatchDistanceFunctor->Distance(potentialMatchRegion, targetRegion);
+    const NNFieldType::PixelType& nnFieldPixel = nnField->GetPixel(nnFieldLocation);
 
-      Match potentialMatch;
-      potentialMatch.SetRegion(potentialMatchRegion);
-      potentialMatch.SetScore(distance);
+    if(nnFieldPixel.GetRegion().GetNumberOfPixels() == 0)
+    {
+        continue; // The neighbor is not a target pixel, so it has no match to propagate
+    }
+    itk::Index<2> bestMatchPixel =
+      ITKHelpers::GetRegionCenter(nnFieldPixel.GetRegion());
 
-      // If there were previous matches, add this one if it is better
-      Match currentMatch = nnField->GetPixel(targetPixel);
+    itk::Index<2> potentialMatchPixel = bestMatchPixel - propagationOffset;
 
-      if(potentialMatch.GetScore() < currentMatch.GetScore())
-      {
-        nnField->SetPixel(targetPixel, potentialMatch);
-      }
+    if(!sourceInternalRegion.IsInside(potentialMatchPixel))
+    {
+        continue; // We don't want to propagate information from outside of the
+                  // viable source region
+    }
 
-      //PropagatedSignal(nnField);
-      propagated = true;
+    if(this->ValidPatchCentersImage && !this->ValidPatchCentersImage->GetPixel(potentialMatchPixel))
+    {
+        continue; // This source patch is not allowed to be used as a match
+    }
 
-    } // end loop over potentialPropagationPixels
+    // The descriptors may already show that this candidate cannot beat the current match
+    if(this->DescriptorPrefilter &&
+       this->DescriptorPrefilter->Rejects(potentialMatchPixel, targetPixel, nnField->GetPixel(targetPixel)))
+    {
+        this->NumberOfRejectedCandidates++;
+        propagated = true;
+        continue;
+    }
 
-    if(propagated)
+    if(this->DistanceBound &&
+       this->DistanceBound->Rejects(potentialMatchPixel, targetPixel, nnField->GetPixel(targetPixel)))
     {
-      numberOfPropagatedPixels++;
+        propagated = true;
+        continue;
     }
 
-  } // end loop over target pixels
+    itk::ImageRegion<2> potentialMatchRegion =
+          ITKHelpers::GetRegionInRadiusAroundPixel(potentialMatchPixel, this->PatchRadius);
 
-  // Reverse the propagation for the next iteration
-  this->Forward = !this->Forward;
+    float distance = this->PatchDistanceFunctor->Distance(potentialMatchRegion, targetRegion);
 
-  //std::cout << "Propagation() propagated " << propagatedPixels << " pixels." << std::endl;
-  //std::cout << "AcceptanceTest failed " << acceptanceTestFailed << std::endl;
-  return numberOfPropagatedPixels;
-}
+    // If there were previous matches, add this one if it is better
+    if(distance < nnField->GetPixel(targetPixel).GetScore())
+    {
+      Match potentialMatch;
+      potentialMatch.SetRegion(potentialMatchRegion);
+      potentialMatch.SetScore(distance);
 
+      nnField->SetPixel(targetPixel, potentialMatch);
 
-template <typename TPatchDistanceFunctor>
-std::vector<itk::Offset<2> > Propagator<TPatchDistanceFunctor>::
-GetPropagationOffsets()
-{
-  std::vector<itk::Offset<2> > propagationOffsets;
-  if(this->Forward)
-  {
-    itk::Offset<2> offset;
-    offset[0] = -1;
-    offset[1] = 0;
-    propagationOffsets.push_back(offset);
-    offset[0] = 0;
-    offset[1] = -1;
-    propagationOffsets.push_back(offset);
-  }
-  else
-  {
-    itk::Offset<2> offset;
-    offset[0] = 1;
-    offset[1] = 0;
-    propagationOffsets.push_back(offset);
-    offset[0] = 0;
-    offset[1] = 1;
-    propagationOffsets.push_back(offset);
-  }
-  return propagationOffsets;
+      if(this->ReverseIndex)
+      {
+        this->ReverseIndex->Update(targetPixel, potentialMatchPixel);
+      }
+    }
+
+    //PropagatedSignal(nnField);
+    propagated = true;
+
+  } // end loop over potentialPropagationPixels
+
+  return propagated;
 }
 
 #endif
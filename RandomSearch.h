@@ -22,9 +22,20 @@
 // ITK
 #include "itkImage.h"
 
+// Boost
+#include <boost/signals2/signal.hpp>
+
+// STL
+#include <random>
+#include <string>
+
 // Custom
+#include "Arena.h"
 #include "Match.h"
+#include "MeanVarianceBound.h"
 #include "NNField.h"
+#include "NNFieldReverseIndex.h"
+#include "PatchDescriptorPrefilter.h"
 
 // Submodules
 #include <Mask/Mask.h>
@@ -41,10 +52,23 @@ struct RandomSearch
     this->PatchRadius = patchRadius;
   }
 
-  /** Set the image on which to operate. */
+  /** Set the image on which to operate when matching an image against itself. */
   void SetImage(TImage* const image)
   {
-    this->Image = image;
+    this->SourceImage = image;
+    this->TargetImage = image;
+  }
+
+  /** Set the image from which matches are drawn. */
+  void SetSourceImage(TImage* const sourceImage)
+  {
+    this->SourceImage = sourceImage;
+  }
+
+  /** Set the image for which the NNField is computed. */
+  void SetTargetImage(TImage* const targetImage)
+  {
+    this->TargetImage = targetImage;
   }
 
   /** Set the functor used to compare patches. */
@@ -62,12 +86,19 @@ struct RandomSearch
   /** A signal to indicate that we accepted a new patch. */
   boost::signals2::signal<void (const itk::Index<2>& queryCenter, const itk::Index<2>& matchCenter, const float)> AcceptedSignal;
 
-  /** Set if the results are truly randomized. */
+  /** Set if the results are truly randomized. If not, the random number generator is seeded with 0. */
   void SetRandom(const bool random)
   {
     this->Random = random;
+    this->GeneratorIsSeeded = false;
   }
 
+  /** Get the state of the random number generator, so that a run can be continued exactly from a checkpoint. */
+  std::string GetRandomState();
+
+  /** Restore a state returned by GetRandomState(). */
+  void SetRandomState(const std::string& randomState);
+
   void SetPixelsToProcess(const std::vector<itk::Index<2> >& pixelsToProcess)
   {
       this->PixelsToProcess = pixelsToProcess;
@@ -78,9 +109,44 @@ struct RandomSearch
     this->ValidPatchCentersImage = validPatchCentersImage;
   }
 
+  /** Set the reverse index to keep up to date with the matches that are accepted. This is optional. */
+  void SetReverseIndex(NNFieldReverseIndex* const reverseIndex)
+  {
+    this->ReverseIndex = reverseIndex;
+  }
+
+  /** Set the arena from which the temporary buffers are drawn. If it is not set, an arena owned by this
+    * functor is used. */
+  void SetArena(Arena* const arena)
+  {
+    this->TemporaryArena = arena;
+  }
+
+  /** Set the descriptors used to reject candidates without computing their patch distance. This is optional. */
+  void SetDescriptorPrefilter(const PatchDescriptorPrefilter* const descriptorPrefilter)
+  {
+    this->DescriptorPrefilter = descriptorPrefilter;
+  }
+
+  /** Set the mean/variance bound used to skip the patch distance of candidates that cannot beat the current
+    * match. This is optional. */
+  void SetMeanVarianceBound(MeanVarianceBound* const meanVarianceBound)
+  {
+    this->DistanceBound = meanVarianceBound;
+  }
+
+  /** Get the number of candidates that the DescriptorPrefilter rejected in the last Search(). */
+  unsigned int GetNumberOfRejectedCandidates() const
+  {
+    return this->NumberOfRejectedCandidates;
+  }
+
 private:
-  /** The image on which to operate. */
-  TImage* Image = nullptr;
+  /** The image from which matches are drawn. */
+  TImage* SourceImage = nullptr;
+
+  /** The image for which the NNField is computed. */
+  TImage* TargetImage = nullptr;
 
   /** The patch radius we are using to define regions to compare. */
   unsigned int PatchRadius = 0;
@@ -91,7 +157,15 @@ private:
   /** Determine if the result should be randomized. This should only be false for testing purposes. */
   bool Random = true;
 
-  /** Seed the random number generator if we are supposed to. */
+  /** The random number generator. It is seeded by the first Search() (or SetRandomState()), and not at every
+    * Search(), so that its state at the end of an iteration is all that is needed to continue the run. Unlike
+    * rand(), it is not shared with other threads. */
+  std::mt19937 Generator;
+
+  /** Whether the Generator has been seeded since Random was set. */
+  bool GeneratorIsSeeded = false;
+
+  /** Seed the random number generator if it has not been seeded yet. */
   void InitializeRandomGenerator();
 
   /** Get a random pixel in the specified region. */
@@ -104,12 +178,43 @@ private:
   /** The pixels for which we are trying to randomly find a better match. */
   std::vector<itk::Index<2> > PixelsToProcess;
 
-  /** An image where if a pixel is 'true', it is the center of a valid region. */
+  /** An image (the size of the source image) where if a pixel is 'true', it is the center of a valid region.
+    * If this is not set, every patch entirely inside the source image is valid. */
   typedef itk::Image<bool, 2> BoolImageType;
-  BoolImageType* ValidPatchCentersImage;
+  BoolImageType* ValidPatchCentersImage = nullptr;
+
+  /** If set, this is updated whenever a match is accepted. */
+  NNFieldReverseIndex* ReverseIndex = nullptr;
+
+  /** If set, candidates whose descriptor bound does not beat the current match are not scored. */
+  const PatchDescriptorPrefilter* DescriptorPrefilter = nullptr;
+
+  unsigned int NumberOfRejectedCandidates = 0;
+
+  /** If set, candidates whose mean/variance bound does not beat the current match are not scored. */
+  MeanVarianceBound* DistanceBound = nullptr;
 
   bool GetRandomValidRegion(const itk::ImageRegion<2>& region, itk::ImageRegion<2>& randomValidRegion);
 
+  /** The candidate regions generated for the pixel currently being searched. These are members so that
+    * their memory is reused from pixel to pixel. */
+  std::vector<itk::ImageRegion<2> > CandidateRegions;
+
+  /** The distances of each of the CandidateRegions to the current query patch. */
+  std::vector<float> CandidateScores;
+
+  /** The arena set with SetArena(), if any. */
+  Arena* TemporaryArena = nullptr;
+
+  /** The arena used when none was set. */
+  Arena OwnArena;
+
+  /** Get the arena to draw temporary buffers from. */
+  Arena* GetArena()
+  {
+    return this->TemporaryArena ? this->TemporaryArena : &this->OwnArena;
+  }
+
 };
 
 #include "RandomSearch.hpp"
@@ -25,8 +25,14 @@
 #include "itkImageRegion.h"
 
 // STL
+#include <algorithm>
 #include <cassert>
 #include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+// Custom
+#include "PatchMatchHelpers.h"
 
 // Submodules
 #include <ITKHelpers/ITKHelpers.h>
@@ -36,37 +42,39 @@ void RandomSearch<TImage, TPatchDistanceFunctor>::
 Search(NNFieldType* const nnField)
 {
   assert(nnField);
-  assert(this->Image);
+  assert(this->SourceImage);
+  assert(this->TargetImage);
   assert(this->PatchRadius > 0);
   assert(this->PatchDistanceFunctor);
 
   assert(nnField->GetLargestPossibleRegion().GetSize()[0] > 0);
-  assert(this->Image->GetLargestPossibleRegion().GetSize()[0] > 0);
+  assert(this->SourceImage->GetLargestPossibleRegion().GetSize()[0] > 0);
   assert(nnField->GetLargestPossibleRegion().GetSize() ==
-         this->Image->GetLargestPossibleRegion().GetSize());
+         this->TargetImage->GetLargestPossibleRegion().GetSize());
 
   InitializeRandomGenerator();
 
   itk::ImageRegion<2> fullRegion = nnField->GetLargestPossibleRegion();
-  itk::ImageRegion<2> internalRegion = ITKHelpers::GetInternalRegion(fullRegion, this->PatchRadius);
+  itk::ImageRegion<2> targetInternalRegion = ITKHelpers::GetInternalRegion(fullRegion, this->PatchRadius);
+  itk::ImageRegion<2> sourceInternalRegion =
+      ITKHelpers::GetInternalRegion(this->SourceImage->GetLargestPossibleRegion(), this->PatchRadius);
 
   unsigned int numberOfUpdatedPixels = 0;
+  this->NumberOfRejectedCandidates = 0;
 
   if(this->PixelsToProcess.size() == 0)
   {
-    this->PixelsToProcess = PatchMatchHelpers::GetAllPixelIndices(internalRegion);
+    this->PixelsToProcess = PatchMatchHelpers::GetAllPixelIndices(targetInternalRegion);
   }
 
-  unsigned int width = internalRegion.GetSize()[0];
-  unsigned int height = internalRegion.GetSize()[1];
+  unsigned int width = sourceInternalRegion.GetSize()[0];
+  unsigned int height = sourceInternalRegion.GetSize()[1];
 
   // The maximum (first) search radius, as prescribed in PatchMatch paper section 3.2
   unsigned int initialRadius = std::max(width, height);
 
   for(size_t pixelId = 0; pixelId < this->PixelsToProcess.size(); ++pixelId)
   {
-    std::cout << "Searching for a better match for pixel " << pixelId << std::endl;
-
     itk::Index<2> queryPixel = this->PixelsToProcess[pixelId];
 
     itk::ImageRegion<2> queryRegion =
@@ -74,13 +82,25 @@ Search(NNFieldType* const nnField)
 
     assert(fullRegion.IsInside(queryRegion));
 
+    // The search windows are centered on the current best match (the 'v_0' of PatchMatch paper section 3.2),
+    // since the query pixel itself has no meaning in the source image when it is a different image.
+    Match currentMatch = nnField->GetPixel(queryPixel);
+    itk::Index<2> currentMatchCenter = ITKHelpers::GetRegionCenter(currentMatch.GetRegion());
+
+    // Generate the candidates from every search radius first, so that they can all be scored
+    // against the query patch in a single batch.
+    this->CandidateRegions.clear();
+
     unsigned int radius = initialRadius;
 
     // Search an exponentially smaller window each time through the loop
     while(radius > this->PatchRadius) // while there is more than just the current patch to search
     {
-      itk::ImageRegion<2> searchRegion = ITKHelpers::GetRegionInRadiusAroundPixel(queryPixel, radius);
-      searchRegion.Crop(internalRegion);
+      itk::ImageRegion<2> searchRegion = ITKHelpers::GetRegionInRadiusAroundPixel(currentMatchCenter, radius);
+      if(!searchRegion.Crop(sourceInternalRegion))
+      {
+          break;
+      }
 
       itk::ImageRegion<2> randomValidRegion;
       bool hasPixels = GetRandomValidRegion(searchRegion, randomValidRegion);
@@ -90,29 +110,66 @@ Search(NNFieldType* const nnField)
           break;
       }
 
-      // Compute the patch difference
-      float dist = this->PatchDistanceFunctor->Distance(randomValidRegion, queryRegion);
+      this->CandidateRegions.push_back(randomValidRegion);
 
-      // Construct a match object
-      Match potentialMatch;
-      potentialMatch.SetRegion(randomValidRegion);
-      potentialMatch.SetScore(dist);
+      radius *= this->RegionReductionRatio;
+    } // end decreasing radius loop
 
-      // Store this match as the best match if it meets the criteria.
-      // In this class, the criteria is simply that it is
-      // better than the current best patch. In subclasses (i.e. GeneralizedPatchMatch),
-      // it must be better than the worst patch currently stored.
+    // Only the candidates that the descriptors and the mean/variance bound do not rule out are scored
+    if(this->DescriptorPrefilter || this->DistanceBound)
+    {
+      size_t numberOfKeptCandidates = 0;
+      for(size_t candidateId = 0; candidateId < this->CandidateRegions.size(); ++candidateId)
+      {
+        itk::Index<2> candidateCenter = ITKHelpers::GetRegionCenter(this->CandidateRegions[candidateId]);
 
-      Match currentMatch = nnField->GetPixel(queryPixel);
+        if(this->DescriptorPrefilter && this->DescriptorPrefilter->Rejects(candidateCenter, queryPixel, currentMatch))
+        {
+          this->NumberOfRejectedCandidates++;
+          continue;
+        }
 
-      if(potentialMatch.GetScore() < currentMatch.GetScore())
-      {
-        nnField->SetPixel(queryPixel, potentialMatch);
-        numberOfUpdatedPixels++;
+        if(this->DistanceBound && this->DistanceBound->Rejects(candidateCenter, queryPixel, currentMatch))
+        {
+          continue;
+        }
+
+        this->CandidateRegions[numberOfKeptCandidates++] = this->CandidateRegions[candidateId];
       }
+      this->CandidateRegions.resize(numberOfKeptCandidates);
+    }
 
-      radius *= this->RegionReductionRatio;
-    } // end decreasing radius loop
+    if(this->CandidateRegions.empty())
+    {
+      continue;
+    }
+
+    // Compute the patch differences
+    PatchMatchHelpers::BatchDistance(this->PatchDistanceFunctor, queryRegion,
+                                     this->CandidateRegions, this->CandidateScores);
+
+    size_t bestCandidateId = std::min_element(this->CandidateScores.begin(), this->CandidateScores.end()) -
+                             this->CandidateScores.begin();
+
+    // Construct a match object
+    Match potentialMatch;
+    potentialMatch.SetRegion(this->CandidateRegions[bestCandidateId]);
+    potentialMatch.SetScore(this->CandidateScores[bestCandidateId]);
+
+    // Store this match as the best match if it meets the criteria.
+    // In this class, the criteria is simply that it is
+    // better than the current best patch. In subclasses (i.e. GeneralizedPatchMatch),
+    // it must be better than the worst patch currently stored.
+    if(potentialMatch.GetScore() < currentMatch.GetScore())
+    {
+      nnField->SetPixel(queryPixel, potentialMatch);
+      numberOfUpdatedPixels++;
+
+      if(this->ReverseIndex)
+      {
+        this->ReverseIndex->Update(queryPixel, ITKHelpers::GetRegionCenter(potentialMatch.GetRegion()));
+      }
+    }
 
   } // end loop over target pixels
 
@@ -124,14 +181,48 @@ template <typename TImage, typename TPatchDistanceFunctor>
 bool RandomSearch<TImage, TPatchDistanceFunctor>::
 GetRandomValidRegion(const itk::ImageRegion<2>& region, itk::ImageRegion<2>& randomValidRegion)
 {
-    std::vector<itk::Index<2> > truePixels = ITKHelpers::GetPixelsWithValueInRegion(this->ValidPatchCentersImage, region, true);
+    // Without a mask, every patch in the (internal) region is valid
+    if(!this->ValidPatchCentersImage)
+    {
+        if(region.GetNumberOfPixels() == 0)
+        {
+            return false;
+        }
+
+        randomValidRegion = ITKHelpers::GetRegionInRadiusAroundPixel(GetRandomPixelInRegion(region),
+                                                                     this->PatchRadius);
+        return true;
+    }
+
+    if(region.GetNumberOfPixels() == 0)
+    {
+        return false;
+    }
+
+    // Usually most of the window is valid, so a few random guesses avoid scanning the whole window
+    const unsigned int numberOfGuesses = 8;
+    for(unsigned int guessId = 0; guessId < numberOfGuesses; ++guessId)
+    {
+        itk::Index<2> randomPixel = GetRandomPixelInRegion(region);
+        if(this->ValidPatchCentersImage->GetPixel(randomPixel))
+        {
+            randomValidRegion = ITKHelpers::GetRegionInRadiusAroundPixel(randomPixel, this->PatchRadius);
+            return true;
+        }
+    }
+
+    // The list of valid centers only lives until a pixel is picked, so it is released as soon as this returns
+    Arena::Scope scope(GetArena());
+    ArenaVector<itk::Index<2> > truePixels(GetArena());
+    truePixels.reserve(region.GetNumberOfPixels());
+    PatchMatchHelpers::AppendPixelsWithValueInRegion(this->ValidPatchCentersImage, region, true, truePixels);
 
     if(truePixels.size() == 0)
     {
         return false;
     }
 
-    unsigned int randomIndex = Helpers::RandomInt(0, truePixels.size() - 1);
+    size_t randomIndex = std::uniform_int_distribution<size_t>(0, truePixels.size() - 1)(this->Generator);
 
     itk::Index<2> randomPixel = truePixels[randomIndex];
 
@@ -144,14 +235,58 @@ GetRandomValidRegion(const itk::ImageRegion<2>& region, itk::ImageRegion<2>& ran
 template <typename TImage, typename TPatchDistanceFunctor>
 void RandomSearch<TImage, TPatchDistanceFunctor>::InitializeRandomGenerator()
 {
+  if(this->GeneratorIsSeeded)
+  {
+    return;
+  }
+
   if(this->Random)
   {
-    srand(time(NULL));
+    std::random_device randomDevice;
+    this->Generator.seed(randomDevice());
   }
   else
   {
-    srand(0);
+    this->Generator.seed(0);
+  }
+  this->GeneratorIsSeeded = true;
+}
+
+template <typename TImage, typename TPatchDistanceFunctor>
+itk::Index<2> RandomSearch<TImage, TPatchDistanceFunctor>::GetRandomPixelInRegion(const itk::ImageRegion<2>& region)
+{
+  itk::Index<2> pixel;
+  for(unsigned int dimension = 0; dimension < 2; ++dimension)
+  {
+    std::uniform_int_distribution<itk::IndexValueType> distribution(region.GetIndex()[dimension],
+                                                                    region.GetIndex()[dimension] +
+                                                                    region.GetSize()[dimension] - 1);
+    pixel[dimension] = distribution(this->Generator);
+  }
+
+  return pixel;
+}
+
+template <typename TImage, typename TPatchDistanceFunctor>
+std::string RandomSearch<TImage, TPatchDistanceFunctor>::GetRandomState()
+{
+  InitializeRandomGenerator();
+
+  std::stringstream randomState;
+  randomState << this->Generator;
+  return randomState.str();
+}
+
+template <typename TImage, typename TPatchDistanceFunctor>
+void RandomSearch<TImage, TPatchDistanceFunctor>::SetRandomState(const std::string& randomState)
+{
+  std::stringstream stateStream(randomState);
+  stateStream >> this->Generator;
+  if(stateStream.fail())
+  {
+    throw std::runtime_error("RandomSearch: Invalid random state!");
   }
+  this->GeneratorIsSeeded = true;
 }
 
 #endif
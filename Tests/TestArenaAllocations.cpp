@@ -0,0 +1,171 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+/** This program checks that once PatchMatch has warmed up, its iterations do not allocate from the heap.
+  * Every call to the global operator new is counted, and the counts are sampled whenever PatchMatch
+  * signals that the NNField was updated (after every propagation and random search). */
+
+// STL
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <vector>
+
+// ITK
+#include "itkImage.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkCovariantVector.h"
+
+// Custom
+#include "BatchSSD.h"
+#include "PatchMatch.h"
+#include "Propagator.h"
+#include "RandomSearch.h"
+#include "TestHelpers.h"
+
+namespace
+{
+std::atomic<size_t> NumberOfAllocations(0);
+}
+
+void* operator new(size_t size)
+{
+  NumberOfAllocations++;
+
+  void* memory = std::malloc(size > 0 ? size : 1);
+  if(!memory)
+  {
+    throw std::bad_alloc();
+  }
+  return memory;
+}
+
+void operator delete(void* memory) noexcept
+{
+  std::free(memory);
+}
+
+typedef itk::Image<itk::CovariantVector<float, 3>, 2> ImageType;
+
+int main(int, char*[])
+{
+  const unsigned int patchRadius = 3;
+  const unsigned int iterations = 6;
+
+  // The number of iterations after which the arena has reached its final size. The first iteration grows it,
+  // and the reset at the start of the second may merge its chunks into one.
+  const unsigned int warmUpIterations = 2;
+
+  itk::Index<2> corner = {{0, 0}};
+  itk::Size<2> size = {{96, 96}};
+  itk::ImageRegion<2> region(corner, size);
+
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions(region);
+  image->Allocate();
+
+  srand(0);
+  TestHelpers::FillRandom(image.GetPointer(), region);
+
+  // Only a few source patches are valid, so the random search often has to fall back to listing the
+  // valid patches of its window, which is what draws from the arena
+  typedef itk::Image<bool, 2> BoolImageType;
+  BoolImageType::Pointer validPatchCentersImage = BoolImageType::New();
+  validPatchCentersImage->SetRegions(region);
+  validPatchCentersImage->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<BoolImageType> validIterator(validPatchCentersImage, region);
+  while(!validIterator.IsAtEnd())
+  {
+    validIterator.Set(validIterator.GetIndex()[0] % 5 == 0 && validIterator.GetIndex()[1] % 5 == 0);
+    ++validIterator;
+  }
+
+  typedef BatchSSD<ImageType> DistanceFunctorType;
+  DistanceFunctorType patchDistanceFunctor;
+  patchDistanceFunctor.SetImage(image);
+
+  typedef Propagator<DistanceFunctorType> PropagatorType;
+  PropagatorType propagationFunctor;
+  propagationFunctor.SetPatchRadius(patchRadius);
+  propagationFunctor.SetPatchDistanceFunctor(&patchDistanceFunctor);
+
+  typedef RandomSearch<ImageType, DistanceFunctorType> RandomSearchType;
+  RandomSearchType randomSearchFunctor;
+  randomSearchFunctor.SetPatchRadius(patchRadius);
+  randomSearchFunctor.SetPatchDistanceFunctor(&patchDistanceFunctor);
+  randomSearchFunctor.SetRandom(false);
+
+  typedef PatchMatch<ImageType, PropagatorType, RandomSearchType> PatchMatchType;
+  PatchMatchType patchMatch;
+  patchMatch.SetImage(image);
+  patchMatch.SetPatchRadius(patchRadius);
+  patchMatch.SetIterations(iterations);
+  patchMatch.SetWriteIntermediateFields(false);
+  patchMatch.SetSourceValidPatchCentersImage(validPatchCentersImage);
+  patchMatch.SetPropagationFunctor(&propagationFunctor);
+  patchMatch.SetRandomSearchFunctor(&randomSearchFunctor);
+  patchMatch.SetRandom(false);
+
+  // Reserved up front so that recording a sample does not allocate
+  std::vector<size_t> allocationCounts;
+  allocationCounts.reserve(2 * iterations);
+  patchMatch.UpdatedSignal.connect([&allocationCounts](NNFieldType*)
+                                   {
+                                     allocationCounts.push_back(NumberOfAllocations.load());
+                                   });
+
+  patchMatch.Compute();
+
+  if(allocationCounts.size() != 2 * iterations)
+  {
+    std::cerr << "Expected " << 2 * iterations << " updates but got " << allocationCounts.size() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if(patchMatch.GetTemporaryArena()->GetPeakUsage() == 0)
+  {
+    std::cerr << "The random search never drew from the arena." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  bool passed = true;
+  for(unsigned int iteration = warmUpIterations; iteration < iterations; ++iteration)
+  {
+    // The count at the end of the previous iteration against the count at the end of this one
+    size_t allocations = allocationCounts[2 * iteration + 1] - allocationCounts[2 * iteration - 1];
+    std::cout << "Iteration " << iteration << ": " << allocations << " heap allocations" << std::endl;
+
+    if(allocations > 0)
+    {
+      passed = false;
+    }
+  }
+
+  std::cout << "Arena peak usage: " << patchMatch.GetTemporaryArena()->GetPeakUsage() << " bytes in "
+            << patchMatch.GetTemporaryArena()->GetNumberOfChunkAllocations() << " chunk allocations" << std::endl;
+
+  if(!passed)
+  {
+    std::cerr << "PatchMatch allocated after warming up." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,199 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+/** This program checks AtomicNNField under contention: several threads offer random matches for the same pixels
+  * at once, many of them with equal scores, and every pixel must end up with the smallest (score, source offset)
+  * that was offered. It also checks that CopyTo() and CopyFrom() round-trip the field. */
+
+// STL
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+// ITK
+#include "itkImageRegionConstIteratorWithIndex.h"
+
+// Custom
+#include "AtomicNNField.h"
+
+/** A match offered by one of the threads. */
+struct Offer
+{
+  itk::Index<2> TargetPixel;
+  itk::Index<2> SourceCenter;
+  float Score;
+};
+
+/** Get the raster offset of 'index' in 'region'. */
+size_t ComputeOffset(const itk::ImageRegion<2>& region, const itk::Index<2>& index)
+{
+  return (index[1] - region.GetIndex()[1]) * region.GetSize()[0] + (index[0] - region.GetIndex()[0]);
+}
+
+int main(int, char*[])
+{
+  const unsigned int patchRadius = 2;
+  const unsigned int numberOfThreads = 8;
+  const unsigned int offersPerPixel = 40;
+
+  itk::Index<2> targetCorner = {{3, 5}};
+  itk::Size<2> targetSize = {{32, 24}};
+  itk::ImageRegion<2> targetRegion(targetCorner, targetSize);
+
+  itk::Index<2> sourceCorner = {{0, 0}};
+  itk::Size<2> sourceSize = {{40, 30}};
+  itk::ImageRegion<2> sourceRegion(sourceCorner, sourceSize);
+
+  AtomicNNField atomicNNField;
+  atomicNNField.Initialize(targetRegion, sourceRegion, patchRadius, numberOfThreads);
+
+  // Every thread offers matches for every pixel, except for a few pixels that are left without a match
+  std::vector<std::vector<Offer> > offers(numberOfThreads);
+  for(unsigned int threadId = 0; threadId < numberOfThreads; ++threadId)
+  {
+    std::mt19937 generator(threadId);
+    std::uniform_int_distribution<int> scoreDistribution(0, 7);
+    std::uniform_int_distribution<int> xDistribution(0, sourceSize[0] - 1);
+    std::uniform_int_distribution<int> yDistribution(0, sourceSize[1] - 1);
+
+    for(unsigned int offerId = 0; offerId < offersPerPixel; ++offerId)
+    {
+      for(itk::IndexValueType y = targetCorner[1]; y < targetCorner[1] + static_cast<itk::IndexValueType>(targetSize[1]); ++y)
+      {
+        for(itk::IndexValueType x = targetCorner[0]; x < targetCorner[0] + static_cast<itk::IndexValueType>(targetSize[0]); ++x)
+        {
+          if((x + y) % 7 == 0)
+          {
+            continue;
+          }
+
+          Offer offer;
+          offer.TargetPixel[0] = x;
+          offer.TargetPixel[1] = y;
+          offer.SourceCenter[0] = xDistribution(generator);
+          offer.SourceCenter[1] = yDistribution(generator);
+          // Few distinct scores, so that most of the decisions are made by the source offset
+          offer.Score = 0.5f * scoreDistribution(generator);
+          offers[threadId].push_back(offer);
+        }
+      }
+    }
+  }
+
+  std::vector<std::thread> threads;
+  for(unsigned int threadId = 0; threadId < numberOfThreads; ++threadId)
+  {
+    threads.push_back(std::thread([&atomicNNField, &offers, threadId]()
+    {
+      for(size_t offerId = 0; offerId < offers[threadId].size(); ++offerId)
+      {
+        const Offer& offer = offers[threadId][offerId];
+        atomicNNField.UpdateIfBetter(offer.TargetPixel, offer.SourceCenter, offer.Score);
+      }
+    }));
+  }
+  for(size_t threadId = 0; threadId < threads.size(); ++threadId)
+  {
+    threads[threadId].join();
+  }
+
+  // The best offer of each pixel, found sequentially
+  std::vector<bool> hasOffer(targetRegion.GetNumberOfPixels(), false);
+  std::vector<Offer> bestOffers(targetRegion.GetNumberOfPixels());
+  for(unsigned int threadId = 0; threadId < numberOfThreads; ++threadId)
+  {
+    for(size_t offerId = 0; offerId < offers[threadId].size(); ++offerId)
+    {
+      const Offer& offer = offers[threadId][offerId];
+      const size_t pixelOffset = ComputeOffset(targetRegion, offer.TargetPixel);
+      const Offer& best = bestOffers[pixelOffset];
+      if(!hasOffer[pixelOffset] || offer.Score < best.Score ||
+         (offer.Score == best.Score &&
+          ComputeOffset(sourceRegion, offer.SourceCenter) < ComputeOffset(sourceRegion, best.SourceCenter)))
+      {
+        bestOffers[pixelOffset] = offer;
+        hasOffer[pixelOffset] = true;
+      }
+    }
+  }
+
+  bool passed = true;
+
+  NNFieldType::Pointer nnField = NNFieldType::New();
+  atomicNNField.CopyTo(nnField);
+
+  AtomicNNField copiedNNField;
+  copiedNNField.CopyFrom(nnField, sourceRegion, patchRadius);
+
+  NNFieldType::Pointer copiedNNFieldImage = NNFieldType::New();
+  copiedNNField.CopyTo(copiedNNFieldImage);
+
+  if(nnField->GetLargestPossibleRegion() != targetRegion ||
+     copiedNNFieldImage->GetLargestPossibleRegion() != targetRegion)
+  {
+    std::cerr << "CopyTo() did not allocate the field over the target region" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  itk::ImageRegionConstIteratorWithIndex<NNFieldType> nnFieldIterator(nnField, targetRegion);
+  while(!nnFieldIterator.IsAtEnd())
+  {
+    const itk::Index<2> targetPixel = nnFieldIterator.GetIndex();
+    const size_t pixelOffset = ComputeOffset(targetRegion, targetPixel);
+
+    itk::Index<2> sourceCenter;
+    float score;
+    const bool hasMatch = atomicNNField.GetMatch(targetPixel, sourceCenter, score);
+    if(hasMatch != hasOffer[pixelOffset] ||
+       (hasMatch && (sourceCenter != bestOffers[pixelOffset].SourceCenter || score != bestOffers[pixelOffset].Score)))
+    {
+      std::cerr << "The match of " << targetPixel << " is " << sourceCenter << " (" << score
+                << ") instead of the best offer " << bestOffers[pixelOffset].SourceCenter << " ("
+                << bestOffers[pixelOffset].Score << ")" << std::endl;
+      passed = false;
+    }
+
+    const Match& match = nnFieldIterator.Get();
+    const Match expectedMatch = atomicNNField.GetMatch(targetPixel);
+    if(match.GetRegion() != expectedMatch.GetRegion() || (hasMatch && match.GetScore() != expectedMatch.GetScore()))
+    {
+      std::cerr << "CopyTo() wrote " << match.GetRegion() << " at " << targetPixel << " instead of "
+                << expectedMatch.GetRegion() << std::endl;
+      passed = false;
+    }
+
+    const Match& copiedMatch = copiedNNFieldImage->GetPixel(targetPixel);
+    if(copiedMatch.GetRegion() != match.GetRegion() || (hasMatch && copiedMatch.GetScore() != match.GetScore()))
+    {
+      std::cerr << "CopyFrom() and CopyTo() changed the match of " << targetPixel << " from "
+                << match.GetRegion() << " to " << copiedMatch.GetRegion() << std::endl;
+      passed = false;
+    }
+
+    ++nnFieldIterator;
+  }
+
+  if(!passed)
+  {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
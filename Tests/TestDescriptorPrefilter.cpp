@@ -0,0 +1,164 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+/** This program checks that the bound of PatchDescriptorPrefilter is a lower bound of the BatchSSD distance, for
+  * random pairs of patches and for pairs of nearly identical patches (where the bound is tightest), and that
+  * PatchMatch with SetUseDescriptorPrefilter() rejects candidates without making the field worse. */
+
+// STL
+#include <iostream>
+
+// ITK
+#include "itkImage.h"
+#include "itkCovariantVector.h"
+
+// Custom
+#include "BatchSSD.h"
+#include "PatchDescriptorPrefilter.h"
+#include "PatchMatch.h"
+#include "Propagator.h"
+#include "RandomSearch.h"
+#include "TestHelpers.h"
+
+typedef itk::Image<itk::CovariantVector<float, 3>, 2> ImageType;
+typedef BatchSSD<ImageType> DistanceFunctorType;
+typedef Propagator<DistanceFunctorType> PropagatorType;
+typedef RandomSearch<ImageType, DistanceFunctorType> RandomSearchType;
+typedef PatchMatch<ImageType, PropagatorType, RandomSearchType> PatchMatchType;
+
+const unsigned int PatchRadius = 3;
+
+/** Get a random pixel of 'region'. */
+itk::Index<2> GetRandomPixel(const itk::ImageRegion<2>& region)
+{
+  itk::Index<2> pixel = {{region.GetIndex()[0] + rand() % static_cast<int>(region.GetSize()[0]),
+                          region.GetIndex()[1] + rand() % static_cast<int>(region.GetSize()[1])}};
+  return pixel;
+}
+
+int main(int, char*[])
+{
+  srand(0);
+
+  itk::Index<2> corner = {{0, 0}};
+  itk::Size<2> sourceSize = {{90, 70}};
+  itk::Size<2> targetSize = {{60, 50}};
+
+  ImageType::Pointer sourceImage = ImageType::New();
+  sourceImage->SetRegions(itk::ImageRegion<2>(corner, sourceSize));
+  sourceImage->Allocate();
+  itk::Offset<2> noShift = {{0, 0}};
+  TestHelpers::FillTexture(sourceImage.GetPointer(), noShift, 0.0f);
+
+  // The target is a noisy copy of part of the source, so every target patch has a nearly identical source patch
+  ImageType::Pointer targetImage = ImageType::New();
+  targetImage->SetRegions(itk::ImageRegion<2>(corner, targetSize));
+  targetImage->Allocate();
+  itk::Offset<2> shift = {{19, 11}};
+  TestHelpers::FillTexture(targetImage.GetPointer(), shift, 4.0f);
+
+  itk::ImageRegion<2> sourceInternalRegion =
+      ITKHelpers::GetInternalRegion(sourceImage->GetLargestPossibleRegion(), PatchRadius);
+  itk::ImageRegion<2> targetInternalRegion =
+      ITKHelpers::GetInternalRegion(targetImage->GetLargestPossibleRegion(), PatchRadius);
+
+  DistanceFunctorType patchDistanceFunctor;
+  patchDistanceFunctor.SetSourceImage(sourceImage);
+  patchDistanceFunctor.SetTargetImage(targetImage);
+
+  PatchDescriptorPrefilter descriptorPrefilter;
+  descriptorPrefilter.Compute(sourceImage.GetPointer(), targetImage.GetPointer(), PatchRadius);
+
+  bool passed = true;
+
+  // The descriptors and the distance are sums of floats computed in different orders, so the bound may exceed
+  // the distance by a rounding error
+  const float relativeTolerance = 1e-4f;
+  const float absoluteTolerance = 1e-2f;
+
+  const unsigned int numberOfPairs = 20000;
+  for(unsigned int pairId = 0; pairId < numberOfPairs; ++pairId)
+  {
+    itk::Index<2> targetCenter = GetRandomPixel(targetInternalRegion);
+    itk::Index<2> sourceCenter = (pairId % 2 == 0) ? GetRandomPixel(sourceInternalRegion) : targetCenter + shift;
+
+    float lowerBound = descriptorPrefilter.LowerBound(sourceCenter, targetCenter);
+    float distance = patchDistanceFunctor.Distance(ITKHelpers::GetRegionInRadiusAroundPixel(sourceCenter, PatchRadius),
+                                                   ITKHelpers::GetRegionInRadiusAroundPixel(targetCenter, PatchRadius));
+
+    if(lowerBound > distance * (1.0f + relativeTolerance) + absoluteTolerance)
+    {
+      std::cerr << "The bound of the source patch at " << sourceCenter << " and the target patch at " << targetCenter
+                << " is " << lowerBound << ", above their distance " << distance << std::endl;
+      passed = false;
+    }
+  }
+
+  // The prefilter only rejects candidates that could not have replaced the current match
+  PropagatorType propagationFunctor;
+  propagationFunctor.SetPatchRadius(PatchRadius);
+  propagationFunctor.SetPatchDistanceFunctor(&patchDistanceFunctor);
+
+  RandomSearchType randomSearchFunctor;
+  randomSearchFunctor.SetPatchRadius(PatchRadius);
+  randomSearchFunctor.SetPatchDistanceFunctor(&patchDistanceFunctor);
+  randomSearchFunctor.SetRandom(false);
+
+  PatchMatchType patchMatch;
+  patchMatch.SetSourceImage(sourceImage);
+  patchMatch.SetTargetImage(targetImage);
+  patchMatch.SetPatchRadius(PatchRadius);
+  patchMatch.SetIterations(3);
+  patchMatch.SetWriteIntermediateFields(false);
+  patchMatch.SetVerbose(false);
+  patchMatch.SetPropagationFunctor(&propagationFunctor);
+  patchMatch.SetRandomSearchFunctor(&randomSearchFunctor);
+
+  patchMatch.SetRandom(false);
+  const double meanScore = TestHelpers::ComputeMeanScore(patchMatch, targetInternalRegion);
+
+  patchMatch.SetUseDescriptorPrefilter(true);
+  patchMatch.SetRandom(false);
+  const double prefilteredMeanScore = TestHelpers::ComputeMeanScore(patchMatch, targetInternalRegion);
+
+  const unsigned int numberOfRejectedCandidates = propagationFunctor.GetNumberOfRejectedCandidates() +
+                                                  randomSearchFunctor.GetNumberOfRejectedCandidates();
+
+  std::cout << "Mean score: " << meanScore << " without the prefilter, " << prefilteredMeanScore << " with it, which"
+            << " rejected " << numberOfRejectedCandidates << " candidates in the last iteration" << std::endl;
+
+  if(numberOfRejectedCandidates == 0)
+  {
+    std::cerr << "The prefilter did not reject any candidate" << std::endl;
+    passed = false;
+  }
+
+  if(prefilteredMeanScore > meanScore * (1.0 + relativeTolerance))
+  {
+    std::cerr << "The prefilter made the field worse" << std::endl;
+    passed = false;
+  }
+
+  if(!passed)
+  {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,51 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#ifndef TestHelpers_H
+#define TestHelpers_H
+
+// ITK
+#include "itkImageRegion.h"
+#include "itkOffset.h"
+
+/** Images and measurements shared by the tests. The images are drawn from rand(), so a test that calls srand()
+  * first gets the same images on every run. */
+namespace TestHelpers
+{
+
+/** Fill 'region' of 'image' with pixels whose components are random values of [0, 255]. */
+template <typename TImage>
+void FillRandom(TImage* const image, const itk::ImageRegion<2>& region);
+
+/** Fill 'image' (of three component pixels) with a smooth texture of a few waves, seen through 'shift', plus
+  * uniform noise of 'noise' levels. One of the waves depends on x * y, so that the texture does not repeat and
+  * a patch of it has one best match. */
+template <typename TImage>
+void FillTexture(TImage* const image, const itk::Offset<2>& shift, const float noise);
+
+/** Compute the field of 'patchMatch' from a new random field and get the mean score of the pixels of
+  * 'targetRegion'. */
+template <typename TPatchMatch>
+double ComputeMeanScore(TPatchMatch& patchMatch, const itk::ImageRegion<2>& targetRegion);
+
+} // end TestHelpers namespace
+
+#include "TestHelpers.hpp"
+
+#endif
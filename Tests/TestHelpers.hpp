@@ -0,0 +1,100 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#ifndef TestHelpers_HPP
+#define TestHelpers_HPP
+
+#include "TestHelpers.h"
+
+// STL
+#include <cmath>
+#include <cstdlib>
+
+// ITK
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIterator.h"
+#include "itkImageRegionIteratorWithIndex.h"
+
+// Custom
+#include "NNField.h"
+
+namespace TestHelpers
+{
+
+template <typename TImage>
+void FillRandom(TImage* const image, const itk::ImageRegion<2>& region)
+{
+  typedef typename TImage::PixelType PixelType;
+
+  itk::ImageRegionIterator<TImage> imageIterator(image, region);
+  while(!imageIterator.IsAtEnd())
+  {
+    PixelType pixel;
+    for(unsigned int component = 0; component < PixelType::GetNumberOfComponents(); ++component)
+    {
+      pixel[component] = rand() % 256;
+    }
+    imageIterator.Set(pixel);
+    ++imageIterator;
+  }
+}
+
+template <typename TImage>
+void FillTexture(TImage* const image, const itk::Offset<2>& shift, const float noise)
+{
+  typedef typename TImage::PixelType PixelType;
+
+  itk::ImageRegionIteratorWithIndex<TImage> imageIterator(image, image->GetLargestPossibleRegion());
+  while(!imageIterator.IsAtEnd())
+  {
+    const float x = imageIterator.GetIndex()[0] + shift[0];
+    const float y = imageIterator.GetIndex()[1] + shift[1];
+
+    PixelType pixel;
+    pixel[0] = 128.0f + 60.0f * std::sin(0.31f * x) + 60.0f * std::cos(0.17f * y);
+    pixel[1] = 128.0f + 80.0f * std::sin(0.05f * x * y / 8.0f + 0.23f * y);
+    pixel[2] = 128.0f + 100.0f * std::cos(0.11f * x - 0.29f * y);
+    for(unsigned int component = 0; component < 3; ++component)
+    {
+      pixel[component] += noise * (static_cast<float>(rand()) / RAND_MAX - 0.5f);
+    }
+    imageIterator.Set(pixel);
+    ++imageIterator;
+  }
+}
+
+template <typename TPatchMatch>
+double ComputeMeanScore(TPatchMatch& patchMatch, const itk::ImageRegion<2>& targetRegion)
+{
+  patchMatch.ResetNNField();
+  patchMatch.Compute();
+
+  double totalScore = 0.0;
+  itk::ImageRegionConstIterator<NNFieldType> nnFieldIterator(patchMatch.GetNNField(), targetRegion);
+  while(!nnFieldIterator.IsAtEnd())
+  {
+    totalScore += nnFieldIterator.Get().GetScore();
+    ++nnFieldIterator;
+  }
+  return totalScore / targetRegion.GetNumberOfPixels();
+}
+
+} // end TestHelpers namespace
+
+#endif
@@ -0,0 +1,114 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+/** This program initializes the NNField of a target image that is a shifted, noisy copy of a textured source image,
+  * once with InitializerCSH and once with random matches, and checks that the mean score of the matches that
+  * coherency sensitive hashing finds is much lower than the mean score of random matches. */
+
+// STL
+#include <iostream>
+
+// ITK
+#include "itkImage.h"
+#include "itkCovariantVector.h"
+
+// Custom
+#include "BatchSSD.h"
+#include "InitializerCSH.h"
+#include "PatchMatch.h"
+#include "Propagator.h"
+#include "RandomSearch.h"
+#include "TestHelpers.h"
+
+typedef itk::Image<itk::CovariantVector<float, 3>, 2> ImageType;
+typedef BatchSSD<ImageType> DistanceFunctorType;
+typedef Propagator<DistanceFunctorType> PropagatorType;
+typedef RandomSearch<ImageType, DistanceFunctorType> RandomSearchType;
+typedef PatchMatch<ImageType, PropagatorType, RandomSearchType> PatchMatchType;
+
+const unsigned int PatchRadius = 3;
+
+int main(int, char*[])
+{
+  srand(0);
+
+  itk::Index<2> corner = {{0, 0}};
+  itk::Size<2> sourceSize = {{120, 100}};
+  itk::Size<2> targetSize = {{80, 70}};
+
+  ImageType::Pointer sourceImage = ImageType::New();
+  sourceImage->SetRegions(itk::ImageRegion<2>(corner, sourceSize));
+  sourceImage->Allocate();
+  itk::Offset<2> noShift = {{0, 0}};
+  TestHelpers::FillTexture(sourceImage.GetPointer(), noShift, 0.0f);
+
+  // Every target patch has a close (but not exact) copy in the source
+  ImageType::Pointer targetImage = ImageType::New();
+  targetImage->SetRegions(itk::ImageRegion<2>(corner, targetSize));
+  targetImage->Allocate();
+  itk::Offset<2> shift = {{23, 17}};
+  TestHelpers::FillTexture(targetImage.GetPointer(), shift, 8.0f);
+
+  itk::ImageRegion<2> targetInternalRegion =
+      ITKHelpers::GetInternalRegion(targetImage->GetLargestPossibleRegion(), PatchRadius);
+
+  DistanceFunctorType patchDistanceFunctor;
+  patchDistanceFunctor.SetSourceImage(sourceImage);
+  patchDistanceFunctor.SetTargetImage(targetImage);
+
+  PropagatorType propagationFunctor;
+  propagationFunctor.SetPatchRadius(PatchRadius);
+  propagationFunctor.SetPatchDistanceFunctor(&patchDistanceFunctor);
+
+  RandomSearchType randomSearchFunctor;
+  randomSearchFunctor.SetPatchRadius(PatchRadius);
+  randomSearchFunctor.SetPatchDistanceFunctor(&patchDistanceFunctor);
+
+  PatchMatchType patchMatch;
+  patchMatch.SetSourceImage(sourceImage);
+  patchMatch.SetTargetImage(targetImage);
+  patchMatch.SetPatchRadius(PatchRadius);
+  // Only the initialization is compared
+  patchMatch.SetIterations(0);
+  patchMatch.SetWriteIntermediateFields(false);
+  patchMatch.SetVerbose(false);
+  patchMatch.SetPropagationFunctor(&propagationFunctor);
+  patchMatch.SetRandomSearchFunctor(&randomSearchFunctor);
+
+  const double randomMeanScore = TestHelpers::ComputeMeanScore(patchMatch, targetInternalRegion);
+
+  InitializerCSH<ImageType, DistanceFunctorType> initializerCSH;
+  initializerCSH.SetSourceImage(sourceImage);
+  initializerCSH.SetTargetImage(targetImage);
+  initializerCSH.SetPatchDistanceFunctor(&patchDistanceFunctor);
+  initializerCSH.SetSeed(0);
+  patchMatch.SetInitializer(&initializerCSH);
+
+  const double cshMeanScore = TestHelpers::ComputeMeanScore(patchMatch, targetInternalRegion);
+
+  std::cout << "Mean initial score: random " << randomMeanScore << ", CSH " << cshMeanScore << std::endl;
+
+  if(!(cshMeanScore < 0.5 * randomMeanScore))
+  {
+    std::cerr << "The CSH initialization is not much better than the random one" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,154 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+/** This program checks that the histograms read from an IntegralHistogram are identical, bin for bin, to the ones
+  * that Histogram::ComputeImageHistogram1D() computes by visiting the pixels, over random regions of an image
+  * whose values include the ends of the range and the boundaries between the bins. */
+
+// STL
+#include <algorithm>
+#include <iostream>
+
+// ITK
+#include "itkImage.h"
+#include "itkImageRegionIterator.h"
+#include "itkCovariantVector.h"
+
+// Submodules
+#include <Histogram/Histogram.h>
+
+// Custom
+#include "IntegralHistogram.h"
+
+typedef itk::Image<itk::CovariantVector<unsigned char, 3>, 2> ImageType;
+
+/** Fill 'image' with values of [rangeMin, rangeMax]. Half of them are the ends of the range or the lower edge of
+  * a bin, where a different rounding of the bin computation would put the value in the neighboring bin. */
+void FillImage(ImageType* const image, const unsigned int numberOfBins, const unsigned int rangeMin,
+               const unsigned int rangeMax)
+{
+  const unsigned int binWidth = (rangeMax - rangeMin) / numberOfBins;
+
+  itk::ImageRegionIterator<ImageType> imageIterator(image, image->GetLargestPossibleRegion());
+  while(!imageIterator.IsAtEnd())
+  {
+    ImageType::PixelType pixel;
+    for(unsigned int component = 0; component < 3; ++component)
+    {
+      switch(rand() % 4)
+      {
+        case 0:
+          pixel[component] = rangeMin + rand() % (rangeMax - rangeMin + 1);
+          break;
+        case 1:
+          pixel[component] = rangeMin + (rand() % (numberOfBins + 1)) * binWidth;
+          break;
+        case 2:
+          pixel[component] = rand() % 2 ? rangeMin : rangeMax;
+          break;
+        default:
+          pixel[component] = rangeMin + std::max(1u, (rand() % (numberOfBins + 1)) * binWidth) - 1;
+          break;
+      }
+    }
+    imageIterator.Set(pixel);
+    ++imageIterator;
+  }
+}
+
+/** Compare the histograms of 'numberOfRegions' random regions, and of the whole image and of its corners. */
+bool CompareHistograms(const ImageType* const image, const unsigned int numberOfBins,
+                       const unsigned char rangeMin, const unsigned char rangeMax, const unsigned int numberOfRegions)
+{
+  IntegralHistogram<ImageType> integralHistogram;
+  integralHistogram.Compute(image, numberOfBins, rangeMin, rangeMax);
+
+  const itk::ImageRegion<2> imageRegion = image->GetLargestPossibleRegion();
+  const itk::Size<2> imageSize = imageRegion.GetSize();
+
+  std::vector<itk::ImageRegion<2> > regions;
+  regions.push_back(imageRegion);
+  for(unsigned int corner = 0; corner < 4; ++corner)
+  {
+    itk::Size<2> size = {{1, 1}};
+    itk::Index<2> index = {{corner % 2 ? static_cast<itk::IndexValueType>(imageSize[0] - 1) : 0,
+                            corner / 2 ? static_cast<itk::IndexValueType>(imageSize[1] - 1) : 0}};
+    regions.push_back(itk::ImageRegion<2>(index, size));
+  }
+  while(regions.size() < numberOfRegions)
+  {
+    itk::Size<2> size = {{1 + rand() % imageSize[0], 1 + rand() % imageSize[1]}};
+    itk::Index<2> index = {{rand() % static_cast<int>(imageSize[0] - size[0] + 1),
+                            rand() % static_cast<int>(imageSize[1] - size[1] + 1)}};
+    regions.push_back(itk::ImageRegion<2>(index, size));
+  }
+
+  for(size_t regionId = 0; regionId < regions.size(); ++regionId)
+  {
+    Histogram<int>::HistogramType expected =
+        Histogram<int>::ComputeImageHistogram1D(image, regions[regionId], numberOfBins, rangeMin, rangeMax);
+    IntegralHistogram<ImageType>::HistogramType histogram = integralHistogram.GetHistogram(regions[regionId]);
+
+    if(histogram != expected)
+    {
+      std::cerr << "The histograms of " << regions[regionId] << " with " << numberOfBins << " bins over ["
+                << static_cast<int>(rangeMin) << ", " << static_cast<int>(rangeMax) << "] differ:" << std::endl;
+      for(size_t bin = 0; bin < std::max(histogram.size(), expected.size()); ++bin)
+      {
+        std::cerr << bin << ": " << (bin < histogram.size() ? histogram[bin] : -1) << " "
+                  << (bin < expected.size() ? expected[bin] : -1) << std::endl;
+      }
+      return false;
+    }
+  }
+
+  return true;
+}
+
+int main(int, char*[])
+{
+  itk::Index<2> corner = {{0, 0}};
+  itk::Size<2> size = {{37, 29}};
+
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions(itk::ImageRegion<2>(corner, size));
+  image->Allocate();
+
+  srand(0);
+
+  bool passed = true;
+
+  // The full range of the pixel type, whose bins do not have integer edges
+  FillImage(image, 16, 0, 255);
+  passed &= CompareHistograms(image, 16, 0, 255, 200);
+
+  // A range whose bin edges are pixel values
+  FillImage(image, 8, 64, 192);
+  passed &= CompareHistograms(image, 8, 64, 192, 200);
+
+  // One bin, which every value must fall in
+  passed &= CompareHistograms(image, 1, 64, 192, 20);
+
+  if(!passed)
+  {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,170 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+/** This program checks that a PatchMatch run that is stopped and resumed from its checkpoint gives exactly
+  * the same NNField as a run that was not stopped. */
+
+// STL
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+
+// POSIX
+#include <unistd.h>
+
+// ITK
+#include "itkImage.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkCovariantVector.h"
+
+// Custom
+#include "BatchSSD.h"
+#include "PatchMatch.h"
+#include "Propagator.h"
+#include "RandomSearch.h"
+#include "TestHelpers.h"
+
+typedef itk::Image<itk::CovariantVector<float, 3>, 2> ImageType;
+typedef BatchSSD<ImageType> DistanceFunctorType;
+typedef Propagator<DistanceFunctorType> PropagatorType;
+typedef RandomSearch<ImageType, DistanceFunctorType> RandomSearchType;
+typedef PatchMatch<ImageType, PropagatorType, RandomSearchType> PatchMatchType;
+
+const unsigned int PatchRadius = 3;
+const unsigned int NumberOfIterations = 6;
+
+/** Compute the NNField of 'targetImage' with matches from 'sourceImage' into 'nnField'. The run either starts from a random field and stops after
+  * 'iterations' iterations, saving checkpoints to 'checkpointFileName' if it is not empty, or, if 'resume' is
+  * set, continues the run saved in 'checkpointFileName' up to NumberOfIterations. Every run uses new functors,
+  * as a resumed run in a new process would. */
+void ComputeNNField(ImageType* const sourceImage, ImageType* const targetImage, const unsigned int iterations,
+                    const std::string& checkpointFileName, const bool resume, NNFieldType* const nnField)
+{
+  DistanceFunctorType patchDistanceFunctor;
+  patchDistanceFunctor.SetSourceImage(sourceImage);
+  patchDistanceFunctor.SetTargetImage(targetImage);
+
+  PropagatorType propagationFunctor;
+  propagationFunctor.SetPatchRadius(PatchRadius);
+  propagationFunctor.SetPatchDistanceFunctor(&patchDistanceFunctor);
+
+  RandomSearchType randomSearchFunctor;
+  randomSearchFunctor.SetPatchRadius(PatchRadius);
+  randomSearchFunctor.SetPatchDistanceFunctor(&patchDistanceFunctor);
+  randomSearchFunctor.SetRandom(false);
+
+  PatchMatchType patchMatch;
+  patchMatch.SetSourceImage(sourceImage);
+  patchMatch.SetTargetImage(targetImage);
+  patchMatch.SetPatchRadius(PatchRadius);
+  patchMatch.SetIterations(iterations);
+  patchMatch.SetWriteIntermediateFields(false);
+  patchMatch.SetVerbose(false);
+  patchMatch.SetPropagationFunctor(&propagationFunctor);
+  patchMatch.SetRandomSearchFunctor(&randomSearchFunctor);
+  patchMatch.SetRandom(false);
+
+  if(resume)
+  {
+    patchMatch.Resume(checkpointFileName);
+  }
+  else
+  {
+    patchMatch.SetCheckpointFileName(checkpointFileName);
+    patchMatch.Compute();
+  }
+
+  ITKHelpers::DeepCopy(patchMatch.GetNNField(), nnField);
+}
+
+/** Create an image of random pixels. */
+ImageType::Pointer CreateRandomImage(const itk::ImageRegion<2>& region)
+{
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions(region);
+  image->Allocate();
+
+  TestHelpers::FillRandom(image.GetPointer(), region);
+
+  return image;
+}
+
+int main(int, char*[])
+{
+  itk::Index<2> corner = {{0, 0}};
+  itk::Size<2> size = {{80, 60}};
+  itk::ImageRegion<2> region(corner, size);
+
+  // Two different images, since an image matched against itself quickly finds every patch exactly
+  srand(0);
+  ImageType::Pointer sourceImage = CreateRandomImage(region);
+  ImageType::Pointer targetImage = CreateRandomImage(region);
+
+  std::stringstream checkpointFileName;
+  checkpointFileName << "/tmp/TestPatchMatchCheckpoint." << getpid() << ".pmc";
+
+  NNFieldType::Pointer uninterruptedNNField = NNFieldType::New();
+  ComputeNNField(sourceImage, targetImage, NumberOfIterations, "", false, uninterruptedNNField);
+
+  // Stop halfway through, after an odd number of iterations so that the propagation direction matters
+  NNFieldType::Pointer stoppedNNField = NNFieldType::New();
+  ComputeNNField(sourceImage, targetImage, NumberOfIterations / 2, checkpointFileName.str(), false, stoppedNNField);
+
+  NNFieldType::Pointer resumedNNField = NNFieldType::New();
+  ComputeNNField(sourceImage, targetImage, NumberOfIterations, checkpointFileName.str(), true, resumedNNField);
+
+  remove(checkpointFileName.str().c_str());
+
+  size_t numberOfDifferentMatches = 0;
+  size_t numberOfImprovedMatches = 0;
+  itk::ImageRegionConstIterator<NNFieldType> uninterruptedIterator(uninterruptedNNField, region);
+  itk::ImageRegionConstIterator<NNFieldType> stoppedIterator(stoppedNNField, region);
+  itk::ImageRegionConstIterator<NNFieldType> resumedIterator(resumedNNField, region);
+  while(!uninterruptedIterator.IsAtEnd())
+  {
+    if(!(uninterruptedIterator.Get() == resumedIterator.Get()))
+    {
+      numberOfDifferentMatches++;
+    }
+    if(resumedIterator.Get().GetScore() < stoppedIterator.Get().GetScore())
+    {
+      numberOfImprovedMatches++;
+    }
+    ++uninterruptedIterator;
+    ++stoppedIterator;
+    ++resumedIterator;
+  }
+
+  std::cout << "The resumed iterations improved " << numberOfImprovedMatches << " matches." << std::endl;
+
+  if(numberOfImprovedMatches == 0)
+  {
+    std::cerr << "The resumed run did not do any work." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if(numberOfDifferentMatches > 0)
+  {
+    std::cerr << numberOfDifferentMatches << " matches of the resumed run differ from the uninterrupted run."
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
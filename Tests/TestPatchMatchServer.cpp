@@ -0,0 +1,258 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+/** This program starts a PatchMatchServer and drives it the way a client would, over its socket. It checks that
+  * a job given in shared memory is answered with a valid field, that a job whose image cannot be read is
+  * answered with an error, and that the admission queue turns away the jobs that do not fit in it. */
+
+// STL
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+// POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// ITK
+#include "itkImage.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkCovariantVector.h"
+
+// Custom
+#include "BatchSSD.h"
+#include "PatchMatchHelpers.h"
+#include "PatchMatchServer.h"
+#include "PatchMatchServerProtocol.h"
+
+typedef itk::Image<itk::CovariantVector<float, 3>, 2> ImageType;
+
+int main(int, char*[])
+{
+  const unsigned int width = 64;
+  const unsigned int height = 48;
+  const unsigned int patchRadius = 3;
+
+  std::stringstream names;
+  names << getpid();
+  const std::string socketPath = "/tmp/TestPatchMatchServer." + names.str() + ".sock";
+  const std::string sharedMemoryName = "/TestPatchMatchServer." + names.str();
+
+  // The client's image, in shared memory
+  const size_t numberOfBytes = width * height * sizeof(ImageType::PixelType);
+  int descriptor = shm_open(sharedMemoryName.c_str(), O_CREAT | O_RDWR, 0600);
+  if(descriptor < 0 || ftruncate(descriptor, numberOfBytes) != 0)
+  {
+    std::cerr << "Could not create the shared memory " << sharedMemoryName << std::endl;
+    return EXIT_FAILURE;
+  }
+  ImageType::PixelType* pixels = static_cast<ImageType::PixelType*>(
+      mmap(nullptr, numberOfBytes, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0));
+  close(descriptor);
+
+  srand(0);
+  for(unsigned int pixelId = 0; pixelId < width * height; ++pixelId)
+  {
+    for(unsigned int component = 0; component < 3; ++component)
+    {
+      pixels[pixelId][component] = rand() % 256;
+    }
+  }
+
+  // The same pixels in an image, to check the scores of the field
+  itk::Index<2> corner = {{0, 0}};
+  itk::Size<2> size = {{width, height}};
+  itk::ImageRegion<2> region(corner, size);
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions(region);
+  image->Allocate();
+  std::memcpy(image->GetBufferPointer(), pixels, numberOfBytes);
+
+  const unsigned int queueCapacity = 2;
+  PatchMatchServer<ImageType> server;
+  server.SetNumberOfThreads(1);
+  server.SetQueueCapacity(queueCapacity);
+  server.SetConnectionTimeout(500);
+  server.Start(socketPath);
+
+  bool passed = true;
+
+  // A valid job
+  PatchMatchServerProtocol::MatchRequest request;
+  request.ImageSource = PatchMatchServerProtocol::SharedMemoryImages;
+  request.SourceName = sharedMemoryName;
+  request.SourceWidth = width;
+  request.SourceHeight = height;
+  request.PatchRadius = patchRadius;
+  request.Iterations = 3;
+
+  PatchMatchServerProtocol::MatchResponse response;
+  if(!PatchMatchServerProtocol::SendRequest(socketPath, request, response) ||
+     response.Status != PatchMatchServerProtocol::StatusSuccess)
+  {
+    std::cerr << "The shared memory job failed." << std::endl;
+    passed = false;
+  }
+  else
+  {
+    NNFieldType::Pointer nnField = NNFieldType::New();
+    unsigned int fieldPatchRadius = PatchMatchHelpers::DeserializeNNField(response.Payload.data(),
+                                                                           response.Payload.size(), nnField);
+    if(fieldPatchRadius != patchRadius || nnField->GetLargestPossibleRegion() != region)
+    {
+      std::cerr << "The field has the wrong size or patch radius." << std::endl;
+      passed = false;
+    }
+
+    BatchSSD<ImageType> patchDistanceFunctor;
+    patchDistanceFunctor.SetImage(image);
+
+    itk::ImageRegion<2> internalRegion = ITKHelpers::GetInternalRegion(region, patchRadius);
+    itk::ImageRegionConstIteratorWithIndex<NNFieldType> nnFieldIterator(nnField, internalRegion);
+    size_t numberOfWrongMatches = 0;
+    while(!nnFieldIterator.IsAtEnd())
+    {
+      const Match& match = nnFieldIterator.Get();
+      itk::ImageRegion<2> queryRegion = ITKHelpers::GetRegionInRadiusAroundPixel(nnFieldIterator.GetIndex(),
+                                                                                 patchRadius);
+      if(!internalRegion.IsInside(ITKHelpers::GetRegionCenter(match.GetRegion())) ||
+         patchDistanceFunctor.Distance(match.GetRegion(), queryRegion) != match.GetScore())
+      {
+        numberOfWrongMatches++;
+      }
+      ++nnFieldIterator;
+    }
+
+    if(numberOfWrongMatches > 0)
+    {
+      std::cerr << numberOfWrongMatches << " matches are outside of the image or have the wrong score." << std::endl;
+      passed = false;
+    }
+  }
+
+  // A job whose image does not exist
+  PatchMatchServerProtocol::MatchRequest missingRequest;
+  missingRequest.SourceName = "/nonexistent/TestPatchMatchServer.png";
+  if(!PatchMatchServerProtocol::SendRequest(socketPath, missingRequest, response) ||
+     response.Status != PatchMatchServerProtocol::StatusError)
+  {
+    std::cerr << "The job with a missing image was not answered with an error." << std::endl;
+    passed = false;
+  }
+  else
+  {
+    std::cout << "Error: " << std::string(response.Payload.begin(), response.Payload.end()) << std::endl;
+  }
+
+  // More jobs at once than one worker and the queue can hold. Every job is either computed or turned away.
+  const unsigned int numberOfClients = 8;
+  std::vector<uint32_t> statuses(numberOfClients, PatchMatchServerProtocol::StatusError);
+  std::vector<std::thread> clients;
+  for(unsigned int clientId = 0; clientId < numberOfClients; ++clientId)
+  {
+    clients.push_back(std::thread([&, clientId]()
+    {
+      PatchMatchServerProtocol::MatchResponse clientResponse;
+      if(PatchMatchServerProtocol::SendRequest(socketPath, request, clientResponse))
+      {
+        statuses[clientId] = clientResponse.Status;
+      }
+    }));
+  }
+  for(unsigned int clientId = 0; clientId < numberOfClients; ++clientId)
+  {
+    clients[clientId].join();
+  }
+
+  unsigned int numberOfSuccesses = 0;
+  unsigned int numberOfBusy = 0;
+  for(unsigned int clientId = 0; clientId < numberOfClients; ++clientId)
+  {
+    numberOfSuccesses += statuses[clientId] == PatchMatchServerProtocol::StatusSuccess;
+    numberOfBusy += statuses[clientId] == PatchMatchServerProtocol::StatusBusy;
+  }
+  std::cout << "Concurrent jobs: " << numberOfSuccesses << " completed, " << numberOfBusy << " busy" << std::endl;
+
+  if(numberOfSuccesses + numberOfBusy != numberOfClients || numberOfSuccesses == 0)
+  {
+    std::cerr << "Some concurrent jobs were neither completed nor turned away." << std::endl;
+    passed = false;
+  }
+
+  // A client that connects and never sends its request. The server must give up on it instead of keeping the
+  // worker, and close the connection without an answer.
+  sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+  int stalledConnection = socket(AF_UNIX, SOCK_STREAM, 0);
+  if(stalledConnection < 0 ||
+     connect(stalledConnection, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+  {
+    std::cerr << "Could not connect the stalled client." << std::endl;
+    passed = false;
+  }
+  else
+  {
+    // The client's own timeout is much longer than the server's, so the read ends because the server hung up
+    PatchMatchServerProtocol::SetTimeout(stalledConnection, 10000);
+    char byte = 0;
+    if(recv(stalledConnection, &byte, 1, 0) != 0)
+    {
+      std::cerr << "The server did not close the connection of the stalled client." << std::endl;
+      passed = false;
+    }
+  }
+  if(stalledConnection >= 0)
+  {
+    close(stalledConnection);
+  }
+
+  server.Stop();
+
+  if(server.GetNumberOfCompletedJobs() != 1 + numberOfSuccesses || server.GetNumberOfFailedJobs() != 2 ||
+     server.GetNumberOfRejectedJobs() != numberOfBusy)
+  {
+    std::cerr << "The server counted " << server.GetNumberOfCompletedJobs() << " completed, "
+              << server.GetNumberOfFailedJobs() << " failed and " << server.GetNumberOfRejectedJobs()
+              << " rejected jobs." << std::endl;
+    passed = false;
+  }
+
+  if(access(socketPath.c_str(), F_OK) == 0)
+  {
+    std::cerr << "The socket file was not removed." << std::endl;
+    passed = false;
+  }
+
+  munmap(pixels, numberOfBytes);
+  shm_unlink(sharedMemoryName.c_str());
+
+  if(!passed)
+  {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,180 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+/** This program edits small regions of a target and a source image whose NNField was computed, and checks that
+  * RecomputeDirty() leaves every match with the score of the edited images, and that the number of pixels it recomputes depends on
+  * the size of the edit rather than on the size of the image. This is checked with BatchSSD, which reads the images,
+  * and with PaddedSSD, whose copies of the images must be refreshed by MarkDirty() and MarkSourceDirty(). */
+
+// STL
+#include <iostream>
+
+// ITK
+#include "itkImage.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkCovariantVector.h"
+
+// Custom
+#include "BatchSSD.h"
+#include "PaddedSSD.h"
+#include "PatchMatch.h"
+#include "Propagator.h"
+#include "RandomSearch.h"
+#include "TestHelpers.h"
+
+typedef itk::Image<itk::CovariantVector<float, 3>, 2> ImageType;
+
+const unsigned int PatchRadius = 3;
+
+/** Match two images of 'imageSize' x 'imageSize' pixels, edit a small square in the middle of each and recompute
+  * the field. Returns the number of recomputed pixels, or 0 if a match has a stale score or if the recomputation
+  * used the mean/variance bound of the whole images. Two different images are used since an image matched against
+  * itself finds its own patches, whose scores stay 0 whatever the edit. The scores are checked with a functor made
+  * after the edit. */
+template <typename TPatchDistanceFunctor>
+size_t EditAndRecompute(const unsigned int imageSize)
+{
+  typedef Propagator<TPatchDistanceFunctor> PropagatorType;
+  typedef RandomSearch<ImageType, TPatchDistanceFunctor> RandomSearchType;
+  typedef PatchMatch<ImageType, PropagatorType, RandomSearchType> PatchMatchType;
+
+  itk::Index<2> corner = {{0, 0}};
+  itk::Size<2> size = {{imageSize, imageSize}};
+  itk::ImageRegion<2> region(corner, size);
+
+  ImageType::Pointer sourceImage = ImageType::New();
+  sourceImage->SetRegions(region);
+  sourceImage->Allocate();
+  TestHelpers::FillRandom(sourceImage.GetPointer(), region);
+
+  ImageType::Pointer targetImage = ImageType::New();
+  targetImage->SetRegions(region);
+  targetImage->Allocate();
+  TestHelpers::FillRandom(targetImage.GetPointer(), region);
+
+  TPatchDistanceFunctor patchDistanceFunctor;
+  patchDistanceFunctor.SetSourceImage(sourceImage);
+  patchDistanceFunctor.SetTargetImage(targetImage);
+
+  PropagatorType propagationFunctor;
+  propagationFunctor.SetPatchRadius(PatchRadius);
+  propagationFunctor.SetPatchDistanceFunctor(&patchDistanceFunctor);
+
+  RandomSearchType randomSearchFunctor;
+  randomSearchFunctor.SetPatchRadius(PatchRadius);
+  randomSearchFunctor.SetPatchDistanceFunctor(&patchDistanceFunctor);
+  randomSearchFunctor.SetRandom(false);
+
+  PatchMatchType patchMatch;
+  patchMatch.SetSourceImage(sourceImage);
+  patchMatch.SetTargetImage(targetImage);
+  patchMatch.SetPatchRadius(PatchRadius);
+  patchMatch.SetIterations(3);
+  patchMatch.SetWriteIntermediateFields(false);
+  patchMatch.SetVerbose(false);
+  patchMatch.SetPropagationFunctor(&propagationFunctor);
+  patchMatch.SetRandomSearchFunctor(&randomSearchFunctor);
+  patchMatch.SetRandom(false);
+  // Compute() uses the bound, RecomputeDirty() must not rebuild it
+  patchMatch.SetUseMeanVarianceBound(true);
+  patchMatch.Compute();
+
+  // The edits
+  itk::Index<2> editCorner = {{imageSize / 2, imageSize / 2}};
+  itk::Size<2> editSize = {{4, 4}};
+  itk::ImageRegion<2> editRegion(editCorner, editSize);
+  TestHelpers::FillRandom(targetImage.GetPointer(), editRegion);
+  TestHelpers::FillRandom(sourceImage.GetPointer(), editRegion);
+
+  // The reverse index is maintained by default, so the source edit does not need a pass over the whole field
+  if(!patchMatch.GetReverseIndex()->IsBuilt())
+  {
+    std::cerr << "Compute() did not build the reverse index" << std::endl;
+    return 0;
+  }
+
+  // The target edit is marked with a mask covering just its bounding box, whose rows merge into one region
+  itk::Image<bool, 2>::Pointer dirtyMask = itk::Image<bool, 2>::New();
+  dirtyMask->SetRegions(editRegion);
+  dirtyMask->Allocate();
+  dirtyMask->FillBuffer(true);
+
+  patchMatch.MarkDirty(dirtyMask);
+  patchMatch.MarkSourceDirty(editRegion);
+  const size_t numberOfTests = patchMatch.GetMeanVarianceBound()->GetNumberOfTests();
+  patchMatch.RecomputeDirty();
+  if(patchMatch.GetMeanVarianceBound()->GetNumberOfTests() != numberOfTests)
+  {
+    std::cerr << "RecomputeDirty() used the mean/variance bound" << std::endl;
+    return 0;
+  }
+
+  TPatchDistanceFunctor editedPatchDistanceFunctor;
+  editedPatchDistanceFunctor.SetSourceImage(sourceImage);
+  editedPatchDistanceFunctor.SetTargetImage(targetImage);
+
+  size_t numberOfStaleScores = 0;
+  itk::ImageRegion<2> internalRegion = ITKHelpers::GetInternalRegion(region, PatchRadius);
+  itk::ImageRegionConstIteratorWithIndex<NNFieldType> nnFieldIterator(patchMatch.GetNNField(), internalRegion);
+  while(!nnFieldIterator.IsAtEnd())
+  {
+    const Match& match = nnFieldIterator.Get();
+    itk::ImageRegion<2> queryRegion = ITKHelpers::GetRegionInRadiusAroundPixel(nnFieldIterator.GetIndex(),
+                                                                               PatchRadius);
+    if(editedPatchDistanceFunctor.Distance(match.GetRegion(), queryRegion) != match.GetScore())
+    {
+      numberOfStaleScores++;
+    }
+    ++nnFieldIterator;
+  }
+
+  std::cout << imageSize << "x" << imageSize << ": recomputed " << patchMatch.GetNumberOfRecomputedPixels()
+            << " of " << internalRegion.GetNumberOfPixels() << " pixels" << std::endl;
+
+  if(numberOfStaleScores > 0)
+  {
+    std::cerr << numberOfStaleScores << " matches do not have the score of the edited image." << std::endl;
+    return 0;
+  }
+
+  return patchMatch.GetNumberOfRecomputedPixels();
+}
+
+int main(int, char*[])
+{
+  srand(0);
+
+  size_t smallImageCount = EditAndRecompute<BatchSSD<ImageType> >(64);
+  size_t largeImageCount = EditAndRecompute<BatchSSD<ImageType> >(192);
+  size_t paddedImageCount = EditAndRecompute<PaddedSSD<ImageType> >(64);
+
+  if(smallImageCount == 0 || largeImageCount == 0 || paddedImageCount == 0)
+  {
+    return EXIT_FAILURE;
+  }
+
+  // The large image has 9 times as many pixels, but the same edit should cost about the same
+  if(largeImageCount > 2 * smallImageCount || largeImageCount > 192 * 192 / 10)
+  {
+    std::cerr << "The number of recomputed pixels grows with the image." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,170 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+/** This program checks PatchMatchHelpers::ReconstructImage(): a field that matches every patch to itself must
+  * give back the source image exactly, and the result must not depend on the number of threads. */
+
+// STL
+#include <cmath>
+#include <iostream>
+
+// ITK
+#include "itkImage.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIterator.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkCovariantVector.h"
+
+// Custom
+#include "NNField.h"
+#include "PatchMatchHelpers.h"
+
+typedef itk::Image<itk::CovariantVector<float, 3>, 2> ImageType;
+
+const unsigned int PatchRadius = 3;
+
+/** Get the largest difference between the components of two images of the same size. */
+float GetMaximumDifference(const ImageType* const image1, const ImageType* const image2)
+{
+  float maximumDifference = 0.0f;
+  itk::ImageRegionConstIterator<ImageType> iterator1(image1, image1->GetLargestPossibleRegion());
+  itk::ImageRegionConstIterator<ImageType> iterator2(image2, image2->GetLargestPossibleRegion());
+  while(!iterator1.IsAtEnd())
+  {
+    for(unsigned int component = 0; component < 3; ++component)
+    {
+      maximumDifference = std::max(maximumDifference, std::fabs(iterator1.Get()[component] - iterator2.Get()[component]));
+    }
+    ++iterator1;
+    ++iterator2;
+  }
+  return maximumDifference;
+}
+
+/** Reconstruct an image from 'nnField' with 'numberOfThreads' threads. */
+ImageType::Pointer Reconstruct(const NNFieldType* const nnField, const ImageType* const sourceImage,
+                               const float scoreWeightScale, const unsigned int numberOfThreads)
+{
+  ImageType::Pointer output = ImageType::New();
+  output->SetRegions(nnField->GetLargestPossibleRegion());
+  output->Allocate();
+
+  ImageType::PixelType zero;
+  zero.Fill(0);
+  output->FillBuffer(zero);
+
+  PatchMatchHelpers::ReconstructImage(nnField, sourceImage, output.GetPointer(), scoreWeightScale, numberOfThreads);
+  return output;
+}
+
+int main(int, char*[])
+{
+  itk::Index<2> corner = {{0, 0}};
+  itk::Size<2> size = {{57, 43}};
+  itk::ImageRegion<2> region(corner, size);
+  itk::ImageRegion<2> internalRegion = ITKHelpers::GetInternalRegion(region, PatchRadius);
+
+  // Integer values, so that the sums of the votes are exact whatever order they are added in
+  srand(0);
+  ImageType::Pointer sourceImage = ImageType::New();
+  sourceImage->SetRegions(region);
+  sourceImage->Allocate();
+  itk::ImageRegionIterator<ImageType> imageIterator(sourceImage, region);
+  while(!imageIterator.IsAtEnd())
+  {
+    ImageType::PixelType pixel;
+    for(unsigned int component = 0; component < 3; ++component)
+    {
+      pixel[component] = rand() % 256;
+    }
+    imageIterator.Set(pixel);
+    ++imageIterator;
+  }
+
+  // Every patch matched to itself. The patches of the internal region cover every pixel of the image.
+  NNFieldType::Pointer identityNNField = NNFieldType::New();
+  identityNNField->SetRegions(region);
+  identityNNField->Allocate();
+  identityNNField->FillBuffer(Match());
+
+  // Random matches with random scores
+  NNFieldType::Pointer randomNNField = NNFieldType::New();
+  randomNNField->SetRegions(region);
+  randomNNField->Allocate();
+  randomNNField->FillBuffer(Match());
+
+  itk::ImageRegionIteratorWithIndex<NNFieldType> identityIterator(identityNNField, internalRegion);
+  itk::ImageRegionIterator<NNFieldType> randomIterator(randomNNField, internalRegion);
+  while(!identityIterator.IsAtEnd())
+  {
+    Match identityMatch;
+    identityMatch.SetRegion(ITKHelpers::GetRegionInRadiusAroundPixel(identityIterator.GetIndex(), PatchRadius));
+    identityMatch.SetScore(0.0f);
+    identityIterator.Set(identityMatch);
+
+    Match randomMatch;
+    randomMatch.SetRegion(PatchMatchHelpers::GetRandomRegionInRegion(internalRegion, PatchRadius));
+    randomMatch.SetScore(rand() % 1000);
+    randomIterator.Set(randomMatch);
+
+    ++identityIterator;
+    ++randomIterator;
+  }
+
+  bool passed = true;
+
+  const unsigned int threadCounts[] = {1, 2, 3, 7};
+  for(unsigned int threadCountId = 0; threadCountId < 4; ++threadCountId)
+  {
+    const unsigned int numberOfThreads = threadCounts[threadCountId];
+
+    for(unsigned int weighted = 0; weighted < 2; ++weighted)
+    {
+      const float scoreWeightScale = weighted ? 500.0f : 0.0f;
+
+      ImageType::Pointer reconstructed = Reconstruct(identityNNField, sourceImage, scoreWeightScale, numberOfThreads);
+      float identityDifference = GetMaximumDifference(reconstructed, sourceImage);
+      if(identityDifference > 0.0f)
+      {
+        std::cerr << "The identity field with " << numberOfThreads << " threads (scoreWeightScale "
+                  << scoreWeightScale << ") differs from the source image by " << identityDifference << std::endl;
+        passed = false;
+      }
+
+      // Without weights the votes are integers, so the result must be identical. With weights the sums are
+      // rounded in a different order.
+      ImageType::Pointer singleThreaded = Reconstruct(randomNNField, sourceImage, scoreWeightScale, 1);
+      ImageType::Pointer multiThreaded = Reconstruct(randomNNField, sourceImage, scoreWeightScale, numberOfThreads);
+      float threadDifference = GetMaximumDifference(singleThreaded, multiThreaded);
+      if(threadDifference > (weighted ? 1e-3f : 0.0f))
+      {
+        std::cerr << "The random field with " << numberOfThreads << " threads (scoreWeightScale "
+                  << scoreWeightScale << ") differs from 1 thread by " << threadDifference << std::endl;
+        passed = false;
+      }
+    }
+  }
+
+  if(!passed)
+  {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,147 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+/** This program matches a target image that is a rotated and scaled view of a textured source image, and checks
+  * that TransformedPatchMatch finds the transform of the view (and the corresponding source pixel) for almost
+  * every target pixel. */
+
+// STL
+#include <cmath>
+#include <iostream>
+
+// ITK
+#include "itkImage.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkCovariantVector.h"
+
+// Custom
+#include "TransformedPatchMatch.h"
+
+typedef itk::Image<itk::CovariantVector<float, 3>, 2> ImageType;
+
+const unsigned int PatchRadius = 4;
+
+/** A smooth texture without rotational symmetry, so that patches are only similar under one rotation. */
+ImageType::PixelType Texture(const float x, const float y)
+{
+  ImageType::PixelType pixel;
+  pixel[0] = 128.0f + 50.0f * std::sin(0.21f * x + 0.4f) + 40.0f * std::sin(0.13f * y + 0.07f * x + 1.3f);
+  pixel[1] = 128.0f + 60.0f * std::sin(0.17f * x - 0.11f * y + 2.1f) + 30.0f * std::sin(0.29f * y + 0.6f);
+  pixel[2] = 128.0f + 45.0f * std::sin(0.08f * x + 0.19f * y + 0.9f) + 35.0f * std::sin(0.25f * x - 0.05f * y);
+  return pixel;
+}
+
+int main(int, char*[])
+{
+  itk::Index<2> corner = {{0, 0}};
+  itk::Size<2> sourceSize = {{150, 150}};
+  itk::Size<2> targetSize = {{56, 56}};
+
+  ImageType::Pointer sourceImage = ImageType::New();
+  sourceImage->SetRegions(itk::ImageRegion<2>(corner, sourceSize));
+  sourceImage->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<ImageType> sourceIterator(sourceImage, sourceImage->GetLargestPossibleRegion());
+  while(!sourceIterator.IsAtEnd())
+  {
+    sourceIterator.Set(Texture(sourceIterator.GetIndex()[0], sourceIterator.GetIndex()[1]));
+    ++sourceIterator;
+  }
+
+  TransformedPatchMatch<ImageType> transformedPatchMatch;
+  TransformedImageCache<ImageType>* cache = transformedPatchMatch.GetCache();
+  cache->SetNumberOfAngles(8);
+  cache->SetNumberOfScales(3);
+  cache->SetMinimumScale(0.8f);
+  cache->SetMaximumScale(1.25f);
+
+  // The target pixel p shows the source point A * (p - targetCenter) + sourceCenter, with A the rotation by 45
+  // degrees and scaling by 1.25 of one of the transforms of the cache
+  const unsigned int expectedTransformId = cache->GetTransformId(1, 2);
+  const float angle = cache->GetAngle(expectedTransformId);
+  const float scale = cache->GetScale(expectedTransformId);
+  const float targetCenter[2] = {28.0f, 28.0f};
+  const float sourceCenter[2] = {75.0f, 75.0f};
+
+  ImageType::Pointer targetImage = ImageType::New();
+  targetImage->SetRegions(itk::ImageRegion<2>(corner, targetSize));
+  targetImage->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<ImageType> targetIterator(targetImage, targetImage->GetLargestPossibleRegion());
+  while(!targetIterator.IsAtEnd())
+  {
+    const float dx = targetIterator.GetIndex()[0] - targetCenter[0];
+    const float dy = targetIterator.GetIndex()[1] - targetCenter[1];
+    targetIterator.Set(Texture(sourceCenter[0] + scale * (std::cos(angle) * dx - std::sin(angle) * dy),
+                               sourceCenter[1] + scale * (std::sin(angle) * dx + std::cos(angle) * dy)));
+    ++targetIterator;
+  }
+
+  transformedPatchMatch.SetSourceImage(sourceImage);
+  transformedPatchMatch.SetTargetImage(targetImage);
+  transformedPatchMatch.SetPatchRadius(PatchRadius);
+  transformedPatchMatch.SetIterations(6);
+  transformedPatchMatch.SetSeed(0);
+  transformedPatchMatch.SetVerbose(false);
+  transformedPatchMatch.Compute();
+
+  itk::ImageRegion<2> targetInternalRegion =
+      ITKHelpers::GetInternalRegion(targetImage->GetLargestPossibleRegion(), PatchRadius);
+
+  size_t numberOfCorrectTransforms = 0;
+  size_t numberOfCorrectSourceCenters = 0;
+  itk::ImageRegionConstIteratorWithIndex<TransformedNNFieldType>
+      nnFieldIterator(transformedPatchMatch.GetTransformedNNField(), targetInternalRegion);
+  while(!nnFieldIterator.IsAtEnd())
+  {
+    const TransformedMatch& match = nnFieldIterator.Get();
+    if(match.Valid && match.TransformId == expectedTransformId)
+    {
+      numberOfCorrectTransforms++;
+
+      const float dx = nnFieldIterator.GetIndex()[0] - targetCenter[0];
+      const float dy = nnFieldIterator.GetIndex()[1] - targetCenter[1];
+      const float expectedX = sourceCenter[0] + scale * (std::cos(angle) * dx - std::sin(angle) * dy);
+      const float expectedY = sourceCenter[1] + scale * (std::sin(angle) * dx + std::cos(angle) * dy);
+
+      // Cache centers are on a grid that is rotated and scaled with respect to the source pixels
+      itk::Index<2> matchSourceCenter = cache->GetSourceCenter(match.CacheCenter, match.TransformId);
+      if(std::abs(matchSourceCenter[0] - expectedX) <= 1.5f && std::abs(matchSourceCenter[1] - expectedY) <= 1.5f)
+      {
+        numberOfCorrectSourceCenters++;
+      }
+    }
+
+    ++nnFieldIterator;
+  }
+
+  const size_t numberOfPixels = targetInternalRegion.GetNumberOfPixels();
+  std::cout << numberOfCorrectTransforms << " of " << numberOfPixels << " pixels found transform "
+            << expectedTransformId << ", " << numberOfCorrectSourceCenters << " of them at the right source pixel"
+            << std::endl;
+
+  if(numberOfCorrectTransforms < 0.9 * numberOfPixels || numberOfCorrectSourceCenters < 0.9 * numberOfPixels)
+  {
+    std::cerr << "TransformedPatchMatch did not find the transform of the target image" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
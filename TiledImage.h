@@ -0,0 +1,129 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#ifndef TiledImage_H
+#define TiledImage_H
+
+// ITK
+#include "itkImage.h"
+#include "itkImageRegion.h"
+#include "itkDefaultConvertPixelTraits.h"
+
+// STL
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/** A float copy of an image in square tiles, with the tiles stored in Z-order (Morton order) and the pixels of
+  * a tile stored row by row with interleaved components. A patch then lies in a few tiles that are close
+  * together in memory, instead of in 2r+1 rows that are a whole image row apart, which on wide images makes
+  * nearly every row of a randomly placed patch a cache and TLB miss. The tiles along the right and bottom
+  * borders are stored whole. Since a patch row can cross tiles, it is read in runs (see GetRunLength). */
+template <typename TImage>
+class TiledImage
+{
+public:
+  typedef typename TImage::PixelType PixelType;
+  typedef itk::DefaultConvertPixelTraits<PixelType> PixelTraitsType;
+
+  /** Copy 'image' into the tiles. */
+  void Compute(const TImage* const image);
+
+  /** Set the side length of a tile, in pixels, as a power of two. The default is 4 (16x16 tiles). */
+  void SetTileSizeLog2(const unsigned int tileSizeLog2)
+  {
+    this->TileSizeLog2 = tileSizeLog2;
+  }
+
+  unsigned int GetTileSize() const
+  {
+    return 1u << this->TileSizeLog2;
+  }
+
+  bool IsComputed() const
+  {
+    return !this->TileOffsets.empty();
+  }
+
+  /** Release the tiles. */
+  void Clear()
+  {
+    this->Data.reset();
+    this->TileOffsets.clear();
+  }
+
+  const itk::ImageRegion<2>& GetRegion() const
+  {
+    return this->Region;
+  }
+
+  unsigned int GetNumberOfComponents() const
+  {
+    return this->NumberOfComponents;
+  }
+
+  /** Get the components of the pixel at 'index'. The components of the next GetRunLength(index) - 1 pixels of
+    * the row follow them. */
+  const float* GetPixel(const itk::Index<2>& index) const
+  {
+    assert(IsComputed());
+    assert(this->Region.IsInside(index));
+
+    const size_t x = index[0] - this->Region.GetIndex()[0];
+    const size_t y = index[1] - this->Region.GetIndex()[1];
+    const size_t mask = GetTileSize() - 1;
+
+    const size_t tileOffset = this->TileOffsets[(y >> this->TileSizeLog2) * this->TilesPerRow + (x >> this->TileSizeLog2)];
+    return this->Tiles + tileOffset + (((y & mask) << this->TileSizeLog2) + (x & mask)) * this->NumberOfComponents;
+  }
+
+  /** Get the number of pixels from 'index' to the end of its row in its tile, including itself. */
+  unsigned int GetRunLength(const itk::Index<2>& index) const
+  {
+    const size_t x = index[0] - this->Region.GetIndex()[0];
+    return GetTileSize() - (x & (GetTileSize() - 1));
+  }
+
+  /** Interleave the bits of 'x' and 'y', with those of 'x' in the even positions. */
+  static uint64_t MortonCode(const uint32_t x, const uint32_t y);
+
+private:
+  itk::ImageRegion<2> Region;
+
+  unsigned int TileSizeLog2 = 4;
+
+  unsigned int NumberOfComponents = 0;
+
+  size_t TilesPerRow = 0;
+
+  /** The offset of the first component of each tile, indexed by its row of tiles times TilesPerRow plus its
+    * column of tiles. */
+  std::vector<size_t> TileOffsets;
+
+  /** The allocation, which is larger than the tiles by a cache line so that they can be aligned. */
+  std::unique_ptr<float[]> Data;
+
+  /** The first tile, aligned to a cache line. */
+  float* Tiles = nullptr;
+};
+
+#include "TiledImage.hpp"
+
+#endif
@@ -0,0 +1,106 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#ifndef TiledImage_HPP
+#define TiledImage_HPP
+
+#include "TiledImage.h"
+
+// STL
+#include <algorithm>
+#include <utility>
+
+template <typename TImage>
+uint64_t TiledImage<TImage>::MortonCode(const uint32_t x, const uint32_t y)
+{
+  // Spread the bits of a 32 bit value into the even bits of a 64 bit value
+  auto spread = [](uint64_t value)
+  {
+    value = (value | (value << 16)) & 0x0000FFFF0000FFFFull;
+    value = (value | (value << 8)) & 0x00FF00FF00FF00FFull;
+    value = (value | (value << 4)) & 0x0F0F0F0F0F0F0F0Full;
+    value = (value | (value << 2)) & 0x3333333333333333ull;
+    value = (value | (value << 1)) & 0x5555555555555555ull;
+    return value;
+  };
+
+  return spread(x) | (spread(y) << 1);
+}
+
+template <typename TImage>
+void TiledImage<TImage>::Compute(const TImage* const image)
+{
+  assert(image);
+
+  this->Region = image->GetLargestPossibleRegion();
+  this->NumberOfComponents = PixelTraitsType::GetNumberOfComponents();
+
+  const size_t tileSize = GetTileSize();
+  const size_t width = this->Region.GetSize()[0];
+  const size_t height = this->Region.GetSize()[1];
+
+  this->TilesPerRow = (width + tileSize - 1) / tileSize;
+  const size_t tilesPerColumn = (height + tileSize - 1) / tileSize;
+  const size_t numberOfTiles = this->TilesPerRow * tilesPerColumn;
+  const size_t floatsPerTile = tileSize * tileSize * this->NumberOfComponents;
+
+  // The tiles are stored in the order of their Morton codes. Ranking the codes, rather than using them as
+  // offsets, leaves no holes when the number of tiles per side is not a power of two.
+  std::vector<std::pair<uint64_t, size_t> > codes(numberOfTiles);
+  for(size_t tileY = 0; tileY < tilesPerColumn; ++tileY)
+  {
+    for(size_t tileX = 0; tileX < this->TilesPerRow; ++tileX)
+    {
+      const size_t tileId = tileY * this->TilesPerRow + tileX;
+      codes[tileId] = std::make_pair(MortonCode(tileX, tileY), tileId);
+    }
+  }
+  std::sort(codes.begin(), codes.end());
+
+  this->TileOffsets.resize(numberOfTiles);
+  for(size_t rank = 0; rank < numberOfTiles; ++rank)
+  {
+    this->TileOffsets[codes[rank].second] = rank * floatsPerTile;
+  }
+
+  const size_t cacheLineFloats = 64 / sizeof(float);
+  const size_t numberOfFloats = numberOfTiles * floatsPerTile;
+  this->Data.reset(new float[numberOfFloats + cacheLineFloats]);
+  this->Tiles = reinterpret_cast<float*>((reinterpret_cast<std::uintptr_t>(this->Data.get()) + 63) / 64 * 64);
+  std::fill(this->Tiles, this->Tiles + numberOfFloats, 0.0f);
+
+  const PixelType* imageBuffer = image->GetBufferPointer() + image->ComputeOffset(this->Region.GetIndex());
+  const itk::SizeValueType imageRowStride = image->GetBufferedRegion().GetSize()[0];
+
+  for(size_t y = 0; y < height; ++y)
+  {
+    const PixelType* imageRow = imageBuffer + y * imageRowStride;
+    for(size_t x = 0; x < width; ++x)
+    {
+      float* value = this->Tiles + this->TileOffsets[(y >> this->TileSizeLog2) * this->TilesPerRow + (x >> this->TileSizeLog2)] +
+                     (((y & (tileSize - 1)) << this->TileSizeLog2) + (x & (tileSize - 1))) * this->NumberOfComponents;
+      for(unsigned int component = 0; component < this->NumberOfComponents; ++component)
+      {
+        value[component] = static_cast<float>(PixelTraitsType::GetNthComponent(component, imageRow[x]));
+      }
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,184 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#ifndef TiledSSD_H
+#define TiledSSD_H
+
+// ITK
+#include "itkImage.h"
+#include "itkImageRegion.h"
+
+// STL
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+// Custom
+#include "PaddedImage.h"
+#include "TiledImage.h"
+
+/** A sum of squared differences patch distance functor with the interface of BatchSSD that reads the candidate
+  * (source) patches from a TiledImage copy of the source image and the query (target) patches from a PaddedImage
+  * copy of the target image. Random search scatters the candidates over the whole source image, and in the tiled
+  * layout each of them touches a few tiles instead of 2r+1 distant rows. Each patch row is scored in runs that
+  * end at the tile borders. As with PaddedSSD, the copies are made on the first distance (or by Compute()) and
+  * Clear() must be called after an image is modified. */
+template <typename TImage>
+class TiledSSD
+{
+public:
+  typedef TImage ImageType;
+
+  /** Set the image from which both the query and the candidate patches are read. */
+  void SetImage(TImage* const image)
+  {
+    this->SourceImage = image;
+    this->TargetImage = image;
+    Clear();
+  }
+
+  /** Set the image from which the candidate (source) patches are read. */
+  void SetSourceImage(TImage* const sourceImage)
+  {
+    this->SourceImage = sourceImage;
+    Clear();
+  }
+
+  /** Get the image from which the candidate (source) patches are read. */
+  TImage* GetSourceImage() const
+  {
+    return this->SourceImage;
+  }
+
+  /** Set the image from which the query (target) patches are read. */
+  void SetTargetImage(TImage* const targetImage)
+  {
+    this->TargetImage = targetImage;
+    Clear();
+  }
+
+  /** Set the side length of the source tiles as a power of two (see TiledImage). */
+  void SetTileSizeLog2(const unsigned int tileSizeLog2)
+  {
+    this->Source.SetTileSizeLog2(tileSizeLog2);
+    Clear();
+  }
+
+  /** Make the copies of the images. This must be done before the functor is shared between threads, since
+    * otherwise the first distance does it. */
+  void Compute()
+  {
+    assert(this->SourceImage);
+    assert(this->TargetImage);
+
+    this->Source.Compute(this->SourceImage);
+    this->Target.Compute(this->TargetImage, 0);
+  }
+
+  /** Discard the copies, so that the images are copied again by the next distance. */
+  void Clear()
+  {
+    this->Source.Clear();
+    this->Target.Clear();
+  }
+
+  /** Compute the distance between a source patch ('region1') and a target patch ('region2'). */
+  float Distance(const itk::ImageRegion<2>& region1, const itk::ImageRegion<2>& region2)
+  {
+    float score = 0.0f;
+    Distance(region2, &region1, 1, &score);
+    return score;
+  }
+
+  /** Compute the distance between 'queryRegion' and each of the 'numberOfCandidates' regions
+    * in 'candidateRegions', storing them in the corresponding entries of 'scores'. */
+  void Distance(const itk::ImageRegion<2>& queryRegion, const itk::ImageRegion<2>* const candidateRegions,
+                const size_t numberOfCandidates, float* const scores)
+  {
+    if(!this->Source.IsComputed())
+    {
+      Compute();
+    }
+
+    const unsigned int numberOfComponents = this->Source.GetNumberOfComponents();
+    const itk::IndexValueType patchWidth = queryRegion.GetSize()[0];
+    const itk::IndexValueType patchHeight = queryRegion.GetSize()[1];
+    const size_t targetRowStride = this->Target.GetRowStride();
+
+    const float* const queryCorner = this->Target.GetPixel(queryRegion.GetIndex());
+
+    for(size_t candidateId = 0; candidateId < numberOfCandidates; ++candidateId)
+    {
+      assert(candidateRegions[candidateId].GetSize() == queryRegion.GetSize());
+      assert(this->Source.GetRegion().IsInside(candidateRegions[candidateId]));
+
+      itk::Index<2> candidateIndex = candidateRegions[candidateId].GetIndex();
+      const itk::IndexValueType firstColumn = candidateIndex[0];
+      const float* queryRow = queryCorner;
+
+      float sum = 0.0f;
+      for(itk::IndexValueType row = 0; row < patchHeight; ++row, ++candidateIndex[1])
+      {
+        const float* queryValue = queryRow;
+        for(candidateIndex[0] = firstColumn; candidateIndex[0] < firstColumn + patchWidth; )
+        {
+          const itk::IndexValueType runLength = std::min<itk::IndexValueType>(this->Source.GetRunLength(candidateIndex),
+                                                                             firstColumn + patchWidth - candidateIndex[0]);
+          const float* candidateValue = this->Source.GetPixel(candidateIndex);
+          const size_t runValues = runLength * numberOfComponents;
+          for(size_t valueId = 0; valueId < runValues; ++valueId)
+          {
+            float difference = queryValue[valueId] - candidateValue[valueId];
+            sum += difference * difference;
+          }
+          queryValue += runValues;
+          candidateIndex[0] += runLength;
+        }
+        queryRow += targetRowStride;
+      }
+
+      scores[candidateId] = sum;
+    }
+  }
+
+  /** Convenience overload of the batched distance for a vector of candidates. */
+  void Distance(const itk::ImageRegion<2>& queryRegion, const std::vector<itk::ImageRegion<2> >& candidateRegions,
+                std::vector<float>& scores)
+  {
+    scores.resize(candidateRegions.size());
+    if(candidateRegions.empty())
+    {
+      return;
+    }
+    Distance(queryRegion, candidateRegions.data(), candidateRegions.size(), scores.data());
+  }
+
+private:
+  /** The image from which candidate (source) patches are read. */
+  TImage* SourceImage = nullptr;
+
+  /** The image from which query (target) patches are read. */
+  TImage* TargetImage = nullptr;
+
+  TiledImage<TImage> Source;
+
+  PaddedImage<TImage> Target;
+};
+
+#endif
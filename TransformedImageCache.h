@@ -0,0 +1,188 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#ifndef TransformedImageCache_H
+#define TransformedImageCache_H
+
+// ITK
+#include "itkImage.h"
+#include "itkImageRegion.h"
+#include "itkDefaultConvertPixelTraits.h"
+
+// STL
+#include <cassert>
+#include <vector>
+
+/** Copies of a source image resampled at a discrete set of rotations and scales, so that the distance to a
+  * rotated and scaled source patch costs the same as a plain SSD instead of interpolating on the fly.
+  * Transform 't' maps a patch offset 'd' to the source offset A_t * d, where A_t is a rotation by GetAngle(t)
+  * times a scaling by GetScale(t). Its cached image is J_t(q) = I(A_t * q) (bilinearly interpolated), so the
+  * transformed patch centered at source point A_t * q is the plain, axis aligned patch of J_t centered at 'q'.
+  * Positions 'q' are called cache centers. Since A_t is linear, shifting a cache center by an offset shifts
+  * the patch by the same offset in transformed coordinates, which is what makes propagation work unchanged.
+  * Memory is NumberOfAngles * NumberOfScales float copies of the (slightly enlarged) source image. */
+template <typename TImage>
+class TransformedImageCache
+{
+public:
+  typedef typename TImage::PixelType PixelType;
+  typedef itk::DefaultConvertPixelTraits<PixelType> PixelTraitsType;
+
+  /** Resample 'sourceImage' at every transform, and find the cache centers whose transformed patches of
+    * radius 'patchRadius' are entirely inside it. */
+  void Compute(const TImage* const sourceImage, const unsigned int patchRadius);
+
+  /** Set the number of rotations, evenly spaced over a full turn starting at 0. */
+  void SetNumberOfAngles(const unsigned int numberOfAngles)
+  {
+    this->NumberOfAngles = numberOfAngles;
+  }
+
+  /** Set the number of scales, geometrically spaced from the MinimumScale to the MaximumScale. With an odd
+    * number of scales and MinimumScale * MaximumScale = 1, the middle one is 1. */
+  void SetNumberOfScales(const unsigned int numberOfScales)
+  {
+    this->NumberOfScales = numberOfScales;
+  }
+
+  void SetMinimumScale(const float minimumScale)
+  {
+    this->MinimumScale = minimumScale;
+  }
+
+  void SetMaximumScale(const float maximumScale)
+  {
+    this->MaximumScale = maximumScale;
+  }
+
+  unsigned int GetNumberOfAngles() const
+  {
+    return this->NumberOfAngles;
+  }
+
+  unsigned int GetNumberOfScales() const
+  {
+    return this->NumberOfScales;
+  }
+
+  unsigned int GetNumberOfTransforms() const
+  {
+    return this->NumberOfAngles * this->NumberOfScales;
+  }
+
+  /** Get the transform with rotation 'angleId' and scale 'scaleId'. */
+  unsigned int GetTransformId(const unsigned int angleId, const unsigned int scaleId) const
+  {
+    return scaleId * this->NumberOfAngles + angleId;
+  }
+
+  unsigned int GetAngleId(const unsigned int transformId) const
+  {
+    return transformId % this->NumberOfAngles;
+  }
+
+  unsigned int GetScaleId(const unsigned int transformId) const
+  {
+    return transformId / this->NumberOfAngles;
+  }
+
+  /** Get the rotation of a transform, in radians. */
+  float GetAngle(const unsigned int transformId) const;
+
+  float GetScale(const unsigned int transformId) const;
+
+  /** Get the transform that does not rotate or scale, or the closest one if there is none. */
+  unsigned int GetIdentityTransformId() const;
+
+  /** Get the region of the cache centers of a transform. */
+  const itk::ImageRegion<2>& GetRegion(const unsigned int transformId) const
+  {
+    return this->Transforms[transformId].Region;
+  }
+
+  /** Determine if the transformed patch centered at 'cacheCenter' is entirely inside the source image. */
+  bool IsValid(const itk::Index<2>& cacheCenter, const unsigned int transformId) const
+  {
+    const TransformData& transform = this->Transforms[transformId];
+    return transform.Region.IsInside(cacheCenter) && transform.ValidCenters[ComputeOffset(transform, cacheCenter)];
+  }
+
+  /** Get the source image pixel closest to the center of the transformed patch centered at 'cacheCenter'. */
+  itk::Index<2> GetSourceCenter(const itk::Index<2>& cacheCenter, const unsigned int transformId) const;
+
+  /** Get the cache center of transform 'transformId' closest to the source pixel 'sourceCenter'. */
+  itk::Index<2> GetCacheCenter(const itk::Index<2>& sourceCenter, const unsigned int transformId) const;
+
+  /** Copy the components of the patch of 'targetImage' centered at 'targetCenter' into 'targetPatch' in the
+    * order the Distance() expects them. */
+  void GetTargetPatch(const TImage* const targetImage, const itk::Index<2>& targetCenter,
+                      std::vector<float>& targetPatch) const;
+
+  /** Compute the sum of squared differences between the transformed patch centered at 'cacheCenter' and a
+    * target patch copied with GetTargetPatch(). The patch must be valid. */
+  float Distance(const itk::Index<2>& cacheCenter, const unsigned int transformId,
+                 const std::vector<float>& targetPatch) const;
+
+private:
+  unsigned int NumberOfAngles = 8;
+
+  unsigned int NumberOfScales = 3;
+
+  float MinimumScale = 0.8f;
+
+  float MaximumScale = 1.25f;
+
+  unsigned int PatchRadius = 0;
+
+  itk::ImageRegion<2> SourceRegion;
+
+  /** The resampled image of one transform. */
+  struct TransformData
+  {
+    /** The matrix A of the transform, row major. */
+    float Matrix[4];
+
+    /** The inverse of the Matrix, row major. */
+    float InverseMatrix[4];
+
+    /** The region of the cache centers, in the (rotated and scaled) coordinates of the cached image. */
+    itk::ImageRegion<2> Region;
+
+    /** The interpolated components of every pixel of the Region, in raster order. */
+    std::vector<float> Values;
+
+    /** Whether the transformed patch centered at each pixel of the Region is entirely inside the source image. */
+    std::vector<unsigned char> ValidCenters;
+  };
+
+  std::vector<TransformData> Transforms;
+
+  static size_t ComputeOffset(const TransformData& transform, const itk::Index<2>& index)
+  {
+    return (index[1] - transform.Region.GetIndex()[1]) * transform.Region.GetSize()[0] +
+           (index[0] - transform.Region.GetIndex()[0]);
+  }
+
+  /** Resample the source image for one transform. */
+  void ComputeTransform(const TImage* const sourceImage, TransformData& transform) const;
+};
+
+#include "TransformedImageCache.hpp"
+
+#endif
@@ -0,0 +1,298 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#ifndef TransformedImageCache_HPP
+#define TransformedImageCache_HPP
+
+#include "TransformedImageCache.h"
+
+// STL
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+
+template <typename TImage>
+void TransformedImageCache<TImage>::Compute(const TImage* const sourceImage, const unsigned int patchRadius)
+{
+  assert(sourceImage);
+
+  if(this->NumberOfAngles == 0 || this->NumberOfScales == 0)
+  {
+    throw std::runtime_error("TransformedImageCache: There must be at least one angle and one scale!");
+  }
+
+  this->PatchRadius = patchRadius;
+  this->SourceRegion = sourceImage->GetLargestPossibleRegion();
+  this->Transforms.resize(GetNumberOfTransforms());
+
+  for(unsigned int transformId = 0; transformId < this->Transforms.size(); ++transformId)
+  {
+    const float angle = GetAngle(transformId);
+    const float scale = GetScale(transformId);
+
+    TransformData& transform = this->Transforms[transformId];
+    transform.Matrix[0] = scale * std::cos(angle);
+    transform.Matrix[1] = -scale * std::sin(angle);
+    transform.Matrix[2] = scale * std::sin(angle);
+    transform.Matrix[3] = scale * std::cos(angle);
+
+    transform.InverseMatrix[0] = std::cos(angle) / scale;
+    transform.InverseMatrix[1] = std::sin(angle) / scale;
+    transform.InverseMatrix[2] = -std::sin(angle) / scale;
+    transform.InverseMatrix[3] = std::cos(angle) / scale;
+  }
+
+  // The transforms are independent, so each thread resamples every numberOfThreads'th one
+  const unsigned int numberOfThreads = std::min<unsigned int>(std::max(1u, std::thread::hardware_concurrency()),
+                                                              this->Transforms.size());
+
+  std::vector<std::thread> threads;
+  for(unsigned int threadId = 0; threadId < numberOfThreads; ++threadId)
+  {
+    threads.push_back(std::thread([this, threadId, numberOfThreads, sourceImage]()
+    {
+      for(size_t transformId = threadId; transformId < this->Transforms.size(); transformId += numberOfThreads)
+      {
+        ComputeTransform(sourceImage, this->Transforms[transformId]);
+      }
+    }));
+  }
+  for(size_t threadId = 0; threadId < threads.size(); ++threadId)
+  {
+    threads[threadId].join();
+  }
+}
+
+template <typename TImage>
+void TransformedImageCache<TImage>::ComputeTransform(const TImage* const sourceImage, TransformData& transform) const
+{
+  const unsigned int numberOfComponents = PixelTraitsType::GetNumberOfComponents();
+  const float* a = transform.Matrix;
+  const float* inverse = transform.InverseMatrix;
+
+  const float sourceBegin[2] = {static_cast<float>(this->SourceRegion.GetIndex()[0]),
+                                static_cast<float>(this->SourceRegion.GetIndex()[1])};
+  const float sourceEnd[2] = {sourceBegin[0] + this->SourceRegion.GetSize()[0] - 1,
+                              sourceBegin[1] + this->SourceRegion.GetSize()[1] - 1};
+
+  // The cached image covers the source image mapped back through the transform
+  float lower[2] = {1e30f, 1e30f};
+  float upper[2] = {-1e30f, -1e30f};
+  for(unsigned int cornerId = 0; cornerId < 4; ++cornerId)
+  {
+    const float x = (cornerId & 1) ? sourceEnd[0] : sourceBegin[0];
+    const float y = (cornerId & 2) ? sourceEnd[1] : sourceBegin[1];
+    const float cacheX = inverse[0] * x + inverse[1] * y;
+    const float cacheY = inverse[2] * x + inverse[3] * y;
+    lower[0] = std::min(lower[0], cacheX);
+    lower[1] = std::min(lower[1], cacheY);
+    upper[0] = std::max(upper[0], cacheX);
+    upper[1] = std::max(upper[1], cacheY);
+  }
+
+  itk::Index<2> regionIndex = {{static_cast<itk::IndexValueType>(std::floor(lower[0])),
+                                static_cast<itk::IndexValueType>(std::floor(lower[1]))}};
+  itk::Size<2> regionSize = {{static_cast<itk::SizeValueType>(std::ceil(upper[0]) - regionIndex[0] + 1),
+                              static_cast<itk::SizeValueType>(std::ceil(upper[1]) - regionIndex[1] + 1)}};
+  transform.Region = itk::ImageRegion<2>(regionIndex, regionSize);
+
+  transform.Values.assign(transform.Region.GetNumberOfPixels() * numberOfComponents, 0.0f);
+  transform.ValidCenters.assign(transform.Region.GetNumberOfPixels(), 0);
+
+  const PixelType* sourceBuffer = sourceImage->GetBufferPointer();
+  const itk::SizeValueType rowStride = sourceImage->GetBufferedRegion().GetSize()[0];
+  const itk::Index<2> sourceCorner = this->SourceRegion.GetIndex();
+
+  // A small tolerance keeps the untransformed patches exactly on the border valid despite rounding
+  const float tolerance = 1e-3f;
+  auto isInside = [&](const float x, const float y)
+  {
+    return x >= sourceBegin[0] - tolerance && x <= sourceEnd[0] + tolerance &&
+           y >= sourceBegin[1] - tolerance && y <= sourceEnd[1] + tolerance;
+  };
+
+  const float radius = static_cast<float>(this->PatchRadius);
+
+  size_t pixelId = 0;
+  for(itk::IndexValueType cacheY = regionIndex[1]; cacheY < regionIndex[1] + static_cast<itk::IndexValueType>(regionSize[1]); ++cacheY)
+  {
+    for(itk::IndexValueType cacheX = regionIndex[0]; cacheX < regionIndex[0] + static_cast<itk::IndexValueType>(regionSize[0]); ++cacheX, ++pixelId)
+    {
+      const float x = a[0] * cacheX + a[1] * cacheY;
+      const float y = a[2] * cacheX + a[3] * cacheY;
+
+      if(!isInside(x, y))
+      {
+        continue;
+      }
+
+      // The samples of the transformed patch form a rotated square, so it is inside if its corners are
+      bool valid = cacheX - radius >= regionIndex[0] && cacheY - radius >= regionIndex[1] &&
+                   cacheX + radius < regionIndex[0] + static_cast<itk::IndexValueType>(regionSize[0]) &&
+                   cacheY + radius < regionIndex[1] + static_cast<itk::IndexValueType>(regionSize[1]);
+      for(unsigned int cornerId = 0; cornerId < 4 && valid; ++cornerId)
+      {
+        const float offsetX = (cornerId & 1) ? radius : -radius;
+        const float offsetY = (cornerId & 2) ? radius : -radius;
+        valid = isInside(x + a[0] * offsetX + a[1] * offsetY, y + a[2] * offsetX + a[3] * offsetY);
+      }
+      transform.ValidCenters[pixelId] = valid;
+
+      // Bilinear interpolation, clamped so that the last row and column do not read past the image
+      const float clampedX = std::min(std::max(x, sourceBegin[0]), sourceEnd[0]);
+      const float clampedY = std::min(std::max(y, sourceBegin[1]), sourceEnd[1]);
+      const itk::IndexValueType x0 = static_cast<itk::IndexValueType>(std::floor(clampedX));
+      const itk::IndexValueType y0 = static_cast<itk::IndexValueType>(std::floor(clampedY));
+      const itk::IndexValueType x1 = std::min<itk::IndexValueType>(x0 + 1, static_cast<itk::IndexValueType>(sourceEnd[0]));
+      const itk::IndexValueType y1 = std::min<itk::IndexValueType>(y0 + 1, static_cast<itk::IndexValueType>(sourceEnd[1]));
+      const float weightX = clampedX - x0;
+      const float weightY = clampedY - y0;
+
+      const PixelType& topLeft = sourceBuffer[(y0 - sourceCorner[1]) * rowStride + (x0 - sourceCorner[0])];
+      const PixelType& topRight = sourceBuffer[(y0 - sourceCorner[1]) * rowStride + (x1 - sourceCorner[0])];
+      const PixelType& bottomLeft = sourceBuffer[(y1 - sourceCorner[1]) * rowStride + (x0 - sourceCorner[0])];
+      const PixelType& bottomRight = sourceBuffer[(y1 - sourceCorner[1]) * rowStride + (x1 - sourceCorner[0])];
+
+      float* value = &transform.Values[pixelId * numberOfComponents];
+      for(unsigned int component = 0; component < numberOfComponents; ++component)
+      {
+        const float top = (1.0f - weightX) * PixelTraitsType::GetNthComponent(component, topLeft) +
+                          weightX * PixelTraitsType::GetNthComponent(component, topRight);
+        const float bottom = (1.0f - weightX) * PixelTraitsType::GetNthComponent(component, bottomLeft) +
+                             weightX * PixelTraitsType::GetNthComponent(component, bottomRight);
+        value[component] = (1.0f - weightY) * top + weightY * bottom;
+      }
+    }
+  }
+}
+
+template <typename TImage>
+float TransformedImageCache<TImage>::GetAngle(const unsigned int transformId) const
+{
+  return 2.0f * std::acos(-1.0f) * GetAngleId(transformId) / this->NumberOfAngles;
+}
+
+template <typename TImage>
+float TransformedImageCache<TImage>::GetScale(const unsigned int transformId) const
+{
+  if(this->NumberOfScales < 2)
+  {
+    return 1.0f;
+  }
+
+  const float fraction = static_cast<float>(GetScaleId(transformId)) / (this->NumberOfScales - 1);
+  return this->MinimumScale * std::pow(this->MaximumScale / this->MinimumScale, fraction);
+}
+
+template <typename TImage>
+unsigned int TransformedImageCache<TImage>::GetIdentityTransformId() const
+{
+  unsigned int bestScaleId = 0;
+  for(unsigned int scaleId = 1; scaleId < this->NumberOfScales; ++scaleId)
+  {
+    if(std::abs(std::log(GetScale(GetTransformId(0, scaleId)))) <
+       std::abs(std::log(GetScale(GetTransformId(0, bestScaleId)))))
+    {
+      bestScaleId = scaleId;
+    }
+  }
+  return GetTransformId(0, bestScaleId);
+}
+
+template <typename TImage>
+itk::Index<2> TransformedImageCache<TImage>::GetSourceCenter(const itk::Index<2>& cacheCenter,
+                                                             const unsigned int transformId) const
+{
+  const float* a = this->Transforms[transformId].Matrix;
+  itk::Index<2> sourceCenter = {{std::lround(a[0] * cacheCenter[0] + a[1] * cacheCenter[1]),
+                                 std::lround(a[2] * cacheCenter[0] + a[3] * cacheCenter[1])}};
+  return sourceCenter;
+}
+
+template <typename TImage>
+itk::Index<2> TransformedImageCache<TImage>::GetCacheCenter(const itk::Index<2>& sourceCenter,
+                                                            const unsigned int transformId) const
+{
+  const float* inverse = this->Transforms[transformId].InverseMatrix;
+  itk::Index<2> cacheCenter = {{std::lround(inverse[0] * sourceCenter[0] + inverse[1] * sourceCenter[1]),
+                                std::lround(inverse[2] * sourceCenter[0] + inverse[3] * sourceCenter[1])}};
+  return cacheCenter;
+}
+
+template <typename TImage>
+void TransformedImageCache<TImage>::GetTargetPatch(const TImage* const targetImage, const itk::Index<2>& targetCenter,
+                                                   std::vector<float>& targetPatch) const
+{
+  const unsigned int numberOfComponents = PixelTraitsType::GetNumberOfComponents();
+  const unsigned int patchSideLength = 2 * this->PatchRadius + 1;
+  targetPatch.resize(patchSideLength * patchSideLength * numberOfComponents);
+
+  itk::Index<2> corner = {{targetCenter[0] - static_cast<itk::IndexValueType>(this->PatchRadius),
+                           targetCenter[1] - static_cast<itk::IndexValueType>(this->PatchRadius)}};
+  const PixelType* row = targetImage->GetBufferPointer() + targetImage->ComputeOffset(corner);
+  const itk::SizeValueType rowStride = targetImage->GetBufferedRegion().GetSize()[0];
+
+  float* value = targetPatch.data();
+  for(unsigned int y = 0; y < patchSideLength; ++y)
+  {
+    for(unsigned int x = 0; x < patchSideLength; ++x)
+    {
+      for(unsigned int component = 0; component < numberOfComponents; ++component)
+      {
+        *value++ = static_cast<float>(PixelTraitsType::GetNthComponent(component, row[x]));
+      }
+    }
+    row += rowStride;
+  }
+}
+
+template <typename TImage>
+float TransformedImageCache<TImage>::Distance(const itk::Index<2>& cacheCenter, const unsigned int transformId,
+                                              const std::vector<float>& targetPatch) const
+{
+  assert(IsValid(cacheCenter, transformId));
+
+  const TransformData& transform = this->Transforms[transformId];
+  const unsigned int numberOfComponents = PixelTraitsType::GetNumberOfComponents();
+  const size_t rowLength = (2 * this->PatchRadius + 1) * numberOfComponents;
+  const size_t rowStride = transform.Region.GetSize()[0] * numberOfComponents;
+
+  itk::Index<2> corner = {{cacheCenter[0] - static_cast<itk::IndexValueType>(this->PatchRadius),
+                           cacheCenter[1] - static_cast<itk::IndexValueType>(this->PatchRadius)}};
+  const float* row = &transform.Values[ComputeOffset(transform, corner) * numberOfComponents];
+  const float* targetValue = targetPatch.data();
+
+  // Each patch row is contiguous in the cache, so this is the same loop as a plain SSD
+  float sum = 0.0f;
+  for(unsigned int y = 0; y < 2 * this->PatchRadius + 1; ++y)
+  {
+    for(size_t valueId = 0; valueId < rowLength; ++valueId)
+    {
+      float difference = row[valueId] - targetValue[valueId];
+      sum += difference * difference;
+    }
+    row += rowStride;
+    targetValue += rowLength;
+  }
+
+  return sum;
+}
+
+#endif
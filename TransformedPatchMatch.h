@@ -0,0 +1,168 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#ifndef TransformedPatchMatch_H
+#define TransformedPatchMatch_H
+
+// ITK
+#include "itkImage.h"
+#include "itkImageRegion.h"
+
+// STL
+#include <limits>
+#include <random>
+#include <vector>
+
+// Custom
+#include "NNField.h"
+#include "TransformedImageCache.h"
+
+/** A match that may be rotated and scaled. The source patch is the patch centered at CacheCenter in the cached
+  * image of transform TransformId (see TransformedImageCache). */
+struct TransformedMatch
+{
+  itk::Index<2> CacheCenter = {{0, 0}};
+
+  unsigned int TransformId = 0;
+
+  float Score = std::numeric_limits<float>::max();
+
+  /** False for target pixels that do not have a match. */
+  bool Valid = false;
+};
+
+typedef itk::Image<TransformedMatch, 2> TransformedNNFieldType;
+
+/** This class computes a nearest neighbor field whose matches may be rotated and scaled versions of the source
+  * patches ("The Generalized PatchMatch Correspondence Algorithm", Barnes et al., ECCV 2010). Every target pixel
+  * has a translation, a rotation and a scale. Propagation hands a neighbor's match over with the same rotation
+  * and scale, shifted by the offset to the neighbor in the transformed coordinates, and random search perturbs
+  * all three, with a range that shrinks along with the search window. The patch distances are plain SSDs
+  * against the resampled source images of a TransformedImageCache, whose angles and scales can be set through
+  * GetCache() before Compute(). */
+template <typename TImage>
+class TransformedPatchMatch
+{
+public:
+  /** Perform multiple iterations of propagation and random search. */
+  void Compute();
+
+  /** Set the image to match against itself. */
+  void SetImage(TImage* const image)
+  {
+    this->SourceImage = image;
+    this->TargetImage = image;
+  }
+
+  /** Set the image from which matches are drawn. */
+  void SetSourceImage(TImage* const sourceImage)
+  {
+    this->SourceImage = sourceImage;
+  }
+
+  /** Set the image for which to compute the NNField. */
+  void SetTargetImage(TImage* const targetImage)
+  {
+    this->TargetImage = targetImage;
+  }
+
+  void SetPatchRadius(const unsigned int patchRadius)
+  {
+    this->PatchRadius = patchRadius;
+  }
+
+  void SetIterations(const unsigned int iterations)
+  {
+    this->Iterations = iterations;
+  }
+
+  /** Set whether the progress of Compute() is written to the standard output. */
+  void SetVerbose(const bool verbose)
+  {
+    this->Verbose = verbose;
+  }
+
+  /** Set the seed of the random initialization and search. */
+  void SetSeed(const unsigned int seed)
+  {
+    this->Seed = seed;
+  }
+
+  /** Get the cache of transformed source images, to set its angles and scales. */
+  TransformedImageCache<TImage>* GetCache()
+  {
+    return &this->Cache;
+  }
+
+  /** Get the field of transformed matches. */
+  TransformedNNFieldType* GetTransformedNNField()
+  {
+    return this->NNField;
+  }
+
+  /** Write the matches into a plain NNField (allocated to the size of the target image), each one as the
+    * untransformed source patch centered on the same source pixel, with the transformed score. */
+  void GetNNField(NNFieldType* const nnField) const;
+
+private:
+  TImage* SourceImage = nullptr;
+
+  TImage* TargetImage = nullptr;
+
+  unsigned int PatchRadius = 5;
+
+  unsigned int Iterations = 5;
+
+  unsigned int Seed = 0;
+
+  /** Whether the progress of Compute() is written to the standard output. */
+  bool Verbose = true;
+
+  TransformedImageCache<TImage> Cache;
+
+  TransformedNNFieldType::Pointer NNField = TransformedNNFieldType::New();
+
+  std::mt19937 Generator;
+
+  /** The components of the target patch currently being matched. */
+  std::vector<float> TargetPatch;
+
+  /** Give every target pixel a random valid match. */
+  void RandomlyInitialize(const itk::ImageRegion<2>& targetInternalRegion);
+
+  /** Propagate the matches of the two previous (forward) or next (backward) neighbors of every target pixel. */
+  void Propagate(const itk::ImageRegion<2>& targetInternalRegion, const bool forward);
+
+  /** Try random matches around the current match of every target pixel. */
+  void RandomSearch(const itk::ImageRegion<2>& targetInternalRegion);
+
+  /** Replace the match of 'targetPixel' by the patch at 'cacheCenter' of 'transformId' if it is valid and
+    * better. The TargetPatch must be that of 'targetPixel'. */
+  void TryCandidate(const itk::Index<2>& targetPixel, const itk::Index<2>& cacheCenter, const unsigned int transformId);
+
+  /** Get a random integer in [minimum, maximum]. */
+  int RandomInt(const int minimum, const int maximum)
+  {
+    return std::uniform_int_distribution<int>(minimum, maximum)(this->Generator);
+  }
+};
+
+#include "TransformedPatchMatch.hpp"
+
+#endif
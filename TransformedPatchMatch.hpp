@@ -0,0 +1,265 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#ifndef TransformedPatchMatch_HPP
+#define TransformedPatchMatch_HPP
+
+#include "TransformedPatchMatch.h"
+
+// ITK
+#include "itkImageRegionConstIteratorWithIndex.h"
+
+// STL
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+
+// Submodules
+#include <ITKHelpers/ITKHelpers.h>
+
+template <typename TImage>
+void TransformedPatchMatch<TImage>::Compute()
+{
+  assert(this->SourceImage);
+  assert(this->TargetImage);
+
+  this->Generator.seed(this->Seed);
+
+  this->Cache.Compute(this->SourceImage, this->PatchRadius);
+
+  itk::ImageRegion<2> targetInternalRegion =
+      ITKHelpers::GetInternalRegion(this->TargetImage->GetLargestPossibleRegion(), this->PatchRadius);
+
+  this->NNField->SetRegions(this->TargetImage->GetLargestPossibleRegion());
+  this->NNField->Allocate();
+  this->NNField->FillBuffer(TransformedMatch());
+
+  RandomlyInitialize(targetInternalRegion);
+
+  for(unsigned int iteration = 0; iteration < this->Iterations; ++iteration)
+  {
+    if(this->Verbose)
+    {
+      std::cout << "TransformedPatchMatch iteration " << iteration << std::endl;
+    }
+
+    Propagate(targetInternalRegion, iteration % 2 == 0);
+    RandomSearch(targetInternalRegion);
+  }
+}
+
+template <typename TImage>
+void TransformedPatchMatch<TImage>::RandomlyInitialize(const itk::ImageRegion<2>& targetInternalRegion)
+{
+  itk::ImageRegion<2> sourceInternalRegion =
+      ITKHelpers::GetInternalRegion(this->SourceImage->GetLargestPossibleRegion(), this->PatchRadius);
+
+  if(sourceInternalRegion.GetNumberOfPixels() == 0)
+  {
+    throw std::runtime_error("TransformedPatchMatch: The source image is smaller than a patch!");
+  }
+
+  const unsigned int numberOfTransforms = this->Cache.GetNumberOfTransforms();
+
+  itk::ImageRegionConstIteratorWithIndex<TransformedNNFieldType> nnFieldIterator(this->NNField, targetInternalRegion);
+  while(!nnFieldIterator.IsAtEnd())
+  {
+    const itk::Index<2> targetPixel = nnFieldIterator.GetIndex();
+    this->Cache.GetTargetPatch(this->TargetImage, targetPixel, this->TargetPatch);
+
+    // Rotated and enlarged patches do not fit near the border of the source image, so a few guesses may be needed
+    const unsigned int numberOfGuesses = 16;
+    for(unsigned int guessId = 0; guessId < numberOfGuesses && !this->NNField->GetPixel(targetPixel).Valid; ++guessId)
+    {
+      const unsigned int transformId = RandomInt(0, numberOfTransforms - 1);
+      itk::Index<2> sourceCenter = {{RandomInt(sourceInternalRegion.GetIndex()[0],
+                                               sourceInternalRegion.GetIndex()[0] + sourceInternalRegion.GetSize()[0] - 1),
+                                     RandomInt(sourceInternalRegion.GetIndex()[1],
+                                               sourceInternalRegion.GetIndex()[1] + sourceInternalRegion.GetSize()[1] - 1)}};
+      TryCandidate(targetPixel, this->Cache.GetCacheCenter(sourceCenter, transformId), transformId);
+    }
+
+    ++nnFieldIterator;
+  }
+}
+
+template <typename TImage>
+void TransformedPatchMatch<TImage>::Propagate(const itk::ImageRegion<2>& targetInternalRegion, const bool forward)
+{
+  const itk::OffsetValueType step = forward ? -1 : 1;
+  const itk::Offset<2> propagationOffsets[2] = {{{step, 0}}, {{0, step}}};
+
+  const itk::IndexValueType width = targetInternalRegion.GetSize()[0];
+  const itk::IndexValueType height = targetInternalRegion.GetSize()[1];
+
+  for(itk::IndexValueType row = 0; row < height; ++row)
+  {
+    for(itk::IndexValueType column = 0; column < width; ++column)
+    {
+      itk::Index<2> targetPixel = {{targetInternalRegion.GetIndex()[0] + (forward ? column : width - 1 - column),
+                                    targetInternalRegion.GetIndex()[1] + (forward ? row : height - 1 - row)}};
+
+      bool bufferedTargetPatch = false;
+      for(unsigned int offsetId = 0; offsetId < 2; ++offsetId)
+      {
+        itk::Index<2> neighbor = targetPixel + propagationOffsets[offsetId];
+        if(!targetInternalRegion.IsInside(neighbor))
+        {
+          continue;
+        }
+
+        const TransformedMatch& neighborMatch = this->NNField->GetPixel(neighbor);
+        if(!neighborMatch.Valid)
+        {
+          continue;
+        }
+
+        // Since the transform is linear, the neighbor's offset is the same in the cached image
+        itk::Index<2> cacheCenter = neighborMatch.CacheCenter - propagationOffsets[offsetId];
+
+        const TransformedMatch& currentMatch = this->NNField->GetPixel(targetPixel);
+        if(currentMatch.Valid && currentMatch.TransformId == neighborMatch.TransformId &&
+           currentMatch.CacheCenter == cacheCenter)
+        {
+          continue;
+        }
+
+        if(!bufferedTargetPatch)
+        {
+          this->Cache.GetTargetPatch(this->TargetImage, targetPixel, this->TargetPatch);
+          bufferedTargetPatch = true;
+        }
+
+        TryCandidate(targetPixel, cacheCenter, neighborMatch.TransformId);
+      }
+    }
+  }
+}
+
+template <typename TImage>
+void TransformedPatchMatch<TImage>::RandomSearch(const itk::ImageRegion<2>& targetInternalRegion)
+{
+  itk::ImageRegion<2> sourceRegion = this->SourceImage->GetLargestPossibleRegion();
+  const float initialRadius = std::max(sourceRegion.GetSize()[0], sourceRegion.GetSize()[1]);
+
+  const int numberOfAngles = this->Cache.GetNumberOfAngles();
+  const int numberOfScales = this->Cache.GetNumberOfScales();
+
+  itk::ImageRegionConstIteratorWithIndex<TransformedNNFieldType> nnFieldIterator(this->NNField, targetInternalRegion);
+  while(!nnFieldIterator.IsAtEnd())
+  {
+    const itk::Index<2> targetPixel = nnFieldIterator.GetIndex();
+    ++nnFieldIterator;
+
+    const TransformedMatch currentMatch = this->NNField->GetPixel(targetPixel);
+    if(!currentMatch.Valid)
+    {
+      continue;
+    }
+
+    this->Cache.GetTargetPatch(this->TargetImage, targetPixel, this->TargetPatch);
+
+    const itk::Index<2> sourceCenter = this->Cache.GetSourceCenter(currentMatch.CacheCenter, currentMatch.TransformId);
+    const int angleId = this->Cache.GetAngleId(currentMatch.TransformId);
+    const int scaleId = this->Cache.GetScaleId(currentMatch.TransformId);
+
+    // The window, and the range of the rotation and scale perturbations, shrink exponentially as in PatchMatch
+    // paper section 3.2. The windows are centered on the current match, as in RandomSearch.
+    for(float radius = initialRadius; radius >= 1.0f; radius *= 0.5f)
+    {
+      const float fraction = radius / initialRadius;
+      const int angleRange = static_cast<int>(std::ceil(fraction * numberOfAngles / 2));
+      const int scaleRange = static_cast<int>(std::ceil(fraction * (numberOfScales - 1)));
+
+      const int candidateAngleId = ((angleId + RandomInt(-angleRange, angleRange)) % numberOfAngles + numberOfAngles) %
+                                   numberOfAngles;
+      const int candidateScaleId = std::min(std::max(scaleId + RandomInt(-scaleRange, scaleRange), 0), numberOfScales - 1);
+      const unsigned int candidateTransformId = this->Cache.GetTransformId(candidateAngleId, candidateScaleId);
+
+      const int windowRadius = static_cast<int>(radius);
+      itk::Index<2> candidateSourceCenter = {{sourceCenter[0] + RandomInt(-windowRadius, windowRadius),
+                                              sourceCenter[1] + RandomInt(-windowRadius, windowRadius)}};
+
+      TryCandidate(targetPixel, this->Cache.GetCacheCenter(candidateSourceCenter, candidateTransformId),
+                   candidateTransformId);
+    }
+  }
+}
+
+template <typename TImage>
+void TransformedPatchMatch<TImage>::TryCandidate(const itk::Index<2>& targetPixel, const itk::Index<2>& cacheCenter,
+                                                 const unsigned int transformId)
+{
+  if(!this->Cache.IsValid(cacheCenter, transformId))
+  {
+    return;
+  }
+
+  float score = this->Cache.Distance(cacheCenter, transformId, this->TargetPatch);
+
+  TransformedMatch& currentMatch = this->NNField->GetPixel(targetPixel);
+  if(!currentMatch.Valid || score < currentMatch.Score)
+  {
+    currentMatch.CacheCenter = cacheCenter;
+    currentMatch.TransformId = transformId;
+    currentMatch.Score = score;
+    currentMatch.Valid = true;
+  }
+}
+
+template <typename TImage>
+void TransformedPatchMatch<TImage>::GetNNField(NNFieldType* const nnField) const
+{
+  assert(nnField);
+
+  nnField->SetRegions(this->NNField->GetLargestPossibleRegion());
+  nnField->Allocate();
+  nnField->FillBuffer(Match());
+
+  itk::ImageRegion<2> sourceInternalRegion =
+      ITKHelpers::GetInternalRegion(this->SourceImage->GetLargestPossibleRegion(), this->PatchRadius);
+
+  itk::ImageRegionConstIteratorWithIndex<TransformedNNFieldType> nnFieldIterator(this->NNField,
+                                                                                this->NNField->GetLargestPossibleRegion());
+  while(!nnFieldIterator.IsAtEnd())
+  {
+    const TransformedMatch& transformedMatch = nnFieldIterator.Get();
+    if(transformedMatch.Valid)
+    {
+      // A scaled patch can be centered closer to the border than an untransformed one fits
+      itk::Index<2> sourceCenter = this->Cache.GetSourceCenter(transformedMatch.CacheCenter, transformedMatch.TransformId);
+      for(unsigned int dimension = 0; dimension < 2; ++dimension)
+      {
+        sourceCenter[dimension] = std::max(sourceCenter[dimension], sourceInternalRegion.GetIndex()[dimension]);
+        sourceCenter[dimension] = std::min(sourceCenter[dimension], sourceInternalRegion.GetIndex()[dimension] +
+                                           static_cast<itk::IndexValueType>(sourceInternalRegion.GetSize()[dimension]) - 1);
+      }
+
+      Match match;
+      match.SetRegion(ITKHelpers::GetRegionInRadiusAroundPixel(sourceCenter, this->PatchRadius));
+      match.SetScore(transformedMatch.Score);
+      nnField->SetPixel(nnFieldIterator.GetIndex(), match);
+    }
+
+    ++nnFieldIterator;
+  }
+}
+
+#endif
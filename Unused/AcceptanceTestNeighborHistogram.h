@@ -27,6 +27,7 @@
 
 // Custom
 #include "AcceptanceTest.h"
+#include "IntegralHistogram.h"
 #include "PatchMatchHelpers.h"
 
 // Submodules
@@ -37,7 +38,7 @@ template <typename TImage>
 class AcceptanceTestNeighborHistogramRatio : public AcceptanceTestImage<TImage>
 {
 public:
-  AcceptanceTestNeighborHistogramRatio() : AcceptanceTestImage<TImage>(), MaxNeighborHistogramRatio(2.0f), NumberOfBinsPerDimension(20)
+  AcceptanceTestNeighborHistogramRatio() : AcceptanceTestImage<TImage>(), MaxNeighborHistogramRatio(2.0f), NumberOfBinsPerDimension(20), IntegralHistogramCache(NULL)
   {
     this->RangeMin = itk::NumericTraits<typename TypeTraits<typename TImage::PixelType>::ComponentType>::min();
     this->RangeMax = itk::NumericTraits<typename TypeTraits<typename TImage::PixelType>::ComponentType>::max();
@@ -57,13 +58,10 @@ public:
     itk::Index<2> queryIndex = ITKHelpers::GetRegionCenter(queryRegion);
 
     typedef Histogram<int>::HistogramType HistogramType;
-    HistogramType queryHistogram = Histogram<int>::ComputeImageHistogram1D(
-                  this->Image, queryRegion, this->NumberOfBinsPerDimension, this->RangeMin, this->RangeMax);
+    HistogramType queryHistogram = ComputeHistogram(queryRegion);
 
     HistogramType potentialMatchHistogram =
-      Histogram<int>::ComputeImageHistogram1D(this->Image,
-                                              potentialBetterMatch.GetRegion(), this->NumberOfBinsPerDimension,
-                                              this->RangeMin, this->RangeMax);
+      ComputeHistogram(potentialBetterMatch.GetRegion());
 
     itk::Offset<2> randomNeighborOffset = PatchMatchHelpers::RandomNeighborNonZeroOffset();
 
@@ -71,8 +69,7 @@ public:
 
     itk::ImageRegion<2> neighborRegion =
       ITKHelpers::GetRegionInRadiusAroundPixel(neighbor, this->PatchRadius);
-    HistogramType neighborHistogram = Histogram<int>::ComputeImageHistogram1D(
-                  this->Image, neighborRegion, this->NumberOfBinsPerDimension, this->RangeMin, this->RangeMax);
+    HistogramType neighborHistogram = ComputeHistogram(neighborRegion);
 
     float neighborHistogramDifference =
       Histogram<int>::HistogramDifference(neighborHistogram, queryHistogram);
@@ -118,6 +115,12 @@ public:
     }
   }
 
+  /** Set the integral histogram of the image to read patch histograms from, or NULL to compute them from the image. */
+  void SetIntegralHistogram(const IntegralHistogram<TImage>* const integralHistogram)
+  {
+    this->IntegralHistogramCache = integralHistogram;
+  }
+
   void SetRangeMin(const typename TypeTraits<typename TImage::PixelType>::ComponentType rangeMin)
   {
     this->RangeMin = rangeMin;
@@ -155,6 +158,19 @@ private:
 
   /** The number of bins to use per image channel/dimension. */
   unsigned int NumberOfBinsPerDimension;
+
+  const IntegralHistogram<TImage>* IntegralHistogramCache;
+
+  Histogram<int>::HistogramType ComputeHistogram(const itk::ImageRegion<2>& region) const
+  {
+    if(this->IntegralHistogramCache)
+    {
+      return this->IntegralHistogramCache->GetHistogram(region);
+    }
+
+    return Histogram<int>::ComputeImageHistogram1D(this->Image, region, this->NumberOfBinsPerDimension,
+                                                   this->RangeMin, this->RangeMax);
+  }
 };
 
 #endif
@@ -21,6 +21,7 @@
 
 // Custom
 #include "Initializer.h"
+#include "IntegralHistogram.h"
 #include "PatchMatchHelpers.h"
 
 // ITK
@@ -35,7 +36,7 @@ template <typename TImage, typename TPatchDistanceFunctor>
 class InitializerNeighborHistogram : public InitializerPatch
 {
 public:
-  InitializerNeighborHistogram() : Image(NULL), NeighborHistogramMultiplier(2.0f), MaxAttempts(10), PatchDistanceFunctor(NULL), NumberOfBinsPerDimension(20)
+  InitializerNeighborHistogram() : Image(NULL), NeighborHistogramMultiplier(2.0f), MaxAttempts(10), PatchDistanceFunctor(NULL), NumberOfBinsPerDimension(20), IntegralHistogramCache(NULL)
   {
     this->RangeMin = itk::NumericTraits<typename TypeTraits<typename TImage::PixelType>::ComponentType>::min();
     this->RangeMax = itk::NumericTraits<typename TypeTraits<typename TImage::PixelType>::ComponentType>::max();
@@ -85,8 +86,7 @@ public:
       itk::Index<2> targetPixel = targetPixels[targetPixelId];
 
       typedef Histogram<int>::HistogramType HistogramType;
-      HistogramType queryHistogram = Histogram<int>::ComputeImageHistogram1D(this->Image,
-                                                                            targetRegion, this->NumberOfBinsPerDimension, this->RangeMin, this->RangeMax);
+      HistogramType queryHistogram = ComputeHistogram(targetRegion);
 
       float randomHistogramDifference;
       float neighborHistogramDifference;
@@ -100,16 +100,14 @@ public:
       {
         unsigned int randomSourceRegionId = Helpers::RandomInt(0, validSourceRegions.size() - 1);
         randomValidRegion = validSourceRegions[randomSourceRegionId];
-        randomPatchHistogram = Histogram<int>::ComputeImageHistogram1D(this->Image,
-                                                                      randomValidRegion, this->NumberOfBinsPerDimension, this->RangeMin, this->RangeMax);
+        randomPatchHistogram = ComputeHistogram(randomValidRegion);
 
         itk::Offset<2> randomNeighborOffset = PatchMatchHelpers::RandomNeighborNonZeroOffset();
 
         itk::Index<2> neighbor = targetPixel + randomNeighborOffset;
 
         itk::ImageRegion<2> neighborRegion = ITKHelpers::GetRegionInRadiusAroundPixel(neighbor, this->PatchRadius);
-        neighborPatchHistogram = Histogram<int>::ComputeImageHistogram1D(this->Image,
-                                                                        neighborRegion, this->NumberOfBinsPerDimension, this->RangeMin, this->RangeMax);
+        neighborPatchHistogram = ComputeHistogram(neighborRegion);
 
         randomHistogramDifference = Histogram<int>::HistogramDifference(queryHistogram, randomPatchHistogram);
 
@@ -157,6 +155,12 @@ public:
     //std::cout << "Finished InitializerNeighborHistogram." << internalRegion << std::endl;
   }
 
+  /** Set the integral histogram of the image to read patch histograms from, or NULL to compute them from the image. */
+  void SetIntegralHistogram(const IntegralHistogram<TImage>* const integralHistogram)
+  {
+    this->IntegralHistogramCache = integralHistogram;
+  }
+
   void SetRangeMin(const typename TypeTraits<typename TImage::PixelType>::ComponentType rangeMin)
   {
     this->RangeMin = rangeMin;
@@ -199,6 +203,19 @@ private:
   TPatchDistanceFunctor* PatchDistanceFunctor;
 
   unsigned int NumberOfBinsPerDimension;
+
+  const IntegralHistogram<TImage>* IntegralHistogramCache;
+
+  Histogram<int>::HistogramType ComputeHistogram(const itk::ImageRegion<2>& region) const
+  {
+    if(this->IntegralHistogramCache)
+    {
+      return this->IntegralHistogramCache->GetHistogram(region);
+    }
+
+    return Histogram<int>::ComputeImageHistogram1D(this->Image, region, this->NumberOfBinsPerDimension,
+                                                   this->RangeMin, this->RangeMax);
+  }
 };
 
 #endif